@@ -169,20 +169,18 @@ void *syncSubListenerThread(void *)
     rc = zmq_setsockopt(syncSubSubscriber, ZMQ_SUBSCRIBE, messageType, sizeof(messageType));
     assert(rc == 0);
 
-    char message[DEFAULT_MESSAGE_BUFFER_SIZE];
-	memset(message, 0, sizeof(message));
+    zmq_msg_t message;
+    zmq_msg_init(&message);
 
 
     while(1)
     {
-        rc = zmq_recv(syncSubSubscriber, message, sizeof(message), 0);
+        rc = zmq_msg_recv(&message, syncSubSubscriber, 0);
 //        assert(rc != -1);
 
 		// Deserialization
-		string s(message, rc);
-
 		SyncDataMessage deserialized;
-		if ( !deserialized.ParseFromString( s ) )
+		if ( !deserialized.ParseFromArray( zmq_msg_data(&message), rc ) )
 		{
 			cerr << "ERROR: Unable to deserialize!\n";
 		}
@@ -200,8 +198,6 @@ fflush(snifferOutFile);
         fprintf(snifferOutFile, "PARAMETER: %s\n", deserialized.parameter().c_str());
         fprintf(snifferOutFile, "BODY:      %s\n\n", deserialized.body().c_str());
 		fflush(snifferOutFile);
-
-        memset(message, 0, sizeof(message));
     }
 	pthread_exit(NULL);
 }
@@ -232,20 +228,18 @@ void *syncPubListenerThread(void *)
     rc = zmq_setsockopt(syncPubSubscriber, ZMQ_SUBSCRIBE, messageType, sizeof(messageType));
     assert(rc == 0);
 
-    char message[DEFAULT_MESSAGE_BUFFER_SIZE];
-	memset(message, 0, sizeof(message));
+    zmq_msg_t message;
+    zmq_msg_init(&message);
 
 
     while(1)
     {
-        rc = zmq_recv(syncPubSubscriber, message, sizeof(message), 0);
+        rc = zmq_msg_recv(&message, syncPubSubscriber, 0);
 //        assert(rc != -1);
 
 		// Deserialization
-		string s(message, rc);
-
 		SyncDataMessage deserialized;
-		if ( !deserialized.ParseFromString( s ) )
+		if ( !deserialized.ParseFromArray( zmq_msg_data(&message), rc ) )
 		{
 			cerr << "ERROR: Unable to deserialize!\n";
 		}
@@ -263,7 +257,6 @@ fflush(snifferOutFile);
         fprintf(snifferOutFile, "PARAMETER: %s\n", deserialized.parameter().c_str());
         fprintf(snifferOutFile, "BODY:      %s\n\n", deserialized.body().c_str());
 		fflush(snifferOutFile);
-        memset(message, 0, sizeof(message));
     }
 	pthread_exit(NULL);
 }
@@ -200,7 +200,8 @@ void *firmwareUpdateListenerThread(void *)
 	char ig1CommandReqSubPort[IP_STRING_SIZE];
 	char escapedFullFilePath[MAX_FILE_PATH];
 	int response = 0;
-    char message[FIRMWARE_UPDATE_BUFFER_SIZE];
+    zmq_msg_t message;
+    zmq_msg_init(&message);
 
 	sprintf(ig1CommandReqSubPort, "tcp://%s:%d", guiIPAddress1, FIRMWARE_UPDATE_PORT_GUI1);
     firmwareUpdateListener = zmq_socket(context, ZMQ_SUB);
@@ -213,17 +214,14 @@ void *firmwareUpdateListenerThread(void *)
 
     while(1)
     {
-		memset(message, 0, sizeof(message));
 		memset(escapedFullFilePath, 0, sizeof(escapedFullFilePath));
 		
-        rc = zmq_recv(firmwareUpdateListener, message, sizeof(message), 0);
+        rc = zmq_msg_recv(&message, firmwareUpdateListener, 0);
         assert(rc != -1);
 
 		// Deserialization
-		string s(message, rc);
-
 		FirmwareUpdate deserialized;
-		if ( !deserialized.ParseFromString( s ) )
+		if ( !deserialized.ParseFromArray( zmq_msg_data(&message), rc ) )
 		{
 			if (debugPrintf)
 			{
@@ -271,7 +269,8 @@ void *firmwareResponseListenerThread(void *)
 	char escapedFullFilePath[MAX_FILE_PATH];
 	int response = 0;
 	uint32_t sequenceNumber = 0;
-    char message[FIRMWARE_UPDATE_BUFFER_SIZE];
+    zmq_msg_t message;
+    zmq_msg_init(&message);
 
 	sprintf(ig1CommandRespPubPort, "tcp://%s:%d", controllerIPAddress, FIRMWARE_UPDATE_RESULT_PORT_CONTROLLER);
 
@@ -284,16 +283,13 @@ void *firmwareResponseListenerThread(void *)
 
     while(1)
     {
-		memset(message, 0, sizeof(message));
 		
-        rc = zmq_recv(firmwareResponseListener, message, sizeof(message), 0);
+        rc = zmq_msg_recv(&message, firmwareResponseListener, 0);
         assert(rc != -1);
 
 		// Deserialization
-		string s(message, rc);
-
 		FirmwareUpdateResult deserialized;
-		if ( !deserialized.ParseFromString( s ) )
+		if ( !deserialized.ParseFromArray( zmq_msg_data(&message), rc ) )
 		{
 			if (debugPrintf)
 			{
@@ -334,7 +330,8 @@ fflush(snifferOutFile);
 void *heartBeatListenerThread(void *)
 {
 	char messageType[] = { 10, 2, 'H', 'B' };
-    char message[DEFAULT_MESSAGE_BUFFER_SIZE];
+    zmq_msg_t message;
+    zmq_msg_init(&message);
 	char heartbeatPort[IP_STRING_SIZE];
 
     heartBeatListener = zmq_socket(context, ZMQ_SUB);
@@ -349,15 +346,12 @@ void *heartBeatListenerThread(void *)
 
     while(1)
     {
-		memset(message, 0, sizeof(message));
-        rc = zmq_recv(heartBeatListener, message, sizeof(message), 0);
+        rc = zmq_msg_recv(&message, heartBeatListener, 0);
         assert(rc != -1);
 
 		// Deserialization
-		string s(message, rc);
-
 		HeartBeat deserialized;
-		if ( !deserialized.ParseFromString( s ) )
+		if ( !deserialized.ParseFromArray( zmq_msg_data(&message), rc ) )
 		{
 			if (debugPrintf)
 			{
@@ -395,7 +389,8 @@ fflush(snifferOutFile);
 void *heartBeatListenerThread2(void *)
 {
 	char messageType[] = { 10, 2, 'H', 'B' };
-    char message[DEFAULT_MESSAGE_BUFFER_SIZE];
+    zmq_msg_t message;
+    zmq_msg_init(&message);
 	char heartbeatPort[IP_STRING_SIZE];
 
     heartBeatListener2 = zmq_socket(context, ZMQ_SUB);
@@ -410,15 +405,12 @@ void *heartBeatListenerThread2(void *)
 
     while(1)
     {
-		memset(message, 0, sizeof(message));
-        rc = zmq_recv(heartBeatListener2, message, sizeof(message), 0);
+        rc = zmq_msg_recv(&message, heartBeatListener2, 0);
         assert(rc != -1);
 
 		// Deserialization
-		string s(message, rc);
-
 		HeartBeat deserialized;
-		if ( !deserialized.ParseFromString( s ) )
+		if ( !deserialized.ParseFromArray( zmq_msg_data(&message), rc ) )
 		{
 			if (debugPrintf)
 			{
@@ -468,19 +460,17 @@ void *timeSyncSubscriberThread(void *)
     rc = zmq_setsockopt(timeSyncSubscriber, ZMQ_SUBSCRIBE, messageType, sizeof(messageType));
     assert(rc == 0);
 
-    char message[DEFAULT_MESSAGE_BUFFER_SIZE];
+    zmq_msg_t message;
+    zmq_msg_init(&message);
 
     while(1)
     {
-		memset(message, 0, sizeof(message));
-        rc = zmq_recv(timeSyncSubscriber, message, sizeof(message), 0);
+        rc = zmq_msg_recv(&message, timeSyncSubscriber, 0);
         assert(rc != -1);
 
 		// Deserialization
-		string s(message, rc);
-
 		TimeSync deserialized;
-		if ( !deserialized.ParseFromString( s ) )
+		if ( !deserialized.ParseFromArray( zmq_msg_data(&message), rc ) )
 		{
 			if (debugPrintf)
 			{
@@ -669,7 +659,8 @@ void *commandHandlerThread(void *)
 	char igCommandReqSubPort[IP_STRING_SIZE];
 	int response = 0;
 	uint32_t sequenceNumber = 0;
-    char message[DEFAULT_MESSAGE_BUFFER_SIZE];
+    zmq_msg_t message;
+    zmq_msg_init(&message);
 	uhc::SystemCommandResponses ret = SYSTEM_COMMAND_RESPONSE_OK;
 	char commandRespPubPort[IP_STRING_SIZE];
 
@@ -687,17 +678,14 @@ fflush(snifferOutFile);
 
     while(1)
     {
-		memset(message, 0, sizeof(message));
 		ret = SYSTEM_COMMAND_RESPONSE_OK;
 		
-        rc = zmq_recv(commandListener, message, sizeof(message), 0);
+        rc = zmq_msg_recv(&message, commandListener, 0);
         assert(rc != -1);
 
 		// Deserialization
-		string s(message, rc);
-
 		SystemCommand deserialized;
-		if ( !deserialized.ParseFromString( s ) )
+		if ( !deserialized.ParseFromArray( zmq_msg_data(&message), rc ) )
 		{
 			if (debugPrintf)
 			{
@@ -742,7 +730,8 @@ void *commandHandlerThread2(void *)
 	char igCommandReqSubPort[IP_STRING_SIZE];
 	int response = 0;
 	uint32_t sequenceNumber = 0;
-    char message[DEFAULT_MESSAGE_BUFFER_SIZE];
+    zmq_msg_t message;
+    zmq_msg_init(&message);
 	uhc::SystemCommandResponses ret = SYSTEM_COMMAND_RESPONSE_OK;
 	char commandRespPubPort[IP_STRING_SIZE];
 
@@ -760,17 +749,14 @@ fflush(snifferOutFile);
 
     while(1)
     {
-		memset(message, 0, sizeof(message));
 		ret = SYSTEM_COMMAND_RESPONSE_OK;
 		
-        rc = zmq_recv(commandListener2, message, sizeof(message), 0);
+        rc = zmq_msg_recv(&message, commandListener2, 0);
         assert(rc != -1);
 
 		// Deserialization
-		string s(message, rc);
-
 		SystemCommand deserialized;
-		if ( !deserialized.ParseFromString( s ) )
+		if ( !deserialized.ParseFromArray( zmq_msg_data(&message), rc ) )
 		{
 			if (debugPrintf)
 			{
@@ -813,7 +799,8 @@ void *commandResponseListenerThread(void *)
 	char igCommandReqSubPort[IP_STRING_SIZE];
 	int response = 0;
 	uint32_t sequenceNumber = 0;
-    char message[DEFAULT_MESSAGE_BUFFER_SIZE];
+    zmq_msg_t message;
+    zmq_msg_init(&message);
 	uhc::SystemCommandResponses ret = SYSTEM_COMMAND_RESPONSE_OK;
 	char commandRespPubPort[IP_STRING_SIZE];
 
@@ -831,17 +818,14 @@ fflush(snifferOutFile);
 
     while(1)
     {
-		memset(message, 0, sizeof(message));
 		ret = SYSTEM_COMMAND_RESPONSE_OK;
 		
-        rc = zmq_recv(commandResponseListener, message, sizeof(message), 0);
+        rc = zmq_msg_recv(&message, commandResponseListener, 0);
         assert(rc != -1);
 
 		// Deserialization
-		string s(message, rc);
-
 		SystemCommandResponse deserialized;
-		if ( !deserialized.ParseFromString( s ) )
+		if ( !deserialized.ParseFromArray( zmq_msg_data(&message), rc ) )
 		{
 			if (debugPrintf)
 			{
@@ -886,7 +870,8 @@ void *commandResponseListenerThread2(void *)
 	char igCommandReqSubPort[IP_STRING_SIZE];
 	int response = 0;
 	uint32_t sequenceNumber = 0;
-    char message[DEFAULT_MESSAGE_BUFFER_SIZE];
+    zmq_msg_t message;
+    zmq_msg_init(&message);
 	uhc::SystemCommandResponses ret = SYSTEM_COMMAND_RESPONSE_OK;
 	char commandRespPubPort[IP_STRING_SIZE];
 
@@ -904,17 +889,14 @@ fflush(snifferOutFile);
 
     while(1)
     {
-		memset(message, 0, sizeof(message));
 		ret = SYSTEM_COMMAND_RESPONSE_OK;
 		
-        rc = zmq_recv(commandResponseListener2, message, sizeof(message), 0);
+        rc = zmq_msg_recv(&message, commandResponseListener2, 0);
         assert(rc != -1);
 
 		// Deserialization
-		string s(message, rc);
-
 		SystemCommandResponse deserialized;
-		if ( !deserialized.ParseFromString( s ) )
+		if ( !deserialized.ParseFromArray( zmq_msg_data(&message), rc ) )
 		{
 			if (debugPrintf)
 			{
@@ -981,20 +963,18 @@ void *statusListenerThread(void *)
     rc = zmq_setsockopt(subscriber, ZMQ_SUBSCRIBE, messageType, sizeof(messageType));
     assert(rc == 0);
 
-    char message[DEFAULT_MESSAGE_BUFFER_SIZE];
-	memset(message, 0, sizeof(message));
+    zmq_msg_t message;
+    zmq_msg_init(&message);
 
 
     while(1)
     {
-        rc = zmq_recv(subscriber, message, sizeof(message), 0);
+        rc = zmq_msg_recv(&message, subscriber, 0);
 //        assert(rc != -1);
 
 		// Deserialization
-		string s(message, rc);
-
 		CurrentSystemState deserialized;
-		if ( !deserialized.ParseFromString( s ) )
+		if ( !deserialized.ParseFromArray( zmq_msg_data(&message), rc ) )
 		{
 			cerr << "ERROR: Unable to deserialize!\n";
 		}
@@ -1098,7 +1078,6 @@ fflush(snifferOutFile);
 			cout << "         firmware version: " << deserialized.firmware_version() << "\n";
 		}
 #endif		
-        memset(message, 0, sizeof(message));
     }
 	pthread_exit(NULL);
 }
@@ -0,0 +1,299 @@
+/******************************************************************************/
+/*                                                                            */
+/* FILE:        cmdLatency.cpp                                                */
+/*                                                                            */
+/* DESCRIPTION: Measures the SystemCommand round trip latency of the          */
+/*              HennyPenny Frontier UHC over the PUB/SUB command ports and    */
+/*              over the request/reply command router                         */
+/*                                                                            */
+/* AUTHOR(S):   USA Firmware, LLC                                             */
+/*                                                                            */
+/* This is an unpublished work subject to Trade Secret and Copyright          */
+/* protection by HennyPenny and USA Firmware, LLC                             */
+/*                                                                            */
+/* USA Firmware, LLC                                                          */
+/* 10060 Brecksville Road Brecksville, OH 44141                               */
+/*                                                                            */
+/******************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <assert.h>
+#include <time.h>
+#include <algorithm>
+#include <vector>
+#include <google/protobuf/util/time_util.h>
+#include <zmq.h>
+
+#include "frontier_uhc.h"
+#include "uhc.pb.h"
+#include "uhc_proto.h"
+
+using namespace uhc;
+using namespace std;
+
+#define DEFAULT_COMMAND_COUNT      200
+#define RESPONSE_TIMEOUT_MS        1000
+#define COMMAND_BUFFER_SIZE        256
+
+void *context;
+char controllerIPAddress[32];
+char myIPAddress[32];
+uint32_t sequenceNumber = 0;
+
+
+/*******************************************************************************************/
+/*                                                                                         */
+/* double elapsedMicroseconds(const struct timespec *start, const struct timespec *end)    */
+/*                                                                                         */
+/* Returns: double microseconds from start to end                                          */
+/*                                                                                         */
+/*******************************************************************************************/
+double elapsedMicroseconds(const struct timespec *start, const struct timespec *end)
+{
+   return ((double)(end->tv_sec - start->tv_sec) * 1000000.0) + ((double)(end->tv_nsec - start->tv_nsec) / 1000.0);
+}
+
+
+/*******************************************************************************************/
+/*                                                                                         */
+/* void printPercentiles(const char *name, vector<double> &samples, int lost)              */
+/*                                                                                         */
+/* Prints the 50th, 90th and 99th percentile and maximum of the round trip times.          */
+/*                                                                                         */
+/* Returns: None                                                                           */
+/*                                                                                         */
+/*******************************************************************************************/
+void printPercentiles(const char *name, vector<double> &samples, int lost)
+{
+   if (samples.empty())
+   {
+      printf("%-24s no responses, %d lost\n", name, lost);
+      return;
+   }
+
+   sort(samples.begin(), samples.end());
+   size_t n = samples.size();
+   printf("%-24s %4u responses %3d lost  p50 %8.0f us  p90 %8.0f us  p99 %8.0f us  max %8.0f us\n",
+          name, (unsigned)n, lost, samples[(n - 1) * 50 / 100], samples[(n - 1) * 90 / 100],
+          samples[(n - 1) * 99 / 100], samples[n - 1]);
+}
+
+
+/*******************************************************************************************/
+/*                                                                                         */
+/* int buildCommand(uint64_t correlationId, char *bytes, size_t size)                      */
+/*                                                                                         */
+/* Serializes a SYSTEM_COMMAND_ESTABLISH_LINK command, which changes nothing on the        */
+/* controller, with the next sequence number.                                              */
+/*                                                                                         */
+/* Returns: int length of the serialized command                                           */
+/*                                                                                         */
+/*******************************************************************************************/
+int buildCommand(uint64_t correlationId, char *bytes, size_t size)
+{
+   SystemCommand sc;
+   sc.set_topic(SYSTEM_COMMAND_TOPIC);
+   sc.set_sender_ip_address(myIPAddress);
+   sc.set_sequence_number(sequenceNumber++);
+   sc.set_command(SYSTEM_COMMAND_ESTABLISH_LINK);
+   sc.set_correlation_id(correlationId);
+
+   int length = (int)sc.ByteSizeLong();
+   assert((size_t)length <= size);
+   if (!sc.SerializeToArray(bytes, length))
+   {
+      fprintf(stderr, "ERROR: Unable to serialize!\n");
+      exit(-1);
+   }
+   return length;
+}
+
+
+/*******************************************************************************************/
+/*                                                                                         */
+/* void benchmarkPubSub(int count)                                                         */
+/*                                                                                         */
+/* Sends the commands one at a time on the GUI1 command port and waits for each response   */
+/* on the GUI1 response port. This PC must have the GUI1 IP address the controller was     */
+/* started with.                                                                           */
+/*                                                                                         */
+/* Returns: None                                                                           */
+/*                                                                                         */
+/*******************************************************************************************/
+void benchmarkPubSub(int count)
+{
+   char port[64];
+   char bytes[COMMAND_BUFFER_SIZE];
+   char response[COMMAND_BUFFER_SIZE];
+   vector<double> samples;
+   int lost = 0;
+
+   void *publisher = zmq_socket(context, ZMQ_PUB);
+   (void)snprintf(port, sizeof(port), "tcp://%s:%d", myIPAddress, SYSTEM_COMMAND_PORT_GUI1);
+   int rc = zmq_bind(publisher, port);
+   assert(rc == 0);
+
+   void *subscriber = zmq_socket(context, ZMQ_SUB);
+   char messageType[] = { 10, 3, 'R', 'S', 'P' };
+   rc = zmq_setsockopt(subscriber, ZMQ_SUBSCRIBE, messageType, sizeof(messageType));
+   assert(rc == 0);
+   int timeout = RESPONSE_TIMEOUT_MS;
+   rc = zmq_setsockopt(subscriber, ZMQ_RCVTIMEO, &timeout, sizeof(timeout));
+   assert(rc == 0);
+   (void)snprintf(port, sizeof(port), "tcp://%s:%d", controllerIPAddress, SYSTEM_COMMAND_RESPONSE_PORT_CONTROLLER);
+   rc = zmq_connect(subscriber, port);
+   assert(rc == 0);
+
+   // give the controller time to connect and the subscription time to arrive
+   sleep(2);
+
+   for (int i = 0; i < count; i++)
+   {
+      struct timespec start, end;
+      int length = buildCommand(0, bytes, sizeof(bytes));
+      clock_gettime(CLOCK_MONOTONIC, &start);
+      (void)zmq_send(publisher, bytes, length, 0);
+
+      // responses to other panels come out on the same port
+      bool answered = false;
+      while (!answered)
+      {
+         rc = zmq_recv(subscriber, response, sizeof(response), 0);
+         if (rc == -1)
+         {
+            break;
+         }
+         SystemCommandResponse cr;
+         answered = cr.ParseFromArray(response, min(rc, (int)sizeof(response))) &&
+                    (cr.requester_ip_address() == myIPAddress);
+      }
+
+      clock_gettime(CLOCK_MONOTONIC, &end);
+      if (answered)
+      {
+         samples.push_back(elapsedMicroseconds(&start, &end));
+      }
+      else
+      {
+         lost++;
+      }
+   }
+
+   printPercentiles("PUB/SUB", samples, lost);
+   zmq_close(publisher);
+   zmq_close(subscriber);
+}
+
+
+/*******************************************************************************************/
+/*                                                                                         */
+/* void benchmarkRouter(int count, bool pipelined)                                         */
+/*                                                                                         */
+/* Sends the commands to the command router from a ZMQ_DEALER, either one at a time or     */
+/* all at once before reading any response, and matches the responses by correlation ID.   */
+/* Finally resends the last command to check it is answered from the controller's cache.   */
+/*                                                                                         */
+/* Returns: None                                                                           */
+/*                                                                                         */
+/*******************************************************************************************/
+void benchmarkRouter(int count, bool pipelined)
+{
+   char port[64];
+   char bytes[COMMAND_BUFFER_SIZE];
+   char response[COMMAND_BUFFER_SIZE];
+   vector<struct timespec> sent(count);
+   vector<double> samples;
+   int lastLength = 0;
+   uint32_t lastResponseSequence = 0;
+
+   void *dealer = zmq_socket(context, ZMQ_DEALER);
+   int timeout = RESPONSE_TIMEOUT_MS;
+   int rc = zmq_setsockopt(dealer, ZMQ_RCVTIMEO, &timeout, sizeof(timeout));
+   assert(rc == 0);
+   (void)snprintf(port, sizeof(port), "tcp://%s:%d", controllerIPAddress, SYSTEM_COMMAND_ROUTER_PORT_CONTROLLER);
+   rc = zmq_connect(dealer, port);
+   assert(rc == 0);
+
+   int sentCount = 0;
+   int receivedCount = 0;
+   while (receivedCount < count)
+   {
+      // keep every command outstanding when pipelining, otherwise just one
+      while ((sentCount < count) && (pipelined || (sentCount == receivedCount)))
+      {
+         lastLength = buildCommand((uint64_t)sentCount, bytes, sizeof(bytes));
+         clock_gettime(CLOCK_MONOTONIC, &sent[sentCount]);
+         (void)zmq_send(dealer, bytes, lastLength, 0);
+         sentCount++;
+      }
+
+      rc = zmq_recv(dealer, response, sizeof(response), 0);
+      if (rc == -1)
+      {
+         break;
+      }
+
+      struct timespec end;
+      clock_gettime(CLOCK_MONOTONIC, &end);
+      SystemCommandResponse cr;
+      if (cr.ParseFromArray(response, min(rc, (int)sizeof(response))) && (cr.correlation_id() < (uint64_t)count))
+      {
+         samples.push_back(elapsedMicroseconds(&sent[cr.correlation_id()], &end));
+         lastResponseSequence = cr.sequence_number();
+      }
+      receivedCount++;
+   }
+
+   printPercentiles(pipelined ? "ROUTER/DEALER pipelined" : "ROUTER/DEALER", samples, count - (int)samples.size());
+
+   // the resent command must come back with the response the controller already sent
+   (void)zmq_send(dealer, bytes, lastLength, 0);
+   rc = zmq_recv(dealer, response, sizeof(response), 0);
+   SystemCommandResponse cr;
+   bool cached = (rc != -1) && cr.ParseFromArray(response, min(rc, (int)sizeof(response))) &&
+                 (cr.sequence_number() == lastResponseSequence);
+   printf("%-24s resent command answered from the cache: %s\n", "", cached ? "yes" : "NO");
+
+   zmq_close(dealer);
+}
+
+
+int main(int argc, char *argv[])
+{
+   int count = DEFAULT_COMMAND_COUNT;
+
+   memset(controllerIPAddress, 0, sizeof(controllerIPAddress));
+   memset(myIPAddress, 0, sizeof(myIPAddress));
+   if ((3 == argc) || (4 == argc))
+   {
+      strncpy(controllerIPAddress, argv[1], sizeof(controllerIPAddress) - 1);
+      strncpy(myIPAddress, argv[2], sizeof(myIPAddress) - 1);
+      if (4 == argc)
+      {
+         count = atoi(argv[3]);
+      }
+   }
+   else
+   {
+      printf("Usage cmdLatency <controllerIPAddress> <ThisPCsIPAddress> [<count>]\n");
+      exit(-1);
+   }
+
+   // the controller only runs a command once per sequence number, so don't reuse them
+   sequenceNumber = (uint32_t)time(NULL) << 8;
+
+   context = zmq_ctx_new();
+   assert(context != NULL);
+
+   printf("%d ESTABLISH_LINK commands to %s\n", count, controllerIPAddress);
+   benchmarkPubSub(count);
+   benchmarkRouter(count, false);
+   benchmarkRouter(count, true);
+
+   zmq_ctx_destroy(context);
+   return 0;
+}
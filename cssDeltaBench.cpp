@@ -0,0 +1,449 @@
+/******************************************************************************/
+/*                                                                            */
+/* FILE:        cssDeltaBench.cpp                                             */
+/*                                                                            */
+/* DESCRIPTION: Compares the size and encode time of the full HennyPenny      */
+/*              Frontier UHC CurrentSystemState with the                      */
+/*              CurrentSystemStateDelta published in its place                */
+/*                                                                            */
+/* AUTHOR(S):   USA Firmware, LLC                                             */
+/*                                                                            */
+/* This is an unpublished work subject to Trade Secret and Copyright          */
+/* protection by HennyPenny and USA Firmware, LLC                             */
+/*                                                                            */
+/* USA Firmware, LLC                                                          */
+/* 10060 Brecksville Road Brecksville, OH 44141                               */
+/*                                                                            */
+/******************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <algorithm>
+#include <vector>
+
+#include "uhc.pb.h"
+#include "uhc_proto.h"
+
+using namespace uhc;
+using namespace std;
+using google::protobuf::Arena;
+
+#define DEFAULT_SECONDS            3600     // an hour of publishes, one a second
+#define DEFAULT_CHANGE_PERCENT     10       // chance each second that a heater's reading moves
+#define TOTAL_SLOTS                6
+#define HEATERS_PER_SLOT           2
+#define MESSAGE_BUFFER_SIZE        4096     // DEFAULT_CSS_MESSAGE_BUFFER_SIZE
+#define SLOT_BUFFER_SIZE           512      // CSS_SLOT_BUFFER_SIZE
+#define DELTA_ARENA_BLOCK_SIZE     4096
+#define RANDOM_SEED                1
+
+struct BENCH_RESULT
+{
+   vector<double> encodeMicroseconds;
+   uint64_t bytes;
+};
+
+// the parts of the last message, serialized, to find what changed the way the controller does
+struct LAST_PARTS
+{
+   char systemData[MESSAGE_BUFFER_SIZE];
+   size_t systemDataLength;
+   char slotData[TOTAL_SLOTS][SLOT_BUFFER_SIZE];
+   size_t slotDataLength[TOTAL_SLOTS];
+};
+
+
+/*******************************************************************************************/
+/*                                                                                         */
+/* double nowMicroseconds()                                                                */
+/*                                                                                         */
+/* Returns: double CLOCK_MONOTONIC in microseconds                                         */
+/*                                                                                         */
+/*******************************************************************************************/
+double nowMicroseconds()
+{
+   struct timespec ts;
+   (void)clock_gettime(CLOCK_MONOTONIC, &ts);
+   return ((double)ts.tv_sec * 1000000.0) + ((double)ts.tv_nsec / 1000.0);
+}
+
+
+/*******************************************************************************************/
+/*                                                                                         */
+/* void fillHeater(HeaterData *heater, HeaterLocation location)                            */
+/*                                                                                         */
+/* Fills in a heater holding its setpoint, as publishSystemState would.                    */
+/*                                                                                         */
+/* Returns: None                                                                           */
+/*                                                                                         */
+/*******************************************************************************************/
+void fillHeater(HeaterData *heater, HeaterLocation location)
+{
+   heater->set_state(HEATER_STATE_ON);
+   heater->set_location(location);
+   heater->set_thermistor_temp(175);
+   heater->set_setpoint_temp(175);
+   heater->set_led_state(LED_STATE_GREEN);
+   heater->mutable_start_time()->set_seconds(1767261600);
+   heater->mutable_end_time()->set_seconds(0);
+   heater->set_is_enabled(true);
+}
+
+
+/*******************************************************************************************/
+/*                                                                                         */
+/* void fillSystemState(CurrentSystemState &s)                                             */
+/*                                                                                         */
+/* Fills in a CurrentSystemState like the controller's with every shelf heating.           */
+/*                                                                                         */
+/* Returns: None                                                                           */
+/*                                                                                         */
+/*******************************************************************************************/
+void fillSystemState(CurrentSystemState &s)
+{
+   s.set_topic(CURRENT_SYSTEM_STATE_TOPIC);
+   s.set_serial_number("HP0123456789");
+   s.set_model_number("UHC-HD-6");
+   s.set_firmware_version("1.0.0");
+   s.set_hardware_revision(3);
+
+   CurrentSystemState::SystemData *systemData = s.mutable_system_data();
+   systemData->mutable_current_time()->set_seconds(1767261600);
+   systemData->mutable_system_up_time()->set_seconds(1767258000);
+   systemData->mutable_last_time_intelligent_glass_1_heard()->set_seconds(1767261600);
+   systemData->mutable_last_time_intelligent_glass_2_heard()->set_seconds(1767261600);
+   systemData->set_heatsink_temp(45);
+   systemData->set_fan_state1(FAN_STATE_ON);
+   systemData->set_fan_state2(FAN_STATE_ON);
+   systemData->set_current_power_consumption(1450.0f);
+   systemData->set_system_status(SYSTEM_STATUS_NORMAL);
+   systemData->set_controller_ip_address("192.168.1.200");
+   systemData->set_intelligent_glass_1_ip_address("192.168.1.201");
+   systemData->set_intelligent_glass_2_ip_address("192.168.1.202");
+   systemData->set_configured_eco_mode_temp(150);
+   systemData->set_configured_eco_mode_minutes(30);
+   systemData->set_eco_mode_state(ECO_MODE_OFF);
+   systemData->set_last_command_received(9);
+   systemData->set_last_command_ip_address("192.168.1.201");
+   systemData->set_ambient_temp(25);
+   systemData->set_logging_period_seconds(3);
+
+   for (int i = 0; i < TOTAL_SLOTS; i++)
+   {
+      SlotData *slotData = s.add_slot_data();
+      slotData->set_slot_number((SlotNumber)(i + 1));
+      fillHeater(slotData->mutable_heater_location_upper(), HEATER_LOCATION_UPPER);
+      fillHeater(slotData->mutable_heater_location_lower(), HEATER_LOCATION_LOWER);
+   }
+}
+
+
+/*******************************************************************************************/
+/*                                                                                         */
+/* void advanceSystemState(CurrentSystemState &s, int changePercent, unsigned int *seed)   */
+/*                                                                                         */
+/* Moves the state on a second: the clocks tick, and each heater reading, the heatsink and */
+/* the power each move a degree with a chance of changePercent. Now and then a heater      */
+/* cycles off, which puts its fields back at their defaults.                               */
+/*                                                                                         */
+/* Returns: None                                                                           */
+/*                                                                                         */
+/*******************************************************************************************/
+void advanceSystemState(CurrentSystemState &s, int changePercent, unsigned int *seed)
+{
+   CurrentSystemState::SystemData *systemData = s.mutable_system_data();
+   systemData->mutable_current_time()->set_seconds(systemData->current_time().seconds() + 1);
+   systemData->mutable_last_time_intelligent_glass_1_heard()->set_seconds(systemData->current_time().seconds());
+   systemData->mutable_last_time_intelligent_glass_2_heard()->set_seconds(systemData->current_time().seconds());
+   s.set_sequence_number(s.sequence_number() + 1);
+
+   if ((int)(rand_r(seed) % 100) < changePercent)
+   {
+      systemData->set_heatsink_temp(44 + (int)(rand_r(seed) % 3));
+   }
+   if ((int)(rand_r(seed) % 100) < changePercent)
+   {
+      systemData->set_current_power_consumption(1400.0f + (float)(rand_r(seed) % 100));
+   }
+
+   for (int i = 0; i < TOTAL_SLOTS; i++)
+   {
+      SlotData *slotData = s.mutable_slot_data(i);
+      HeaterData *heaters[HEATERS_PER_SLOT] = { slotData->mutable_heater_location_upper(), slotData->mutable_heater_location_lower() };
+      for (int h = 0; h < HEATERS_PER_SLOT; h++)
+      {
+         if ((int)(rand_r(seed) % 100) < changePercent)
+         {
+            heaters[h]->set_thermistor_temp(heaters[h]->setpoint_temp() - 1 + (int)(rand_r(seed) % 3));
+         }
+         if (0 == (rand_r(seed) % 600))
+         {
+            // switched off at the glass: back to defaults, which proto3 leaves out
+            heaters[h]->set_state(HEATER_STATE_OFF);
+            heaters[h]->set_led_state(LED_STATE_OFF);
+            heaters[h]->set_setpoint_temp(0);
+            heaters[h]->set_is_enabled(false);
+         }
+         else if ((HEATER_STATE_OFF == heaters[h]->state()) && (0 == (rand_r(seed) % 60)))
+         {
+            fillHeater(heaters[h], heaters[h]->location());
+         }
+      }
+   }
+}
+
+
+/*******************************************************************************************/
+/*                                                                                         */
+/* bool partChanged(const google::protobuf::MessageLite &part, char *last,                 */
+/*                  size_t lastSize, size_t *lastLength)                                   */
+/*                                                                                         */
+/* messagePartChanged from frontier_uhc.cpp: serializes part and compares the bytes with   */
+/* the last ones, then keeps the new bytes for the next comparison.                        */
+/*                                                                                         */
+/* Returns: bool true if part changed or is too big to compare                             */
+/*                                                                                         */
+/*******************************************************************************************/
+bool partChanged(const google::protobuf::MessageLite &part, char *last, size_t lastSize, size_t *lastLength)
+{
+   char current[MESSAGE_BUFFER_SIZE];
+   size_t length = part.ByteSizeLong();
+
+   if ((length > sizeof(current)) || (length > lastSize) || !part.SerializeToArray(current, (int)length))
+   {
+      *lastLength = 0;
+      return true;
+   }
+
+   bool changed = (length != *lastLength) || (memcmp(current, last, length) != 0);
+   (void)memcpy(last, current, length);
+   *lastLength = length;
+
+   return changed;
+}
+
+
+/*******************************************************************************************/
+/*                                                                                         */
+/* size_t encodeDelta(CurrentSystemState &s, LAST_PARTS *last, Arena *arena, char *buffer, */
+/*                    size_t bufferSize)                                                   */
+/*                                                                                         */
+/* Finds what changed since the last message and builds and serializes the delta, as       */
+/* findSystemStateChanges and serializeSystemStateDelta do.                                */
+/*                                                                                         */
+/* Returns: size_t bytes serialized into buffer, 0 on failure                              */
+/*                                                                                         */
+/*******************************************************************************************/
+size_t encodeDelta(CurrentSystemState &s, LAST_PARTS *last, Arena *arena, char *buffer, size_t bufferSize)
+{
+   CurrentSystemState::SystemData *systemData = s.mutable_system_data();
+   google::protobuf::Timestamp savedClocks[4] =
+   {
+      systemData->current_time(), systemData->system_up_time(),
+      systemData->last_time_intelligent_glass_1_heard(), systemData->last_time_intelligent_glass_2_heard()
+   };
+
+   // the clocks go in every delta, so leave them out of the comparison
+   systemData->clear_current_time();
+   systemData->clear_system_up_time();
+   systemData->clear_last_time_intelligent_glass_1_heard();
+   systemData->clear_last_time_intelligent_glass_2_heard();
+   bool systemDataChanged = partChanged(*systemData, last->systemData, sizeof(last->systemData), &last->systemDataLength);
+
+   CurrentSystemStateDelta *delta = Arena::CreateMessage<CurrentSystemStateDelta>(arena);
+   delta->set_topic(CURRENT_SYSTEM_STATE_DELTA_TOPIC);
+   delta->set_sequence_number(s.sequence_number());
+   delta->set_base_sequence_number(s.sequence_number() - 1);
+   *delta->mutable_current_time() = savedClocks[0];
+   *delta->mutable_system_up_time() = savedClocks[1];
+   *delta->mutable_last_time_intelligent_glass_1_heard() = savedClocks[2];
+   *delta->mutable_last_time_intelligent_glass_2_heard() = savedClocks[3];
+   if (systemDataChanged)
+   {
+      *delta->mutable_system_data() = *systemData;
+   }
+
+   *systemData->mutable_current_time() = savedClocks[0];
+   *systemData->mutable_system_up_time() = savedClocks[1];
+   *systemData->mutable_last_time_intelligent_glass_1_heard() = savedClocks[2];
+   *systemData->mutable_last_time_intelligent_glass_2_heard() = savedClocks[3];
+
+   for (int i = 0; i < TOTAL_SLOTS; i++)
+   {
+      if (partChanged(s.slot_data(i), last->slotData[i], sizeof(last->slotData[i]), &last->slotDataLength[i]))
+      {
+         *delta->add_slot_data() = s.slot_data(i);
+      }
+   }
+
+   size_t length = delta->ByteSizeLong();
+   bool serialized = (length <= bufferSize) && delta->SerializeToArray(buffer, (int)length);
+   arena->Reset();
+
+   return serialized ? length : 0;
+}
+
+
+/*******************************************************************************************/
+/*                                                                                         */
+/* bool applyDelta(CurrentSystemState &cached, const char *bytes, size_t length)           */
+/*                                                                                         */
+/* Applies a delta the way a GUI must: the clocks from the delta's own fields, and each    */
+/* system_data or slot_data present replacing the cached one whole, not merged into it.    */
+/*                                                                                         */
+/* Returns: bool true if the delta parsed and follows on from cached                       */
+/*                                                                                         */
+/*******************************************************************************************/
+bool applyDelta(CurrentSystemState &cached, const char *bytes, size_t length)
+{
+   CurrentSystemStateDelta delta;
+   if (!delta.ParseFromArray(bytes, (int)length) || (delta.base_sequence_number() != cached.sequence_number()))
+   {
+      return false;
+   }
+
+   cached.set_sequence_number(delta.sequence_number());
+   CurrentSystemState::SystemData *systemData = cached.mutable_system_data();
+   if (delta.has_system_data())
+   {
+      *systemData = delta.system_data();
+   }
+   *systemData->mutable_current_time() = delta.current_time();
+   *systemData->mutable_system_up_time() = delta.system_up_time();
+   *systemData->mutable_last_time_intelligent_glass_1_heard() = delta.last_time_intelligent_glass_1_heard();
+   *systemData->mutable_last_time_intelligent_glass_2_heard() = delta.last_time_intelligent_glass_2_heard();
+
+   for (int i = 0; i < delta.slot_data_size(); i++)
+   {
+      for (int j = 0; j < cached.slot_data_size(); j++)
+      {
+         if (cached.slot_data(j).slot_number() == delta.slot_data(i).slot_number())
+         {
+            *cached.mutable_slot_data(j) = delta.slot_data(i);
+         }
+      }
+   }
+
+   return true;
+}
+
+
+/*******************************************************************************************/
+/*                                                                                         */
+/* void printResult(const char *name, BENCH_RESULT *result, int count)                     */
+/*                                                                                         */
+/* Prints the average message size and the encode time percentiles.                        */
+/*                                                                                         */
+/* Returns: None                                                                           */
+/*                                                                                         */
+/*******************************************************************************************/
+void printResult(const char *name, BENCH_RESULT *result, int count)
+{
+   vector<double> &samples = result->encodeMicroseconds;
+   sort(samples.begin(), samples.end());
+   size_t n = samples.size();
+   double total = 0.0;
+   for (size_t i = 0; i < n; i++)
+   {
+      total += samples[i];
+   }
+
+   printf("%-8s %7.1f bytes/message  %9.1f KB total  encode p50 %6.1f us  p99 %6.1f us  max %7.1f us  total %7.1f ms\n",
+          name, (double)result->bytes / (double)count, (double)result->bytes / 1024.0,
+          samples[(n - 1) * 50 / 100], samples[(n - 1) * 99 / 100], samples[n - 1], total / 1000.0);
+}
+
+
+int main(int argc, char *argv[])
+{
+   int count = DEFAULT_SECONDS;
+   int changePercent = DEFAULT_CHANGE_PERCENT;
+   unsigned int seed = RANDOM_SEED;
+   static char buffer[MESSAGE_BUFFER_SIZE];
+   static char arenaBlock[DELTA_ARENA_BLOCK_SIZE];
+   static LAST_PARTS last;
+   BENCH_RESULT full;
+   BENCH_RESULT delta;
+   int mismatches = 0;
+
+   GOOGLE_PROTOBUF_VERIFY_VERSION;
+
+   if (argc > 3)
+   {
+      printf("Usage cssDeltaBench [<seconds> [<changePercent>]]\n");
+      printf("      e.g. cssDeltaBench 3600 10\n");
+      exit(1);
+   }
+   if (argc > 1)
+   {
+      count = atoi(argv[1]);
+   }
+   if (argc > 2)
+   {
+      changePercent = atoi(argv[2]);
+   }
+   if ((count < 1) || (changePercent < 0) || (changePercent > 100))
+   {
+      printf("seconds must be at least 1 and changePercent 0 to 100\n");
+      exit(1);
+   }
+
+   google::protobuf::ArenaOptions options;
+   options.initial_block = arenaBlock;
+   options.initial_block_size = sizeof(arenaBlock);
+   Arena arena(options);
+
+   CurrentSystemState s;
+   CurrentSystemState cached;
+   fillSystemState(s);
+   full.bytes = 0;
+   delta.bytes = 0;
+
+   // the first message is the keyframe the GUI starts from
+   (void)encodeDelta(s, &last, &arena, buffer, sizeof(buffer));
+   cached = s;
+
+   for (int i = 0; i < count; i++)
+   {
+      advanceSystemState(s, changePercent, &seed);
+
+      double start = nowMicroseconds();
+      size_t length = s.ByteSizeLong();
+      bool serialized = (length <= sizeof(buffer)) && s.SerializeToArray(buffer, (int)length);
+      full.encodeMicroseconds.push_back(nowMicroseconds() - start);
+      if (!serialized)
+      {
+         printf("CurrentSystemState of %u bytes did not serialize\n", (uint32_t)length);
+         exit(1);
+      }
+      full.bytes += length;
+
+      start = nowMicroseconds();
+      length = encodeDelta(s, &last, &arena, buffer, sizeof(buffer));
+      delta.encodeMicroseconds.push_back(nowMicroseconds() - start);
+      if (0 == length)
+      {
+         printf("CurrentSystemStateDelta did not serialize\n");
+         exit(1);
+      }
+      delta.bytes += length;
+
+      // check that the GUI's copy rebuilt from the deltas is the message it stands in for
+      if (!applyDelta(cached, buffer, length) || (cached.SerializeAsString() != s.SerializeAsString()))
+      {
+         mismatches++;
+         cached = s;
+      }
+   }
+
+   printf("%d publishes, %d%% chance a reading changes each second\n", count, changePercent);
+   printResult("full", &full, count);
+   printResult("delta", &delta, count);
+   printf("delta is %.1f%% of full, GUI copy rebuilt from deltas differed %d times\n",
+          100.0 * (double)delta.bytes / (double)full.bytes, mismatches);
+
+   return (0 == mismatches) ? 0 : 2;
+}
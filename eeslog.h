@@ -0,0 +1,635 @@
+/******************************************************************************/
+/*                                                                            */
+/* FILE:        eeslog.h                                                      */
+/*                                                                            */
+/* DESCRIPTION: Record formats of the status/error/event log of the           */
+/*              HennyPenny Frontier UHC, shared by frontier_uhc and the       */
+/*              logConvert tool: the CSV record layouts, and the compact      */
+/*              binary format with its encoder, which logConvert decodes      */
+/*                                                                            */
+/* AUTHOR(S):   USA Firmware, LLC                                             */
+/*                                                                            */
+/* This is an unpublished work subject to Trade Secret and Copyright          */
+/* protection by HennyPenny and USA Firmware, LLC                             */
+/*                                                                            */
+/* USA Firmware, LLC                                                          */
+/* 10060 Brecksville Road Brecksville, OH 44141                               */
+/*                                                                            */
+/******************************************************************************/
+
+#ifndef EESLOG_H
+#define EESLOG_H
+
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+// CSV status record: date and time, UTC offset, DST enabled, system status, fan 1 and fan 2 status,
+// ambient and heat sink temperatures, voltage and current, then for each shelf its status and the
+// status, setpoint and temperature of its upper and lower heaters. Events and error are empty.
+#define EESLOG_CSV_STATUS_FORMAT \
+   "\"%s\",\"%s\",\"%d\","                               /* Date and time, UTC offset, DST enabled. */ \
+   "\"%s\","                                             /* Status (clean/normal). */ \
+   "\"%s\",\"%s\","                                      /* Fan 1 and Fan 2 status. */ \
+   "\"%d\",\"%d\","                                      /* Ambient and heat sink temperatures. */ \
+   "\"%.0f\",\"%.1f\","                                  /* Voltage and current. */ \
+   "\"%s\",\"%s\",\"%d\",\"%.1f\",\"%s\",\"%d\",\"%.1f\","   /* Shelf 1 */ \
+   "\"%s\",\"%s\",\"%d\",\"%.1f\",\"%s\",\"%d\",\"%.1f\","   /* Shelf 2 */ \
+   "\"%s\",\"%s\",\"%d\",\"%.1f\",\"%s\",\"%d\",\"%.1f\","   /* Shelf 3 */ \
+   "\"%s\",\"%s\",\"%d\",\"%.1f\",\"%s\",\"%d\",\"%.1f\","   /* Shelf 4 */ \
+   "\"%s\",\"%s\",\"%d\",\"%.1f\",\"%s\",\"%d\",\"%.1f\","   /* Shelf 5 */ \
+   "\"%s\",\"%s\",\"%d\",\"%.1f\",\"%s\",\"%d\",\"%.1f\","   /* Shelf 6 */ \
+   "\"\",\"\""                                           /* Events, error. Empty in a status record. */ \
+   "\n"
+
+// CSV error or event record: date and time, 51 empty columns (C - BA), events, error
+#define EESLOG_CSV_EVENT_FORMAT \
+   "\"%s\"," \
+   "\"\",\"\",\"\",\"\",\"\",\"\",\"\",\"\",\"\",\"\",\"\",\"\"," \
+   "\"\",\"\",\"\",\"\",\"\",\"\",\"\",\"\",\"\",\"\",\"\",\"\"," \
+   "\"\",\"\",\"\",\"\",\"\",\"\",\"\",\"\",\"\",\"\",\"\",\"\"," \
+   "\"\",\"\",\"\",\"\",\"\",\"\",\"\",\"\",\"\",\"\",\"\",\"\"," \
+   "\"\",\"\",\"\"," \
+   "\"%s\",\"%s\"" \
+   "\n"
+
+// columns A and B of every record
+#define EESLOG_CSV_TIME_FORMAT      "%m/%d/%Y\",\"%H:%M:%S"
+
+// The binary log (YYYYMMDDControl.bin) holds the same records as the CSV log, and logConvert turns
+// it back into the CSV byte for byte. All values are little-endian.
+//
+// Status records are not fixed-width columns. Most of a status record repeats the one before it: the
+// status strings rarely change and the temperatures move a few tenths at a time. So a status record holds
+// only what changed, with strings as per-block indices and temperatures as deltas. That came to about
+// 28 bytes a record on a simulated day, where a fixed-width record of every column would be 85. The cost
+// is that a block has to be decoded from its start, which is why each block starts with a full status
+// record.
+//
+// The file starts with a day header:
+//    char     magic[4]          "HPEL"
+//    uint16   schema_version    EESLOG_SCHEMA_VERSION
+//    uint16   header_size       EESLOG_DAY_HEADER_SIZE
+//    uint16   year
+//    uint8    month, day
+//    uint8    reserved[4]
+//
+// followed by blocks, each written in one piece and decodable on its own:
+//    uint16   magic             EESLOG_BLOCK_MAGIC
+//    uint16   payload_length
+//    uint16   num_records
+//    uint8    is_dst            of every record in the block
+//    uint8    reserved
+//    uint32   base_seconds      UTC time of the first record
+//    int32    gmtoff_seconds    local time offset of every record in the block
+//    uint32   crc               CRC-32 of the payload
+//    uint8    payload[payload_length]
+//
+// The payload is a sequence of records, each starting with its type:
+//    EESLOG_RECORD_TEXT    uint16 length, text written to the CSV as is (the log header)
+//    EESLOG_RECORD_STRING  uint8 index, uint8 length, text: defines a string for the status records of this block
+//    EESLOG_RECORD_EVENT   int32 seconds from base, uint8 column (0 events, 1 error), uint16 length, text
+//    EESLOG_RECORD_STATUS  uint16 seconds from base, then only what changed since the block's previous status
+//                          record (the first status record of a block has everything):
+//                          uint32 mask of the EESLOG_STATUS_NUM_STRINGS string fields, a uint8 string index for each
+//                          uint8  flags, then in this order the values they say are present:
+//                                 EESLOG_STATUS_AMBIENT    int16
+//                                 EESLOG_STATUS_HEATSINK   int16
+//                                 EESLOG_STATUS_VOLTAGE    float
+//                                 EESLOG_STATUS_CURRENT    float
+//                                 EESLOG_STATUS_SETPOINTS  uint16 mask of heaters, a uint16 setpoint for each
+//                                 EESLOG_STATUS_TEMPS      an int8 change in tenths of a degree for each heater,
+//                                                          or EESLOG_TEMP_ESCAPE then the int16 temperature
+#define EESLOG_MAGIC                "HPEL"
+#define EESLOG_SCHEMA_VERSION       1
+#define EESLOG_DAY_HEADER_SIZE      16
+#define EESLOG_BLOCK_MAGIC          0xB10C
+#define EESLOG_BLOCK_HEADER_SIZE    20
+#define EESLOG_BLOCK_PAYLOAD_SIZE   4096
+#define EESLOG_MAX_STRINGS          32       // per block
+#define EESLOG_MAX_STRING_LENGTH    63
+#define EESLOG_MAX_STATUS_RECORD    1536     // worst case, with every string defined
+#define EESLOG_TEXT_CHUNK_SIZE      1024     // longer text is split into several records
+
+#define EESLOG_RECORD_TEXT          1
+#define EESLOG_RECORD_STRING        2
+#define EESLOG_RECORD_EVENT         3
+#define EESLOG_RECORD_STATUS        4
+
+#define EESLOG_NUM_HEATERS          12
+#define EESLOG_NUM_SLOTS            6
+#define EESLOG_STRING_SYSTEM        0
+#define EESLOG_STRING_FAN1          1
+#define EESLOG_STRING_FAN2          2
+#define EESLOG_STRING_SLOT1         3        // then one per slot
+#define EESLOG_STRING_HEATER1       (EESLOG_STRING_SLOT1 + EESLOG_NUM_SLOTS)   // then one per heater
+#define EESLOG_STATUS_NUM_STRINGS   (EESLOG_STRING_HEATER1 + EESLOG_NUM_HEATERS)
+
+#define EESLOG_STATUS_AMBIENT       0x01
+#define EESLOG_STATUS_HEATSINK      0x02
+#define EESLOG_STATUS_VOLTAGE       0x04
+#define EESLOG_STATUS_CURRENT       0x08
+#define EESLOG_STATUS_SETPOINTS     0x10
+#define EESLOG_STATUS_TEMPS         0x20
+#define EESLOG_TEMP_ESCAPE          (-128)
+
+#define EESLOG_EVENT_COLUMN_EVENTS  0
+#define EESLOG_EVENT_COLUMN_ERROR   1
+
+// the values of one status record
+typedef struct
+{
+   uint32_t utc_seconds;
+   int32_t gmtoff_seconds;
+   uint8_t is_dst;
+   const char *strings[EESLOG_STATUS_NUM_STRINGS];
+   int16_t ambient;
+   int16_t heatsink;
+   float voltage;
+   float irms;
+   uint16_t setpoint[EESLOG_NUM_HEATERS];
+   int16_t temperature_tenths[EESLOG_NUM_HEATERS];
+} EESLOG_STATUS;
+
+// a block being built (encoder) or read (decoder)
+typedef struct
+{
+   uint8_t payload[EESLOG_BLOCK_PAYLOAD_SIZE];
+   uint16_t length;
+   uint16_t num_records;
+   uint8_t is_dst;
+   uint32_t base_seconds;
+   int32_t gmtoff_seconds;
+   const char *strings[EESLOG_MAX_STRINGS];
+   char string_text[EESLOG_MAX_STRINGS][EESLOG_MAX_STRING_LENGTH + 1];   // decoder only
+   int num_strings;
+   bool have_previous;
+   EESLOG_STATUS previous;
+} EESLOG_BLOCK;
+
+
+/*******************************************************************************************/
+/*                                                                                         */
+/* static inline void eeslogPut16(uint8_t *p, uint16_t v)                                  */
+/*                                                                                         */
+/* Stores a little-endian 16 bit value.                                                    */
+/*                                                                                         */
+/* Returns: None                                                                           */
+/*                                                                                         */
+/*******************************************************************************************/
+static inline void eeslogPut16(uint8_t *p, uint16_t v)
+{
+   p[0] = (uint8_t)v;
+   p[1] = (uint8_t)(v >> 8);
+}
+
+
+/*******************************************************************************************/
+/*                                                                                         */
+/* static inline void eeslogPut32(uint8_t *p, uint32_t v)                                  */
+/*                                                                                         */
+/* Stores a little-endian 32 bit value.                                                    */
+/*                                                                                         */
+/* Returns: None                                                                           */
+/*                                                                                         */
+/*******************************************************************************************/
+static inline void eeslogPut32(uint8_t *p, uint32_t v)
+{
+   p[0] = (uint8_t)v;
+   p[1] = (uint8_t)(v >> 8);
+   p[2] = (uint8_t)(v >> 16);
+   p[3] = (uint8_t)(v >> 24);
+}
+
+
+/*******************************************************************************************/
+/*                                                                                         */
+/* static inline uint16_t eeslogGet16(const uint8_t *p)                                    */
+/*                                                                                         */
+/* Loads a little-endian 16 bit value.                                                     */
+/*                                                                                         */
+/* Returns: uint16_t value                                                                 */
+/*                                                                                         */
+/*******************************************************************************************/
+static inline uint16_t eeslogGet16(const uint8_t *p)
+{
+   return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+
+/*******************************************************************************************/
+/*                                                                                         */
+/* static inline uint32_t eeslogGet32(const uint8_t *p)                                    */
+/*                                                                                         */
+/* Loads a little-endian 32 bit value.                                                     */
+/*                                                                                         */
+/* Returns: uint32_t value                                                                 */
+/*                                                                                         */
+/*******************************************************************************************/
+static inline uint32_t eeslogGet32(const uint8_t *p)
+{
+   return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+
+/*******************************************************************************************/
+/*                                                                                         */
+/* static inline uint32_t eeslogCRC32(const uint8_t *data, size_t len)                     */
+/*                                                                                         */
+/* CRC-32 (IEEE 802.3) of the data. Bitwise rather than table driven: it runs once per     */
+/* block, and keeps 1 KB of table out of the cache.                                        */
+/*                                                                                         */
+/* Returns: uint32_t crc                                                                   */
+/*                                                                                         */
+/*******************************************************************************************/
+static inline uint32_t eeslogCRC32(const uint8_t *data, size_t len)
+{
+   uint32_t crc = 0xFFFFFFFF;
+
+   for (size_t i = 0; i < len; i++)
+   {
+      crc ^= data[i];
+      for (int bit = 0; bit < 8; bit++)
+      {
+         crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+      }
+   }
+
+   return ~crc;
+}
+
+
+/*******************************************************************************************/
+/*                                                                                         */
+/* static inline void eeslogDayHeader(uint8_t *header, int year, int month, int day)       */
+/*                                                                                         */
+/* Fills in the EESLOG_DAY_HEADER_SIZE byte header that starts a binary log file.          */
+/*                                                                                         */
+/* Returns: None                                                                           */
+/*                                                                                         */
+/*******************************************************************************************/
+static inline void eeslogDayHeader(uint8_t *header, int year, int month, int day)
+{
+   (void)memset(header, 0, EESLOG_DAY_HEADER_SIZE);
+   (void)memcpy(header, EESLOG_MAGIC, 4);
+   eeslogPut16(&header[4], EESLOG_SCHEMA_VERSION);
+   eeslogPut16(&header[6], EESLOG_DAY_HEADER_SIZE);
+   eeslogPut16(&header[8], (uint16_t)year);
+   header[10] = (uint8_t)month;
+   header[11] = (uint8_t)day;
+}
+
+
+/*******************************************************************************************/
+/*                                                                                         */
+/* static inline void eeslogBlockReset(EESLOG_BLOCK *block)                                */
+/*                                                                                         */
+/* Empties a block, forgetting its strings and previous status record.                     */
+/*                                                                                         */
+/* Returns: None                                                                           */
+/*                                                                                         */
+/*******************************************************************************************/
+static inline void eeslogBlockReset(EESLOG_BLOCK *block)
+{
+   block->length = 0;
+   block->num_records = 0;
+   block->num_strings = 0;
+   block->have_previous = false;
+}
+
+
+/*******************************************************************************************/
+/*                                                                                         */
+/* static inline bool eeslogBlockStart(EESLOG_BLOCK *block, uint32_t utc_seconds,          */
+/*                                     int32_t gmtoff_seconds, uint8_t is_dst,             */
+/*                                     uint32_t space, bool shortOffset)                   */
+/*                                                                                         */
+/* Checks that a record at the given time, needing space bytes, can go into the block,     */
+/* taking the block's base time and offset from it if it is the first. shortOffset is for  */
+/* status records, whose time is a uint16 past the base.                                   */
+/*                                                                                         */
+/* Returns: bool true if it fits, false if the block has to be written out first           */
+/*                                                                                         */
+/*******************************************************************************************/
+static inline bool eeslogBlockStart(EESLOG_BLOCK *block, uint32_t utc_seconds, int32_t gmtoff_seconds,
+                                    uint8_t is_dst, uint32_t space, bool shortOffset)
+{
+   if (0 == block->num_records)
+   {
+      block->base_seconds = utc_seconds;
+      block->gmtoff_seconds = gmtoff_seconds;
+      block->is_dst = is_dst;
+      return true;
+   }
+
+   if ((gmtoff_seconds != block->gmtoff_seconds) || (is_dst != block->is_dst) ||
+       ((block->length + space) > EESLOG_BLOCK_PAYLOAD_SIZE))
+   {
+      return false;
+   }
+
+   if (shortOffset && ((utc_seconds < block->base_seconds) || ((utc_seconds - block->base_seconds) > 0xFFFF)))
+   {
+      return false;
+   }
+
+   return true;
+}
+
+
+/*******************************************************************************************/
+/*                                                                                         */
+/* static inline bool eeslogAddText(EESLOG_BLOCK *block, const char *text, uint16_t len,   */
+/*                                  uint32_t utc_seconds, int32_t gmtoff_seconds,          */
+/*                                  uint8_t is_dst)                                        */
+/*                                                                                         */
+/* Adds text to be copied to the CSV as is. len must be at most EESLOG_TEXT_CHUNK_SIZE.    */
+/*                                                                                         */
+/* Returns: bool true if added, false if the block has to be written out first             */
+/*                                                                                         */
+/*******************************************************************************************/
+static inline bool eeslogAddText(EESLOG_BLOCK *block, const char *text, uint16_t len, uint32_t utc_seconds,
+                                 int32_t gmtoff_seconds, uint8_t is_dst)
+{
+   if (!eeslogBlockStart(block, utc_seconds, gmtoff_seconds, is_dst, 3 + len, false))
+   {
+      return false;
+   }
+
+   uint8_t *p = &block->payload[block->length];
+   p[0] = EESLOG_RECORD_TEXT;
+   eeslogPut16(&p[1], len);
+   (void)memcpy(&p[3], text, len);
+   block->length += 3 + len;
+   block->num_records++;
+
+   return true;
+}
+
+
+/*******************************************************************************************/
+/*                                                                                         */
+/* static inline bool eeslogAddEvent(EESLOG_BLOCK *block, uint32_t utc_seconds,            */
+/*                                   int32_t gmtoff_seconds, uint8_t is_dst,               */
+/*                                   uint8_t column, const char *text)                     */
+/*                                                                                         */
+/* Adds an error or event record, text going in the events or the error column.            */
+/*                                                                                         */
+/* Returns: bool true if added, false if the block has to be written out first             */
+/*                                                                                         */
+/*******************************************************************************************/
+static inline bool eeslogAddEvent(EESLOG_BLOCK *block, uint32_t utc_seconds, int32_t gmtoff_seconds,
+                                  uint8_t is_dst, uint8_t column, const char *text)
+{
+   size_t len = strlen(text);
+   if (len > EESLOG_TEXT_CHUNK_SIZE)
+   {
+      len = EESLOG_TEXT_CHUNK_SIZE;
+   }
+
+   if (!eeslogBlockStart(block, utc_seconds, gmtoff_seconds, is_dst, 8 + len, false))
+   {
+      return false;
+   }
+
+   uint8_t *p = &block->payload[block->length];
+   p[0] = EESLOG_RECORD_EVENT;
+   eeslogPut32(&p[1], utc_seconds - block->base_seconds);
+   p[5] = column;
+   eeslogPut16(&p[6], (uint16_t)len);
+   (void)memcpy(&p[8], text, len);
+   block->length += 8 + len;
+   block->num_records++;
+
+   return true;
+}
+
+
+/*******************************************************************************************/
+/*                                                                                         */
+/* static inline int eeslogInternString(EESLOG_BLOCK *block, const char *str)              */
+/*                                                                                         */
+/* Returns the block's index for the string, defining it in the block the first time.      */
+/* The status strings are literals, so the pointer compare nearly always finds them.       */
+/*                                                                                         */
+/* Returns: int index, -1 if the block's string table is full                              */
+/*                                                                                         */
+/*******************************************************************************************/
+static inline int eeslogInternString(EESLOG_BLOCK *block, const char *str)
+{
+   for (int i = 0; i < block->num_strings; i++)
+   {
+      if ((block->strings[i] == str) || (0 == strcmp(block->strings[i], str)))
+      {
+         return i;
+      }
+   }
+
+   if (block->num_strings >= EESLOG_MAX_STRINGS)
+   {
+      return -1;
+   }
+
+   size_t len = strlen(str);
+   if (len > EESLOG_MAX_STRING_LENGTH)
+   {
+      len = EESLOG_MAX_STRING_LENGTH;
+   }
+
+   int index = block->num_strings++;
+   block->strings[index] = str;
+
+   uint8_t *p = &block->payload[block->length];
+   p[0] = EESLOG_RECORD_STRING;
+   p[1] = (uint8_t)index;
+   p[2] = (uint8_t)len;
+   (void)memcpy(&p[3], str, len);
+   block->length += 3 + len;
+   block->num_records++;
+
+   return index;
+}
+
+
+/*******************************************************************************************/
+/*                                                                                         */
+/* static inline bool eeslogAddStatus(EESLOG_BLOCK *block, const EESLOG_STATUS *status)    */
+/*                                                                                         */
+/* Adds a status record, storing only what changed since the block's previous one.         */
+/*                                                                                         */
+/* Returns: bool true if added, false if the block has to be written out first             */
+/*                                                                                         */
+/*******************************************************************************************/
+static inline bool eeslogAddStatus(EESLOG_BLOCK *block, const EESLOG_STATUS *status)
+{
+   if (!eeslogBlockStart(block, status->utc_seconds, status->gmtoff_seconds, status->is_dst, EESLOG_MAX_STATUS_RECORD, true))
+   {
+      return false;
+   }
+
+   // the strings first, since they may add STRING records ahead of this one
+   int index[EESLOG_STATUS_NUM_STRINGS];
+   uint32_t stringMask = 0;
+   for (int i = 0; i < EESLOG_STATUS_NUM_STRINGS; i++)
+   {
+      index[i] = eeslogInternString(block, status->strings[i]);
+      if (index[i] < 0)
+      {
+         return false;
+      }
+      if (!block->have_previous || (block->previous.strings[i] != block->strings[index[i]]))
+      {
+         stringMask |= (1UL << i);
+      }
+   }
+
+   const EESLOG_STATUS *prev = &block->previous;
+   bool all = !block->have_previous;
+   uint8_t *start = &block->payload[block->length];
+   uint8_t *p = start;
+
+   *p++ = EESLOG_RECORD_STATUS;
+   eeslogPut16(p, (uint16_t)(status->utc_seconds - block->base_seconds));
+   p += 2;
+   eeslogPut32(p, stringMask);
+   p += 4;
+   for (int i = 0; i < EESLOG_STATUS_NUM_STRINGS; i++)
+   {
+      if (0 != (stringMask & (1UL << i)))
+      {
+         *p++ = (uint8_t)index[i];
+      }
+   }
+
+   uint8_t *flags = p++;
+   *flags = 0;
+   if (all || (status->ambient != prev->ambient))
+   {
+      *flags |= EESLOG_STATUS_AMBIENT;
+      eeslogPut16(p, (uint16_t)status->ambient);
+      p += 2;
+   }
+   if (all || (status->heatsink != prev->heatsink))
+   {
+      *flags |= EESLOG_STATUS_HEATSINK;
+      eeslogPut16(p, (uint16_t)status->heatsink);
+      p += 2;
+   }
+   if (all || (0 != memcmp(&status->voltage, &prev->voltage, sizeof(float))))
+   {
+      uint32_t bits;
+      (void)memcpy(&bits, &status->voltage, sizeof(bits));
+      *flags |= EESLOG_STATUS_VOLTAGE;
+      eeslogPut32(p, bits);
+      p += 4;
+   }
+   if (all || (0 != memcmp(&status->irms, &prev->irms, sizeof(float))))
+   {
+      uint32_t bits;
+      (void)memcpy(&bits, &status->irms, sizeof(bits));
+      *flags |= EESLOG_STATUS_CURRENT;
+      eeslogPut32(p, bits);
+      p += 4;
+   }
+
+   uint16_t setpointMask = 0;
+   for (int i = 0; i < EESLOG_NUM_HEATERS; i++)
+   {
+      if (all || (status->setpoint[i] != prev->setpoint[i]))
+      {
+         setpointMask |= (uint16_t)(1 << i);
+      }
+   }
+   if (0 != setpointMask)
+   {
+      *flags |= EESLOG_STATUS_SETPOINTS;
+      eeslogPut16(p, setpointMask);
+      p += 2;
+      for (int i = 0; i < EESLOG_NUM_HEATERS; i++)
+      {
+         if (0 != (setpointMask & (1 << i)))
+         {
+            eeslogPut16(p, status->setpoint[i]);
+            p += 2;
+         }
+      }
+   }
+
+   bool tempsChanged = all;
+   for (int i = 0; (i < EESLOG_NUM_HEATERS) && !tempsChanged; i++)
+   {
+      tempsChanged = (status->temperature_tenths[i] != prev->temperature_tenths[i]);
+   }
+   if (tempsChanged)
+   {
+      *flags |= EESLOG_STATUS_TEMPS;
+      for (int i = 0; i < EESLOG_NUM_HEATERS; i++)
+      {
+         int delta = all ? EESLOG_TEMP_ESCAPE : (status->temperature_tenths[i] - prev->temperature_tenths[i]);
+         if ((delta <= EESLOG_TEMP_ESCAPE) || (delta > 127))
+         {
+            *p++ = (uint8_t)(int8_t)EESLOG_TEMP_ESCAPE;
+            eeslogPut16(p, (uint16_t)status->temperature_tenths[i]);
+            p += 2;
+         }
+         else
+         {
+            *p++ = (uint8_t)(int8_t)delta;
+         }
+      }
+   }
+
+   block->length += (uint16_t)(p - start);
+   block->num_records++;
+   block->previous = *status;
+   for (int i = 0; i < EESLOG_STATUS_NUM_STRINGS; i++)
+   {
+      block->previous.strings[i] = block->strings[index[i]];
+   }
+   block->have_previous = true;
+
+   return true;
+}
+
+
+/*******************************************************************************************/
+/*                                                                                         */
+/* static inline void eeslogBlockHeader(const EESLOG_BLOCK *block, uint8_t *header)        */
+/*                                                                                         */
+/* Fills in the EESLOG_BLOCK_HEADER_SIZE byte header written ahead of the payload.         */
+/*                                                                                         */
+/* Returns: None                                                                           */
+/*                                                                                         */
+/*******************************************************************************************/
+static inline void eeslogBlockHeader(const EESLOG_BLOCK *block, uint8_t *header)
+{
+   eeslogPut16(&header[0], EESLOG_BLOCK_MAGIC);
+   eeslogPut16(&header[2], block->length);
+   eeslogPut16(&header[4], block->num_records);
+   header[6] = block->is_dst;
+   header[7] = 0;
+   eeslogPut32(&header[8], block->base_seconds);
+   eeslogPut32(&header[12], (uint32_t)block->gmtoff_seconds);
+   eeslogPut32(&header[16], eeslogCRC32(block->payload, block->length));
+}
+
+
+/*******************************************************************************************/
+/*                                                                                         */
+/* static inline void eeslogFormatTime(char *timestr, size_t size, uint32_t utc_seconds,   */
+/*                                     int32_t gmtoff_seconds)                             */
+/*                                                                                         */
+/* Formats columns A and B of a record, in the local time the record was written in.       */
+/*                                                                                         */
+/* Returns: None                                                                           */
+/*                                                                                         */
+/*******************************************************************************************/
+static inline void eeslogFormatTime(char *timestr, size_t size, uint32_t utc_seconds, int32_t gmtoff_seconds)
+{
+   time_t local = (time_t)utc_seconds + gmtoff_seconds;
+   struct tm localtm;
+   (void)gmtime_r(&local, &localtm);
+   (void)strftime(timestr, size, EESLOG_CSV_TIME_FORMAT, &localtm);
+}
+
+#endif // EESLOG_H
@@ -0,0 +1,215 @@
+/*
+ ***********************************************************************************************************************
+ *
+ * (c) COPYRIGHT, 2023 USA Firmware Corporation
+ *
+ * All rights reserved. This file is the intellectual property of USA Firmware Corporation and it may not be disclosed
+ * to others or used for any purposes without the written consent of USA Firmware Corporation.
+ *
+ ***********************************************************************************************************************
+ */
+
+/**
+ ***********************************************************************************************************************
+ *
+ * @brief   A lock-free flight recorder ring, and the frame and dump file formats of the controller's recorder.
+ * @file    flight_recorder.h
+ * @author  USA Firmware Corporation
+ *
+ * The controller records a FLIGHT_FRAME on every pass of the heater algorithm into a FlightRecorder, and when an
+ * error is logged it dumps the frames around it to the SD card. logConvert turns a dump into CSV.
+ *
+ * Only one thread may call record(). Any number of threads may call frames() and read(); a reader never blocks the
+ * writer, it just finds that a frame the writer is reusing is no longer there.
+ *
+ ***********************************************************************************************************************
+ */
+
+
+/*
+ ***********************************************************************************************************************
+ *                                                      MODULE
+ ***********************************************************************************************************************
+ */
+#pragma once
+
+
+/*
+ ***********************************************************************************************************************
+ *                                                   INCLUDE FILES
+ ***********************************************************************************************************************
+ */
+/****************************************************** System ********************************************************/
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+
+/*****************************************************   User   *******************************************************/
+
+
+/*
+ ***********************************************************************************************************************
+ *                                                  Frame and file formats
+ ***********************************************************************************************************************
+ */
+#define FLIGHT_FRAME_NUM_RTDS          14
+#define FLIGHT_FRAME_NUM_HEATERS       12
+#define FLIGHT_FILE_MAGIC              "HPFR"
+#define FLIGHT_FILE_VERSION            1
+#define FLIGHT_FILE_ERROR_CODE_SIZE    16
+
+/** One pass of the heater algorithm: the RTD scan it acted on, what it did with the heaters, and the power monitor. */
+typedef struct
+{
+   uint32_t frame_number;                                  /**< Counts up from 0 at startup. */
+   uint32_t scan_sequence;                                 /**< SENSOR_SNAPSHOT sequence_number of the scan. */
+   uint32_t utc_seconds;                                   /**< When the scan completed. */
+   uint32_t utc_microseconds;
+   uint32_t heater_latency_us;                             /**< Scan to heater pass latency. */
+   float irms;
+   float voltage;
+   int16_t raw_counts[FLIGHT_FRAME_NUM_RTDS];              /**< -1 if the read failed. */
+   int16_t temperature_tenths[FLIGHT_FRAME_NUM_RTDS];      /**< -10 if open or shorted. */
+   uint16_t setpoint[FLIGHT_FRAME_NUM_HEATERS];
+   uint16_t rtd_open;                                      /**< A bit per RTD. */
+   uint16_t rtd_shorted;                                   /**< A bit per RTD. */
+   uint16_t heaters_on;                                    /**< A bit per heater. */
+   uint16_t heaters_enabled;                               /**< A bit per heater. */
+   uint16_t heaters_eco;                                   /**< A bit per heater. */
+   uint8_t fans_on;                                        /**< Bit 0 fan 1, bit 1 fan 2. */
+   uint8_t system_status;                                  /**< uhc::SystemStatus. */
+   uint8_t power_monitor_bad;
+   uint8_t reserved[7];
+} FLIGHT_FRAME;
+
+static_assert(128 == sizeof(FLIGHT_FRAME), "FLIGHT_FRAME must have no padding, it is written to the dump file as is");
+
+/**
+ * The dump file starts with this header, followed by num_frames FLIGHT_FRAMEs, oldest first. Both are written in the
+ * controller's byte order, which is little-endian.
+ */
+typedef struct
+{
+   char magic[4];                                          /**< FLIGHT_FILE_MAGIC */
+   uint16_t version;                                       /**< FLIGHT_FILE_VERSION */
+   uint16_t frame_size;                                    /**< sizeof(FLIGHT_FRAME) */
+   uint32_t trigger_frame;                                 /**< The first frame recorded after the error. */
+   uint32_t trigger_utc_seconds;                           /**< When the error was logged. */
+   uint32_t trigger_utc_microseconds;
+   uint32_t num_frames;
+   char error_code[FLIGHT_FILE_ERROR_CODE_SIZE];           /**< Of the error that triggered the dump. */
+   uint8_t reserved[24];
+} FLIGHT_FILE_HEADER;
+
+static_assert(64 == sizeof(FLIGHT_FILE_HEADER), "FLIGHT_FILE_HEADER must have no padding, it is written as is");
+
+
+/*
+ ***********************************************************************************************************************
+ *                                                  Class Definition
+ ***********************************************************************************************************************
+ */
+template <typename T, int N> class FlightRecorder
+{
+   static_assert((N >= 2) && (0 == (N & (N - 1))), "FlightRecorder capacity must be a power of two");
+
+public:
+   FlightRecorder()
+   : next_frame(0)
+   {
+      for (uint32_t i = 0; i < (uint32_t)N; i++)
+      {
+         cells[i].sequence.store(0, std::memory_order_relaxed);
+      }
+   }
+
+   virtual ~FlightRecorder()
+   {
+   }
+
+   /**
+    * @brief Record a frame, overwriting the oldest one once the ring is full.
+    *
+    * Never blocks, and makes no system call. Only one thread may call it.
+    *
+    * @param[in] frame The frame to record.
+    */
+   void record(const T &frame)
+   {
+      uint32_t n = next_frame.load(std::memory_order_relaxed);
+      cell_t &cell = cells[n & (N - 1)];
+
+      // odd while the frame is being written, so a reader can tell it raced with the writer
+      cell.sequence.store((n << 1) | 1, std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_release);
+      (void)memcpy(&cell.data, &frame, sizeof(T));
+      cell.sequence.store((n << 1) + 2, std::memory_order_release);
+
+      next_frame.store(n + 1, std::memory_order_release);
+   }
+
+   /**
+    * @brief Get the number of frames recorded since startup.
+    *
+    * @return The frame number the next record() will use. The frames still held are the last N before it.
+    */
+   uint32_t frames() const
+   {
+      return next_frame.load(std::memory_order_acquire);
+   }
+
+   /**
+    * @brief Copy out a recorded frame.
+    *
+    * @param[in] n The number of the frame.
+    *
+    * @param[out] frame Where to copy it.
+    *
+    * @retval true The frame was copied.
+    * @retval false The frame has not been recorded yet, or has been, or is being, overwritten.
+    */
+   bool read(uint32_t n, T *frame) const
+   {
+      const cell_t &cell = cells[n & (N - 1)];
+      uint32_t expected = (n << 1) + 2;
+
+      if (cell.sequence.load(std::memory_order_acquire) != expected)
+      {
+         return false;
+      }
+      (void)memcpy(frame, &cell.data, sizeof(T));
+      std::atomic_thread_fence(std::memory_order_acquire);
+
+      return cell.sequence.load(std::memory_order_relaxed) == expected;
+   }
+
+   /**
+    * @brief Get the number of frames the ring holds.
+    *
+    * @return N.
+    */
+   int size() const
+   {
+      return N;
+   }
+
+protected:
+
+private:
+   /** One frame and the sequence number that says which frame it is, odd while it is being written. */
+   struct cell_t
+   {
+      std::atomic<uint32_t> sequence;
+      T data;
+   };
+
+   /** The array of cells, of size N. */
+   std::array<cell_t, N> cells;
+
+   /** The number the next frame recorded gets. Only the writer writes it. */
+   alignas(64) std::atomic<uint32_t> next_frame;
+};
+
+
+/*********************************************      End of file        ************************************************/
@@ -45,6 +45,11 @@
 #include <iostream>
 #include <errno.h>
 #include <execinfo.h>
+#include <sched.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <atomic>
+#include <new>
 
 #include "frontier_uhc.h"
 #include "uhc.pb.h"
@@ -52,10 +57,15 @@
 #include "atm90e26.h"
 #include "PGA117.h"
 #include "safe_queue.h"
+#include "lockfree_queue.h"
+#include "eeslog.h"
+#include "flight_recorder.h"
 
 using namespace uhc;
 using namespace std;
 using namespace google::protobuf::util;
+using google::protobuf::Arena;
+using google::protobuf::ArenaOptions;
 
 // global variables
 bool initialStartup = true;
@@ -63,23 +73,42 @@ bool startupComplete = false;
 bool selfTestsOK = false;
 void *context = NULL;
 void *statusPublisher = NULL;
+void *alarmPublisher = NULL;
+void *rtdStreamPublisher = NULL;
+void *commandRouter = NULL;
 void *subscriber = NULL;
 void *subscriber2 = NULL;
-void *timeSyncSubscriber = NULL;
-void *timeSyncSubscriber2 = NULL;
-void *commandListener = NULL;
-void *commandListener2 = NULL;
-void *commandResponsePublisher = NULL;
-void *commandResponsePublisher2 = NULL;
-void *heartBeatListener = NULL;
-void *heartBeatListener2 = NULL;
 void *firmwareUpdateResponsePublisher = NULL;
 void *firmwareUpdateListener = NULL;
 void *rtdPublisher = NULL;
 
 char controllerIPAddress[IP_STRING_SIZE];
-char guiIPAddress1[IP_STRING_SIZE];
-char guiIPAddress2[IP_STRING_SIZE];
+GUI_SESSION guiSessions[MAX_GUI_SESSIONS];
+int numGUISessions = 0;
+
+// responses to the last COMMAND_CACHE_SIZE commands received on the command router
+COMMAND_CACHE_ENTRY commandCache[COMMAND_CACHE_SIZE];
+uint32_t commandCacheNext = 0;
+uint32_t routerCommandsReceived = 0;
+uint32_t routerCommandsDuplicated = 0;
+uint32_t routerCommandsKeyReused = 0;             // same sender, sequence and correlation ID, different command
+
+// results of the operations of the last SYSTEM_COMMAND_BATCH, for its response
+uhc::SystemCommandResponses batchOperationResponses[MAX_BATCH_OPERATIONS];
+int numBatchOperationResponses = 0;
+
+// points found by the last SYSTEM_COMMAND_QUERY_HISTORY, for its response
+HISTORY_AGGREGATE historyQueryPoints[HISTORY_MAX_QUERY_POINTS];
+int numHistoryQueryPoints = 0;
+
+// ports for each panel, in the order the panels are given on the command line
+static const GUI_SESSION_PORTS guiSessionPorts[MAX_GUI_SESSIONS] =
+{
+   { HEARTBEAT_PORT_GUI1, SYSTEM_COMMAND_PORT_GUI1, SYSTEM_COMMAND_RESPONSE_PORT_CONTROLLER,  TIME_SYNC_PORT_GUI1 },
+   { HEARTBEAT_PORT_GUI2, SYSTEM_COMMAND_PORT_GUI2, SYSTEM_COMMAND_RESPONSE_PORT_CONTROLLER2, TIME_SYNC_PORT_GUI2 },
+   { HEARTBEAT_PORT_GUI3, SYSTEM_COMMAND_PORT_GUI3, SYSTEM_COMMAND_RESPONSE_PORT_CONTROLLER3, TIME_SYNC_PORT_GUI3 },
+   { HEARTBEAT_PORT_GUI4, SYSTEM_COMMAND_PORT_GUI4, SYSTEM_COMMAND_RESPONSE_PORT_CONTROLLER4, TIME_SYNC_PORT_GUI4 }
+};
 char serialNumber[SERIAL_NUMBER_SIZE + 1];
 char modelNumber[MODEL_NUMBER_SIZE + 1];
 char errorCodeString[ERROR_CODE_LENGTH + 1];
@@ -91,18 +120,17 @@ char frontierUHCPackageFilename[MAX_FILE_PATH + 1];
 pthread_t statusPublisherThread_ID;
 pthread_t loggerThread_ID;
 pthread_t subscriberThread_ID;
-pthread_t heartBeatListenerThread_ID;
-pthread_t heartBeatListenerThread2_ID;
 pthread_t readADCThread_ID;
-pthread_t timeSyncSubscriberThread_ID;
-pthread_t timeSyncSubscriberThread2_ID;
 pthread_t firmwareUpdateListenerThread_ID;
-pthread_t commandHandlerThread_ID;
-pthread_t commandHandlerThread2_ID;
 pthread_t heaterControlThread_ID;
 pthread_t softPowerdownThread_ID;
 pthread_t firmwareUpdatePackageThread_ID;
 pthread_t rtdPublisherThread_ID;
+pthread_t zmqReactorThread_ID;
+pthread_t guiSessionThread_ID;
+pthread_t alarmPublisherThread_ID;
+pthread_t rtdStreamThread_ID;
+pthread_t subprocessThread_ID;
 
 uint16_t controllerBoardRevision = 0;
 FAN_GPIO_SYSFS_INFO fanInfo[NUM_FANS];
@@ -118,6 +146,113 @@ char setpointHighLimitText[SETPOINT_LIMIT_SIZE];
 int fd_analogInput0 = -1;
 int fd_analogInput1 = -1;
 int fd_spi_bus_0 = -1;
+int fd_iioDevice = -1;
+bool iioBufferedCapture = false;  // read AIN0/AIN1 from the IIO buffer instead of the sysfs text files
+uint32_t rtdScanTimeMicroseconds = 0;
+uint32_t rtdScanTimeMaxMicroseconds = 0;
+
+// latest sensor readings, published once per scan by readADCThread
+// the sequence lock is odd while the snapshot is being written
+SENSOR_SNAPSHOT sensorSnapshot;
+std::atomic<uint32_t> sensorSnapshotLock(0);
+
+// readADCThread signals each completed scan so the heater algorithm can act on it right away
+bool scanTriggeredHeaters = false;
+pthread_mutex_t sensorScanMutex = PTHREAD_MUTEX_INITIALIZER;
+pthread_mutex_t heaterAlgorithmMutex = PTHREAD_MUTEX_INITIALIZER;   // held for each pass of the heater algorithm
+pthread_cond_t sensorScanCondition;
+uint32_t sensorScanCount = 0;
+struct timespec heaterScanTimeMonotonic;    // scan the current heater pass is acting on
+uint32_t heaterLatencyMicroseconds = 0;
+uint32_t heaterLatencyMaxMicroseconds = 0;
+uint32_t heaterScanTimeouts = 0;
+
+// history store, sampled once a second by heaterControlThread, see HISTORY_SECONDS
+pthread_mutex_t historyMutex = PTHREAD_MUTEX_INITIALIZER;
+HISTORY_SAMPLE historySeconds[HISTORY_SECONDS];
+HISTORY_AGGREGATE historyMinutes[HISTORY_MINUTES];
+HISTORY_AGGREGATE historyHours[HISTORY_HOURS];
+HISTORY_RING historySecondsRing;
+HISTORY_RING historyMinutesRing;
+HISTORY_RING historyHoursRing;
+HISTORY_ACCUMULATOR historyMinute;
+HISTORY_ACCUMULATOR historyHour;
+uint32_t historyLastSampleSeconds = 0;
+
+// flight recorder, written by heaterControlThread and dumped by loggerThread after an error is logged
+static_assert((NUM_RTDs == FLIGHT_FRAME_NUM_RTDS) && (NUM_HEATERS == FLIGHT_FRAME_NUM_HEATERS), "FLIGHT_FRAME does not match");
+static FlightRecorder<FLIGHT_FRAME, FLIGHT_RECORDER_FRAMES> flightRecorder;
+std::atomic<uint32_t> flightRecorderTrigger(0);             // first frame after the error + 1, 0 if no dump is pending,
+                                                            // FLIGHT_RECORDER_TRIGGER_CLAIMED while it is being set
+std::atomic<const char *> flightRecorderTriggerCode(NULL);
+std::atomic<uint32_t> flightRecorderTriggerSeconds(0);      // monotonicSeconds() of the error
+struct timeval flightRecorderTriggerTime;                   // set with flightRecorderTrigger, read once the dump is due
+uint32_t flightRecorderDumps = 0;
+uint32_t flightRecorderDumpsToday = 0;
+uint32_t flightRecorderDumpsSkipped = 0;
+
+// RTD scans per second while streaming, 0 when not, see RTD_STREAM_RATE_FILE
+std::atomic<uint32_t> rtdStreamRateHz(0);
+uint32_t rtdStreamBatchesPublished = 0;
+
+// alarms go out on the ALARM topic as soon as they are raised, see raiseAlarm
+std::atomic<uint32_t> lastAlarmId(0);
+uint32_t alarmsPublished = 0;
+uint32_t alarmsSendFailed = 0;              // zmq_send returned an error, the alarm is still in the next CurrentSystemState
+uint32_t alarmSendFailLoggedSeconds = 0;    // monotonicSeconds of the last send failure syslog, 0 = none yet
+uint32_t alarmLatencyMicroseconds = 0;      // detection to zmq_send returning, last alarm
+uint32_t alarmLatencyMaxMicroseconds = 0;
+
+// shell commands queued with runSubprocess and run by subprocessThread
+uint32_t subprocessesDropped = 0;           // queued while the subprocess queue was full
+uint32_t subprocessesRun = 0;
+uint32_t subprocessesFailed = 0;            // exited with a non-zero status, were killed or could not be started
+uint32_t subprocessesTimedOut = 0;
+uint32_t subprocessMaxMilliseconds = 0;     // the longest running
+char subprocessMaxName[SUBPROCESS_NAME_SIZE] = "";
+
+// 1 second task schedules, kept global so their statistics can be logged
+PERIODIC_TASK readADCTask;
+PERIODIC_TASK heaterControlTask;
+PERIODIC_TASK statusPublisherTask;
+PERIODIC_TASK rtdPublisherTask;
+PERIODIC_TASK mainLoopTask;
+
+// when set, one zmqReactorThread services every subscriber socket and runs the publishers
+// instead of a thread per socket
+bool zmqReactor = false;
+
+// one CurrentSystemState, built on an arena whose first block is this static buffer and
+// refilled in place every publish so its submessages and strings are allocated only once
+char cssArenaBlock[CSS_ARENA_BLOCK_SIZE];
+Arena *cssArena = NULL;
+CurrentSystemState *cssMessage = NULL;
+char cssSerializeBuffer[DEFAULT_CSS_MESSAGE_BUFFER_SIZE];
+
+// heap allocations made by the calling thread: blocks the CurrentSystemState arenas get
+// beyond their initial blocks, see cssArenaBlockAlloc, and in a COUNT_HEAP_ALLOCATIONS build
+// every operator new call as well. A publish is counted only while it builds and serializes
+// the message; the copy zmq_send mallocs for every frame inside libzmq is not counted
+thread_local uint32_t threadHeapAllocations = 0;
+uint32_t cssHeapAllocations = 0;           // protobuf/arena allocations made building and serializing the last CurrentSystemState
+uint32_t cssHeapAllocatingPublishes = 0;   // publishes after the first one that made any protobuf/arena allocation
+
+// delta mode, see CSS_DELTA_ENABLE_FILE. Each delta is built on its own arena, which is reset
+// back to this static block after every publish
+bool cssDelta = false;
+std::atomic<bool> cssKeyframeRequested(false);   // set by SYSTEM_COMMAND_REQUEST_KEYFRAME
+char cssDeltaArenaBlock[CSS_DELTA_ARENA_BLOCK_SIZE];
+Arena *cssDeltaArena = NULL;
+CSS_STREAM_STATS cssFullStats;
+CSS_STREAM_STATS cssDeltaStats;
+uint64_t cssFullEquivalentBytes = 0;        // what sending the full message every time would have cost
+struct timespec cssStreamStatsStart;        // CLOCK_MONOTONIC
+
+// frames received into a zmq_msg_t that the old fixed DEFAULT_MESSAGE_BUFFER_SIZE buffer would
+// have truncated, and frames over ZMQ_MAX_MESSAGE_SIZE that were dropped without being parsed
+std::atomic<uint32_t> zmqLargeFrames(0);
+std::atomic<uint32_t> zmqOversizeFrames(0);
+std::atomic<uint32_t> zmqOversizeLoggedSeconds(0);   // monotonicSeconds of the last oversize syslog, 0 = none yet
 
 bool shutdownRequested = false;
 bool debugPrintf = false;        // turn on debug messages to the console on the fly if /tmp/debug exists
@@ -138,8 +273,6 @@ bool debugCSV = false;
 bool ethernetUp = true;
 bool previousEthernetUp = true;
 bool ethernetErrorOneShot = true;
-bool gui1MissingOneShot = true;
-bool gui2MissingOneShot = true;
 bool bothGuisMissingOneShot = true;
 bool manifestFileContainsFrontierUHC = false;
 bool processFrontierInstaller = false;
@@ -154,6 +287,7 @@ bool fan2CurrentLimitOneShot = true;
 bool alreadyClosing = false;
 bool maxStartupTimeExceededOneShot = true;
 bool fsckAttempted = false;
+std::atomic<int> sdCardRepairStatus(0);     // exit status of the remount after an fsck, SUBPROCESS_PENDING until then
 bool nsoMode = false;
 bool demoMode = false;
 bool loggingIsEventDriven = false;
@@ -174,14 +308,18 @@ uint32_t loggingPeriodSeconds = DEFAULT_LOGGING_PERIOD_SECONDS;
 
 enum SD_CARD_TYPE sdCardType = UNKNOWN;
 
-uint32_t lastTimeGUI1Heard = 0;
-uint32_t lastTimeGUI2Heard = 0;
 long systemUptime = 0;
 
 FILE *csvFile = NULL;
 bool debugHeatersWriteCSVFile = false;
 struct timeval csvStartTime;
 
+// startup heater data, written by heaterControlThread and moved into the log directory by loggerThread
+static char heaterDataBuffer[HEATER_DATA_BUFFER_SIZE];
+std::atomic<bool> heaterDataClosed(false);      // HEATER_DATA_CLOSED_FILE is waiting to be rotated in
+uint32_t heaterDataLines = 0;                   // lines in HEATER_DATA_CLOSED_FILE
+uint32_t heaterDataCloseMicroseconds = 0;       // on the heater thread
+
 // current draw from the wall outlet for the heaters
 float irms = 0.0;
 float voltage = 0.0;
@@ -192,8 +330,139 @@ uhc::SystemCommands lastCommandReceived = SYSTEM_COMMAND_UNKNOWN;
 
 char firmwareUpdateResultBuffer[FIRMWARE_UPDATE_RESULT_BUFFER_SIZE];
 
+#ifdef COUNT_HEAP_ALLOCATIONS
+/*******************************************************************************************/
+/*                                                                                         */
+/* void *operator new(size_t size)                                                         */
+/*                                                                                         */
+/* Replaces the global operator new so each thread can count its own heap allocations.     */
+/* Only built with -DCOUNT_HEAP_ALLOCATIONS, to check while benchmarking that building and */
+/* serializing the steady state messages does not allocate; the normal build counts only   */
+/* the arena blocks. libzmq allocates with malloc, so its copy of each frame is not seen.  */
+/*                                                                                         */
+/* Returns: void *allocated memory, throws std::bad_alloc on failure                       */
+/*                                                                                         */
+/*******************************************************************************************/
+void *operator new(size_t size)
+{
+   threadHeapAllocations++;
+   if (0 == size)
+   {
+      size = 1;
+   }
+
+   while (true)
+   {
+      void *p = malloc(size);
+      if (NULL != p)
+      {
+         return p;
+      }
+
+      // as the standard operator new does, let the new handler free some memory and retry
+      std::new_handler handler = std::get_new_handler();
+      if (NULL == handler)
+      {
+         throw std::bad_alloc();
+      }
+      handler();
+   }
+}
+
+void operator delete(void *p) noexcept
+{
+   free(p);
+}
+
+void operator delete(void *p, size_t) noexcept
+{
+   free(p);
+}
+#endif
+
+
 // Function prototypes
 int enableDisableHeater(int heaterIndex, bool enabled);
+int initIIOBufferedCapture();
+void buildTempFromRawCountsTable(int rtdIndex);
+void setHeaterTemperature(int heaterIndex, int rawCounts);
+void initSensorSnapshot();
+int initHistory();
+void historyAccumulatorStart(HISTORY_ACCUMULATOR *accumulator, const HISTORY_SAMPLE *sample, uint32_t nowSeconds);
+void historyAccumulatorAdd(HISTORY_ACCUMULATOR *accumulator, const HISTORY_SAMPLE *sample);
+void historyAccumulatorFinish(const HISTORY_ACCUMULATOR *accumulator, HISTORY_AGGREGATE *aggregate);
+uint32_t historyRingPush(HISTORY_RING *ring, uint32_t size);
+void recordHistorySample();
+void recordFlightFrame();
+int runSubprocess(const char *name, const char *command, uint32_t timeoutSeconds, std::atomic<int> *status);
+int startSubprocess(const char *command, pid_t *pid);
+int runSubprocessNow(const char *name, const char *command, uint32_t timeoutSeconds);
+bool pollSubprocess(pid_t pid, const struct timespec *start, uint32_t timeoutSeconds, int *status);
+bool reapUrgentSubprocesses();
+int heaterDataScan(int *newest, int *oldest);
+void heaterDataClose();
+int heaterDataCopy(const char *source, const char *destination);
+void heaterDataRotate();
+void publishSensorSnapshot(const SENSOR_SNAPSHOT *snapshot);
+void getSensorSnapshot(SENSOR_SNAPSHOT *snapshot);
+int16_t snapshotAmbientTemp(const SENSOR_SNAPSHOT *snapshot);
+int initSensorScanSignal();
+void signalSensorScan();
+bool waitForSensorScan(uint32_t *lastScanCount);
+void recordHeaterLatency();
+void addMicrosecondsToTimespec(struct timespec *ts, uint32_t microseconds);
+int64_t timespecDiffMicroseconds(const struct timespec *a, const struct timespec *b);
+void initPeriodicTask(PERIODIC_TASK *task, const char *name, uint32_t periodMicroseconds);
+void advancePeriodicTask(PERIODIC_TASK *task);
+void recordPeriodicTaskJitter(PERIODIC_TASK *task);
+void waitPeriodicTask(PERIODIC_TASK *task);
+void logPeriodicTaskStats(const PERIODIC_TASK *task);
+void logThreadsAndMemory();
+void logCSSStreamStats();
+int receiveZMQMessage(void *socket, zmq_msg_t *msg, int flags, const char *receiver);
+int addGUISession(const char *ipAddress);
+uint32_t monotonicSeconds();
+void markGUISessionHeard(GUI_SESSION *session);
+uint32_t guiSessionSecondsSinceHeard(const GUI_SESSION *session);
+GUI_SESSION *findGUISession(const char *ipAddress);
+void *openGUISubscriber(const GUI_SESSION *session, int port, const char *topic, const char *name);
+void openGUISession(GUI_SESSION *session);
+void closeGUISession(GUI_SESSION *session);
+int openGUISessions(zmq_pollitem_t *items, ZMQ_REACTOR_SOCKET *sockets);
+void dispatchGUISessionMessages(zmq_pollitem_t *items, const ZMQ_REACTOR_SOCKET *sockets, int numSockets, zmq_msg_t *message, const char *receiver);
+void logGUISessionStats();
+void handleHeartBeat(GUI_SESSION *session, const char *message, int length);
+int ecoModeOnHeaters(int channelIndexTopHeater, int channelIndexBottomHeater);
+int ecoModeOffHeaters(int channelIndexTopHeater, int channelIndexBottomHeater);
+uint16_t setEcoModeSetpoint(uint32_t temperature);
+uhc::SystemCommandResponses validateBatchOperation(const BatchOperation &op);
+int applyBatchOperation(const BatchOperation &op);
+uhc::SystemCommandResponses processBatchCommand(const SystemCommand &systemCommand);
+uhc::SystemCommandResponses processHistoryQuery(const SystemCommand &systemCommand);
+void fillCommandResponse(const SystemCommand &command, uhc::SystemCommandResponses ret, uint32_t sequenceNumber, SystemCommandResponse *cr);
+void handleSystemCommand(GUI_SESSION *session, const char *message, int length);
+void openCommandRouter();
+void handleRouterCommand(const void *identity, size_t identityLength, bool delimited, const char *message, int length);
+void sendRouterResponse(const void *identity, size_t identityLength, bool delimited, const void *response, size_t length);
+void finishRouterCommand(const SystemCommand &command);
+void serviceCommandRouter(zmq_msg_t *message);
+void handleTimeSync(GUI_SESSION *session, const char *message, int length);
+void *cssArenaBlockAlloc(size_t size);
+void cssArenaBlockDealloc(void *block, size_t size);
+void openStatusPublisher();
+bool messagePartChanged(const google::protobuf::MessageLite &part, char *last, size_t lastSize, size_t *lastLength);
+void findSystemStateChanges(CurrentSystemState &s, bool *systemDataChanged, bool *slotChanged);
+bool serializeSystemStateDelta(const CurrentSystemState &s, bool systemDataChanged, const bool *slotChanged, size_t *length);
+void raiseAlarm(uhc::AlarmCode code, const char *errorCode, int slotNumber, const char *location);
+void publishSystemState();
+void openRTDPublisher();
+void publishRTDs();
+uint32_t readRTDStreamRate();
+uint32_t rtdStreamScansPerSecond(uint32_t requestedHz);
+void openRTDStreamPublisher();
+void publishRTDStream(const RTD_STREAM_BATCH *batch);
+void addRTDStreamScan(RTD_STREAM_BATCH *batch, const int *rawCounts, uint32_t rateHz);
+void closeIIOBufferedCapture();
 int turnHeaterOnOff(int heaterIndex, uhc::HeaterState on);
 
 const char *labels[NUM_RTDs] = { "Heater 0  Slot 1 Top   ",
@@ -231,7 +500,8 @@ enum log_type_t
 enum internal_event_t
 {
    STARTUP_COMPLETE_T,
-   TIMESYNC_RECEIVED_T
+   TIMESYNC_RECEIVED_T,
+   SUBPROCESS_EXITED_T
 };
 
 struct error_event_t
@@ -258,12 +528,97 @@ struct error_event_t
       struct internal_event_data_t
       {
          internal_event_t event;
+         char description[LOGERROR_DESCR_SIZE];
       } internal_event_data;
    } data;
 };
 
-#define MAX_LOG_QUEUE_ELEMENTS   16
-static SafeQueue<error_event_t, MAX_LOG_QUEUE_ELEMENTS> log_queue;
+// written from the ADC and heater threads, so a put must never wait on a lock; must be a power of two
+#define MAX_LOG_QUEUE_ELEMENTS   64
+#define LOG_DRAIN_MAX            16       // events the logger writes per file open
+#define LOG_ERROR_EVENT_STR_SIZE (LOGERROR_LOCATION_SIZE + LOGERROR_DESCR_SIZE + 32)   // Add space for the error code
+#define RECENT_ERRORS_LINE_SIZE  (TIME_STR_SIZE + LOG_ERROR_EVENT_STR_SIZE)
+static_assert(LOG_DRAIN_MAX <= RECENT_ERRORS_MAX, "a batch of errors must fit in the recent errors");
+static LockFreeQueue<error_event_t, MAX_LOG_QUEUE_ELEMENTS> log_queue;
+
+struct alarm_event_t
+{
+   uint32_t alarm_id;
+   uhc::AlarmCode alarm_code;
+   char error_code[ERROR_CODE_LENGTH + 1];
+   int slot_number;                    // 0 if the alarm is not for a shelf
+   char location[LOGERROR_LOCATION_SIZE];
+   struct timeval timestamp;
+   struct timespec detected;           // CLOCK_MONOTONIC, for the detection to send latency
+};
+
+#define MAX_ALARM_QUEUE_ELEMENTS   16
+#define ALARM_QUEUE_TIMEOUT_MS     1000
+#define ALARM_SEND_FAIL_LOG_INTERVAL_SECONDS  60   // at most one syslog per interval for failed sends
+// Written from readADCThread and heaterControlThread, so a put must never wait on a lock.
+// MAX_ALARM_QUEUE_ELEMENTS must be a power of two.
+static LockFreeQueue<alarm_event_t, MAX_ALARM_QUEUE_ELEMENTS> alarm_queue;
+
+// RTDStream batches from readADCThread for rtdStreamThread to publish, so the lookups,
+// serialization and zmq_send stay out of the scan period.
+// MAX_RTD_STREAM_QUEUE_ELEMENTS must be a power of two.
+#define MAX_RTD_STREAM_QUEUE_ELEMENTS   8
+#define RTD_STREAM_QUEUE_TIMEOUT_MS     1000
+static LockFreeQueue<RTD_STREAM_BATCH, MAX_RTD_STREAM_QUEUE_ELEMENTS> rtd_stream_queue;
+
+struct subprocess_request_t
+{
+   char name[SUBPROCESS_NAME_SIZE];    // for the logs
+   char command[COMMAND_LINE_BUFFER_SIZE];
+   uint32_t timeout_seconds;
+   std::atomic<int> *status;           // if not NULL, set to the exit status when it finishes
+   internal_event_t event;             // logged with how it went, SUBPROCESS_EXITED_T unless it is the point of it
+   struct timespec queued;             // CLOCK_MONOTONIC
+};
+
+#define MAX_SUBPROCESS_QUEUE_ELEMENTS   16
+#define SUBPROCESS_QUEUE_TIMEOUT_MS     1000
+#define SUBPROCESS_POLL_MAX_MS          100
+static SafeQueue<subprocess_request_t, MAX_SUBPROCESS_QUEUE_ELEMENTS> subprocess_queue;
+
+// started by runSubprocessNow rather than queued, reaped by subprocessThread
+#define URGENT_SUBPROCESS_SLOTS         4
+#define URGENT_SUBPROCESS_CLAIMED       (-1)
+static subprocess_request_t urgentSubprocesses[URGENT_SUBPROCESS_SLOTS];     // set before the slot's pid
+static std::atomic<pid_t> urgentSubprocessPids[URGENT_SUBPROCESS_SLOTS];     // 0 if free, URGENT_SUBPROCESS_CLAIMED while it is being started
+
+// the status/error/event log file, kept open by the logger thread from one record to the next
+struct log_writer_t
+{
+   FILE *fp;
+   char name[MAX_FILE_PATH];
+   char buffer[LOG_WRITE_BUFFER_SIZE];
+   long flushed_offset;                // file offset of the end of the last flush
+   uint32_t first_unflushed_seconds;   // monotonicSeconds() of the oldest buffered record, 0 if none
+   bool binary;                        // today's file is the eeslog.h binary format rather than CSV
+   EESLOG_BLOCK block;                 // binary records not yet handed to the file
+};
+static log_writer_t logWriter;
+static std::atomic<bool> logWriterReopen(false);   // the SD card came or went, reopen the log file
+
+std::atomic<uint32_t> logFileBytesToday(0);
+std::atomic<uint32_t> logFileFlushes(0);
+std::atomic<uint32_t> logFileOpens(0);
+std::atomic<uint32_t> logFlushLatencyMicroseconds(0);
+std::atomic<uint32_t> logFlushLatencyMaxMicroseconds(0);
+
+// the most recent 25 errors, newest first, kept by the logger thread and rewritten to RECENT_ERRORS_FILE
+struct recent_errors_t
+{
+   char lines[RECENT_ERRORS_MAX][RECENT_ERRORS_LINE_SIZE];
+   int count;
+   bool loaded;                        // lines holds what is in RECENT_ERRORS_FILE on the current card
+};
+static recent_errors_t recentErrors;
+
+std::atomic<uint32_t> recentErrorsWrites(0);
+std::atomic<uint32_t> recentErrorsLatencyMicroseconds(0);
+std::atomic<uint32_t> recentErrorsLatencyMaxMicroseconds(0);
 
 static const char *systemStatusStr();
 static const char *slotStatusStr(int slot_number);
@@ -275,17 +630,31 @@ static date_t currentDateGet();
 static inline bool datesEqual(const date_t &date1, const date_t &date2);
 static void logfileNameCreate(char *name, size_t name_len, date_t date);
 static FILE *logfileOpen(const char *name);
+static FILE *logWriterOpen(const char *name);
+static void logWriterRecordDone(bool flushNow);
+static void logWriterFlush();
+static void logWriterClose();
+static void logBinaryFinishBlock();
+static void logBinaryTextWrite(const char *text, size_t len);
+static void logBinaryEventWrite(struct timeval timestamp, uint8_t column, const char *text);
+static void logBinaryStatusWrite(const SENSOR_SNAPSHOT *snapshot);
 static void logHeaderWrite(const char *name);
-static void logErrorEventWrite(const char *name, const error_event_t &ee);
+static void logErrorEventsWrite(const char *name, const error_event_t *ees, int count);
 static void logStatusWrite(const char *name);
 static int logCommandEvent(uhc::SystemCommands command, const ::std::string &sender_ip_address);
 static int logCommandEvent(uhc::SystemCommands command, const ::std::string &sender_ip_address, int data1);
 static int logCommandEvent(uhc::SystemCommands command, const ::std::string &sender_ip_address, int data1, int data2);
 static int logCommandEvent(uhc::SystemCommands command, const ::std::string &sender_ip_address, int data1, int data2, int data3);
 static int logInternalEvent(internal_event_t event);
+static int logInternalEvent(internal_event_t event, const char *description);
+int runSubprocessNow(const char *name, const char *command, uint32_t timeoutSeconds, internal_event_t event);
 static int logError(char const *error_code, char const *location, char const *description);
-static void logAppendRecentErrors(struct timeval timestamp, const char *errorstr);
+static void recentErrorsLoad();
+static void logAppendRecentErrors(const struct timeval *timestamps, char (*errorstrs)[LOG_ERROR_EVENT_STR_SIZE], int count);
 static void logStop();
+static void flightRecorderTriggerDump(const char *error_code);
+static void flightRecorderService();
+static void flightRecorderDump(uint32_t triggerFrame, const char *error_code);
 
 // One of these lookup tables MUST be included or the code won't build
 #define LOOKUPTABLEHP   1
@@ -310,45 +679,14 @@ static __attribute__((noreturn)) void closeProgram()
       (void)zmq_close (subscriber);
       subscriber = NULL;
    }
-   if (timeSyncSubscriber != NULL)
+   for (int i = 0; i < numGUISessions; i++)
    {
-      (void)zmq_close (timeSyncSubscriber);
-      timeSyncSubscriber = NULL;
+      closeGUISession(&guiSessions[i]);
    }
-   if (timeSyncSubscriber2 != NULL)
+   if (commandRouter != NULL)
    {
-      (void)zmq_close (timeSyncSubscriber2);
-      timeSyncSubscriber2 = NULL;
-   }
-   if (heartBeatListener != NULL)
-   {
-      (void)zmq_close (heartBeatListener);
-      heartBeatListener = NULL;
-   }
-   if (heartBeatListener2 != NULL)
-   {
-      (void)zmq_close (heartBeatListener2);
-      heartBeatListener2 = NULL;
-   }
-   if (commandListener != NULL)
-   {
-      (void)zmq_close (commandListener);
-      commandListener = NULL;
-   }
-   if (commandListener2 != NULL)
-   {
-      (void)zmq_close (commandListener2);
-      commandListener2 = NULL;
-   }
-   if (commandResponsePublisher != NULL)
-   {
-      (void)zmq_close (commandResponsePublisher);
-      commandResponsePublisher = NULL;
-   }
-   if (commandResponsePublisher2 != NULL)
-   {
-      (void)zmq_close (commandResponsePublisher2);
-      commandResponsePublisher2 = NULL;
+      (void)zmq_close (commandRouter);
+      commandRouter = NULL;
    }
    if (firmwareUpdateListener != NULL)
    {
@@ -365,6 +703,7 @@ static __attribute__((noreturn)) void closeProgram()
       (void)zmq_close (rtdPublisher);
       rtdPublisher = NULL;
    }
+   closeIIOBufferedCapture();
    if (context != NULL)
    {
       (void)zmq_ctx_destroy (context);
@@ -548,119 +887,66 @@ bool logDirectoryExists(char const *dirname)
 
 /*******************************************************************************************/
 /*                                                                                         */
-/* int getFileCount()                                                                      */
+/* int heaterDataScan(int *newest, int *oldest)                                            */
 /*                                                                                         */
-/* Gets the current count of heater data log files                                         */
+/* Finds the heaterData<n>.csv files in the log directory, and the numbers of the newest   */
+/* and oldest of them by modification time. newest and oldest are left 0 if there are      */
+/* none.                                                                                   */
 /*                                                                                         */
-/* Returns: int fc                                                                         */
+/* Returns: int count of heater data files                                                 */
 /*                                                                                         */
 /*******************************************************************************************/
-int getFileCount()
+int heaterDataScan(int *newest, int *oldest)
 {
-   int fc = 0;
-   char commandLine[COMMAND_LINE_BUFFER_SIZE];
+   int count = 0;
+   struct timespec newestTime = { 0, 0 };
+   struct timespec oldestTime = { 0, 0 };
 
-   (void)snprintf(commandLine, sizeof(commandLine) - 1, GET_FILE_COUNT, HENNYPENNY_HEATER_DATA_FILES, FILE_COUNT_FILE);
-   (void)unlink(FILE_COUNT_FILE);
-   sync();
-   int ret = system(commandLine);
-   if (0 == ret)
-   {
-      FILE *fp = fopen(FILE_COUNT_FILE, "r");
-      if (fp != NULL)
-      {
-         char buf[32];
-         (void)fread(buf, 1, sizeof(buf) - 1, fp);
-         fc = atoi(buf);
-      }
-      else
-      {
-         (void)printf("%s doesn't exist\n", FILE_COUNT_FILE);
-      }
+   *newest = 0;
+   *oldest = 0;
 
+   DIR *dir = opendir(HENNYPENNY_LOG_DIRECTORY);
+   if (NULL == dir)
+   {
+      return 0;
    }
 
-   return fc;
-}
-
-
-/*******************************************************************************************/
-/*                                                                                         */
-/* int getNewestFile(char *newestFile)                                                     */
-/*                                                                                         */
-/* Gets the filename of the newest log file                                                */
-/*                                                                                         */
-/* Returns: int ret - 0 = success, 1 = failure                                             */
-/*                                                                                         */
-/*******************************************************************************************/
-int getNewestFile(char *newestFile, size_t newestFile_len)
-{
-   int ret = 0;
-   char commandLine[COMMAND_LINE_BUFFER_SIZE];
-
-   (void)snprintf(commandLine, sizeof(commandLine) - 1, GET_NEWEST_LOG_FILE, NEWEST_FILENAME_FILE);
-   (void)unlink(NEWEST_FILENAME_FILE);
-   sync();
-   ret = system(commandLine);
-   if (0 == ret)
+   struct dirent *entry;
+   while (NULL != (entry = readdir(dir)))
    {
-      FILE *fp = fopen(NEWEST_FILENAME_FILE, "r");
-      if (fp != NULL)
+      int number = 0;
+      int length = 0;
+      if ((1 != sscanf(entry->d_name, HEATER_DATA_FILE_NAME "%n", &number, &length)) || ('\0' != entry->d_name[length]) ||
+          (number < 1) || (number > MAX_HEATER_DATA_FILES))
       {
-         char buf[MAX_FILE_PATH];
-         (void)memset(buf, 0, sizeof(buf));
-         (void)fread(buf, 1, sizeof(buf) - 1, fp);
-         (void)removeCRLF(buf, sizeof(buf));
-         (void)strncpy(newestFile, buf, newestFile_len);
+         continue;
       }
-      else
+
+      char path[MAX_FILE_PATH];
+      struct stat st;
+      (void)snprintf(path, sizeof(path), HEATER_DATA_TARGET_FILE, number);
+      if ((0 != stat(path, &st)) || !S_ISREG(st.st_mode))
       {
-         (void)printf("%s doesn't exist\n", NEWEST_FILENAME_FILE);
-         ret = 1;
+         continue;
       }
-   }
 
-   return ret;
-}
-
-
-/*******************************************************************************************/
-/*                                                                                         */
-/* int getNextFilename(char *filename)                                                     */
-/*                                                                                         */
-/* Gets the next filename to use for heater logging                                        */
-/*                                                                                         */
-/* Returns: int ret - 0 = success, 1 = failure                                             */
-/*                                                                                         */
-/*******************************************************************************************/
-int getOldestFile(char *file, size_t file_len)
-{
-   int ret = 0;
-   char commandLine[COMMAND_LINE_BUFFER_SIZE];
-
-   (void)snprintf(commandLine, sizeof(commandLine) - 1, GET_OLDEST_LOG_FILE, OLDEST_FILENAME_FILE);
-   (void)unlink(OLDEST_FILENAME_FILE);
-   sync();
-   ret = system(commandLine);
-   if (0 == ret)
-   {
-      FILE *fp = fopen(OLDEST_FILENAME_FILE, "r");
-      if (fp != NULL)
+      if ((0 == count) || (st.st_mtim.tv_sec > newestTime.tv_sec) ||
+          ((st.st_mtim.tv_sec == newestTime.tv_sec) && (st.st_mtim.tv_nsec > newestTime.tv_nsec)))
       {
-         char buf[MAX_FILE_PATH];
-         (void)memset(buf, 0, sizeof(buf));
-         (void)fread(buf, 1, sizeof(buf) - 1, fp);
-         (void)removeCRLF(buf, sizeof(buf));
-         (void)strncpy(file, buf, file_len);
+         *newest = number;
+         newestTime = st.st_mtim;
       }
-      else
+      if ((0 == count) || (st.st_mtim.tv_sec < oldestTime.tv_sec) ||
+          ((st.st_mtim.tv_sec == oldestTime.tv_sec) && (st.st_mtim.tv_nsec < oldestTime.tv_nsec)))
       {
-         (void)printf("%s doesn't exist\n", OLDEST_FILENAME_FILE);
-         ret = 1;
+         *oldest = number;
+         oldestTime = st.st_mtim;
       }
+      count++;
    }
+   (void)closedir(dir);
 
-   return ret;
+   return count;
 }
 
 
@@ -668,7 +954,8 @@ int getOldestFile(char *file, size_t file_len)
 /*                                                                                         */
 /* int getNextFilename(char *filename)                                                     */
 /*                                                                                         */
-/* Gets the next filename to use for heater logging                                        */
+/* Gets the next filename to use for heater logging: the one after the newest, or the      */
+/* oldest once there are MAX_HEATER_DATA_FILES of them                                     */
 /*                                                                                         */
 /* Returns: int ret - 0 = success, 1 = failure                                             */
 /*                                                                                         */
@@ -676,45 +963,23 @@ int getOldestFile(char *file, size_t file_len)
 int getNextFilename(char *filename, size_t filename_len)
 {
    int ret = 0;
-   char nextFilename[MAX_FILE_PATH];
-   char lastFilename[MAX_FILE_PATH];
+   int newest = 0;
+   int oldest = 0;
+   int next = 1;
 
-   int fileCount = getFileCount();
-   if (0 == fileCount)
+   int fileCount = heaterDataScan(&newest, &oldest);
+   if (fileCount >= MAX_HEATER_DATA_FILES)
    {
-      (void)snprintf(nextFilename, sizeof(nextFilename) - 1, HEATER_DATA_TARGET_FILE, 1);
-      (void)strncpy(filename, nextFilename, filename_len);
+      next = oldest;
    }
-   else
+   else if (0 != fileCount)
    {
-      if (MAX_HEATER_DATA_FILES == fileCount)
-      {
-         (void)getOldestFile(lastFilename, sizeof(lastFilename));
-         (void)strncpy(filename, lastFilename, filename_len);
-         (void)unlink(lastFilename);
-      }
-      else
-      {
-         (void)getNewestFile(lastFilename, sizeof(lastFilename));
-         int idNumber = atoi(&lastFilename[strlen(lastFilename) - 5]);
-
-         switch (idNumber)
-         {
-            case 1:
-            case 2:
-            case 3:
-            case 4:
-            default:
-               (void)snprintf(nextFilename, sizeof(nextFilename) - 1, HEATER_DATA_TARGET_FILE, idNumber + 1);
-               break;
-
-            case 5:
-               (void)snprintf(nextFilename, sizeof(nextFilename) - 1, HEATER_DATA_TARGET_FILE, 1);
-               break;
-         }
+      next = (newest % MAX_HEATER_DATA_FILES) + 1;
+   }
 
-         (void)strncpy(filename, nextFilename, filename_len);
-      }
+   if (snprintf(filename, filename_len, HEATER_DATA_TARGET_FILE, next) >= (int)filename_len)
+   {
+      ret = 1;
    }
 
    return ret;
@@ -1267,10 +1532,191 @@ int initADCData()
       ret = 1;
    }
 
+   // try to switch the RTD scan over to buffered capture
+   // if it can't be set up, the sysfs text files opened above are used instead
+   if (access(IIO_BUFFERED_CAPTURE_DISABLE_FILE, F_OK) == 0)
+   {
+      syslog(LOG_NOTICE, "IIO buffered capture disabled by %s", IIO_BUFFERED_CAPTURE_DISABLE_FILE);
+   }
+   else if (0 == initIIOBufferedCapture())
+   {
+      iioBufferedCapture = true;
+      syslog(LOG_NOTICE, "RTD scan using IIO buffered capture");
+   }
+   else
+   {
+      syslog(LOG_WARNING, "IIO buffered capture unavailable - RTD scan using sysfs reads");
+   }
+
+   return ret;
+}
+
+
+/*******************************************************************************************/
+/*                                                                                         */
+/* int writeIIOAttribute(const char *fileName, const char *value)                          */
+/*                                                                                         */
+/* Write a value to one of the IIO sysfs attribute files.                                  */
+/*                                                                                         */
+/* Returns: int ret - 0 = success, 1 = failure                                             */
+/*                                                                                         */
+/*******************************************************************************************/
+int writeIIOAttribute(const char *fileName, const char *value)
+{
+   int ret = 1;
+
+   int fd = open(fileName, O_WRONLY);
+   if (fd >= 0)
+   {
+      if (write(fd, value, strlen(value)) == (ssize_t)strlen(value))
+      {
+         ret = 0;
+      }
+      (void)close(fd);
+   }
+
+   return ret;
+}
+
+
+/*******************************************************************************************/
+/*                                                                                         */
+/* int initIIOBufferedCapture()                                                            */
+/*                                                                                         */
+/* Enable the AIN0 and AIN1 scan elements, size and enable the IIO buffer, and open the    */
+/* IIO character device the binary scan frames are read from.                              */
+/*                                                                                         */
+/* Returns: int ret - 0 = success, 1 = failure                                             */
+/*                                                                                         */
+/*******************************************************************************************/
+int initIIOBufferedCapture()
+{
+   int ret = 0;
+   char fileName[MAX_FILE_PATH];
+
+   // the buffer has to be disabled while the scan elements and length are changed
+   (void)writeIIOAttribute(IIO_BUFFER_ENABLE_PATH, IIO_DISABLE_STRING);
+
+   (void)memset(fileName, 0, sizeof(fileName));
+   (void)snprintf(fileName, sizeof(fileName), IIO_SCAN_ELEMENT_ENABLE_PATH, AIN0_CHANNEL);
+   ret |= writeIIOAttribute(fileName, IIO_ENABLE_STRING);
+
+   (void)memset(fileName, 0, sizeof(fileName));
+   (void)snprintf(fileName, sizeof(fileName), IIO_SCAN_ELEMENT_ENABLE_PATH, AIN1_CHANNEL);
+   ret |= writeIIOAttribute(fileName, IIO_ENABLE_STRING);
+
+   ret |= writeIIOAttribute(IIO_BUFFER_LENGTH_PATH, IIO_BUFFER_LENGTH_STRING);
+
+   if (0 == ret)
+   {
+      ret = writeIIOAttribute(IIO_BUFFER_ENABLE_PATH, IIO_ENABLE_STRING);
+   }
+
+   if (0 == ret)
+   {
+      // non-blocking so stale frames can be drained; poll() waits for fresh ones
+      fd_iioDevice = open(IIO_DEVICE_PATH, O_RDONLY | O_NONBLOCK);
+      if (fd_iioDevice < 0)
+      {
+         ret = 1;
+      }
+   }
+
+   if (0 != ret)
+   {
+      closeIIOBufferedCapture();
+   }
+
    return ret;
 }
 
 
+/*******************************************************************************************/
+/*                                                                                         */
+/* void closeIIOBufferedCapture()                                                          */
+/*                                                                                         */
+/* Close the IIO character device and disable the buffer. While the buffer is enabled the  */
+/* driver rejects the sysfs raw reads, so this must be done before falling back to them.   */
+/*                                                                                         */
+/* Returns: None                                                                           */
+/*                                                                                         */
+/*******************************************************************************************/
+void closeIIOBufferedCapture()
+{
+   iioBufferedCapture = false;
+
+   if (fd_iioDevice >= 0)
+   {
+      (void)close(fd_iioDevice);
+      fd_iioDevice = -1;
+   }
+
+   (void)writeIIOAttribute(IIO_BUFFER_ENABLE_PATH, IIO_DISABLE_STRING);
+}
+
+
+/*******************************************************************************************/
+/*                                                                                         */
+/* int readIIOScan(const struct timespec *muxSwitched, uint16_t *samples)                  */
+/*                                                                                         */
+/* Read one fresh AIN0/AIN1 scan frame from the IIO buffer. Waits until IIO_SETTLE_US      */
+/* after the mux was switched (CLOCK_MONOTONIC muxSwitched), then drains and discards the  */
+/* frames captured before that, along with the next IIO_DISCARD_FRAMES.                    */
+/*                                                                                         */
+/* Returns: int ret - 0 = success, 1 = failure                                             */
+/*                                                                                         */
+/*******************************************************************************************/
+int readIIOScan(const struct timespec *muxSwitched, uint16_t *samples)
+{
+   uint8_t flushBuffer[IIO_FLUSH_BUFFER_SIZE];
+   uint8_t frame[IIO_SCAN_FRAME_SIZE];
+   struct pollfd poll_iio;
+
+   if (fd_iioDevice < 0)
+   {
+      return 1;
+   }
+
+   // give the PGA117 output time to settle after the channel switch; a frame count alone
+   // depends on the sampling frequency. By the time the SPI write returns this has usually
+   // passed already, and clock_nanosleep returns at once.
+   struct timespec settled = *muxSwitched;
+   addMicrosecondsToTimespec(&settled, IIO_SETTLE_US);
+   while (EINTR == clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &settled, NULL))
+   {
+      // interrupted by a signal, keep waiting for the same deadline
+   }
+
+   // drain whatever the ADC captured while the mux output settled
+   while (read(fd_iioDevice, flushBuffer, sizeof(flushBuffer)) > 0)
+   {
+   }
+
+   // the first new frame may have started converting before the settle ended, so skip it too
+   for (int i = 0; i <= IIO_DISCARD_FRAMES; i++)
+   {
+      poll_iio.fd = fd_iioDevice;
+      poll_iio.events = POLLIN;
+      poll_iio.revents = 0;
+      if (poll(&poll_iio, 1, IIO_READ_TIMEOUT_MS) != 1)
+      {
+         return 1;
+      }
+
+      if (read(fd_iioDevice, frame, sizeof(frame)) != (ssize_t)sizeof(frame))
+      {
+         return 1;
+      }
+   }
+
+   // samples are little-endian, AIN0 first
+   samples[AIN0_CHANNEL] = (uint16_t)(frame[0] | (frame[1] << 8)) & IIO_SAMPLE_MASK;
+   samples[AIN1_CHANNEL] = (uint16_t)(frame[2] | (frame[3] << 8)) & IIO_SAMPLE_MASK;
+
+   return 0;
+}
+
+
 /*******************************************************************************************/
 /*                                                                                         */
 /* int initRTDMappings()                                                                   */
@@ -1541,6 +1987,11 @@ int initRTDMappings()
    (void)strncpy(rtdMappings[i].temp_data_filename, TEMPERATURE_LOOKUP_FILENAME_RTD_BOARD, sizeof(rtdMappings[i].temp_data_filename));
    (void)memcpy(rtdMappings[i].temp_lookup_table, tempLookupTable, sizeof(rtdMappings[i].temp_lookup_table));
 
+   for (i = 0; i < NUM_RTDs; i++)
+   {
+      buildTempFromRawCountsTable(i);
+   }
+
    return 0;
 
 }
@@ -1548,46 +1999,107 @@ int initRTDMappings()
 
 /*******************************************************************************************/
 /*                                                                                         */
-/* int lookupTempFromRawCounts(int rawCounts, rtdIndex)                                    */
+/* void buildTempFromRawCountsTable(int rtdIndex)                                          */
 /*                                                                                         */
-/* Calculates the temperature in farenheit from the supplied ADC raw counts for the        */
-/* specified RTD. This allows individual RTDs to have their own calibration data.          */
+/* Expands the calibration lookup table of the specified RTD into one entry per possible   */
+/* ADC raw count, so converting a reading is a single array access. Each entry is the      */
+/* temperature in tenths of a degree, linearly interpolated between the two table rows     */
+/* that bracket the raw count and rounded down, so dividing by TEMP_TENTHS_PER_DEGREE      */
+/* gives the same whole degree as the bracket itself. Counts below the first entry         */
+/* (shorted) or above the last entry (open) hold TEMP_OUT_OF_RANGE_TENTHS. Must be called  */
+/* again whenever temp_lookup_table changes.                                               */
 /*                                                                                         */
-/* Returns: int temp (-1 if out of range)                                                  */
+/* Returns: None                                                                           */
 /*                                                                                         */
 /*******************************************************************************************/
-int lookupTempFromRawCounts(int rawCounts, int rtdIndex)
+void buildTempFromRawCountsTable(int rtdIndex)
 {
-   int temp = -1;
+   TEMP_LOOKUP_TABLE *tlt = rtdMappings[rtdIndex].temp_lookup_table;
+   int entry = 0;
 
-   if ((rawCounts < rtdMappings[rtdIndex].temp_lookup_table[0].adc_raw_counts) || (rawCounts > rtdMappings[rtdIndex].temp_lookup_table[NUM_TEMP_LOOKUP_ENTRIES-1].adc_raw_counts))
-   {
-      // out of range
-      temp = -1;
-   }
-   else if (rawCounts == rtdMappings[rtdIndex].temp_lookup_table[0].adc_raw_counts)
+   for (int rawCounts = 0; rawCounts < ADC_NUM_RAW_COUNTS; rawCounts++)
    {
-      temp = rtdMappings[rtdIndex].temp_lookup_table[0].degreesF;
-   }
-   else if (rawCounts == rtdMappings[rtdIndex].temp_lookup_table[NUM_TEMP_LOOKUP_ENTRIES-1].adc_raw_counts)
-   {
-      temp = rtdMappings[rtdIndex].temp_lookup_table[NUM_TEMP_LOOKUP_ENTRIES-1].degreesF;
-   }
-   else
-   {
-      bool found = false;
-      for (int i = 0; (i < (int)NUM_TEMP_LOOKUP_ENTRIES) && !found; i++)
+      if ((rawCounts < tlt[0].adc_raw_counts) || (rawCounts > tlt[NUM_TEMP_LOOKUP_ENTRIES-1].adc_raw_counts))
+      {
+         // out of range
+         rtdMappings[rtdIndex].temp_tenths_from_raw_counts[rawCounts] = TEMP_OUT_OF_RANGE_TENTHS;
+      }
+      else
       {
-         if ((rawCounts >= rtdMappings[rtdIndex].temp_lookup_table[i].adc_raw_counts) && (rawCounts < rtdMappings[rtdIndex].temp_lookup_table[i+1].adc_raw_counts))
+         // the temperature is the entry whose bracket [entry, entry+1) holds the raw count
+         while ((entry < (int)(NUM_TEMP_LOOKUP_ENTRIES-1)) && (rawCounts >= tlt[entry+1].adc_raw_counts))
          {
-            // we've found the correct value
-            found = true;
-            temp = rtdMappings[rtdIndex].temp_lookup_table[i].degreesF;
+            entry++;
          }
+
+         int tenths = tlt[entry].degreesF * TEMP_TENTHS_PER_DEGREE;
+         if (entry < (int)(NUM_TEMP_LOOKUP_ENTRIES-1))
+         {
+            // interpolate across the segment; the degree step and count span come from the table itself
+            int segmentTenths = (tlt[entry+1].degreesF - tlt[entry].degreesF) * TEMP_TENTHS_PER_DEGREE;
+            int segmentCounts = tlt[entry+1].adc_raw_counts - tlt[entry].adc_raw_counts;
+            tenths += (segmentTenths * (rawCounts - tlt[entry].adc_raw_counts)) / segmentCounts;
+         }
+         rtdMappings[rtdIndex].temp_tenths_from_raw_counts[rawCounts] = (int16_t)tenths;
       }
    }
+}
+
+
+/*******************************************************************************************/
+/*                                                                                         */
+/* int lookupTempTenthsFromRawCounts(int rawCounts, rtdIndex)                              */
+/*                                                                                         */
+/* Calculates the temperature in tenths of a degree farenheit from the supplied ADC raw    */
+/* counts for the specified RTD, interpolated between the calibration table entries.       */
+/*                                                                                         */
+/* Returns: int tenths (TEMP_OUT_OF_RANGE_TENTHS if out of range)                          */
+/*                                                                                         */
+/*******************************************************************************************/
+int lookupTempTenthsFromRawCounts(int rawCounts, int rtdIndex)
+{
+   if ((rawCounts < 0) || (rawCounts >= ADC_NUM_RAW_COUNTS))
+   {
+      // failed read
+      return TEMP_OUT_OF_RANGE_TENTHS;
+   }
+
+   return rtdMappings[rtdIndex].temp_tenths_from_raw_counts[rawCounts];
+}
+
+
+/*******************************************************************************************/
+/*                                                                                         */
+/* int lookupTempFromRawCounts(int rawCounts, rtdIndex)                                    */
+/*                                                                                         */
+/* Calculates the temperature in farenheit from the supplied ADC raw counts for the        */
+/* specified RTD. This allows individual RTDs to have their own calibration data.          */
+/*                                                                                         */
+/* Returns: int temp (-1 if out of range)                                                  */
+/*                                                                                         */
+/*******************************************************************************************/
+int lookupTempFromRawCounts(int rawCounts, int rtdIndex)
+{
+   return lookupTempTenthsFromRawCounts(rawCounts, rtdIndex) / TEMP_TENTHS_PER_DEGREE;
+}
+
+
+/*******************************************************************************************/
+/*                                                                                         */
+/* void setHeaterTemperature(int heaterIndex, int rawCounts)                               */
+/*                                                                                         */
+/* Converts the raw counts read from a heater RTD and stores the result in both whole      */
+/* degrees and tenths of a degree.                                                         */
+/*                                                                                         */
+/* Returns: None                                                                           */
+/*                                                                                         */
+/*******************************************************************************************/
+void setHeaterTemperature(int heaterIndex, int rawCounts)
+{
+   int tenths = lookupTempTenthsFromRawCounts(rawCounts, heaterIndex);
 
-   return temp;
+   heaterInfo[heaterIndex].current_temperature_tenths = (int16_t)tenths;
+   heaterInfo[heaterIndex].current_temperature = (int16_t)(tenths / TEMP_TENTHS_PER_DEGREE);
 }
 
 
@@ -1729,6 +2241,7 @@ int readTemperatureLookupFiles()
          if (((NUM_TEMP_LOOKUP_ENTRIES * 2) == count) && (FIRST_TEMPERATURE_ENTRY == tlt[0].degreesF) && (LAST_TEMPERATURE_ENTRY == tlt[NUM_TEMP_LOOKUP_ENTRIES - 1].degreesF))
          {
             (void)memcpy(rtdMappings[i].temp_lookup_table, tlt, sizeof(rtdMappings[i].temp_lookup_table));
+            buildTempFromRawCountsTable(i);
          }
          else
          {
@@ -1747,43 +2260,50 @@ int readTemperatureLookupFiles()
 
 /*******************************************************************************************/
 /*                                                                                         */
-/* int issueSPICommands(int rtd_index)                                                     */
+/* int issueSPICommandsPair(int ain0_rtd_index, int ain1_rtd_index)                        */
 /*                                                                                         */
-/* Builds and issues the SPI commands for the daisy chained PGA117 analog muxes.           */
+/* Builds and issues the SPI commands for the daisy chained PGA117 analog muxes, routing   */
+/* one RTD through mux 0 to AIN0 and another through mux 1 to AIN1 in the same 32 bit      */
+/* write. Pass RTD_SCAN_NO_RTD to park a mux on channel 0 (GND).                           */
 /*                                                                                         */
 /* Returns: int ret - 0 = success, 1 = failure                                             */
 /*                                                                                         */
 /*******************************************************************************************/
-int issueSPICommands(int rtd_index)
+int issueSPICommandsPair(int ain0_rtd_index, int ain1_rtd_index)
 {
    int retVal = 0;
    uint16_t mux1Command = 0;
    uint16_t mux2Command = 0;
 
-   // Select channel 0 (GND) with unity gain as the output for the Mux we're not trying to read
-   if (rtd_index < NUM_RTDS_ON_AIN0)
+   // Select channel 0 (GND) with unity gain as the output for any Mux we're not trying to read
+   if (ain0_rtd_index != RTD_SCAN_NO_RTD)
    {
       /* reading Mux 0 */
       /* Format the commands */
       mux1Command = PGA117_CMD_WRITE |
-         ((uint16_t)rtdMappings[rtd_index].mux_channel << PGA117_CHANNEL_SHIFT) |
-         ((uint16_t)rtdMappings[rtd_index].gain << PGA117_GAIN_SHIFT);
-
-      mux2Command = PGA117_DCCMD_WRITE |
-         ((uint16_t)PGA117_CHANNEL_CH0 << PGA117_CHANNEL_SHIFT) |
-         ((uint16_t)PGA117_GAIN_1 << PGA117_GAIN_SHIFT);
+         ((uint16_t)rtdMappings[ain0_rtd_index].mux_channel << PGA117_CHANNEL_SHIFT) |
+         ((uint16_t)rtdMappings[ain0_rtd_index].gain << PGA117_GAIN_SHIFT);
    }
    else
    {
-      /* reading Mux 1 */
-      /* Format the commands */
       mux1Command = PGA117_CMD_WRITE |
          ((uint16_t)PGA117_CHANNEL_CH0 << PGA117_CHANNEL_SHIFT) |
          ((uint16_t)PGA117_GAIN_1 << PGA117_GAIN_SHIFT);
+   }
 
+   if (ain1_rtd_index != RTD_SCAN_NO_RTD)
+   {
+      /* reading Mux 1 */
+      /* Format the commands */
+      mux2Command = PGA117_DCCMD_WRITE |
+         ((uint16_t)rtdMappings[ain1_rtd_index].mux_channel << PGA117_CHANNEL_SHIFT) |
+         ((uint16_t)rtdMappings[ain1_rtd_index].gain << PGA117_GAIN_SHIFT);
+   }
+   else
+   {
       mux2Command = PGA117_DCCMD_WRITE |
-         ((uint16_t)rtdMappings[rtd_index].mux_channel << PGA117_CHANNEL_SHIFT) |
-         ((uint16_t)rtdMappings[rtd_index].gain << PGA117_GAIN_SHIFT);
+         ((uint16_t)PGA117_CHANNEL_CH0 << PGA117_CHANNEL_SHIFT) |
+         ((uint16_t)PGA117_GAIN_1 << PGA117_GAIN_SHIFT);
    }
 
    // when daisy chained, the second devices' command gets sent first
@@ -1810,54 +2330,233 @@ int issueSPICommands(int rtd_index)
 
 /*******************************************************************************************/
 /*                                                                                         */
-/* int readADCChannel(int rtd_index)                                                       */
+/* int issueSPICommands(int rtd_index)                                                     */
 /*                                                                                         */
-/* Reads the ADC value for the specified RTD.                                              */
+/* Routes a single RTD through its mux and parks the other mux on channel 0.               */
 /*                                                                                         */
-/* Returns: int rawCount                                                                   */
+/* Returns: int ret - 0 = success, 1 = failure                                             */
 /*                                                                                         */
 /*******************************************************************************************/
-int readADCChannel(int rtd_index)
+int issueSPICommands(int rtd_index)
+{
+   if (rtd_index < NUM_RTDS_ON_AIN0)
+   {
+      return issueSPICommandsPair(rtd_index, RTD_SCAN_NO_RTD);
+   }
+
+   return issueSPICommandsPair(RTD_SCAN_NO_RTD, rtd_index);
+}
+
+
+/*******************************************************************************************/
+/*                                                                                         */
+/* int readADCSysfsValue(int fd)                                                           */
+/*                                                                                         */
+/* Reads a raw ADC count from one of the sysfs in_voltage text files.                      */
+/*                                                                                         */
+/* Returns: int rawCount (-1 if the read failed)                                           */
+/*                                                                                         */
+/*******************************************************************************************/
+int readADCSysfsValue(int fd)
+{
+   int rawCount = -1;
+
+   // each time we read a value, we need to rewind the file descriptor back to the beginning of the file
+   // or we'll never read another value
+   (void)lseek(fd, 0, SEEK_SET);
+   char buf[ADC_READ_BUFFER_SIZE];
+   (void)memset(buf, 0, sizeof(buf));
+   int readLen = read(fd, buf, sizeof(buf));
+   if (readLen > 1)
+   {
+      // more than EOL; make sure it's NULL terminated
+      buf[readLen-1] = '\0';
+      rawCount = atoi(buf);
+   }
+
+   return rawCount;
+}
+
+
+/*******************************************************************************************/
+/*                                                                                         */
+/* int readADCRawCount(int rtd_index)                                                      */
+/*                                                                                         */
+/* Routes the specified RTD through its PGA117 and reads back the raw ADC count, either    */
+/* from the IIO buffer or, as the fallback, from the sysfs text file.                      */
+/*                                                                                         */
+/* Returns: int rawCount (-1 if the read failed)                                           */
+/*                                                                                         */
+/*******************************************************************************************/
+int readADCRawCount(int rtd_index)
 {
    int rawCount = -1;
+
+   // issuing the SPI commands routes the RTD data through the PGA to either AIN0 or AIN1 ADC
+   // which is actually the value we need (raw ADC count)
+   (void)issueSPICommands(rtd_index);
+   struct timespec muxSwitched;
+   (void)clock_gettime(CLOCK_MONOTONIC, &muxSwitched);
+
+   if (iioBufferedCapture)
+   {
+      uint16_t samples[NUM_ADC_CHANNELS];
+      if (0 == readIIOScan(&muxSwitched, samples))
+      {
+         return samples[rtdMappings[rtd_index].analog_input_channel];
+      }
+
+      // the buffer stopped delivering frames; the sysfs files can't be read until it's disabled
+      closeIIOBufferedCapture();
+      syslog(LOG_WARNING, "IIO buffered capture failed - RTD scan falling back to sysfs reads");
+   }
+
+   (void)usleep(10000);
+   rawCount = readADCSysfsValue(rtdMappings[rtd_index].fd);
+
+   return rawCount;
+}
+
+
+/*******************************************************************************************/
+/*                                                                                         */
+/* int readADCPair(int ain0_rtd_index, int ain1_rtd_index, int *rawCounts)                 */
+/*                                                                                         */
+/* Routes an RTD on each mux at once, lets both settle together and reads AIN0 and AIN1    */
+/* back to back. The results land in rawCounts[] at the RTD indices.                       */
+/*                                                                                         */
+/* Returns: int ret - 0 = success, 1 = failure                                             */
+/*                                                                                         */
+/*******************************************************************************************/
+int readADCPair(int ain0_rtd_index, int ain1_rtd_index, int *rawCounts)
+{
+   int ret = issueSPICommandsPair(ain0_rtd_index, ain1_rtd_index);
+   struct timespec muxSwitched;
+   (void)clock_gettime(CLOCK_MONOTONIC, &muxSwitched);
+
+   if (iioBufferedCapture)
+   {
+      uint16_t samples[NUM_ADC_CHANNELS];
+      if (0 == readIIOScan(&muxSwitched, samples))
+      {
+         if (ain0_rtd_index != RTD_SCAN_NO_RTD)
+         {
+            rawCounts[ain0_rtd_index] = samples[AIN0_CHANNEL];
+         }
+         if (ain1_rtd_index != RTD_SCAN_NO_RTD)
+         {
+            rawCounts[ain1_rtd_index] = samples[AIN1_CHANNEL];
+         }
+         return ret;
+      }
+
+      // the buffer stopped delivering frames; the sysfs files can't be read until it's disabled
+      closeIIOBufferedCapture();
+      syslog(LOG_WARNING, "IIO buffered capture failed - RTD scan falling back to sysfs reads");
+   }
+
+   // one settling delay covers both muxes
+   (void)usleep(10000);
+   if (ain0_rtd_index != RTD_SCAN_NO_RTD)
+   {
+      rawCounts[ain0_rtd_index] = readADCSysfsValue(rtdMappings[ain0_rtd_index].fd);
+   }
+   if (ain1_rtd_index != RTD_SCAN_NO_RTD)
+   {
+      rawCounts[ain1_rtd_index] = readADCSysfsValue(rtdMappings[ain1_rtd_index].fd);
+   }
+
+   return ret;
+}
+
+
+/*******************************************************************************************/
+/*                                                                                         */
+/* void scanRTDs(int *rawCounts)                                                           */
+/*                                                                                         */
+/* Reads all of the RTDs in mux pairs: step n routes the nth AIN0 RTD and the nth AIN1     */
+/* RTD together, so the full scan takes NUM_RTD_SCAN_STEPS settle/read cycles instead of   */
+/* NUM_RTDs. The time taken is saved for the RTD publisher.                                */
+/*                                                                                         */
+/* Returns: None                                                                           */
+/*                                                                                         */
+/*******************************************************************************************/
+void scanRTDs(int *rawCounts)
+{
+   struct timespec start;
+   struct timespec end;
+
+   // monotonic, so a clock set by TimeSync can't corrupt the scan time
+   (void)clock_gettime(CLOCK_MONOTONIC, &start);
+
+   for (int i = 0; i < NUM_RTDs; i++)
+   {
+      rawCounts[i] = -1;
+   }
+
+   for (int step = 0; step < NUM_RTD_SCAN_STEPS; step++)
+   {
+      int ain0_rtd_index = RTD_SCAN_NO_RTD;
+      int ain1_rtd_index = RTD_SCAN_NO_RTD;
+
+      // RTD indices 0 - 5 are on mux 0 / AIN0, 6 - 13 are on mux 1 / AIN1
+      if (step < NUM_RTDS_ON_AIN0)
+      {
+         ain0_rtd_index = step;
+      }
+      if (step < NUM_RTDS_ON_AIN1)
+      {
+         ain1_rtd_index = NUM_RTDS_ON_AIN0 + step;
+      }
+
+      (void)readADCPair(ain0_rtd_index, ain1_rtd_index, rawCounts);
+   }
+
+   (void)clock_gettime(CLOCK_MONOTONIC, &end);
+
+   rtdScanTimeMicroseconds = (uint32_t)timespecDiffMicroseconds(&end, &start);
+   if (rtdScanTimeMicroseconds > rtdScanTimeMaxMicroseconds)
+   {
+      rtdScanTimeMaxMicroseconds = rtdScanTimeMicroseconds;
+   }
+}
+
+
+/*******************************************************************************************/
+/*                                                                                         */
+/* int validateADCReading(int rtd_index, int rawCount)                                     */
+/*                                                                                         */
+/* Checks a scanned ADC value for the specified RTD. An out of range value is re-read on   */
+/* its own before the open/short checks are run on it.                                     */
+/*                                                                                         */
+/* Returns: int rawCount                                                                   */
+/*                                                                                         */
+/*******************************************************************************************/
+int validateADCReading(int rtd_index, int rawCount)
+{
    char topString[] = {"TOP"};
    char bottomString[] = {"BOTTOM"};
 
-   if (rtdMappings[rtd_index].fd != -1)
+   if (rtdMappings[rtd_index].fd == -1)
+   {
+      rawCount = -1;
+   }
+   else
    {
       int retryCount = 0;
 
-      // issuing the SPI commands routes the RTD data through the PGA to either AIN0 or AIN1 ADC
-      // which is actually the value we need (raw ADC count)
-      (void)issueSPICommands(rtd_index);
-      // each time we read a value, we need to rewind the file descriptor back to the beginning of the file
-      // or we'll never read another value
-      (void)usleep(10000);
-      (void)lseek(rtdMappings[rtd_index].fd, 0, SEEK_SET);
-      char buf[ADC_READ_BUFFER_SIZE];
-      (void)memset(buf, 0, sizeof(buf));
-      int readLen = read(rtdMappings[rtd_index].fd, buf, sizeof(buf));
-      if (readLen > 1)
+      if (rawCount >= 0)
       {
-         // more than EOL; make sure it's NULL terminated
-         buf[readLen-1] = '\0';
-         rawCount = atoi(buf);
          // check for out of range
          // if so, read up to 4 more times
          if ((retryCount < MAX_READ_RTD_RETRY_COUNT) && ((rawCount > rtdMappings[rtd_index].temp_lookup_table[NUM_TEMP_LOOKUP_ENTRIES-10].adc_raw_counts)
                                                      ||  (rawCount < rtdMappings[rtd_index].temp_lookup_table[0].adc_raw_counts)))
          {
             retryCount++;
-            (void)issueSPICommands(rtd_index);
-            (void)usleep(10000);
-            (void)lseek(rtdMappings[rtd_index].fd, 0, SEEK_SET);
-            (void)memset(buf, 0, sizeof(buf));
-            readLen = read(rtdMappings[rtd_index].fd, buf, sizeof(buf));
-            if (readLen > 1)
+            int retryRawCount = readADCRawCount(rtd_index);
+            if (retryRawCount >= 0)
             {
-               // more than EOL; make sure it's NULL terminated
-               buf[readLen-1] = '\0';
-               rawCount = atoi(buf);
+               rawCount = retryRawCount;
             }
          }
 
@@ -1942,11 +2641,12 @@ int readADCChannel(int rtd_index)
                   if (!rtdMappings[rtd_index].open_oneshot)
                   {
                      rtdMappings[rtd_index].open_oneshot = true;
+                     char location_str[LOGERROR_LOCATION_SIZE];
+                     (void)snprintf(location_str, sizeof(location_str), "Shelf %d %s", shelfNumber, locationString);
+                     raiseAlarm(ALARM_CODE_HEATER_FAILED, TEMP_PROBE_OPEN_ERROR_CODE, shelfNumber, location_str);
                      syslog(LOG_ERR, "%s Temp probe open failure for RTD %d raw count %d location %s shelf %d", TEMP_PROBE_OPEN_ERROR_CODE, rtd_index, rawCount, locationString, shelfNumber);
                      (void)strncpy(errorCodeString, TEMP_PROBE_OPEN_ERROR_CODE, sizeof(errorCodeString) - 1);
                      systemStatus = SYSTEM_STATUS_ERROR;
-                     char location_str[LOGERROR_LOCATION_SIZE];
-                     (void)snprintf(location_str, sizeof(location_str), "Shelf %d %s", shelfNumber, locationString);
                      (void)logError(TEMP_PROBE_OPEN_ERROR_CODE, location_str, "Temp probe open failure");
                   }
                }
@@ -2024,11 +2724,12 @@ int readADCChannel(int rtd_index)
                   if (!rtdMappings[rtd_index].shorted_oneshot)
                   {
                      rtdMappings[rtd_index].shorted_oneshot = true;
+                     char location_str[LOGERROR_LOCATION_SIZE];
+                     (void)snprintf(location_str, sizeof(location_str), "Shelf %d %s", shelfNumber, locationString);
+                     raiseAlarm(ALARM_CODE_HEATER_FAILED, TEMP_PROBE_CLOSED_ERROR_CODE, shelfNumber, location_str);
                      syslog(LOG_ERR, "%s Temp probe shorted failure for RTD %d raw count %d location %s shelf %d", TEMP_PROBE_CLOSED_ERROR_CODE, rtd_index, rawCount, locationString, shelfNumber);
                      (void)strncpy(errorCodeString, TEMP_PROBE_CLOSED_ERROR_CODE, sizeof(errorCodeString) - 1);
                      systemStatus = SYSTEM_STATUS_ERROR;
-                     char location_str[LOGERROR_LOCATION_SIZE];
-                     (void)snprintf(location_str, sizeof(location_str), "Shelf %d %s", shelfNumber, locationString);
                      (void)logError(TEMP_PROBE_CLOSED_ERROR_CODE, location_str, "Temp probe shorted failure");
                   }
                }
@@ -2060,6 +2761,7 @@ int readADCChannel(int rtd_index)
                   if (!rtdMappings[rtd_index].open_oneshot)
                   {
                      rtdMappings[rtd_index].open_oneshot = true;
+                     raiseAlarm(ALARM_CODE_HARDWARE_FAILURE, TEMP_PROBE_OPEN_ERROR_CODE, 0, "Heat sink");
                      syslog(LOG_ERR, "%s Temp probe open failure for HEATSINK raw count %d", TEMP_PROBE_OPEN_ERROR_CODE, rawCount);
                      (void)strncpy(errorCodeString, TEMP_PROBE_OPEN_ERROR_CODE, sizeof(errorCodeString) - 1);
                      systemStatus = SYSTEM_STATUS_ERROR;
@@ -2091,6 +2793,7 @@ int readADCChannel(int rtd_index)
                   if (!rtdMappings[rtd_index].shorted_oneshot)
                   {
                      rtdMappings[rtd_index].shorted_oneshot = true;
+                     raiseAlarm(ALARM_CODE_HARDWARE_FAILURE, TEMP_PROBE_CLOSED_ERROR_CODE, 0, "Heat sink");
                      syslog(LOG_ERR, "%s Temp probe shorted failure for HEATSINK raw count %d", TEMP_PROBE_CLOSED_ERROR_CODE, rawCount);
                      (void)strncpy(errorCodeString, TEMP_PROBE_CLOSED_ERROR_CODE, sizeof(errorCodeString) - 1);
                      systemStatus = SYSTEM_STATUS_ERROR;
@@ -2130,6 +2833,7 @@ int readADCChannel(int rtd_index)
                      if (!rtdMappings[rtd_index].open_oneshot)
                      {
                         rtdMappings[rtd_index].open_oneshot = true;
+                        raiseAlarm(ALARM_CODE_HARDWARE_FAILURE, TEMP_PROBE_OPEN_ERROR_CODE, 0, "Ambient temp");
                         syslog(LOG_ERR, "%s Temp probe open failure for AMBIENT raw count %d", TEMP_PROBE_OPEN_ERROR_CODE, rawCount);
                         (void)strncpy(errorCodeString, TEMP_PROBE_OPEN_ERROR_CODE, sizeof(errorCodeString) - 1);
                         systemStatus = SYSTEM_STATUS_ERROR;
@@ -2162,6 +2866,8 @@ int readADCChannel(int rtd_index)
 #endif
                      if (!rtdMappings[rtd_index].shorted_oneshot)
                      {
+                        rtdMappings[rtd_index].shorted_oneshot = true;
+                        raiseAlarm(ALARM_CODE_HARDWARE_FAILURE, TEMP_PROBE_CLOSED_ERROR_CODE, 0, "Ambient temp");
                         syslog(LOG_ERR, "%s Temp probe shorted failure for AMBIENT raw count %d", TEMP_PROBE_CLOSED_ERROR_CODE, rawCount);
                         (void)strncpy(errorCodeString, TEMP_PROBE_CLOSED_ERROR_CODE, sizeof(errorCodeString) - 1);
                         systemStatus = SYSTEM_STATUS_ERROR;
@@ -2189,1683 +2895,3716 @@ int readADCChannel(int rtd_index)
 
 /*******************************************************************************************/
 /*                                                                                         */
-/* void *readADCThread(void *)                                                             */
+/* int readADCChannel(int rtd_index)                                                       */
 /*                                                                                         */
-/* Run this thread once per second to get the current RTD values through the ADC channels. */
-/* Also read the current and voltage from the power monitor IC.                            */
-/* Runs forever.                                                                           */
+/* Reads the ADC value for the specified RTD.                                              */
 /*                                                                                         */
-/* Returns: pthread_exit(NULL)                                                             */
+/* Returns: int rawCount                                                                   */
 /*                                                                                         */
 /*******************************************************************************************/
-void *readADCThread(void *)
+int readADCChannel(int rtd_index)
 {
-    struct timeval start;
-    struct timeval end;
-    uint32_t executionTime;
-    uint32_t balance;
-    int i;
-    int j;
+   return validateADCReading(rtd_index, readADCRawCount(rtd_index));
+}
 
-    numThreadsRunning++;
-    while(!sigTermReceived)
-    {
-      (void)gettimeofday(&start, NULL);
 
-      // need to handle setting of the PGA117 analog mux here
-      // and which channel of the ADC to read
-      for (i = 0; i < NUM_RTDs; i++)
-      {
-         rtdMappings[i].value = readADCChannel(i);
-         if (i < HEATSINK_RTD_INDEX)
-         {
-            heaterInfo[i].current_temperature = lookupTempFromRawCounts(rtdMappings[i].value, i);
-         }
-         else if (HEATSINK_RTD_INDEX == i)
-         {
-            // read the HEATSINK
-            heatsinkTemp = lookupTempFromRawCounts(rtdMappings[i].value, i);
-            if (heatsinkTemp >= HEATSINK_MAX_TEMP)
-            {
-               heatsinkOvertempSeconds++;
-               if ((heatsinkOvertempSeconds >= HEATSINK_OVERTEMP_TIME_LIMIT_SECONDS) && !heatsinkOvertempOneShot)
-               {
-                  // for self-preservation of the electronics, we need to
-                  // shut down the heaters immediately
-                  // and report and log the error
-                  heatsinkOvertemp = true;
-                  heatsinkOvertempOneShot = true;
-                  alarmCode = ALARM_CODE_HEATSINK_OVER_TEMP;
+/*******************************************************************************************/
+/*                                                                                         */
+/* void initSensorSnapshot()                                                               */
+/*                                                                                         */
+/* Clears the sensor snapshot so that readers see every RTD as out of range until the      */
+/* first scan has been published.                                                          */
+/*                                                                                         */
+/* Returns: None                                                                           */
+/*                                                                                         */
+/*******************************************************************************************/
+void initSensorSnapshot()
+{
+   SENSOR_SNAPSHOT snapshot;
 
-                  // turn all heaters off
-                  for (int j = 0; j < NUM_HEATERS; j++)
-                  {
-                     (void)enableDisableHeater(j, HEATER_DISABLED);
-                     (void)turnHeaterOnOff(j, HEATER_STATE_OFF);
-                  }
+   (void)memset(&snapshot, 0, sizeof(snapshot));
+   for (int i = 0; i < NUM_RTDs; i++)
+   {
+      snapshot.temperature[i] = TEMP_OUT_OF_RANGE;
+      snapshot.temperature_tenths[i] = TEMP_OUT_OF_RANGE_TENTHS;
+   }
 
-                  syslog(LOG_ERR, "%s ALARM_CODE_HEATSINK_OVER_TEMP temp = %u F", HEATSINK_OVER_TEMP_ERROR_CODE, heatsinkTemp);
-                  char descr_str[LOGERROR_DESCR_SIZE];
-                  (void)snprintf(descr_str, sizeof(descr_str), "Heatsink over temperature %d F", heatsinkTemp);
-                  (void)logError(HEATSINK_OVER_TEMP_ERROR_CODE, "Heat sink", descr_str);
-                  syslog(LOG_ERR, "Heaters turned off and disabled");
-                  (void)strncpy(errorCodeString, HEATSINK_OVER_TEMP_ERROR_CODE, sizeof(errorCodeString) - 1);
-                  systemStatus = SYSTEM_STATUS_ERROR;
-               }
-            }
-            else
-            {
-               heatsinkOvertemp = false;
-               heatsinkOvertempOneShot = false;
-               heatsinkOvertempSeconds = 0;
-            }
-         }
-         else
-         {
-            if (controllerBoardRevision > 0)
-            {
-               // read the BOARD (PCB, aka AMBIENT) temp sensor
-               ambientTemp = lookupTempFromRawCounts(rtdMappings[AMBIENT_TEMP_RTD_INDEX].value, AMBIENT_TEMP_RTD_INDEX);
-               if (ambientTemp >= AMBIENT_MAX_TEMP)
-               {
-                  ambientOvertempSeconds++;
-                  if ((ambientOvertempSeconds >= AMBIENT_OVERTEMP_TIME_LIMIT_SECONDS) && !ambientOvertempOneShot)
-                  {
-                     // for self-preservation of the electronics, we need to
-                     // report and log the error
-                     ambientOvertemp = true;
-                     ambientOvertempOneShot = true;
-                     alarmCode = ALARM_CODE_AMBIENT_OVER_TEMP;
+   publishSensorSnapshot(&snapshot);
+}
 
-                     syslog(LOG_ERR, "%s ALARM_CODE_AMBIENT_OVER_TEMP temp = %u F", AMBIENT_OVER_TEMP_ERROR_CODE, ambientTemp);
-                     char descr_str[LOGERROR_DESCR_SIZE];
-                     (void)snprintf(descr_str, sizeof(descr_str), "Ambient over temperature %d F", ambientTemp);
-                     (void)logError(AMBIENT_OVER_TEMP_ERROR_CODE, "Ambient temp", descr_str);
-                     (void)strncpy(errorCodeString, AMBIENT_OVER_TEMP_ERROR_CODE, sizeof(errorCodeString) - 1);
-                     systemStatus = SYSTEM_STATUS_ERROR;
-                  }
-               }
-               else
-               {
-                  ambientOvertemp = false;
-                  ambientOvertempOneShot = false;
-                  ambientOvertempSeconds = 0;
-               }
-            }
-            else
-            {
-               // for pre-A02 hardware, substutute the HEATSINK for the AMBIENT temp sensor
-               ambientTemp = lookupTempFromRawCounts(rtdMappings[HEATSINK_RTD_INDEX].value, HEATSINK_RTD_INDEX);
-            }
-         }
-      }
 
-      // read the current comsumption and voltage from the power monitor
-      // sometimes it takes multiple reads to get a non-zero value
-      irms = 0.0;
-      for (j = 0; (j < POWER_METER_MAX_READS) && (0.0 == irms); j++)
-      {
-         (void)atm90e26_irms_get(&irms);
-         if (j > 0)
-         {
-            irms_retries++;
-         }
-      }
-      if (POWER_METER_MAX_READS == j)
-      {
-         powerMonitorBad = true;
-      }
+/*******************************************************************************************/
+/*                                                                                         */
+/* void publishSensorSnapshot(const SENSOR_SNAPSHOT *snapshot)                             */
+/*                                                                                         */
+/* Copies a completed scan into the shared sensor snapshot. Only readADCThread (and        */
+/* initialization, before the threads start) may call this. The sequence lock is made     */
+/* odd for the duration of the copy so readers can tell they raced with the update.        */
+/*                                                                                         */
+/* Returns: None                                                                           */
+/*                                                                                         */
+/*******************************************************************************************/
+void publishSensorSnapshot(const SENSOR_SNAPSHOT *snapshot)
+{
+   uint32_t sequence = sensorSnapshotLock.load(std::memory_order_relaxed);
 
-      voltage = 0.0;
-      for (j = 0; (j < POWER_METER_MAX_READS) && (0.0 == voltage); j++)
-      {
-         (void)atm90e26_vrms_get(&voltage);
-         if (j > 0)
-         {
-            vrms_retries++;
-         }
-      }
-      if (POWER_METER_MAX_READS == j)
-      {
-         powerMonitorBad = true;
-      }
+   sensorSnapshotLock.store(sequence + 1, std::memory_order_relaxed);
+   std::atomic_thread_fence(std::memory_order_release);
+   (void)memcpy(&sensorSnapshot, snapshot, sizeof(sensorSnapshot));
+   sensorSnapshotLock.store(sequence + 2, std::memory_order_release);
+}
 
-      if (debugHeatersPrintf)
+
+/*******************************************************************************************/
+/*                                                                                         */
+/* void getSensorSnapshot(SENSOR_SNAPSHOT *snapshot)                                       */
+/*                                                                                         */
+/* Takes a consistent copy of the latest sensor snapshot without blocking the writer. If   */
+/* the copy overlapped an update it is thrown away and taken again.                        */
+/*                                                                                         */
+/* Returns: None                                                                           */
+/*                                                                                         */
+/*******************************************************************************************/
+void getSensorSnapshot(SENSOR_SNAPSHOT *snapshot)
+{
+   uint32_t before;
+   uint32_t after;
+
+   while (true)
+   {
+      before = sensorSnapshotLock.load(std::memory_order_acquire);
+      if (0 == (before & 1))
       {
-         (void)printf("Current draw = %0.2fA  voltage = %0.2fV\n", irms, voltage);
-         for (int i = 0; i < NUM_RTDs; i++)
+         (void)memcpy(snapshot, &sensorSnapshot, sizeof(sensorSnapshot));
+         std::atomic_thread_fence(std::memory_order_acquire);
+         after = sensorSnapshotLock.load(std::memory_order_relaxed);
+         if (before == after)
          {
-            (void)printf("ADC channel [%d]  counts = %d  temp = %dF\n", i, rtdMappings[i].value, lookupTempFromRawCounts(rtdMappings[i].value, i));
+            break;
          }
-
-         (void)printf("\n");
       }
 
-      (void)gettimeofday(&end, NULL);
-
-      executionTime = (((end.tv_sec - start.tv_sec) * ONE_SECOND_IN_MICROSECONDS) + (end.tv_usec - start.tv_usec));
-      if (executionTime < ONE_SECOND_IN_MICROSECONDS)
-      {
-         balance = ONE_SECOND_IN_MICROSECONDS - executionTime;
-//      printf("task execution took %d microseconds balance = %ld\n", executionTime, balance);
-         usleep(balance);
-      }
-      else
-      {
-         // force a minimum thread sleep time
-//         printf("Execution time took more than 1 second - %d.%d\n", (executionTime / ONE_SECOND_IN_MICROSECONDS), (executionTime % ONE_SECOND_IN_MICROSECONDS));
-         usleep(MINIMUM_THREAD_SLEEP_TIME);
-      }
+      // the writer is mid-update, let it finish
+      (void)sched_yield();
    }
-
-   numThreadsRunning--;
-   pthread_exit(NULL);
 }
 
 
-// unused GPIO code
 /*******************************************************************************************/
 /*                                                                                         */
-/* int initUnusedGPIOs()                                                                   */
+/* int16_t snapshotAmbientTemp(const SENSOR_SNAPSHOT *snapshot)                            */
 /*                                                                                         */
-/* Initialize the unused GPIOs. Set them all to inputs per the schematic.                  */
+/* The ambient temperature to report from a snapshot. The ambient sensor only exists from  */
+/* rev A02 hardware on; before that the heatsink temperature stands in for it.             */
 /*                                                                                         */
-/* Returns: int ret - 0 = success, 1 = failure                                             */
+/* Returns: int16_t degrees Farenheit                                                      */
 /*                                                                                         */
 /*******************************************************************************************/
-int initUnusedGPIOs()
+int16_t snapshotAmbientTemp(const SENSOR_SNAPSHOT *snapshot)
 {
-   char commandLine[COMMAND_LINE_BUFFER_SIZE];
-
-   (void)memset(commandLine, 0, sizeof(commandLine));
-   (void)strncpy(commandLine, UNUSED_GPIO_INIT_SCRIPT, sizeof(commandLine));
-   int ret = system(commandLine);
+   // the controller board HW revision was bumped from 0 to 1 for A02 hardware
+   if (controllerBoardRevision > 0)
+   {
+      return snapshot->temperature[AMBIENT_TEMP_RTD_INDEX];
+   }
 
-   return ret;
+   return snapshot->temperature[HEATSINK_RTD_INDEX];
 }
 
 
-// heater code
 /*******************************************************************************************/
 /*                                                                                         */
-/* int initHeaterGPIOs()                                                                   */
+/* void initPeriodicTask(PERIODIC_TASK *task, const char *name, uint32_t periodMicroseconds) */
 /*                                                                                         */
-/* Initialize the GPIOs for managing the heaters.                                          */
+/* Sets up a periodic task whose first period starts now. Deadlines are kept on            */
+/* CLOCK_MONOTONIC so setting the system time does not stall or speed up the task.         */
 /*                                                                                         */
-/* Returns: int ret - 0 = success, 1 = failure                                             */
+/* Returns: None                                                                           */
 /*                                                                                         */
 /*******************************************************************************************/
-int initHeaterGPIOs()
+void initPeriodicTask(PERIODIC_TASK *task, const char *name, uint32_t periodMicroseconds)
 {
-   char commandLine[COMMAND_LINE_BUFFER_SIZE];
-
-   (void)memset(commandLine, 0, sizeof(commandLine));
-   (void)strncpy(commandLine, HEATER_GPIO_INIT_SCRIPT, sizeof(commandLine));
-   int ret = system(commandLine);
-
-   return ret;
+   (void)memset(task, 0, sizeof(PERIODIC_TASK));
+   task->name = name;
+   task->period_us = periodMicroseconds;
+   (void)clock_gettime(CLOCK_MONOTONIC, &task->next_deadline);
 }
 
 
 /*******************************************************************************************/
 /*                                                                                         */
-/* int enableDisableHeater(int heaterIndex, bool enabled)                                  */
+/* void addMicrosecondsToTimespec(struct timespec *ts, uint32_t microseconds)              */
 /*                                                                                         */
-/* Turns the requested heater on/off                                                       */
+/* Advances ts by the specified number of microseconds.                                    */
 /*                                                                                         */
-/* Returns: int ret - 0 = success, 1 = failure                                             */
+/* Returns: None                                                                           */
 /*                                                                                         */
 /*******************************************************************************************/
-int enableDisableHeater(int heaterIndex, bool enabled)
+void addMicrosecondsToTimespec(struct timespec *ts, uint32_t microseconds)
 {
-   int ret = 0;
-
-   if ((heaterIndex >= SLOT1_TOP_HEATER_INDEX) && (heaterIndex <= SLOT6_BOTTOM_HEATER_INDEX))
-   {
-      // if the index is in range, set is_enabled to the specified value
-      heaterInfo[heaterIndex].is_enabled = enabled;
-      if (enabled)
-      {
-         // if we're enabling a heater, reset error states
-         // they will be checked the next time the heater algorithm runs
-         rtdMappings[heaterIndex].is_shorted = false;
-         rtdMappings[heaterIndex].is_open    = false;
-         heaterInfo[heaterIndex].is_undertemp = false;
-         heaterInfo[heaterIndex].is_overtemp = false;
-         heaterInfo[heaterIndex].is_undertemp_CSS = false;
-         heaterInfo[heaterIndex].is_overtemp_CSS = false;
-         heaterInfo[heaterIndex].overtemp_oneshot = false;
-         heaterInfo[heaterIndex].undertemp_oneshot = false;
-         rtdMappings[heaterIndex].shorted_oneshot = false;
-         rtdMappings[heaterIndex].open_oneshot = false;
-         heaterInfo[heaterIndex].eco_mode_on = false;
-         heaterInfo[heaterIndex].seconds_undertemp = 0;
-         heaterInfo[heaterIndex].seconds_overtemp = 0;
-         rtdMappings[heaterIndex].seconds_shorted = 0;
-         rtdMappings[heaterIndex].seconds_open = 0;
-      }
-   }
-   else
+   ts->tv_sec += microseconds / ONE_SECOND_IN_MICROSECONDS;
+   ts->tv_nsec += (long)(microseconds % ONE_SECOND_IN_MICROSECONDS) * 1000;
+   if (ts->tv_nsec >= 1000000000)
    {
-      // bad index
-      ret = 1;
+      ts->tv_sec++;
+      ts->tv_nsec -= 1000000000;
    }
+}
 
-   return ret;
+
+/*******************************************************************************************/
+/*                                                                                         */
+/* int64_t timespecDiffMicroseconds(const struct timespec *a, const struct timespec *b)    */
+/*                                                                                         */
+/* Returns: int64_t a - b in microseconds                                                  */
+/*                                                                                         */
+/*******************************************************************************************/
+int64_t timespecDiffMicroseconds(const struct timespec *a, const struct timespec *b)
+{
+   return ((int64_t)(a->tv_sec - b->tv_sec) * ONE_SECOND_IN_MICROSECONDS) + ((a->tv_nsec - b->tv_nsec) / 1000);
 }
 
 
 /*******************************************************************************************/
 /*                                                                                         */
-/* int turnHeaterOnOff(int heaterIndex, uhc::HeaterState on)                               */
+/* void advancePeriodicTask(PERIODIC_TASK *task)                                           */
 /*                                                                                         */
-/* Turns the requested heater on/off                                                       */
+/* Called at the end of each pass of a periodic task. Moves the deadline on by exactly one */
+/* period, measured from the previous deadline rather than from now, so the task does not  */
+/* drift. If the pass ran past one or more deadlines those periods are counted as missed   */
+/* and skipped rather than run back to back.                                               */
 /*                                                                                         */
-/* Returns: int ret - 0 = success, 1 = failure                                             */
+/* Returns: None                                                                           */
 /*                                                                                         */
 /*******************************************************************************************/
-int turnHeaterOnOff(int heaterIndex, uhc::HeaterState on)
+void advancePeriodicTask(PERIODIC_TASK *task)
 {
-   int ret = 0;
+   struct timespec now;
 
-   if ((heaterIndex >= SLOT1_TOP_HEATER_INDEX) && (heaterIndex <= SLOT6_BOTTOM_HEATER_INDEX))
-   {
-      // if the index is in range, set heater_on to the specified value
-      int fd_on = heaterInfo[heaterIndex].fd;
-      int bytesWritten = 0;
-      heaterInfo[heaterIndex].state = on;
-
-      if (HEATER_STATE_ON == on)
-      {
-         bytesWritten = write(fd_on, HEATER_ON_STRING, 1);
-         if (debugHeatersPrintf)
-         {
-            (void)printf("Heater %d ON\n", heaterIndex);
-         }
-      }
-      else
-      {
-         bytesWritten = write(fd_on, HEATER_OFF_STRING, 1);
-         if (debugHeatersPrintf)
-         {
-            (void)printf("Heater %d OFF\n", heaterIndex);
-         }
-      }
+   task->runs++;
+   addMicrosecondsToTimespec(&task->next_deadline, task->period_us);
 
-      if (-1 == bytesWritten)
+   (void)clock_gettime(CLOCK_MONOTONIC, &now);
+   int64_t late = timespecDiffMicroseconds(&now, &task->next_deadline);
+   if (late >= 0)
+   {
+      // this pass overran its period; resume on the next deadline still in the future
+      uint32_t missed = (uint32_t)(late / task->period_us) + 1;
+      task->overruns++;
+      task->missed_deadlines += missed;
+      for (uint32_t i = 0; i < missed; i++)
       {
-         if (debugPrintf)
-         {
-            (void)printf("Error writing to %s\n", heaterInfo[heaterIndex].GPIO_PATH);
-         }
-
-         ret = 1;
+         addMicrosecondsToTimespec(&task->next_deadline, task->period_us);
       }
    }
-   else
-   {
-      // bad index
-      ret = 1;
-   }
-
-   return ret;
 }
 
 
 /*******************************************************************************************/
 /*                                                                                         */
-/* int setHeaterTimesIndex(int heaterIndex,                                                */
-/*                         google::protobuf::Timestamp startTime,                          */
-/*                         google::protobuf::Timestamp endTime)                            */
+/* void recordPeriodicTaskJitter(PERIODIC_TASK *task)                                      */
 /*                                                                                         */
-/* Set the heater start and end times to the specified values.                             */
+/* Called when a periodic task wakes up for its deadline. Records how late the wakeup was  */
+/* in the jitter histogram.                                                                */
 /*                                                                                         */
-/* Returns: int ret - 0 = success, 1 = failure                                             */
+/* Returns: None                                                                           */
 /*                                                                                         */
 /*******************************************************************************************/
-int setHeaterTimesIndex(int heaterIndex, google::protobuf::Timestamp startTime, google::protobuf::Timestamp endTime)
+void recordPeriodicTaskJitter(PERIODIC_TASK *task)
 {
-   int ret = 0;
+   struct timespec now;
 
-   if ((heaterIndex >= SLOT1_TOP_HEATER_INDEX) && (heaterIndex <= SLOT6_BOTTOM_HEATER_INDEX))
+   (void)clock_gettime(CLOCK_MONOTONIC, &now);
+   int64_t jitter = timespecDiffMicroseconds(&now, &task->next_deadline);
+   if (jitter < 0)
    {
-      // if the index is in range, set start and end times to the specified value
-      heaterInfo[heaterIndex].start_time = startTime;
-      heaterInfo[heaterIndex].end_time = endTime;
+      jitter = 0;
    }
-   else
+   if (jitter > task->max_jitter_us)
    {
-      // bad index
-      ret = 1;
+      task->max_jitter_us = (uint32_t)jitter;
    }
 
-   return ret;
+   // bucket 0 is under PERIODIC_TASK_JITTER_BASE_MICROSECONDS, each bucket after that doubles,
+   // the last bucket holds everything beyond
+   int bucket = 0;
+   uint32_t limit = PERIODIC_TASK_JITTER_BASE_MICROSECONDS;
+   while ((bucket < (PERIODIC_TASK_JITTER_BUCKETS - 1)) && (jitter >= limit))
+   {
+      bucket++;
+      limit *= 2;
+   }
+   task->jitter_histogram[bucket]++;
 }
 
 
 /*******************************************************************************************/
 /*                                                                                         */
-/* int setHeaterTimesSlot(int slot,                                                        */
-/*                         google::protobuf::Timestamp startTime,                          */
-/*                         google::protobuf::Timestamp endTime)                            */
+/* void waitPeriodicTask(PERIODIC_TASK *task)                                              */
 /*                                                                                         */
-/* Set the heater start and end times to the specified values for a given slot.            */
+/* Called at the end of each pass of a periodic task that has a thread of its own. Sleeps  */
+/* until the next deadline on CLOCK_MONOTONIC.                                             */
 /*                                                                                         */
-/* Returns: int ret - 0 = success, 1 = failure                                             */
+/* Returns: None                                                                           */
 /*                                                                                         */
 /*******************************************************************************************/
-int setHeaterTimesSlot(int slot, google::protobuf::Timestamp startTime, google::protobuf::Timestamp endTime)
+void waitPeriodicTask(PERIODIC_TASK *task)
 {
-   int ret = 0;
+   advancePeriodicTask(task);
 
-   if ((slot >= SLOT1) && (slot <= SLOT6))
+   while (EINTR == clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &task->next_deadline, NULL))
    {
-      // SLOTS are 1 based; the index needs to be zero based.
-      slot -= 1;
+      // interrupted by a signal, keep waiting for the same deadline
+   }
 
-      // if the index is in range, set start and end times to the specified value
-      // set the upper heater times
-      heaterInfo[(slot*2)].start_time = startTime;
-      heaterInfo[(slot*2)].end_time = endTime;
+   recordPeriodicTaskJitter(task);
+}
 
-      // set the upper heater times
-      heaterInfo[(slot*2)+1].start_time = startTime;
-      heaterInfo[(slot*2)+1].end_time = endTime;
-   }
-   else
+
+/*******************************************************************************************/
+/*                                                                                         */
+/* void logPeriodicTaskStats(const PERIODIC_TASK *task)                                    */
+/*                                                                                         */
+/* Writes the scheduling statistics of a periodic task to the syslog.                      */
+/*                                                                                         */
+/* Returns: None                                                                           */
+/*                                                                                         */
+/*******************************************************************************************/
+void logPeriodicTaskStats(const PERIODIC_TASK *task)
+{
+   char histogram[128];
+   int len = 0;
+
+   (void)memset(histogram, 0, sizeof(histogram));
+   for (int i = 0; (i < PERIODIC_TASK_JITTER_BUCKETS) && (len < (int)sizeof(histogram)); i++)
    {
-      // bad index
-      ret = 1;
+      len += snprintf(&histogram[len], sizeof(histogram) - len, " %u", task->jitter_histogram[i]);
    }
 
-   return ret;
+   syslog(LOG_INFO, "%s runs %u overruns %u missed deadlines %u max jitter %u us jitter histogram%s",
+          task->name, task->runs, task->overruns, task->missed_deadlines, task->max_jitter_us, histogram);
 }
+
+
 /*******************************************************************************************/
 /*                                                                                         */
-/* int initHeaterDataStructures()                                                          */
+/* void logThreadsAndMemory()                                                              */
 /*                                                                                         */
-/* Initialize the data structures for managing the heaters.                                */
+/* Writes the number of threads and the resident memory of this process to the syslog, so  */
+/* the thread per socket and reactor modes can be compared.                                */
 /*                                                                                         */
-/* Returns: int ret - 0 = success, 1 = failure                                             */
+/* Returns: None                                                                           */
 /*                                                                                         */
 /*******************************************************************************************/
-int initHeaterDataStructures()
+void logThreadsAndMemory()
 {
-   (void)memset(heaterInfo, 0, sizeof(heaterInfo));
+   char line[128];
+   char threads[32];
+   char rss[32];
 
-   ::google::protobuf::Timestamp* timestamp = new ::google::protobuf::Timestamp();
-   struct timeval now;
-   (void)gettimeofday(&now, NULL);
-   timestamp->set_seconds(now.tv_sec);
-   timestamp->set_nanos(now.tv_usec * 1000);
+   (void)memset(threads, 0, sizeof(threads));
+   (void)memset(rss, 0, sizeof(rss));
 
-   int i = 0;
-   heaterInfo[i].state = HEATER_OFF;
-   heaterInfo[i].location = (i % 2) ? HEATER_LOCATION_LOWER : HEATER_LOCATION_UPPER;
-   heaterInfo[i].temperature_setpoint = DEFAULT_SETPOINT;
-   heaterInfo[i].saved_setpoint = DEFAULT_SETPOINT;
-   heaterInfo[i].cleaning_mode_setpoint = CLEANING_MODE_SETPOINT;
-   heaterInfo[i].eco_mode_setpoint = DEFAULT_ECO_MODE_SETPOINT;
-   heaterInfo[i].current_temperature = lookupTempFromRawCounts(readADCChannel(i), i);
-   (void)strncpy(heaterInfo[i].GPIO_PATH, SLOT1_TOP_HEATER, sizeof(heaterInfo[i].GPIO_PATH));
-   heaterInfo[i].fd = open(heaterInfo[i].GPIO_PATH, O_WRONLY);
-   heaterInfo[i].is_enabled = false;
-   heaterInfo[i].is_on = false;
-   heaterInfo[i].was_on = false;
-   heaterInfo[i].is_undertemp = false;
-   heaterInfo[i].is_overtemp = false;
-   heaterInfo[i].is_undertemp_CSS = false;
-   heaterInfo[i].is_overtemp_CSS = false;
-   heaterInfo[i].overtemp_oneshot = false;
-   heaterInfo[i].undertemp_oneshot = false;
-   heaterInfo[i].eco_mode_on = false;
-   heaterInfo[i].setpoint_changed = false;
-   heaterInfo[i].eco_mode_is_on = false;
-   heaterInfo[i].seconds_undertemp = 0;
-   heaterInfo[i].seconds_overtemp = 0;
-   heaterInfo[i].seconds_on_time = 0;
-   heaterInfo[i].delta_temp = heaterInfo[i].temperature_setpoint - heaterInfo[i].current_temperature;
-   heaterInfo[i].start_time.set_seconds(timestamp->seconds());
-   heaterInfo[i].start_time.set_nanos(0);
-   heaterInfo[i].end_time.set_seconds(timestamp->seconds());
-   heaterInfo[i].end_time.set_nanos(0);
+   FILE *fp = fopen(PROCESS_STATUS_FILE, "r");
+   if (NULL == fp)
+   {
+      syslog(LOG_ERR, "logThreadsAndMemory unable to open %s", PROCESS_STATUS_FILE);
+      return;
+   }
 
-   i++;  // 1
-   heaterInfo[i].state = HEATER_OFF;
-   heaterInfo[i].location = (i % 2) ? HEATER_LOCATION_LOWER : HEATER_LOCATION_UPPER;
-   heaterInfo[i].temperature_setpoint = DEFAULT_SETPOINT;
-   heaterInfo[i].saved_setpoint = DEFAULT_SETPOINT;
-   heaterInfo[i].cleaning_mode_setpoint = CLEANING_MODE_SETPOINT;
-   heaterInfo[i].eco_mode_setpoint = DEFAULT_ECO_MODE_SETPOINT;
-   heaterInfo[i].current_temperature = lookupTempFromRawCounts(readADCChannel(i), i);
-   (void)strncpy(heaterInfo[i].GPIO_PATH, SLOT1_BOTTOM_HEATER, sizeof(heaterInfo[i].GPIO_PATH));
-   heaterInfo[i].fd = open(heaterInfo[i].GPIO_PATH, O_WRONLY);
-   heaterInfo[i].is_enabled = false;
-   heaterInfo[i].is_on = false;
-   heaterInfo[i].was_on = false;
-   heaterInfo[i].is_undertemp = false;
-   heaterInfo[i].is_overtemp = false;
-   heaterInfo[i].is_undertemp_CSS = false;
-   heaterInfo[i].is_overtemp_CSS = false;
-   heaterInfo[i].overtemp_oneshot = false;
-   heaterInfo[i].undertemp_oneshot = false;
-   heaterInfo[i].eco_mode_on = false;
-   heaterInfo[i].setpoint_changed = false;
-   heaterInfo[i].eco_mode_is_on = false;
-   heaterInfo[i].seconds_undertemp = 0;
-   heaterInfo[i].seconds_overtemp = 0;
-   heaterInfo[i].seconds_on_time = 0;
-   heaterInfo[i].delta_temp = heaterInfo[i].temperature_setpoint - heaterInfo[i].current_temperature;
-   heaterInfo[i].start_time.set_seconds(timestamp->seconds());
-   heaterInfo[i].start_time.set_nanos(0);
-   heaterInfo[i].end_time.set_seconds(timestamp->seconds());
-   heaterInfo[i].end_time.set_nanos(0);
+   while (NULL != fgets(line, sizeof(line), fp))
+   {
+      (void)sscanf(line, "Threads: %31s", threads);
+      (void)sscanf(line, "VmRSS: %31s", rss);
+   }
+   (void)fclose(fp);
 
-   i++;  // 2
-   heaterInfo[i].state = HEATER_OFF;
-   heaterInfo[i].location = (i % 2) ? HEATER_LOCATION_LOWER : HEATER_LOCATION_UPPER;
-   heaterInfo[i].temperature_setpoint = DEFAULT_SETPOINT;
-   heaterInfo[i].saved_setpoint = DEFAULT_SETPOINT;
-   heaterInfo[i].cleaning_mode_setpoint = CLEANING_MODE_SETPOINT;
-   heaterInfo[i].eco_mode_setpoint = DEFAULT_ECO_MODE_SETPOINT;
-   heaterInfo[i].current_temperature = lookupTempFromRawCounts(readADCChannel(i), i);
-   (void)strncpy(heaterInfo[i].GPIO_PATH, SLOT2_TOP_HEATER, sizeof(heaterInfo[i].GPIO_PATH));
-   heaterInfo[i].fd = open(heaterInfo[i].GPIO_PATH, O_WRONLY);
-   heaterInfo[i].is_enabled = false;
-   heaterInfo[i].is_on = false;
-   heaterInfo[i].was_on = false;
-   heaterInfo[i].is_undertemp = false;
-   heaterInfo[i].is_overtemp = false;
-   heaterInfo[i].is_undertemp_CSS = false;
-   heaterInfo[i].is_overtemp_CSS = false;
-   heaterInfo[i].overtemp_oneshot = false;
-   heaterInfo[i].undertemp_oneshot = false;
-   heaterInfo[i].eco_mode_on = false;
-   heaterInfo[i].setpoint_changed = false;
-   heaterInfo[i].eco_mode_is_on = false;
-   heaterInfo[i].seconds_undertemp = 0;
-   heaterInfo[i].seconds_overtemp = 0;
-   heaterInfo[i].seconds_on_time = 0;
-   heaterInfo[i].delta_temp = heaterInfo[i].temperature_setpoint - heaterInfo[i].current_temperature;
-   heaterInfo[i].start_time.set_seconds(timestamp->seconds());
-   heaterInfo[i].start_time.set_nanos(0);
-   heaterInfo[i].end_time.set_seconds(timestamp->seconds());
-   heaterInfo[i].end_time.set_nanos(0);
+   syslog(LOG_INFO, "%s threads %s RSS %s kB", zmqReactor ? "ZMQ reactor" : "Thread per socket", threads, rss);
+}
 
-   i++;  // 3
-   heaterInfo[i].state = HEATER_OFF;
-   heaterInfo[i].location = (i % 2) ? HEATER_LOCATION_LOWER : HEATER_LOCATION_UPPER;
-   heaterInfo[i].temperature_setpoint = DEFAULT_SETPOINT;
-   heaterInfo[i].saved_setpoint = DEFAULT_SETPOINT;
-   heaterInfo[i].cleaning_mode_setpoint = CLEANING_MODE_SETPOINT;
-   heaterInfo[i].eco_mode_setpoint = DEFAULT_ECO_MODE_SETPOINT;
-   heaterInfo[i].current_temperature = lookupTempFromRawCounts(readADCChannel(i), i);
-   (void)strncpy(heaterInfo[i].GPIO_PATH, SLOT2_BOTTOM_HEATER, sizeof(heaterInfo[i].GPIO_PATH));
-   heaterInfo[i].fd = open(heaterInfo[i].GPIO_PATH, O_WRONLY);
-   heaterInfo[i].is_enabled = false;
-   heaterInfo[i].is_on = false;
-   heaterInfo[i].was_on = false;
-   heaterInfo[i].is_undertemp = false;
-   heaterInfo[i].is_overtemp = false;
-   heaterInfo[i].is_undertemp_CSS = false;
-   heaterInfo[i].is_overtemp_CSS = false;
-   heaterInfo[i].overtemp_oneshot = false;
-   heaterInfo[i].undertemp_oneshot = false;
-   heaterInfo[i].eco_mode_on = false;
-   heaterInfo[i].setpoint_changed = false;
-   heaterInfo[i].eco_mode_is_on = false;
-   heaterInfo[i].seconds_undertemp = 0;
-   heaterInfo[i].seconds_overtemp = 0;
-   heaterInfo[i].seconds_on_time = 0;
-   heaterInfo[i].delta_temp = heaterInfo[i].temperature_setpoint - heaterInfo[i].current_temperature;
-   heaterInfo[i].start_time.set_seconds(timestamp->seconds());
-   heaterInfo[i].start_time.set_nanos(0);
-   heaterInfo[i].end_time.set_seconds(timestamp->seconds());
-   heaterInfo[i].end_time.set_nanos(0);
 
-   i++;  // 4
-   heaterInfo[i].state = HEATER_OFF;
-   heaterInfo[i].location = (i % 2) ? HEATER_LOCATION_LOWER : HEATER_LOCATION_UPPER;
-   heaterInfo[i].temperature_setpoint = DEFAULT_SETPOINT;
-   heaterInfo[i].saved_setpoint = DEFAULT_SETPOINT;
-   heaterInfo[i].cleaning_mode_setpoint = CLEANING_MODE_SETPOINT;
-   heaterInfo[i].eco_mode_setpoint = DEFAULT_ECO_MODE_SETPOINT;
-   heaterInfo[i].current_temperature = lookupTempFromRawCounts(readADCChannel(i), i);
-   (void)strncpy(heaterInfo[i].GPIO_PATH, SLOT3_TOP_HEATER, sizeof(heaterInfo[i].GPIO_PATH));
-   heaterInfo[i].fd = open(heaterInfo[i].GPIO_PATH, O_WRONLY);
-   heaterInfo[i].is_enabled = false;
-   heaterInfo[i].is_on = false;
-   heaterInfo[i].was_on = false;
-   heaterInfo[i].is_undertemp = false;
-   heaterInfo[i].is_overtemp = false;
-   heaterInfo[i].is_undertemp_CSS = false;
-   heaterInfo[i].is_overtemp_CSS = false;
-   heaterInfo[i].overtemp_oneshot = false;
-   heaterInfo[i].undertemp_oneshot = false;
-   heaterInfo[i].eco_mode_on = false;
-   heaterInfo[i].setpoint_changed = false;
-   heaterInfo[i].eco_mode_is_on = false;
-   heaterInfo[i].seconds_undertemp = 0;
-   heaterInfo[i].seconds_overtemp = 0;
-   heaterInfo[i].seconds_on_time = 0;
-   heaterInfo[i].delta_temp = heaterInfo[i].temperature_setpoint - heaterInfo[i].current_temperature;
-   heaterInfo[i].start_time.set_seconds(timestamp->seconds());
-   heaterInfo[i].start_time.set_nanos(0);
-   heaterInfo[i].end_time.set_seconds(timestamp->seconds());
-   heaterInfo[i].end_time.set_nanos(0);
+/*******************************************************************************************/
+/*                                                                                         */
+/* void logCSSStreamStats()                                                                */
+/*                                                                                         */
+/* Writes the bytes per second and the serialization CPU per message of the                */
+/* CurrentSystemState stream to the syslog, for full messages and deltas separately, along */
+/* with what a full message on every publish would have cost. Clears the statistics.       */
+/*                                                                                         */
+/* Returns: None                                                                           */
+/*                                                                                         */
+/*******************************************************************************************/
+void logCSSStreamStats()
+{
+   struct timespec now;
+   (void)clock_gettime(CLOCK_MONOTONIC, &now);
+   int64_t seconds = timespecDiffMicroseconds(&now, &cssStreamStatsStart) / ONE_SECOND_IN_MICROSECONDS;
+   if (seconds <= 0)
+   {
+      seconds = 1;
+   }
 
-   i++;  // 5
-   heaterInfo[i].state = HEATER_OFF;
-   heaterInfo[i].location = (i % 2) ? HEATER_LOCATION_LOWER : HEATER_LOCATION_UPPER;
-   heaterInfo[i].temperature_setpoint = DEFAULT_SETPOINT;
-   heaterInfo[i].saved_setpoint = DEFAULT_SETPOINT;
-   heaterInfo[i].cleaning_mode_setpoint = CLEANING_MODE_SETPOINT;
-   heaterInfo[i].eco_mode_setpoint = DEFAULT_ECO_MODE_SETPOINT;
-   heaterInfo[i].current_temperature = lookupTempFromRawCounts(readADCChannel(i), i);
-   (void)strncpy(heaterInfo[i].GPIO_PATH, SLOT3_BOTTOM_HEATER, sizeof(heaterInfo[i].GPIO_PATH));
-   heaterInfo[i].fd = open(heaterInfo[i].GPIO_PATH, O_WRONLY);
-   heaterInfo[i].is_enabled = false;
-   heaterInfo[i].is_on = false;
-   heaterInfo[i].was_on = false;
-   heaterInfo[i].is_undertemp = false;
-   heaterInfo[i].is_overtemp = false;
-   heaterInfo[i].is_undertemp_CSS = false;
-   heaterInfo[i].is_overtemp_CSS = false;
-   heaterInfo[i].overtemp_oneshot = false;
-   heaterInfo[i].undertemp_oneshot = false;
-   heaterInfo[i].eco_mode_on = false;
-   heaterInfo[i].setpoint_changed = false;
-   heaterInfo[i].eco_mode_is_on = false;
-   heaterInfo[i].seconds_undertemp = 0;
-   heaterInfo[i].seconds_overtemp = 0;
-   heaterInfo[i].seconds_on_time = 0;
-   heaterInfo[i].delta_temp = heaterInfo[i].temperature_setpoint - heaterInfo[i].current_temperature;
-   heaterInfo[i].start_time.set_seconds(timestamp->seconds());
-   heaterInfo[i].start_time.set_nanos(0);
-   heaterInfo[i].end_time.set_seconds(timestamp->seconds());
-   heaterInfo[i].end_time.set_nanos(0);
+   const CSS_STREAM_STATS *stats[] = { &cssFullStats, &cssDeltaStats };
+   const char *names[] = { "full", "delta" };
+   for (int i = 0; i < 2; i++)
+   {
+      uint32_t cpuPerMessage = stats[i]->messages ? (uint32_t)(stats[i]->cpu_nanoseconds / stats[i]->messages) : 0;
+      syslog(LOG_INFO, "CurrentSystemState %s messages %u, %u bytes/s, %u ns CPU per message",
+             names[i], stats[i]->messages, (uint32_t)(stats[i]->bytes / seconds), cpuPerMessage);
+   }
+   if (cssDelta)
+   {
+      syslog(LOG_INFO, "CurrentSystemState full messages only would have been %u bytes/s",
+             (uint32_t)(cssFullEquivalentBytes / seconds));
+   }
 
-   i++;  // 6
-   heaterInfo[i].state = HEATER_OFF;
-   heaterInfo[i].location = (i % 2) ? HEATER_LOCATION_LOWER : HEATER_LOCATION_UPPER;
-   heaterInfo[i].temperature_setpoint = DEFAULT_SETPOINT;
-   heaterInfo[i].saved_setpoint = DEFAULT_SETPOINT;
-   heaterInfo[i].cleaning_mode_setpoint = CLEANING_MODE_SETPOINT;
-   heaterInfo[i].eco_mode_setpoint = DEFAULT_ECO_MODE_SETPOINT;
-   heaterInfo[i].current_temperature = lookupTempFromRawCounts(readADCChannel(i), i);
-   (void)strncpy(heaterInfo[i].GPIO_PATH, SLOT4_TOP_HEATER, sizeof(heaterInfo[i].GPIO_PATH));
-   heaterInfo[i].fd = open(heaterInfo[i].GPIO_PATH, O_WRONLY);
-   heaterInfo[i].is_enabled = false;
-   heaterInfo[i].is_on = false;
-   heaterInfo[i].was_on = false;
-   heaterInfo[i].is_undertemp = false;
-   heaterInfo[i].is_overtemp = false;
-   heaterInfo[i].is_undertemp_CSS = false;
-   heaterInfo[i].is_overtemp_CSS = false;
-   heaterInfo[i].overtemp_oneshot = false;
-   heaterInfo[i].undertemp_oneshot = false;
-   heaterInfo[i].eco_mode_on = false;
-   heaterInfo[i].setpoint_changed = false;
-   heaterInfo[i].eco_mode_is_on = false;
-   heaterInfo[i].seconds_undertemp = 0;
-   heaterInfo[i].seconds_overtemp = 0;
-   heaterInfo[i].seconds_on_time = 0;
-   heaterInfo[i].delta_temp = heaterInfo[i].temperature_setpoint - heaterInfo[i].current_temperature;
-   heaterInfo[i].start_time.set_seconds(timestamp->seconds());
-   heaterInfo[i].start_time.set_nanos(0);
-   heaterInfo[i].end_time.set_seconds(timestamp->seconds());
-   heaterInfo[i].end_time.set_nanos(0);
-
-   i++;  // 7
-   heaterInfo[i].state = HEATER_OFF;
-   heaterInfo[i].location = (i % 2) ? HEATER_LOCATION_LOWER : HEATER_LOCATION_UPPER;
-   heaterInfo[i].temperature_setpoint = DEFAULT_SETPOINT;
-   heaterInfo[i].saved_setpoint = DEFAULT_SETPOINT;
-   heaterInfo[i].cleaning_mode_setpoint = CLEANING_MODE_SETPOINT;
-   heaterInfo[i].eco_mode_setpoint = DEFAULT_ECO_MODE_SETPOINT;
-   heaterInfo[i].current_temperature = lookupTempFromRawCounts(readADCChannel(i), i);
-   (void)strncpy(heaterInfo[i].GPIO_PATH, SLOT4_BOTTOM_HEATER, sizeof(heaterInfo[i].GPIO_PATH));
-   heaterInfo[i].fd = open(heaterInfo[i].GPIO_PATH, O_WRONLY);
-   heaterInfo[i].is_enabled = false;
-   heaterInfo[i].is_on = false;
-   heaterInfo[i].was_on = false;
-   heaterInfo[i].is_undertemp = false;
-   heaterInfo[i].is_overtemp = false;
-   heaterInfo[i].is_undertemp_CSS = false;
-   heaterInfo[i].is_overtemp_CSS = false;
-   heaterInfo[i].overtemp_oneshot = false;
-   heaterInfo[i].undertemp_oneshot = false;
-   heaterInfo[i].eco_mode_on = false;
-   heaterInfo[i].setpoint_changed = false;
-   heaterInfo[i].eco_mode_is_on = false;
-   heaterInfo[i].seconds_undertemp = 0;
-   heaterInfo[i].seconds_overtemp = 0;
-   heaterInfo[i].seconds_on_time = 0;
-   heaterInfo[i].delta_temp = heaterInfo[i].temperature_setpoint - heaterInfo[i].current_temperature;
-   heaterInfo[i].start_time.set_seconds(timestamp->seconds());
-   heaterInfo[i].start_time.set_nanos(0);
-   heaterInfo[i].end_time.set_seconds(timestamp->seconds());
-   heaterInfo[i].end_time.set_nanos(0);
-
-   i++;  // 8
-   heaterInfo[i].state = HEATER_OFF;
-   heaterInfo[i].location = (i % 2) ? HEATER_LOCATION_LOWER : HEATER_LOCATION_UPPER;
-   heaterInfo[i].temperature_setpoint = DEFAULT_SETPOINT;
-   heaterInfo[i].saved_setpoint = DEFAULT_SETPOINT;
-   heaterInfo[i].cleaning_mode_setpoint = CLEANING_MODE_SETPOINT;
-   heaterInfo[i].eco_mode_setpoint = DEFAULT_ECO_MODE_SETPOINT;
-   heaterInfo[i].current_temperature = lookupTempFromRawCounts(readADCChannel(i), i);
-   (void)strncpy(heaterInfo[i].GPIO_PATH, SLOT5_TOP_HEATER, sizeof(heaterInfo[i].GPIO_PATH));
-   heaterInfo[i].fd = open(heaterInfo[i].GPIO_PATH, O_WRONLY);
-   heaterInfo[i].is_enabled = false;
-   heaterInfo[i].is_on = false;
-   heaterInfo[i].was_on = false;
-   heaterInfo[i].is_undertemp = false;
-   heaterInfo[i].is_overtemp = false;
-   heaterInfo[i].is_undertemp_CSS = false;
-   heaterInfo[i].is_overtemp_CSS = false;
-   heaterInfo[i].overtemp_oneshot = false;
-   heaterInfo[i].undertemp_oneshot = false;
-   heaterInfo[i].eco_mode_on = false;
-   heaterInfo[i].setpoint_changed = false;
-   heaterInfo[i].eco_mode_is_on = false;
-   heaterInfo[i].seconds_undertemp = 0;
-   heaterInfo[i].seconds_overtemp = 0;
-   heaterInfo[i].seconds_on_time = 0;
-   heaterInfo[i].delta_temp = heaterInfo[i].temperature_setpoint - heaterInfo[i].current_temperature;
-   heaterInfo[i].start_time.set_seconds(timestamp->seconds());
-   heaterInfo[i].start_time.set_nanos(0);
-   heaterInfo[i].end_time.set_seconds(timestamp->seconds());
-   heaterInfo[i].end_time.set_nanos(0);
-
-   i++;  // 9
-   heaterInfo[i].state = HEATER_OFF;
-   heaterInfo[i].location = (i % 2) ? HEATER_LOCATION_LOWER : HEATER_LOCATION_UPPER;
-   heaterInfo[i].temperature_setpoint = DEFAULT_SETPOINT;
-   heaterInfo[i].saved_setpoint = DEFAULT_SETPOINT;
-   heaterInfo[i].cleaning_mode_setpoint = CLEANING_MODE_SETPOINT;
-   heaterInfo[i].eco_mode_setpoint = DEFAULT_ECO_MODE_SETPOINT;
-   heaterInfo[i].current_temperature = lookupTempFromRawCounts(readADCChannel(i), i);
-   (void)strncpy(heaterInfo[i].GPIO_PATH, SLOT5_BOTTOM_HEATER, sizeof(heaterInfo[i].GPIO_PATH));
-   heaterInfo[i].fd = open(heaterInfo[i].GPIO_PATH, O_WRONLY);
-   heaterInfo[i].is_enabled = false;
-   heaterInfo[i].is_on = false;
-   heaterInfo[i].was_on = false;
-   heaterInfo[i].is_undertemp = false;
-   heaterInfo[i].is_overtemp = false;
-   heaterInfo[i].is_undertemp_CSS = false;
-   heaterInfo[i].is_overtemp_CSS = false;
-   heaterInfo[i].overtemp_oneshot = false;
-   heaterInfo[i].undertemp_oneshot = false;
-   heaterInfo[i].eco_mode_on = false;
-   heaterInfo[i].setpoint_changed = false;
-   heaterInfo[i].eco_mode_is_on = false;
-   heaterInfo[i].seconds_undertemp = 0;
-   heaterInfo[i].seconds_overtemp = 0;
-   heaterInfo[i].seconds_on_time = 0;
-   heaterInfo[i].delta_temp = heaterInfo[i].temperature_setpoint - heaterInfo[i].current_temperature;
-   heaterInfo[i].start_time.set_seconds(timestamp->seconds());
-   heaterInfo[i].start_time.set_nanos(0);
-   heaterInfo[i].end_time.set_seconds(timestamp->seconds());
-   heaterInfo[i].end_time.set_nanos(0);
-
-   i++;  // 10
-   heaterInfo[i].state = HEATER_OFF;
-   heaterInfo[i].location = (i % 2) ? HEATER_LOCATION_LOWER : HEATER_LOCATION_UPPER;
-   heaterInfo[i].temperature_setpoint = DEFAULT_SETPOINT;
-   heaterInfo[i].saved_setpoint = DEFAULT_SETPOINT;
-   heaterInfo[i].cleaning_mode_setpoint = CLEANING_MODE_SETPOINT;
-   heaterInfo[i].eco_mode_setpoint = DEFAULT_ECO_MODE_SETPOINT;
-   heaterInfo[i].current_temperature = lookupTempFromRawCounts(readADCChannel(i), i);
-   (void)strncpy(heaterInfo[i].GPIO_PATH, SLOT6_TOP_HEATER, sizeof(heaterInfo[i].GPIO_PATH));
-   heaterInfo[i].fd = open(heaterInfo[i].GPIO_PATH, O_WRONLY);
-   heaterInfo[i].is_enabled = false;
-   heaterInfo[i].is_on = false;
-   heaterInfo[i].was_on = false;
-   heaterInfo[i].is_undertemp = false;
-   heaterInfo[i].is_overtemp = false;
-   heaterInfo[i].is_undertemp_CSS = false;
-   heaterInfo[i].is_overtemp_CSS = false;
-   heaterInfo[i].overtemp_oneshot = false;
-   heaterInfo[i].undertemp_oneshot = false;
-   heaterInfo[i].eco_mode_on = false;
-   heaterInfo[i].setpoint_changed = false;
-   heaterInfo[i].eco_mode_is_on = false;
-   heaterInfo[i].seconds_undertemp = 0;
-   heaterInfo[i].seconds_overtemp = 0;
-   heaterInfo[i].seconds_on_time = 0;
-   heaterInfo[i].delta_temp = heaterInfo[i].temperature_setpoint - heaterInfo[i].current_temperature;
-   heaterInfo[i].start_time.set_seconds(timestamp->seconds());
-   heaterInfo[i].start_time.set_nanos(0);
-   heaterInfo[i].end_time.set_seconds(timestamp->seconds());
-   heaterInfo[i].end_time.set_nanos(0);
-
-   i++;  // 11
-   heaterInfo[i].state = HEATER_OFF;
-   heaterInfo[i].location = (i % 2) ? HEATER_LOCATION_LOWER : HEATER_LOCATION_UPPER;
-   heaterInfo[i].temperature_setpoint = DEFAULT_SETPOINT;
-   heaterInfo[i].saved_setpoint = DEFAULT_SETPOINT;
-   heaterInfo[i].cleaning_mode_setpoint = CLEANING_MODE_SETPOINT;
-   heaterInfo[i].eco_mode_setpoint = DEFAULT_ECO_MODE_SETPOINT;
-   heaterInfo[i].current_temperature = lookupTempFromRawCounts(readADCChannel(i), i);
-   (void)strncpy(heaterInfo[i].GPIO_PATH, SLOT6_BOTTOM_HEATER, sizeof(heaterInfo[i].GPIO_PATH));
-   heaterInfo[i].fd = open(heaterInfo[i].GPIO_PATH, O_WRONLY);
-   heaterInfo[i].is_enabled = false;
-   heaterInfo[i].is_on = false;
-   heaterInfo[i].was_on = false;
-   heaterInfo[i].is_undertemp = false;
-   heaterInfo[i].is_overtemp = false;
-   heaterInfo[i].is_undertemp_CSS = false;
-   heaterInfo[i].is_overtemp_CSS = false;
-   heaterInfo[i].overtemp_oneshot = false;
-   heaterInfo[i].undertemp_oneshot = false;
-   heaterInfo[i].eco_mode_on = false;
-   heaterInfo[i].setpoint_changed = false;
-   heaterInfo[i].eco_mode_is_on = false;
-   heaterInfo[i].seconds_undertemp = 0;
-   heaterInfo[i].seconds_overtemp = 0;
-   heaterInfo[i].seconds_on_time = 0;
-   heaterInfo[i].delta_temp = heaterInfo[i].temperature_setpoint - heaterInfo[i].current_temperature;
-   heaterInfo[i].start_time.set_seconds(timestamp->seconds());
-   heaterInfo[i].start_time.set_nanos(0);
-   heaterInfo[i].end_time.set_seconds(timestamp->seconds());
-   heaterInfo[i].end_time.set_nanos(0);
-
-   return 0;
-}
+   (void)memset(&cssFullStats, 0, sizeof(cssFullStats));
+   (void)memset(&cssDeltaStats, 0, sizeof(cssDeltaStats));
+   cssFullEquivalentBytes = 0;
+   cssStreamStatsStart = now;
+}
 
 
 /*******************************************************************************************/
 /*                                                                                         */
-/* int setSetpointHeater(int channelIndex, uint32_t setpoint)                              */
+/* int initSensorScanSignal()                                                              */
 /*                                                                                         */
-/* Set the temperature setpoint for a specific heater.                                     */
+/* Sets up the condition variable readADCThread uses to wake heaterControlThread after     */
+/* each scan. The condition variable runs on CLOCK_MONOTONIC so the fallback timeout is    */
+/* not affected by the system time being set.                                              */
 /*                                                                                         */
-/* Returns: None                                                                           */
+/* Returns: int 0 = success, 1 = failure                                                   */
 /*                                                                                         */
 /*******************************************************************************************/
-int setSetpointHeater(int channelIndex, uint32_t setpoint)
+int initSensorScanSignal()
 {
-   int ret = 0;
+   pthread_condattr_t attr;
 
-   if ((channelIndex >= SLOT1_TOP_HEATER_INDEX) && (channelIndex <= SLOT6_BOTTOM_HEATER_INDEX))
+   (void)pthread_condattr_init(&attr);
+   (void)pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+   if (0 != pthread_cond_init(&sensorScanCondition, &attr))
    {
-      // if the index is in range, set the setpoint to the specified value
-      heaterInfo[channelIndex].temperature_setpoint = (uint16_t)setpoint;
-      heaterInfo[channelIndex].setpoint_changed = true;
-      ret = 0;
+      syslog(LOG_ERR, "initSensorScanSignal unable to create the scan condition variable");
+      (void)pthread_condattr_destroy(&attr);
+      return 1;
+   }
+   (void)pthread_condattr_destroy(&attr);
+
+   if (access(SCAN_TRIGGERED_HEATERS_DISABLE_FILE, F_OK) == 0)
+   {
+      scanTriggeredHeaters = false;
+      syslog(LOG_NOTICE, "Scan triggered heater control disabled by %s", SCAN_TRIGGERED_HEATERS_DISABLE_FILE);
    }
    else
    {
-      ret = 1;
+      scanTriggeredHeaters = true;
+      syslog(LOG_NOTICE, "Heater control triggered by each RTD scan");
    }
 
-   return ret;
+   return 0;
 }
 
 
 /*******************************************************************************************/
 /*                                                                                         */
-/* void setSetpointSlot(int slotNumber, uint32_ setpoint)                                  */
+/* void signalSensorScan()                                                                 */
 /*                                                                                         */
-/* Set the temperature setpoint for a slot. Since there are two heaters/RTDs per slot,     */
-/* set both setpoints to the same value.                                                   */
+/* Called by readADCThread after publishing a scan to wake anything waiting on it.         */
 /*                                                                                         */
 /* Returns: None                                                                           */
 /*                                                                                         */
 /*******************************************************************************************/
-void setSetpointSlot(int slotNumber, uint32_t setpoint)
+void signalSensorScan()
 {
-    // when you set a setpoint for a slot, both the upper and lower heaters
-    // get the same setpoint
-    switch (slotNumber)
-    {
-        case SLOT1:
-            heaterInfo[SLOT1_TOP_HEATER_INDEX].temperature_setpoint     = (uint16_t)setpoint;
-            heaterInfo[SLOT1_BOTTOM_HEATER_INDEX].temperature_setpoint  = (uint16_t)setpoint;
-            heaterInfo[SLOT1_TOP_HEATER_INDEX].saved_setpoint           = (uint16_t)setpoint;
-            heaterInfo[SLOT1_BOTTOM_HEATER_INDEX].saved_setpoint        = (uint16_t)setpoint;
-            heaterInfo[SLOT1_TOP_HEATER_INDEX].setpoint_changed = true;
-            heaterInfo[SLOT1_BOTTOM_HEATER_INDEX].setpoint_changed = true;
-            break;
-
-        case SLOT2:
-            heaterInfo[SLOT2_TOP_HEATER_INDEX].temperature_setpoint     = (uint16_t)setpoint;
-            heaterInfo[SLOT2_BOTTOM_HEATER_INDEX].temperature_setpoint  = (uint16_t)setpoint;
-            heaterInfo[SLOT2_TOP_HEATER_INDEX].saved_setpoint           = (uint16_t)setpoint;
-            heaterInfo[SLOT2_BOTTOM_HEATER_INDEX].saved_setpoint        = (uint16_t)setpoint;
-            heaterInfo[SLOT2_TOP_HEATER_INDEX].setpoint_changed = true;
-            heaterInfo[SLOT2_BOTTOM_HEATER_INDEX].setpoint_changed = true;
-            break;
+   (void)pthread_mutex_lock(&sensorScanMutex);
+   sensorScanCount++;
+   (void)pthread_cond_broadcast(&sensorScanCondition);
+   (void)pthread_mutex_unlock(&sensorScanMutex);
+}
 
-        case SLOT3:
-            heaterInfo[SLOT3_TOP_HEATER_INDEX].temperature_setpoint     = (uint16_t)setpoint;
-            heaterInfo[SLOT3_BOTTOM_HEATER_INDEX].temperature_setpoint  = (uint16_t)setpoint;
-            heaterInfo[SLOT3_TOP_HEATER_INDEX].saved_setpoint           = (uint16_t)setpoint;
-            heaterInfo[SLOT3_BOTTOM_HEATER_INDEX].saved_setpoint        = (uint16_t)setpoint;
-            heaterInfo[SLOT3_TOP_HEATER_INDEX].setpoint_changed = true;
-            heaterInfo[SLOT3_BOTTOM_HEATER_INDEX].setpoint_changed = true;
-            break;
 
-        case SLOT4:
-            heaterInfo[SLOT4_TOP_HEATER_INDEX].temperature_setpoint     = (uint16_t)setpoint;
-            heaterInfo[SLOT4_BOTTOM_HEATER_INDEX].temperature_setpoint  = (uint16_t)setpoint;
-            heaterInfo[SLOT4_TOP_HEATER_INDEX].saved_setpoint           = (uint16_t)setpoint;
-            heaterInfo[SLOT4_BOTTOM_HEATER_INDEX].saved_setpoint        = (uint16_t)setpoint;
-            heaterInfo[SLOT4_TOP_HEATER_INDEX].setpoint_changed = true;
-            heaterInfo[SLOT4_BOTTOM_HEATER_INDEX].setpoint_changed = true;
-            break;
+/*******************************************************************************************/
+/*                                                                                         */
+/* bool waitForSensorScan(uint32_t *lastScanCount)                                         */
+/*                                                                                         */
+/* Waits until a scan newer than *lastScanCount has been published, or until              */
+/* HEATER_SCAN_TIMEOUT_MICROSECONDS has passed so the caller still runs if readADCThread   */
+/* stalls. *lastScanCount is updated to the newest scan.                                   */
+/*                                                                                         */
+/* Returns: bool true = new scan, false = timed out                                        */
+/*                                                                                         */
+/*******************************************************************************************/
+bool waitForSensorScan(uint32_t *lastScanCount)
+{
+   struct timespec timeout;
+   int rc = 0;
 
-        case SLOT5:
-            heaterInfo[SLOT5_TOP_HEATER_INDEX].temperature_setpoint     = (uint16_t)setpoint;
-            heaterInfo[SLOT5_BOTTOM_HEATER_INDEX].temperature_setpoint  = (uint16_t)setpoint;
-            heaterInfo[SLOT5_TOP_HEATER_INDEX].saved_setpoint           = (uint16_t)setpoint;
-            heaterInfo[SLOT5_BOTTOM_HEATER_INDEX].saved_setpoint        = (uint16_t)setpoint;
-            heaterInfo[SLOT5_TOP_HEATER_INDEX].setpoint_changed = true;
-            heaterInfo[SLOT5_BOTTOM_HEATER_INDEX].setpoint_changed = true;
-            break;
+   (void)clock_gettime(CLOCK_MONOTONIC, &timeout);
+   addMicrosecondsToTimespec(&timeout, HEATER_SCAN_TIMEOUT_MICROSECONDS);
 
-        case SLOT6:
-            heaterInfo[SLOT6_TOP_HEATER_INDEX].temperature_setpoint     = (uint16_t)setpoint;
-            heaterInfo[SLOT6_BOTTOM_HEATER_INDEX].temperature_setpoint  = (uint16_t)setpoint;
-            heaterInfo[SLOT6_TOP_HEATER_INDEX].saved_setpoint           = (uint16_t)setpoint;
-            heaterInfo[SLOT6_BOTTOM_HEATER_INDEX].saved_setpoint        = (uint16_t)setpoint;
-            heaterInfo[SLOT6_TOP_HEATER_INDEX].setpoint_changed = true;
-            heaterInfo[SLOT6_BOTTOM_HEATER_INDEX].setpoint_changed = true;
-            break;
+   (void)pthread_mutex_lock(&sensorScanMutex);
+   while ((sensorScanCount == *lastScanCount) && (0 == rc) && !sigTermReceived)
+   {
+      rc = pthread_cond_timedwait(&sensorScanCondition, &sensorScanMutex, &timeout);
+   }
+   bool newScan = (sensorScanCount != *lastScanCount);
+   *lastScanCount = sensorScanCount;
+   (void)pthread_mutex_unlock(&sensorScanMutex);
 
-        default:
-            break;
-    }
+   return newScan;
 }
 
 
 /*******************************************************************************************/
 /*                                                                                         */
-/* void lookupHeaterIndices(int slotNumber,                                                */
-/*                          int *channelIndexTopHeater,                                    */
-/*                          int *channelIndexBottomHeater)                                 */
+/* void recordHeaterLatency()                                                              */
 /*                                                                                         */
-/* Look up the heater indices for a give slot number.                                      */
+/* Records the time from the end of the scan the last heater pass acted on until now,      */
+/* i.e. until the heater outputs were updated.                                             */
 /*                                                                                         */
 /* Returns: None                                                                           */
 /*                                                                                         */
 /*******************************************************************************************/
-void lookupHeaterIndices(int slotNumber, int *channelIndexTopHeater, int *channelIndexBottomHeater)
+void recordHeaterLatency()
 {
-   switch (slotNumber)
+   struct timespec now;
+
+   if ((0 == heaterScanTimeMonotonic.tv_sec) && (0 == heaterScanTimeMonotonic.tv_nsec))
    {
-      case SLOT1:
-         *channelIndexTopHeater = SLOT1_TOP_HEATER_INDEX;
-         *channelIndexBottomHeater = SLOT1_BOTTOM_HEATER_INDEX;
-         break;
+      // no scan published yet
+      return;
+   }
 
-      case SLOT2:
-         *channelIndexTopHeater = SLOT2_TOP_HEATER_INDEX;
-         *channelIndexBottomHeater = SLOT2_BOTTOM_HEATER_INDEX;
-         break;
-
-      case SLOT3:
-         *channelIndexTopHeater = SLOT3_TOP_HEATER_INDEX;
-         *channelIndexBottomHeater = SLOT3_BOTTOM_HEATER_INDEX;
-         break;
-
-      case SLOT4:
-         *channelIndexTopHeater = SLOT4_TOP_HEATER_INDEX;
-         *channelIndexBottomHeater = SLOT4_BOTTOM_HEATER_INDEX;
-         break;
-
-      case SLOT5:
-         *channelIndexTopHeater = SLOT5_TOP_HEATER_INDEX;
-         *channelIndexBottomHeater = SLOT5_BOTTOM_HEATER_INDEX;
-         break;
-
-      case SLOT6:
-      default:
-         *channelIndexTopHeater = SLOT6_TOP_HEATER_INDEX;
-         *channelIndexBottomHeater = SLOT6_BOTTOM_HEATER_INDEX;
-         break;
-   }
-}
+   (void)clock_gettime(CLOCK_MONOTONIC, &now);
+   heaterLatencyMicroseconds = (uint32_t)(((now.tv_sec - heaterScanTimeMonotonic.tv_sec) * ONE_SECOND_IN_MICROSECONDS) +
+                                          ((now.tv_nsec - heaterScanTimeMonotonic.tv_nsec) / 1000));
+   if (heaterLatencyMicroseconds > heaterLatencyMaxMicroseconds)
+   {
+      heaterLatencyMaxMicroseconds = heaterLatencyMicroseconds;
+   }
+}
 
 
 /*******************************************************************************************/
 /*                                                                                         */
-/* void heatersAtStartup(int maxHeatersOn)                                                 */
+/* void *readADCThread(void *)                                                             */
 /*                                                                                         */
-/* This is the heater startup algorithm. Attempt the fastest possible startup by keeping   */
-/* the most heaters on that we can. This will turn on the bottom heaters of all 6 slots    */
-/* and the top heaters of slot 1 and 6, and if possible, up to 2 more upper heaters based  */
-/* on the line voltage.                                                                    */
+/* Run this thread once per second to get the current RTD values through the ADC channels. */
+/* Also read the current and voltage from the power monitor IC.                            */
+/* Runs forever.                                                                           */
 /*                                                                                         */
-/* Returns: None                                                                           */
+/* Returns: pthread_exit(NULL)                                                             */
 /*                                                                                         */
 /*******************************************************************************************/
-void heatersAtStartup(int maxHeatersOn)
+void *readADCThread(void *)
 {
-   int i = 0;
-   int numHeatersOn = 0;
-
-   // first turn everything off so we don't blow the power budget
-   for (i = 0; i < NUM_HEATERS; i++)
-   {
-      (void)turnHeaterOnOff(i, HEATER_STATE_OFF);
-      heaterInfo[i].is_on = false;
-      heaterInfo[i].was_on = false;
-   }
+    int i;
+    int j;
+    int rawCounts[NUM_RTDs];
+    uint32_t scanSequenceNumber = 0;
+    SENSOR_SNAPSHOT snapshot;
+    uint32_t scansPerSecond = 1;
+    uint32_t requestedStreamRate = 0;
+    struct timespec now;
+    struct timespec nextSecond;    // CLOCK_MONOTONIC, when the next once a second pass is due
+    static RTD_STREAM_BATCH streamBatch;
+
+    (void)clock_gettime(CLOCK_MONOTONIC, &nextSecond);
+    initPeriodicTask(&readADCTask, "readADCThread", ONE_SECOND_IN_MICROSECONDS);
+    numThreadsRunning++;
+    while(!sigTermReceived)
+    {
+      // route and read the RTDs two at a time, one on each PGA117 mux
+      scanRTDs(rawCounts);
+      if (scansPerSecond > 1)
+      {
+         addRTDStreamScan(&streamBatch, rawCounts, scansPerSecond);
+      }
 
-   // check all lower heaters first
-   if ((numHeatersOn < maxHeatersOn) && heaterInfo[SLOT1_BOTTOM_HEATER_INDEX].is_enabled && (heaterInfo[SLOT1_BOTTOM_HEATER_INDEX].current_temperature < heaterInfo[SLOT1_BOTTOM_HEATER_INDEX].temperature_setpoint))
-   {
-      (void)turnHeaterOnOff(SLOT1_BOTTOM_HEATER_INDEX, HEATER_STATE_ON);
-      heaterInfo[SLOT1_BOTTOM_HEATER_INDEX].was_on = heaterInfo[SLOT1_BOTTOM_HEATER_INDEX].is_on;
-      heaterInfo[SLOT1_BOTTOM_HEATER_INDEX].is_on = true;
-      heaterInfo[SLOT1_BOTTOM_HEATER_INDEX].seconds_on_time++;
-      numHeatersOn++;
-   }
+      // while streaming only one scan a second goes on to the checks below and the heaters,
+      // since the open, shorted and over temp limits are all counted in seconds. The second
+      // is kept on the monotonic clock rather than by counting scans, so scans that overrun
+      // their period can't stretch it.
+      (void)clock_gettime(CLOCK_MONOTONIC, &now);
+      if ((scansPerSecond > 1) && (timespecDiffMicroseconds(&now, &nextSecond) < 0))
+      {
+         waitPeriodicTask(&readADCTask);
+         continue;
+      }
+      addMicrosecondsToTimespec(&nextSecond, ONE_SECOND_IN_MICROSECONDS);
+      if (timespecDiffMicroseconds(&now, &nextSecond) >= 0)
+      {
+         // more than a second behind, count the seconds from now
+         nextSecond = now;
+         addMicrosecondsToTimespec(&nextSecond, ONE_SECOND_IN_MICROSECONDS);
+      }
 
-   if ((numHeatersOn < maxHeatersOn) && heaterInfo[SLOT2_BOTTOM_HEATER_INDEX].is_enabled && (heaterInfo[SLOT2_BOTTOM_HEATER_INDEX].current_temperature < heaterInfo[SLOT2_BOTTOM_HEATER_INDEX].temperature_setpoint))
-   {
-      (void)turnHeaterOnOff(SLOT2_BOTTOM_HEATER_INDEX, HEATER_STATE_ON);
-      heaterInfo[SLOT2_BOTTOM_HEATER_INDEX].was_on = heaterInfo[SLOT2_BOTTOM_HEATER_INDEX].is_on;
-      heaterInfo[SLOT2_BOTTOM_HEATER_INDEX].is_on = true;
-      heaterInfo[SLOT2_BOTTOM_HEATER_INDEX].seconds_on_time++;
-      numHeatersOn++;
-   }
+      for (i = 0; i < NUM_RTDs; i++)
+      {
+         rtdMappings[i].value = validateADCReading(i, rawCounts[i]);
+         if (HEATSINK_RTD_INDEX == i)
+         {
+            // read the HEATSINK
+            heatsinkTemp = lookupTempFromRawCounts(rtdMappings[i].value, i);
+            if (heatsinkTemp >= HEATSINK_MAX_TEMP)
+            {
+               heatsinkOvertempSeconds++;
+               if ((heatsinkOvertempSeconds >= HEATSINK_OVERTEMP_TIME_LIMIT_SECONDS) && !heatsinkOvertempOneShot)
+               {
+                  // for self-preservation of the electronics, we need to
+                  // shut down the heaters immediately
+                  // and report and log the error
+                  heatsinkOvertemp = true;
+                  heatsinkOvertempOneShot = true;
+                  alarmCode = ALARM_CODE_HEATSINK_OVER_TEMP;
+                  raiseAlarm(ALARM_CODE_HEATSINK_OVER_TEMP, HEATSINK_OVER_TEMP_ERROR_CODE, 0, "Heat sink");
 
-   if ((numHeatersOn < maxHeatersOn) && heaterInfo[SLOT3_BOTTOM_HEATER_INDEX].is_enabled && (heaterInfo[SLOT3_BOTTOM_HEATER_INDEX].current_temperature < heaterInfo[SLOT3_BOTTOM_HEATER_INDEX].temperature_setpoint))
-   {
-      (void)turnHeaterOnOff(SLOT3_BOTTOM_HEATER_INDEX, HEATER_STATE_ON);
-      heaterInfo[SLOT3_BOTTOM_HEATER_INDEX].was_on = heaterInfo[SLOT3_BOTTOM_HEATER_INDEX].is_on;
-      heaterInfo[SLOT3_BOTTOM_HEATER_INDEX].is_on = true;
-      heaterInfo[SLOT3_BOTTOM_HEATER_INDEX].seconds_on_time++;
-      numHeatersOn++;
-   }
+                  // turn all heaters off
+                  for (int j = 0; j < NUM_HEATERS; j++)
+                  {
+                     (void)enableDisableHeater(j, HEATER_DISABLED);
+                     (void)turnHeaterOnOff(j, HEATER_STATE_OFF);
+                  }
 
-   if ((numHeatersOn < maxHeatersOn) && heaterInfo[SLOT4_BOTTOM_HEATER_INDEX].is_enabled && (heaterInfo[SLOT4_BOTTOM_HEATER_INDEX].current_temperature < heaterInfo[SLOT4_BOTTOM_HEATER_INDEX].temperature_setpoint))
-   {
-      (void)turnHeaterOnOff(SLOT4_BOTTOM_HEATER_INDEX, HEATER_STATE_ON);
-      heaterInfo[SLOT4_BOTTOM_HEATER_INDEX].was_on = heaterInfo[SLOT4_BOTTOM_HEATER_INDEX].is_on;
-      heaterInfo[SLOT4_BOTTOM_HEATER_INDEX].is_on = true;
-      heaterInfo[SLOT4_BOTTOM_HEATER_INDEX].seconds_on_time++;
-      numHeatersOn++;
-   }
+                  syslog(LOG_ERR, "%s ALARM_CODE_HEATSINK_OVER_TEMP temp = %u F", HEATSINK_OVER_TEMP_ERROR_CODE, heatsinkTemp);
+                  char descr_str[LOGERROR_DESCR_SIZE];
+                  (void)snprintf(descr_str, sizeof(descr_str), "Heatsink over temperature %d F", heatsinkTemp);
+                  (void)logError(HEATSINK_OVER_TEMP_ERROR_CODE, "Heat sink", descr_str);
+                  syslog(LOG_ERR, "Heaters turned off and disabled");
+                  (void)strncpy(errorCodeString, HEATSINK_OVER_TEMP_ERROR_CODE, sizeof(errorCodeString) - 1);
+                  systemStatus = SYSTEM_STATUS_ERROR;
+               }
+            }
+            else
+            {
+               heatsinkOvertemp = false;
+               heatsinkOvertempOneShot = false;
+               heatsinkOvertempSeconds = 0;
+            }
+         }
+         else if (AMBIENT_TEMP_RTD_INDEX == i)
+         {
+            if (controllerBoardRevision > 0)
+            {
+               // read the BOARD (PCB, aka AMBIENT) temp sensor
+               ambientTemp = lookupTempFromRawCounts(rtdMappings[AMBIENT_TEMP_RTD_INDEX].value, AMBIENT_TEMP_RTD_INDEX);
+               if (ambientTemp >= AMBIENT_MAX_TEMP)
+               {
+                  ambientOvertempSeconds++;
+                  if ((ambientOvertempSeconds >= AMBIENT_OVERTEMP_TIME_LIMIT_SECONDS) && !ambientOvertempOneShot)
+                  {
+                     // for self-preservation of the electronics, we need to
+                     // report and log the error
+                     ambientOvertemp = true;
+                     ambientOvertempOneShot = true;
+                     alarmCode = ALARM_CODE_AMBIENT_OVER_TEMP;
+                     raiseAlarm(ALARM_CODE_AMBIENT_OVER_TEMP, AMBIENT_OVER_TEMP_ERROR_CODE, 0, "Ambient temp");
 
-   if ((numHeatersOn < maxHeatersOn) && heaterInfo[SLOT5_BOTTOM_HEATER_INDEX].is_enabled && (heaterInfo[SLOT5_BOTTOM_HEATER_INDEX].current_temperature < heaterInfo[SLOT5_BOTTOM_HEATER_INDEX].temperature_setpoint))
-   {
-      (void)turnHeaterOnOff(SLOT5_BOTTOM_HEATER_INDEX, HEATER_STATE_ON);
-      heaterInfo[SLOT5_BOTTOM_HEATER_INDEX].was_on = heaterInfo[SLOT5_BOTTOM_HEATER_INDEX].is_on;
-      heaterInfo[SLOT5_BOTTOM_HEATER_INDEX].is_on = true;
-      heaterInfo[SLOT5_BOTTOM_HEATER_INDEX].seconds_on_time++;
-      numHeatersOn++;
-   }
+                     syslog(LOG_ERR, "%s ALARM_CODE_AMBIENT_OVER_TEMP temp = %u F", AMBIENT_OVER_TEMP_ERROR_CODE, ambientTemp);
+                     char descr_str[LOGERROR_DESCR_SIZE];
+                     (void)snprintf(descr_str, sizeof(descr_str), "Ambient over temperature %d F", ambientTemp);
+                     (void)logError(AMBIENT_OVER_TEMP_ERROR_CODE, "Ambient temp", descr_str);
+                     (void)strncpy(errorCodeString, AMBIENT_OVER_TEMP_ERROR_CODE, sizeof(errorCodeString) - 1);
+                     systemStatus = SYSTEM_STATUS_ERROR;
+                  }
+               }
+               else
+               {
+                  ambientOvertemp = false;
+                  ambientOvertempOneShot = false;
+                  ambientOvertempSeconds = 0;
+               }
+            }
+            else
+            {
+               // for pre-A02 hardware, substutute the HEATSINK for the AMBIENT temp sensor
+               ambientTemp = lookupTempFromRawCounts(rtdMappings[HEATSINK_RTD_INDEX].value, HEATSINK_RTD_INDEX);
+            }
+         }
+      }
 
-   if ((numHeatersOn < maxHeatersOn) && heaterInfo[SLOT6_BOTTOM_HEATER_INDEX].is_enabled && (heaterInfo[SLOT6_BOTTOM_HEATER_INDEX].current_temperature < heaterInfo[SLOT6_BOTTOM_HEATER_INDEX].temperature_setpoint))
-   {
-      (void)turnHeaterOnOff(SLOT6_BOTTOM_HEATER_INDEX, HEATER_STATE_ON);
-      heaterInfo[SLOT6_BOTTOM_HEATER_INDEX].was_on = heaterInfo[SLOT6_BOTTOM_HEATER_INDEX].is_on;
-      heaterInfo[SLOT6_BOTTOM_HEATER_INDEX].is_on = true;
-      heaterInfo[SLOT6_BOTTOM_HEATER_INDEX].seconds_on_time++;
-      numHeatersOn++;
-   }
+      // read the current comsumption and voltage from the power monitor
+      // sometimes it takes multiple reads to get a non-zero value
+      irms = 0.0;
+      for (j = 0; (j < POWER_METER_MAX_READS) && (0.0 == irms); j++)
+      {
+         (void)atm90e26_irms_get(&irms);
+         if (j > 0)
+         {
+            irms_retries++;
+         }
+      }
+      if (POWER_METER_MAX_READS == j)
+      {
+         powerMonitorBad = true;
+      }
 
-   // now, check the upper heaters; turn on as many as we can
-   if ((numHeatersOn < maxHeatersOn) && heaterInfo[SLOT6_TOP_HEATER_INDEX].is_enabled && (heaterInfo[SLOT6_TOP_HEATER_INDEX].current_temperature < heaterInfo[SLOT6_TOP_HEATER_INDEX].temperature_setpoint))
-   {
-      (void)turnHeaterOnOff(SLOT6_TOP_HEATER_INDEX, HEATER_STATE_ON);
-      heaterInfo[SLOT6_TOP_HEATER_INDEX].was_on = heaterInfo[SLOT6_TOP_HEATER_INDEX].is_on;
-      heaterInfo[SLOT6_TOP_HEATER_INDEX].is_on = true;
-      heaterInfo[SLOT6_TOP_HEATER_INDEX].seconds_on_time++;
-      numHeatersOn++;
-   }
+      voltage = 0.0;
+      for (j = 0; (j < POWER_METER_MAX_READS) && (0.0 == voltage); j++)
+      {
+         (void)atm90e26_vrms_get(&voltage);
+         if (j > 0)
+         {
+            vrms_retries++;
+         }
+      }
+      if (POWER_METER_MAX_READS == j)
+      {
+         powerMonitorBad = true;
+      }
 
-   if ((numHeatersOn < maxHeatersOn) && heaterInfo[SLOT1_TOP_HEATER_INDEX].is_enabled && (heaterInfo[SLOT1_TOP_HEATER_INDEX].current_temperature < heaterInfo[SLOT1_TOP_HEATER_INDEX].temperature_setpoint))
-   {
-      (void)turnHeaterOnOff(SLOT1_TOP_HEATER_INDEX, HEATER_STATE_ON);
-      heaterInfo[SLOT1_TOP_HEATER_INDEX].was_on = heaterInfo[SLOT1_TOP_HEATER_INDEX].is_on;
-      heaterInfo[SLOT1_TOP_HEATER_INDEX].is_on = true;
-      heaterInfo[SLOT1_TOP_HEATER_INDEX].seconds_on_time++;
-      numHeatersOn++;
-   }
+      // hand the converted scan to the other threads in one piece
+      (void)memset(&snapshot, 0, sizeof(snapshot));
+      for (i = 0; i < NUM_RTDs; i++)
+      {
+         int tenths = lookupTempTenthsFromRawCounts(rtdMappings[i].value, i);
+         snapshot.raw_counts[i] = rtdMappings[i].value;
+         snapshot.temperature_tenths[i] = (int16_t)tenths;
+         snapshot.temperature[i] = (int16_t)(tenths / TEMP_TENTHS_PER_DEGREE);
+         snapshot.is_open[i] = rtdMappings[i].is_open;
+         snapshot.is_shorted[i] = rtdMappings[i].is_shorted;
+      }
+      snapshot.irms = irms;
+      snapshot.voltage = voltage;
+      snapshot.power_monitor_bad = powerMonitorBad;
+      snapshot.sequence_number = ++scanSequenceNumber;
+      (void)gettimeofday(&snapshot.scan_time, NULL);
+      (void)clock_gettime(CLOCK_MONOTONIC, &snapshot.scan_time_monotonic);
+      publishSensorSnapshot(&snapshot);
+      signalSensorScan();
 
-   if ((numHeatersOn < maxHeatersOn) && heaterInfo[SLOT5_TOP_HEATER_INDEX].is_enabled && (heaterInfo[SLOT5_TOP_HEATER_INDEX].current_temperature < heaterInfo[SLOT5_TOP_HEATER_INDEX].temperature_setpoint))
-   {
-      (void)turnHeaterOnOff(SLOT5_TOP_HEATER_INDEX, HEATER_STATE_ON);
-      heaterInfo[SLOT5_TOP_HEATER_INDEX].was_on = heaterInfo[SLOT5_TOP_HEATER_INDEX].is_on;
-      heaterInfo[SLOT5_TOP_HEATER_INDEX].is_on = true;
-      heaterInfo[SLOT5_TOP_HEATER_INDEX].seconds_on_time++;
-      numHeatersOn++;
-   }
+      if (debugHeatersPrintf)
+      {
+         (void)printf("Current draw = %0.2fA  voltage = %0.2fV\n", irms, voltage);
+         (void)printf("RTD scan took %u microseconds (max %u)\n", rtdScanTimeMicroseconds, rtdScanTimeMaxMicroseconds);
+         for (int i = 0; i < NUM_RTDs; i++)
+         {
+            (void)printf("ADC channel [%d]  counts = %d  temp = %dF\n", i, rtdMappings[i].value, lookupTempFromRawCounts(rtdMappings[i].value, i));
+         }
 
-   if ((numHeatersOn < maxHeatersOn) && heaterInfo[SLOT2_TOP_HEATER_INDEX].is_enabled && (heaterInfo[SLOT2_TOP_HEATER_INDEX].current_temperature < heaterInfo[SLOT2_TOP_HEATER_INDEX].temperature_setpoint))
-   {
-      (void)turnHeaterOnOff(SLOT2_TOP_HEATER_INDEX, HEATER_STATE_ON);
-      heaterInfo[SLOT2_TOP_HEATER_INDEX].was_on = heaterInfo[SLOT2_TOP_HEATER_INDEX].is_on;
-      heaterInfo[SLOT2_TOP_HEATER_INDEX].is_on = true;
-      heaterInfo[SLOT2_TOP_HEATER_INDEX].seconds_on_time++;
-      numHeatersOn++;
-   }
+         (void)printf("\n");
+      }
 
-   if ((numHeatersOn < maxHeatersOn) && heaterInfo[SLOT3_TOP_HEATER_INDEX].is_enabled && (heaterInfo[SLOT3_TOP_HEATER_INDEX].current_temperature < heaterInfo[SLOT3_TOP_HEATER_INDEX].temperature_setpoint))
-   {
-      (void)turnHeaterOnOff(SLOT3_TOP_HEATER_INDEX, HEATER_STATE_ON);
-      heaterInfo[SLOT3_TOP_HEATER_INDEX].was_on = heaterInfo[SLOT3_TOP_HEATER_INDEX].is_on;
-      heaterInfo[SLOT3_TOP_HEATER_INDEX].is_on = true;
-      heaterInfo[SLOT3_TOP_HEATER_INDEX].seconds_on_time++;
-      numHeatersOn++;
-   }
+      // pick up a new stream rate on a second boundary. A rate the scans can't keep up with
+      // is lowered right away, but only raised again when a new rate is requested.
+      uint32_t streamRate = rtdStreamRateHz;
+      uint32_t newScansPerSecond = rtdStreamScansPerSecond(streamRate);
+      if ((newScansPerSecond != scansPerSecond) &&
+          ((streamRate != requestedStreamRate) || (newScansPerSecond < scansPerSecond)))
+      {
+         scansPerSecond = newScansPerSecond;
+         readADCTask.period_us = ONE_SECOND_IN_MICROSECONDS / scansPerSecond;
+         streamBatch.num_scans = 0;
+         syslog(LOG_NOTICE, "RTD scans now %u per second (%u requested, scan %u us, IIO buffered capture %s)",
+                scansPerSecond, streamRate, rtdScanTimeMicroseconds, iioBufferedCapture ? "on" : "off");
+      }
+      requestedStreamRate = streamRate;
 
-   if ((numHeatersOn < maxHeatersOn) && heaterInfo[SLOT4_TOP_HEATER_INDEX].is_enabled && (heaterInfo[SLOT4_TOP_HEATER_INDEX].current_temperature < heaterInfo[SLOT4_TOP_HEATER_INDEX].temperature_setpoint))
-   {
-      (void)turnHeaterOnOff(SLOT4_TOP_HEATER_INDEX, HEATER_STATE_ON);
-      heaterInfo[SLOT4_TOP_HEATER_INDEX].was_on = heaterInfo[SLOT4_TOP_HEATER_INDEX].is_on;
-      heaterInfo[SLOT4_TOP_HEATER_INDEX].is_on = true;
-      heaterInfo[SLOT4_TOP_HEATER_INDEX].seconds_on_time++;
-      numHeatersOn++;
+      waitPeriodicTask(&readADCTask);
    }
 
-   int numberOfHeatersAtTemp = 0;
-   int numberOfHeatersEnabled = 0;
-   for (i = 0; i < NUM_HEATERS; i++)
+   numThreadsRunning--;
+   pthread_exit(NULL);
+}
+
+
+// unused GPIO code
+/*******************************************************************************************/
+/*                                                                                         */
+/* int initUnusedGPIOs()                                                                   */
+/*                                                                                         */
+/* Initialize the unused GPIOs. Set them all to inputs per the schematic.                  */
+/*                                                                                         */
+/* Returns: int ret - 0 = success, 1 = failure                                             */
+/*                                                                                         */
+/*******************************************************************************************/
+int initUnusedGPIOs()
+{
+   char commandLine[COMMAND_LINE_BUFFER_SIZE];
+
+   (void)memset(commandLine, 0, sizeof(commandLine));
+   (void)strncpy(commandLine, UNUSED_GPIO_INIT_SCRIPT, sizeof(commandLine));
+   int ret = system(commandLine);
+
+   return ret;
+}
+
+
+// heater code
+/*******************************************************************************************/
+/*                                                                                         */
+/* int initHeaterGPIOs()                                                                   */
+/*                                                                                         */
+/* Initialize the GPIOs for managing the heaters.                                          */
+/*                                                                                         */
+/* Returns: int ret - 0 = success, 1 = failure                                             */
+/*                                                                                         */
+/*******************************************************************************************/
+int initHeaterGPIOs()
+{
+   char commandLine[COMMAND_LINE_BUFFER_SIZE];
+
+   (void)memset(commandLine, 0, sizeof(commandLine));
+   (void)strncpy(commandLine, HEATER_GPIO_INIT_SCRIPT, sizeof(commandLine));
+   int ret = system(commandLine);
+
+   return ret;
+}
+
+
+/*******************************************************************************************/
+/*                                                                                         */
+/* int enableDisableHeater(int heaterIndex, bool enabled)                                  */
+/*                                                                                         */
+/* Turns the requested heater on/off                                                       */
+/*                                                                                         */
+/* Returns: int ret - 0 = success, 1 = failure                                             */
+/*                                                                                         */
+/*******************************************************************************************/
+int enableDisableHeater(int heaterIndex, bool enabled)
+{
+   int ret = 0;
+
+   if ((heaterIndex >= SLOT1_TOP_HEATER_INDEX) && (heaterIndex <= SLOT6_BOTTOM_HEATER_INDEX))
    {
-      if (heaterInfo[i].is_enabled)
-      {
-         numberOfHeatersEnabled++;
-      }
-      if (heaterInfo[i].is_enabled && ((HEATER_LOCATION_UPPER == heaterInfo[i].location) && (heaterInfo[i].current_temperature >= (heaterInfo[i].temperature_setpoint - 10))))
-      {
-         numberOfHeatersAtTemp++;
-      }
-      if (heaterInfo[i].is_enabled && ((HEATER_LOCATION_LOWER == heaterInfo[i].location) && (heaterInfo[i].current_temperature >= heaterInfo[i].temperature_setpoint)))
+      // if the index is in range, set is_enabled to the specified value
+      heaterInfo[heaterIndex].is_enabled = enabled;
+      if (enabled)
       {
-         numberOfHeatersAtTemp++;
+         // if we're enabling a heater, reset error states
+         // they will be checked the next time the heater algorithm runs
+         rtdMappings[heaterIndex].is_shorted = false;
+         rtdMappings[heaterIndex].is_open    = false;
+         heaterInfo[heaterIndex].is_undertemp = false;
+         heaterInfo[heaterIndex].is_overtemp = false;
+         heaterInfo[heaterIndex].is_undertemp_CSS = false;
+         heaterInfo[heaterIndex].is_overtemp_CSS = false;
+         heaterInfo[heaterIndex].overtemp_oneshot = false;
+         heaterInfo[heaterIndex].undertemp_oneshot = false;
+         rtdMappings[heaterIndex].shorted_oneshot = false;
+         rtdMappings[heaterIndex].open_oneshot = false;
+         heaterInfo[heaterIndex].eco_mode_on = false;
+         heaterInfo[heaterIndex].seconds_undertemp = 0;
+         heaterInfo[heaterIndex].seconds_overtemp = 0;
+         rtdMappings[heaterIndex].seconds_shorted = 0;
+         rtdMappings[heaterIndex].seconds_open = 0;
       }
    }
- printf("numberOfHeatersEnabled = %d, numberOfHeatersAtTemp = %d\n", numberOfHeatersEnabled, numberOfHeatersAtTemp);
-   if ((numberOfHeatersEnabled == numberOfHeatersAtTemp) || (startupTimeSeconds >= MAX_STARTUP_REACH_SETPOINT_TIME))
+   else
    {
-printf("initialStartup is COMPLETE or startup time exceeded. Should resume regular heater algorithm\n");
-      initialStartup = false;
+      // bad index
+      ret = 1;
    }
+
+   return ret;
 }
 
 
 /*******************************************************************************************/
 /*                                                                                         */
-/* void runHeaterAlgorithm()                                                               */
+/* int turnHeaterOnOff(int heaterIndex, uhc::HeaterState on)                               */
 /*                                                                                         */
-/* Once per second, run the heater control algorithm. Figure out the eight heaters that    */
-/* are the farthest from their setpoints, and turn on their heaters. Ones that were on     */
-/* but won't be, turn them off before turning on any heaters. This eliminates the chance   */
-/* of having more than eight heaters on at any given time. Turn off a heater if it is      */
-/* above the setpoint.                                                                     */
+/* Turns the requested heater on/off                                                       */
 /*                                                                                         */
-/* Returns: None                                                                           */
+/* Returns: int ret - 0 = success, 1 = failure                                             */
 /*                                                                                         */
 /*******************************************************************************************/
-void runHeaterAlgorithm()
+int turnHeaterOnOff(int heaterIndex, uhc::HeaterState on)
 {
-   // based on the data provided by HennyPenny, their custom Watlow
-   // heaters are rated for 400W at 240V, thus drawing a max of 1.66A
-   // With 1.2A consumed by the 12V power supply, we
-   // have 13.8A to work with to power the heaters and stay within
-   // the 15A from the wall outlet limit.
-   // At 1.66A each, we can safely run 8 heaters, since
-   // 8 * 1.66A = 13.28A
-   // 13.28A + 1.2A < 15A
-
-   // check if any heaters are at or above their setpoints
-   // by calculating their current delta_temp
-   // if the delta is <= 0, turn those heaters off
-   // if the delta is > 0 but <= 5, that heater may need to turned on.
-   // go through all of the heaters and find the top 8 deltas
-   // then turn their heaters on.
-   // but first, turn off any heaters that are transitioning to off so that
-   // we don't violate the power budget
-
-   float volts = 0.0;
-   (void)atm90e26_vrms_get(&volts);
-
-   // default to 8 and 4 if we can't get the line voltage
-   int maxHeatersOn = 8;
-   int startingIndex = 4;
+   int ret = 0;
 
-   if (volts > 0.0)
+   if ((heaterIndex >= SLOT1_TOP_HEATER_INDEX) && (heaterIndex <= SLOT6_BOTTOM_HEATER_INDEX))
    {
-      if (volts <= 201.0)
-      {
-         maxHeatersOn = 10;
-         startingIndex = 2;
-      }
-      else if ((volts > 201.0) && (volts <= 221.0))
+      // if the index is in range, set heater_on to the specified value
+      int fd_on = heaterInfo[heaterIndex].fd;
+      int bytesWritten = 0;
+      heaterInfo[heaterIndex].state = on;
+
+      if (HEATER_STATE_ON == on)
       {
-         maxHeatersOn = 9;
-         startingIndex = 3;
+         bytesWritten = write(fd_on, HEATER_ON_STRING, 1);
+         if (debugHeatersPrintf)
+         {
+            (void)printf("Heater %d ON\n", heaterIndex);
+         }
       }
       else
       {
-         maxHeatersOn = 8;
-         startingIndex = 4;
+         bytesWritten = write(fd_on, HEATER_OFF_STRING, 1);
+         if (debugHeatersPrintf)
+         {
+            (void)printf("Heater %d OFF\n", heaterIndex);
+         }
       }
-   }
-
-   if (initialStartup)
-   {
-      regularHeaterAlgorithmOneShot = true;
 
-      if (!startupMessageReceived)
-      {
-         // do not start the fastest heating possible algorithm
-         // until the HMI sends the STARTUP command.
-         return;
-      }
-      // Turn on all 6 lower heaters and at least two uppers 100% duty cycle until startup is complete,
-      // then resume the normal algorithm
-      startupTimeSeconds++;
-#if (0)
-      for (int i = 0; i < NUM_HEATERS; i++)
+      if (-1 == bytesWritten)
       {
-         if (!heaterInfo[i].is_enabled)
+         if (debugPrintf)
          {
-            // if the user has turned off ANY heater
-            // abort the startup algorithm and let the regular algorithm take over.
-            initialStartup = false;
-            return;
+            (void)printf("Error writing to %s\n", heaterInfo[heaterIndex].GPIO_PATH);
          }
+
+         ret = 1;
       }
-#endif
-      // run the heater startup algorithm
-      heatersAtStartup(maxHeatersOn);
    }
    else
    {
-      if (regularHeaterAlgorithmOneShot)
-      {
-         printf("Resuming regular heater algorithm\n");
-         regularHeaterAlgorithmOneShot = false;
-      }
-      // normal operating mode heater algorithm
-      (void)memset(tempDeltas, 0, sizeof(tempDeltas));
-      for (int i = 0; i < NUM_HEATERS; i++)
-      {
-         if (!heaterInfo[i].is_enabled)
-         {
-            // if a heater is not enabled, make sure it's off
-            // and set the delta to MAX_NEGATIVE_DELTA_TEMP so that it's shuffled to the end of the line
-            // a negative delta temp means the temp is above the setpoint
-            heaterInfo[i].delta_temp = MAX_NEGATIVE_DELTA_TEMP;
-            tempDeltas[i] = heaterInfo[i].delta_temp;
-            heaterInfo[i].was_on = false;
-            heaterInfo[i].is_on = false;
-            (void)turnHeaterOnOff(i, HEATER_STATE_OFF);
-         }
-         else
-         {
-            // readADCThread is the single point of contact for reading the RTDs
-            // so it updates the current temperature in the heater info structure
-            // a negative delta temp means the temp is above the setpoint
-            heaterInfo[i].delta_temp = heaterInfo[i].temperature_setpoint - heaterInfo[i].current_temperature;
-            tempDeltas[i] = heaterInfo[i].delta_temp;
-            heaterInfo[i].was_on = heaterInfo[i].is_on;
-            heaterInfo[i].is_on = false;
-            if (startupComplete && !heaterInfo[i].setpoint_changed)
-            {
-               // only perform undertemp or overtemp limit checking once startup is complete
-               // otherwise, virtually all slots will generate an undertemp limit alarm
-               if (heaterInfo[i].current_temperature < (heaterInfo[i].temperature_setpoint - UNDERTEMP_DELTA_LIMIT_DEGREES))
-               {
-                  heaterInfo[i].is_undertemp = true;
-               }
-               else
-               {
-                  heaterInfo[i].is_undertemp = false;
-               }
+      // bad index
+      ret = 1;
+   }
 
-               if (heaterInfo[i].current_temperature > (heaterInfo[i].temperature_setpoint + OVERTEMP_DELTA_LIMIT_DEGREES))
-               {
-                  heaterInfo[i].is_overtemp = true;
-               }
-               else
-               {
-                  heaterInfo[i].is_overtemp = false;
-               }
+   return ret;
+}
 
-               int lowerHeaterThisShelf = 0;
-               int upperHeaterThisShelf = 0;
-               int shelfNumber = 0;
 
-               if (heaterInfo[i].is_undertemp && heaterInfo[i].is_enabled && !heaterInfo[i].setpoint_changed)
-               {
-                  heaterInfo[i].seconds_undertemp++;
-                  if ((heaterInfo[i].seconds_undertemp > UNDERTEMP_DELTA_LIMIT_SECONDS) && !heaterInfo[i].undertemp_oneshot)
-                  {
-                     if (debugHeatersPrintf)
+/*******************************************************************************************/
+/*                                                                                         */
+/* int setHeaterTimesIndex(int heaterIndex,                                                */
+/*                         google::protobuf::Timestamp startTime,                          */
+/*                         google::protobuf::Timestamp endTime)                            */
+/*                                                                                         */
+/* Set the heater start and end times to the specified values.                             */
+/*                                                                                         */
+/* Returns: int ret - 0 = success, 1 = failure                                             */
+/*                                                                                         */
+/*******************************************************************************************/
+int setHeaterTimesIndex(int heaterIndex, google::protobuf::Timestamp startTime, google::protobuf::Timestamp endTime)
+{
+   int ret = 0;
+
+   if ((heaterIndex >= SLOT1_TOP_HEATER_INDEX) && (heaterIndex <= SLOT6_BOTTOM_HEATER_INDEX))
+   {
+      // if the index is in range, set start and end times to the specified value
+      heaterInfo[heaterIndex].start_time = startTime;
+      heaterInfo[heaterIndex].end_time = endTime;
+   }
+   else
+   {
+      // bad index
+      ret = 1;
+   }
+
+   return ret;
+}
+
+
+/*******************************************************************************************/
+/*                                                                                         */
+/* int setHeaterTimesSlot(int slot,                                                        */
+/*                         google::protobuf::Timestamp startTime,                          */
+/*                         google::protobuf::Timestamp endTime)                            */
+/*                                                                                         */
+/* Set the heater start and end times to the specified values for a given slot.            */
+/*                                                                                         */
+/* Returns: int ret - 0 = success, 1 = failure                                             */
+/*                                                                                         */
+/*******************************************************************************************/
+int setHeaterTimesSlot(int slot, google::protobuf::Timestamp startTime, google::protobuf::Timestamp endTime)
+{
+   int ret = 0;
+
+   if ((slot >= SLOT1) && (slot <= SLOT6))
+   {
+      // SLOTS are 1 based; the index needs to be zero based.
+      slot -= 1;
+
+      // if the index is in range, set start and end times to the specified value
+      // set the upper heater times
+      heaterInfo[(slot*2)].start_time = startTime;
+      heaterInfo[(slot*2)].end_time = endTime;
+
+      // set the upper heater times
+      heaterInfo[(slot*2)+1].start_time = startTime;
+      heaterInfo[(slot*2)+1].end_time = endTime;
+   }
+   else
+   {
+      // bad index
+      ret = 1;
+   }
+
+   return ret;
+}
+/*******************************************************************************************/
+/*                                                                                         */
+/* int initHeaterDataStructures()                                                          */
+/*                                                                                         */
+/* Initialize the data structures for managing the heaters.                                */
+/*                                                                                         */
+/* Returns: int ret - 0 = success, 1 = failure                                             */
+/*                                                                                         */
+/*******************************************************************************************/
+int initHeaterDataStructures()
+{
+   (void)memset(heaterInfo, 0, sizeof(heaterInfo));
+
+   ::google::protobuf::Timestamp* timestamp = new ::google::protobuf::Timestamp();
+   struct timeval now;
+   (void)gettimeofday(&now, NULL);
+   timestamp->set_seconds(now.tv_sec);
+   timestamp->set_nanos(now.tv_usec * 1000);
+
+   int i = 0;
+   heaterInfo[i].state = HEATER_OFF;
+   heaterInfo[i].location = (i % 2) ? HEATER_LOCATION_LOWER : HEATER_LOCATION_UPPER;
+   heaterInfo[i].temperature_setpoint = DEFAULT_SETPOINT;
+   heaterInfo[i].saved_setpoint = DEFAULT_SETPOINT;
+   heaterInfo[i].cleaning_mode_setpoint = CLEANING_MODE_SETPOINT;
+   heaterInfo[i].eco_mode_setpoint = DEFAULT_ECO_MODE_SETPOINT;
+   setHeaterTemperature(i, readADCChannel(i));
+   (void)strncpy(heaterInfo[i].GPIO_PATH, SLOT1_TOP_HEATER, sizeof(heaterInfo[i].GPIO_PATH));
+   heaterInfo[i].fd = open(heaterInfo[i].GPIO_PATH, O_WRONLY);
+   heaterInfo[i].is_enabled = false;
+   heaterInfo[i].is_on = false;
+   heaterInfo[i].was_on = false;
+   heaterInfo[i].is_undertemp = false;
+   heaterInfo[i].is_overtemp = false;
+   heaterInfo[i].is_undertemp_CSS = false;
+   heaterInfo[i].is_overtemp_CSS = false;
+   heaterInfo[i].overtemp_oneshot = false;
+   heaterInfo[i].undertemp_oneshot = false;
+   heaterInfo[i].eco_mode_on = false;
+   heaterInfo[i].setpoint_changed = false;
+   heaterInfo[i].eco_mode_is_on = false;
+   heaterInfo[i].seconds_undertemp = 0;
+   heaterInfo[i].seconds_overtemp = 0;
+   heaterInfo[i].seconds_on_time = 0;
+   heaterInfo[i].delta_temp = (heaterInfo[i].temperature_setpoint * TEMP_TENTHS_PER_DEGREE) - heaterInfo[i].current_temperature_tenths;
+   heaterInfo[i].start_time.set_seconds(timestamp->seconds());
+   heaterInfo[i].start_time.set_nanos(0);
+   heaterInfo[i].end_time.set_seconds(timestamp->seconds());
+   heaterInfo[i].end_time.set_nanos(0);
+
+   i++;  // 1
+   heaterInfo[i].state = HEATER_OFF;
+   heaterInfo[i].location = (i % 2) ? HEATER_LOCATION_LOWER : HEATER_LOCATION_UPPER;
+   heaterInfo[i].temperature_setpoint = DEFAULT_SETPOINT;
+   heaterInfo[i].saved_setpoint = DEFAULT_SETPOINT;
+   heaterInfo[i].cleaning_mode_setpoint = CLEANING_MODE_SETPOINT;
+   heaterInfo[i].eco_mode_setpoint = DEFAULT_ECO_MODE_SETPOINT;
+   setHeaterTemperature(i, readADCChannel(i));
+   (void)strncpy(heaterInfo[i].GPIO_PATH, SLOT1_BOTTOM_HEATER, sizeof(heaterInfo[i].GPIO_PATH));
+   heaterInfo[i].fd = open(heaterInfo[i].GPIO_PATH, O_WRONLY);
+   heaterInfo[i].is_enabled = false;
+   heaterInfo[i].is_on = false;
+   heaterInfo[i].was_on = false;
+   heaterInfo[i].is_undertemp = false;
+   heaterInfo[i].is_overtemp = false;
+   heaterInfo[i].is_undertemp_CSS = false;
+   heaterInfo[i].is_overtemp_CSS = false;
+   heaterInfo[i].overtemp_oneshot = false;
+   heaterInfo[i].undertemp_oneshot = false;
+   heaterInfo[i].eco_mode_on = false;
+   heaterInfo[i].setpoint_changed = false;
+   heaterInfo[i].eco_mode_is_on = false;
+   heaterInfo[i].seconds_undertemp = 0;
+   heaterInfo[i].seconds_overtemp = 0;
+   heaterInfo[i].seconds_on_time = 0;
+   heaterInfo[i].delta_temp = (heaterInfo[i].temperature_setpoint * TEMP_TENTHS_PER_DEGREE) - heaterInfo[i].current_temperature_tenths;
+   heaterInfo[i].start_time.set_seconds(timestamp->seconds());
+   heaterInfo[i].start_time.set_nanos(0);
+   heaterInfo[i].end_time.set_seconds(timestamp->seconds());
+   heaterInfo[i].end_time.set_nanos(0);
+
+   i++;  // 2
+   heaterInfo[i].state = HEATER_OFF;
+   heaterInfo[i].location = (i % 2) ? HEATER_LOCATION_LOWER : HEATER_LOCATION_UPPER;
+   heaterInfo[i].temperature_setpoint = DEFAULT_SETPOINT;
+   heaterInfo[i].saved_setpoint = DEFAULT_SETPOINT;
+   heaterInfo[i].cleaning_mode_setpoint = CLEANING_MODE_SETPOINT;
+   heaterInfo[i].eco_mode_setpoint = DEFAULT_ECO_MODE_SETPOINT;
+   setHeaterTemperature(i, readADCChannel(i));
+   (void)strncpy(heaterInfo[i].GPIO_PATH, SLOT2_TOP_HEATER, sizeof(heaterInfo[i].GPIO_PATH));
+   heaterInfo[i].fd = open(heaterInfo[i].GPIO_PATH, O_WRONLY);
+   heaterInfo[i].is_enabled = false;
+   heaterInfo[i].is_on = false;
+   heaterInfo[i].was_on = false;
+   heaterInfo[i].is_undertemp = false;
+   heaterInfo[i].is_overtemp = false;
+   heaterInfo[i].is_undertemp_CSS = false;
+   heaterInfo[i].is_overtemp_CSS = false;
+   heaterInfo[i].overtemp_oneshot = false;
+   heaterInfo[i].undertemp_oneshot = false;
+   heaterInfo[i].eco_mode_on = false;
+   heaterInfo[i].setpoint_changed = false;
+   heaterInfo[i].eco_mode_is_on = false;
+   heaterInfo[i].seconds_undertemp = 0;
+   heaterInfo[i].seconds_overtemp = 0;
+   heaterInfo[i].seconds_on_time = 0;
+   heaterInfo[i].delta_temp = (heaterInfo[i].temperature_setpoint * TEMP_TENTHS_PER_DEGREE) - heaterInfo[i].current_temperature_tenths;
+   heaterInfo[i].start_time.set_seconds(timestamp->seconds());
+   heaterInfo[i].start_time.set_nanos(0);
+   heaterInfo[i].end_time.set_seconds(timestamp->seconds());
+   heaterInfo[i].end_time.set_nanos(0);
+
+   i++;  // 3
+   heaterInfo[i].state = HEATER_OFF;
+   heaterInfo[i].location = (i % 2) ? HEATER_LOCATION_LOWER : HEATER_LOCATION_UPPER;
+   heaterInfo[i].temperature_setpoint = DEFAULT_SETPOINT;
+   heaterInfo[i].saved_setpoint = DEFAULT_SETPOINT;
+   heaterInfo[i].cleaning_mode_setpoint = CLEANING_MODE_SETPOINT;
+   heaterInfo[i].eco_mode_setpoint = DEFAULT_ECO_MODE_SETPOINT;
+   setHeaterTemperature(i, readADCChannel(i));
+   (void)strncpy(heaterInfo[i].GPIO_PATH, SLOT2_BOTTOM_HEATER, sizeof(heaterInfo[i].GPIO_PATH));
+   heaterInfo[i].fd = open(heaterInfo[i].GPIO_PATH, O_WRONLY);
+   heaterInfo[i].is_enabled = false;
+   heaterInfo[i].is_on = false;
+   heaterInfo[i].was_on = false;
+   heaterInfo[i].is_undertemp = false;
+   heaterInfo[i].is_overtemp = false;
+   heaterInfo[i].is_undertemp_CSS = false;
+   heaterInfo[i].is_overtemp_CSS = false;
+   heaterInfo[i].overtemp_oneshot = false;
+   heaterInfo[i].undertemp_oneshot = false;
+   heaterInfo[i].eco_mode_on = false;
+   heaterInfo[i].setpoint_changed = false;
+   heaterInfo[i].eco_mode_is_on = false;
+   heaterInfo[i].seconds_undertemp = 0;
+   heaterInfo[i].seconds_overtemp = 0;
+   heaterInfo[i].seconds_on_time = 0;
+   heaterInfo[i].delta_temp = (heaterInfo[i].temperature_setpoint * TEMP_TENTHS_PER_DEGREE) - heaterInfo[i].current_temperature_tenths;
+   heaterInfo[i].start_time.set_seconds(timestamp->seconds());
+   heaterInfo[i].start_time.set_nanos(0);
+   heaterInfo[i].end_time.set_seconds(timestamp->seconds());
+   heaterInfo[i].end_time.set_nanos(0);
+
+   i++;  // 4
+   heaterInfo[i].state = HEATER_OFF;
+   heaterInfo[i].location = (i % 2) ? HEATER_LOCATION_LOWER : HEATER_LOCATION_UPPER;
+   heaterInfo[i].temperature_setpoint = DEFAULT_SETPOINT;
+   heaterInfo[i].saved_setpoint = DEFAULT_SETPOINT;
+   heaterInfo[i].cleaning_mode_setpoint = CLEANING_MODE_SETPOINT;
+   heaterInfo[i].eco_mode_setpoint = DEFAULT_ECO_MODE_SETPOINT;
+   setHeaterTemperature(i, readADCChannel(i));
+   (void)strncpy(heaterInfo[i].GPIO_PATH, SLOT3_TOP_HEATER, sizeof(heaterInfo[i].GPIO_PATH));
+   heaterInfo[i].fd = open(heaterInfo[i].GPIO_PATH, O_WRONLY);
+   heaterInfo[i].is_enabled = false;
+   heaterInfo[i].is_on = false;
+   heaterInfo[i].was_on = false;
+   heaterInfo[i].is_undertemp = false;
+   heaterInfo[i].is_overtemp = false;
+   heaterInfo[i].is_undertemp_CSS = false;
+   heaterInfo[i].is_overtemp_CSS = false;
+   heaterInfo[i].overtemp_oneshot = false;
+   heaterInfo[i].undertemp_oneshot = false;
+   heaterInfo[i].eco_mode_on = false;
+   heaterInfo[i].setpoint_changed = false;
+   heaterInfo[i].eco_mode_is_on = false;
+   heaterInfo[i].seconds_undertemp = 0;
+   heaterInfo[i].seconds_overtemp = 0;
+   heaterInfo[i].seconds_on_time = 0;
+   heaterInfo[i].delta_temp = (heaterInfo[i].temperature_setpoint * TEMP_TENTHS_PER_DEGREE) - heaterInfo[i].current_temperature_tenths;
+   heaterInfo[i].start_time.set_seconds(timestamp->seconds());
+   heaterInfo[i].start_time.set_nanos(0);
+   heaterInfo[i].end_time.set_seconds(timestamp->seconds());
+   heaterInfo[i].end_time.set_nanos(0);
+
+   i++;  // 5
+   heaterInfo[i].state = HEATER_OFF;
+   heaterInfo[i].location = (i % 2) ? HEATER_LOCATION_LOWER : HEATER_LOCATION_UPPER;
+   heaterInfo[i].temperature_setpoint = DEFAULT_SETPOINT;
+   heaterInfo[i].saved_setpoint = DEFAULT_SETPOINT;
+   heaterInfo[i].cleaning_mode_setpoint = CLEANING_MODE_SETPOINT;
+   heaterInfo[i].eco_mode_setpoint = DEFAULT_ECO_MODE_SETPOINT;
+   setHeaterTemperature(i, readADCChannel(i));
+   (void)strncpy(heaterInfo[i].GPIO_PATH, SLOT3_BOTTOM_HEATER, sizeof(heaterInfo[i].GPIO_PATH));
+   heaterInfo[i].fd = open(heaterInfo[i].GPIO_PATH, O_WRONLY);
+   heaterInfo[i].is_enabled = false;
+   heaterInfo[i].is_on = false;
+   heaterInfo[i].was_on = false;
+   heaterInfo[i].is_undertemp = false;
+   heaterInfo[i].is_overtemp = false;
+   heaterInfo[i].is_undertemp_CSS = false;
+   heaterInfo[i].is_overtemp_CSS = false;
+   heaterInfo[i].overtemp_oneshot = false;
+   heaterInfo[i].undertemp_oneshot = false;
+   heaterInfo[i].eco_mode_on = false;
+   heaterInfo[i].setpoint_changed = false;
+   heaterInfo[i].eco_mode_is_on = false;
+   heaterInfo[i].seconds_undertemp = 0;
+   heaterInfo[i].seconds_overtemp = 0;
+   heaterInfo[i].seconds_on_time = 0;
+   heaterInfo[i].delta_temp = (heaterInfo[i].temperature_setpoint * TEMP_TENTHS_PER_DEGREE) - heaterInfo[i].current_temperature_tenths;
+   heaterInfo[i].start_time.set_seconds(timestamp->seconds());
+   heaterInfo[i].start_time.set_nanos(0);
+   heaterInfo[i].end_time.set_seconds(timestamp->seconds());
+   heaterInfo[i].end_time.set_nanos(0);
+
+   i++;  // 6
+   heaterInfo[i].state = HEATER_OFF;
+   heaterInfo[i].location = (i % 2) ? HEATER_LOCATION_LOWER : HEATER_LOCATION_UPPER;
+   heaterInfo[i].temperature_setpoint = DEFAULT_SETPOINT;
+   heaterInfo[i].saved_setpoint = DEFAULT_SETPOINT;
+   heaterInfo[i].cleaning_mode_setpoint = CLEANING_MODE_SETPOINT;
+   heaterInfo[i].eco_mode_setpoint = DEFAULT_ECO_MODE_SETPOINT;
+   setHeaterTemperature(i, readADCChannel(i));
+   (void)strncpy(heaterInfo[i].GPIO_PATH, SLOT4_TOP_HEATER, sizeof(heaterInfo[i].GPIO_PATH));
+   heaterInfo[i].fd = open(heaterInfo[i].GPIO_PATH, O_WRONLY);
+   heaterInfo[i].is_enabled = false;
+   heaterInfo[i].is_on = false;
+   heaterInfo[i].was_on = false;
+   heaterInfo[i].is_undertemp = false;
+   heaterInfo[i].is_overtemp = false;
+   heaterInfo[i].is_undertemp_CSS = false;
+   heaterInfo[i].is_overtemp_CSS = false;
+   heaterInfo[i].overtemp_oneshot = false;
+   heaterInfo[i].undertemp_oneshot = false;
+   heaterInfo[i].eco_mode_on = false;
+   heaterInfo[i].setpoint_changed = false;
+   heaterInfo[i].eco_mode_is_on = false;
+   heaterInfo[i].seconds_undertemp = 0;
+   heaterInfo[i].seconds_overtemp = 0;
+   heaterInfo[i].seconds_on_time = 0;
+   heaterInfo[i].delta_temp = (heaterInfo[i].temperature_setpoint * TEMP_TENTHS_PER_DEGREE) - heaterInfo[i].current_temperature_tenths;
+   heaterInfo[i].start_time.set_seconds(timestamp->seconds());
+   heaterInfo[i].start_time.set_nanos(0);
+   heaterInfo[i].end_time.set_seconds(timestamp->seconds());
+   heaterInfo[i].end_time.set_nanos(0);
+
+   i++;  // 7
+   heaterInfo[i].state = HEATER_OFF;
+   heaterInfo[i].location = (i % 2) ? HEATER_LOCATION_LOWER : HEATER_LOCATION_UPPER;
+   heaterInfo[i].temperature_setpoint = DEFAULT_SETPOINT;
+   heaterInfo[i].saved_setpoint = DEFAULT_SETPOINT;
+   heaterInfo[i].cleaning_mode_setpoint = CLEANING_MODE_SETPOINT;
+   heaterInfo[i].eco_mode_setpoint = DEFAULT_ECO_MODE_SETPOINT;
+   setHeaterTemperature(i, readADCChannel(i));
+   (void)strncpy(heaterInfo[i].GPIO_PATH, SLOT4_BOTTOM_HEATER, sizeof(heaterInfo[i].GPIO_PATH));
+   heaterInfo[i].fd = open(heaterInfo[i].GPIO_PATH, O_WRONLY);
+   heaterInfo[i].is_enabled = false;
+   heaterInfo[i].is_on = false;
+   heaterInfo[i].was_on = false;
+   heaterInfo[i].is_undertemp = false;
+   heaterInfo[i].is_overtemp = false;
+   heaterInfo[i].is_undertemp_CSS = false;
+   heaterInfo[i].is_overtemp_CSS = false;
+   heaterInfo[i].overtemp_oneshot = false;
+   heaterInfo[i].undertemp_oneshot = false;
+   heaterInfo[i].eco_mode_on = false;
+   heaterInfo[i].setpoint_changed = false;
+   heaterInfo[i].eco_mode_is_on = false;
+   heaterInfo[i].seconds_undertemp = 0;
+   heaterInfo[i].seconds_overtemp = 0;
+   heaterInfo[i].seconds_on_time = 0;
+   heaterInfo[i].delta_temp = (heaterInfo[i].temperature_setpoint * TEMP_TENTHS_PER_DEGREE) - heaterInfo[i].current_temperature_tenths;
+   heaterInfo[i].start_time.set_seconds(timestamp->seconds());
+   heaterInfo[i].start_time.set_nanos(0);
+   heaterInfo[i].end_time.set_seconds(timestamp->seconds());
+   heaterInfo[i].end_time.set_nanos(0);
+
+   i++;  // 8
+   heaterInfo[i].state = HEATER_OFF;
+   heaterInfo[i].location = (i % 2) ? HEATER_LOCATION_LOWER : HEATER_LOCATION_UPPER;
+   heaterInfo[i].temperature_setpoint = DEFAULT_SETPOINT;
+   heaterInfo[i].saved_setpoint = DEFAULT_SETPOINT;
+   heaterInfo[i].cleaning_mode_setpoint = CLEANING_MODE_SETPOINT;
+   heaterInfo[i].eco_mode_setpoint = DEFAULT_ECO_MODE_SETPOINT;
+   setHeaterTemperature(i, readADCChannel(i));
+   (void)strncpy(heaterInfo[i].GPIO_PATH, SLOT5_TOP_HEATER, sizeof(heaterInfo[i].GPIO_PATH));
+   heaterInfo[i].fd = open(heaterInfo[i].GPIO_PATH, O_WRONLY);
+   heaterInfo[i].is_enabled = false;
+   heaterInfo[i].is_on = false;
+   heaterInfo[i].was_on = false;
+   heaterInfo[i].is_undertemp = false;
+   heaterInfo[i].is_overtemp = false;
+   heaterInfo[i].is_undertemp_CSS = false;
+   heaterInfo[i].is_overtemp_CSS = false;
+   heaterInfo[i].overtemp_oneshot = false;
+   heaterInfo[i].undertemp_oneshot = false;
+   heaterInfo[i].eco_mode_on = false;
+   heaterInfo[i].setpoint_changed = false;
+   heaterInfo[i].eco_mode_is_on = false;
+   heaterInfo[i].seconds_undertemp = 0;
+   heaterInfo[i].seconds_overtemp = 0;
+   heaterInfo[i].seconds_on_time = 0;
+   heaterInfo[i].delta_temp = (heaterInfo[i].temperature_setpoint * TEMP_TENTHS_PER_DEGREE) - heaterInfo[i].current_temperature_tenths;
+   heaterInfo[i].start_time.set_seconds(timestamp->seconds());
+   heaterInfo[i].start_time.set_nanos(0);
+   heaterInfo[i].end_time.set_seconds(timestamp->seconds());
+   heaterInfo[i].end_time.set_nanos(0);
+
+   i++;  // 9
+   heaterInfo[i].state = HEATER_OFF;
+   heaterInfo[i].location = (i % 2) ? HEATER_LOCATION_LOWER : HEATER_LOCATION_UPPER;
+   heaterInfo[i].temperature_setpoint = DEFAULT_SETPOINT;
+   heaterInfo[i].saved_setpoint = DEFAULT_SETPOINT;
+   heaterInfo[i].cleaning_mode_setpoint = CLEANING_MODE_SETPOINT;
+   heaterInfo[i].eco_mode_setpoint = DEFAULT_ECO_MODE_SETPOINT;
+   setHeaterTemperature(i, readADCChannel(i));
+   (void)strncpy(heaterInfo[i].GPIO_PATH, SLOT5_BOTTOM_HEATER, sizeof(heaterInfo[i].GPIO_PATH));
+   heaterInfo[i].fd = open(heaterInfo[i].GPIO_PATH, O_WRONLY);
+   heaterInfo[i].is_enabled = false;
+   heaterInfo[i].is_on = false;
+   heaterInfo[i].was_on = false;
+   heaterInfo[i].is_undertemp = false;
+   heaterInfo[i].is_overtemp = false;
+   heaterInfo[i].is_undertemp_CSS = false;
+   heaterInfo[i].is_overtemp_CSS = false;
+   heaterInfo[i].overtemp_oneshot = false;
+   heaterInfo[i].undertemp_oneshot = false;
+   heaterInfo[i].eco_mode_on = false;
+   heaterInfo[i].setpoint_changed = false;
+   heaterInfo[i].eco_mode_is_on = false;
+   heaterInfo[i].seconds_undertemp = 0;
+   heaterInfo[i].seconds_overtemp = 0;
+   heaterInfo[i].seconds_on_time = 0;
+   heaterInfo[i].delta_temp = (heaterInfo[i].temperature_setpoint * TEMP_TENTHS_PER_DEGREE) - heaterInfo[i].current_temperature_tenths;
+   heaterInfo[i].start_time.set_seconds(timestamp->seconds());
+   heaterInfo[i].start_time.set_nanos(0);
+   heaterInfo[i].end_time.set_seconds(timestamp->seconds());
+   heaterInfo[i].end_time.set_nanos(0);
+
+   i++;  // 10
+   heaterInfo[i].state = HEATER_OFF;
+   heaterInfo[i].location = (i % 2) ? HEATER_LOCATION_LOWER : HEATER_LOCATION_UPPER;
+   heaterInfo[i].temperature_setpoint = DEFAULT_SETPOINT;
+   heaterInfo[i].saved_setpoint = DEFAULT_SETPOINT;
+   heaterInfo[i].cleaning_mode_setpoint = CLEANING_MODE_SETPOINT;
+   heaterInfo[i].eco_mode_setpoint = DEFAULT_ECO_MODE_SETPOINT;
+   setHeaterTemperature(i, readADCChannel(i));
+   (void)strncpy(heaterInfo[i].GPIO_PATH, SLOT6_TOP_HEATER, sizeof(heaterInfo[i].GPIO_PATH));
+   heaterInfo[i].fd = open(heaterInfo[i].GPIO_PATH, O_WRONLY);
+   heaterInfo[i].is_enabled = false;
+   heaterInfo[i].is_on = false;
+   heaterInfo[i].was_on = false;
+   heaterInfo[i].is_undertemp = false;
+   heaterInfo[i].is_overtemp = false;
+   heaterInfo[i].is_undertemp_CSS = false;
+   heaterInfo[i].is_overtemp_CSS = false;
+   heaterInfo[i].overtemp_oneshot = false;
+   heaterInfo[i].undertemp_oneshot = false;
+   heaterInfo[i].eco_mode_on = false;
+   heaterInfo[i].setpoint_changed = false;
+   heaterInfo[i].eco_mode_is_on = false;
+   heaterInfo[i].seconds_undertemp = 0;
+   heaterInfo[i].seconds_overtemp = 0;
+   heaterInfo[i].seconds_on_time = 0;
+   heaterInfo[i].delta_temp = (heaterInfo[i].temperature_setpoint * TEMP_TENTHS_PER_DEGREE) - heaterInfo[i].current_temperature_tenths;
+   heaterInfo[i].start_time.set_seconds(timestamp->seconds());
+   heaterInfo[i].start_time.set_nanos(0);
+   heaterInfo[i].end_time.set_seconds(timestamp->seconds());
+   heaterInfo[i].end_time.set_nanos(0);
+
+   i++;  // 11
+   heaterInfo[i].state = HEATER_OFF;
+   heaterInfo[i].location = (i % 2) ? HEATER_LOCATION_LOWER : HEATER_LOCATION_UPPER;
+   heaterInfo[i].temperature_setpoint = DEFAULT_SETPOINT;
+   heaterInfo[i].saved_setpoint = DEFAULT_SETPOINT;
+   heaterInfo[i].cleaning_mode_setpoint = CLEANING_MODE_SETPOINT;
+   heaterInfo[i].eco_mode_setpoint = DEFAULT_ECO_MODE_SETPOINT;
+   setHeaterTemperature(i, readADCChannel(i));
+   (void)strncpy(heaterInfo[i].GPIO_PATH, SLOT6_BOTTOM_HEATER, sizeof(heaterInfo[i].GPIO_PATH));
+   heaterInfo[i].fd = open(heaterInfo[i].GPIO_PATH, O_WRONLY);
+   heaterInfo[i].is_enabled = false;
+   heaterInfo[i].is_on = false;
+   heaterInfo[i].was_on = false;
+   heaterInfo[i].is_undertemp = false;
+   heaterInfo[i].is_overtemp = false;
+   heaterInfo[i].is_undertemp_CSS = false;
+   heaterInfo[i].is_overtemp_CSS = false;
+   heaterInfo[i].overtemp_oneshot = false;
+   heaterInfo[i].undertemp_oneshot = false;
+   heaterInfo[i].eco_mode_on = false;
+   heaterInfo[i].setpoint_changed = false;
+   heaterInfo[i].eco_mode_is_on = false;
+   heaterInfo[i].seconds_undertemp = 0;
+   heaterInfo[i].seconds_overtemp = 0;
+   heaterInfo[i].seconds_on_time = 0;
+   heaterInfo[i].delta_temp = (heaterInfo[i].temperature_setpoint * TEMP_TENTHS_PER_DEGREE) - heaterInfo[i].current_temperature_tenths;
+   heaterInfo[i].start_time.set_seconds(timestamp->seconds());
+   heaterInfo[i].start_time.set_nanos(0);
+   heaterInfo[i].end_time.set_seconds(timestamp->seconds());
+   heaterInfo[i].end_time.set_nanos(0);
+
+   return 0;
+}
+
+
+/*******************************************************************************************/
+/*                                                                                         */
+/* int setSetpointHeater(int channelIndex, uint32_t setpoint)                              */
+/*                                                                                         */
+/* Set the temperature setpoint for a specific heater.                                     */
+/*                                                                                         */
+/* Returns: None                                                                           */
+/*                                                                                         */
+/*******************************************************************************************/
+int setSetpointHeater(int channelIndex, uint32_t setpoint)
+{
+   int ret = 0;
+
+   if ((channelIndex >= SLOT1_TOP_HEATER_INDEX) && (channelIndex <= SLOT6_BOTTOM_HEATER_INDEX))
+   {
+      // if the index is in range, set the setpoint to the specified value
+      heaterInfo[channelIndex].temperature_setpoint = (uint16_t)setpoint;
+      heaterInfo[channelIndex].setpoint_changed = true;
+      ret = 0;
+   }
+   else
+   {
+      ret = 1;
+   }
+
+   return ret;
+}
+
+
+/*******************************************************************************************/
+/*                                                                                         */
+/* void setSetpointSlot(int slotNumber, uint32_ setpoint)                                  */
+/*                                                                                         */
+/* Set the temperature setpoint for a slot. Since there are two heaters/RTDs per slot,     */
+/* set both setpoints to the same value.                                                   */
+/*                                                                                         */
+/* Returns: None                                                                           */
+/*                                                                                         */
+/*******************************************************************************************/
+void setSetpointSlot(int slotNumber, uint32_t setpoint)
+{
+    // when you set a setpoint for a slot, both the upper and lower heaters
+    // get the same setpoint
+    switch (slotNumber)
+    {
+        case SLOT1:
+            heaterInfo[SLOT1_TOP_HEATER_INDEX].temperature_setpoint     = (uint16_t)setpoint;
+            heaterInfo[SLOT1_BOTTOM_HEATER_INDEX].temperature_setpoint  = (uint16_t)setpoint;
+            heaterInfo[SLOT1_TOP_HEATER_INDEX].saved_setpoint           = (uint16_t)setpoint;
+            heaterInfo[SLOT1_BOTTOM_HEATER_INDEX].saved_setpoint        = (uint16_t)setpoint;
+            heaterInfo[SLOT1_TOP_HEATER_INDEX].setpoint_changed = true;
+            heaterInfo[SLOT1_BOTTOM_HEATER_INDEX].setpoint_changed = true;
+            break;
+
+        case SLOT2:
+            heaterInfo[SLOT2_TOP_HEATER_INDEX].temperature_setpoint     = (uint16_t)setpoint;
+            heaterInfo[SLOT2_BOTTOM_HEATER_INDEX].temperature_setpoint  = (uint16_t)setpoint;
+            heaterInfo[SLOT2_TOP_HEATER_INDEX].saved_setpoint           = (uint16_t)setpoint;
+            heaterInfo[SLOT2_BOTTOM_HEATER_INDEX].saved_setpoint        = (uint16_t)setpoint;
+            heaterInfo[SLOT2_TOP_HEATER_INDEX].setpoint_changed = true;
+            heaterInfo[SLOT2_BOTTOM_HEATER_INDEX].setpoint_changed = true;
+            break;
+
+        case SLOT3:
+            heaterInfo[SLOT3_TOP_HEATER_INDEX].temperature_setpoint     = (uint16_t)setpoint;
+            heaterInfo[SLOT3_BOTTOM_HEATER_INDEX].temperature_setpoint  = (uint16_t)setpoint;
+            heaterInfo[SLOT3_TOP_HEATER_INDEX].saved_setpoint           = (uint16_t)setpoint;
+            heaterInfo[SLOT3_BOTTOM_HEATER_INDEX].saved_setpoint        = (uint16_t)setpoint;
+            heaterInfo[SLOT3_TOP_HEATER_INDEX].setpoint_changed = true;
+            heaterInfo[SLOT3_BOTTOM_HEATER_INDEX].setpoint_changed = true;
+            break;
+
+        case SLOT4:
+            heaterInfo[SLOT4_TOP_HEATER_INDEX].temperature_setpoint     = (uint16_t)setpoint;
+            heaterInfo[SLOT4_BOTTOM_HEATER_INDEX].temperature_setpoint  = (uint16_t)setpoint;
+            heaterInfo[SLOT4_TOP_HEATER_INDEX].saved_setpoint           = (uint16_t)setpoint;
+            heaterInfo[SLOT4_BOTTOM_HEATER_INDEX].saved_setpoint        = (uint16_t)setpoint;
+            heaterInfo[SLOT4_TOP_HEATER_INDEX].setpoint_changed = true;
+            heaterInfo[SLOT4_BOTTOM_HEATER_INDEX].setpoint_changed = true;
+            break;
+
+        case SLOT5:
+            heaterInfo[SLOT5_TOP_HEATER_INDEX].temperature_setpoint     = (uint16_t)setpoint;
+            heaterInfo[SLOT5_BOTTOM_HEATER_INDEX].temperature_setpoint  = (uint16_t)setpoint;
+            heaterInfo[SLOT5_TOP_HEATER_INDEX].saved_setpoint           = (uint16_t)setpoint;
+            heaterInfo[SLOT5_BOTTOM_HEATER_INDEX].saved_setpoint        = (uint16_t)setpoint;
+            heaterInfo[SLOT5_TOP_HEATER_INDEX].setpoint_changed = true;
+            heaterInfo[SLOT5_BOTTOM_HEATER_INDEX].setpoint_changed = true;
+            break;
+
+        case SLOT6:
+            heaterInfo[SLOT6_TOP_HEATER_INDEX].temperature_setpoint     = (uint16_t)setpoint;
+            heaterInfo[SLOT6_BOTTOM_HEATER_INDEX].temperature_setpoint  = (uint16_t)setpoint;
+            heaterInfo[SLOT6_TOP_HEATER_INDEX].saved_setpoint           = (uint16_t)setpoint;
+            heaterInfo[SLOT6_BOTTOM_HEATER_INDEX].saved_setpoint        = (uint16_t)setpoint;
+            heaterInfo[SLOT6_TOP_HEATER_INDEX].setpoint_changed = true;
+            heaterInfo[SLOT6_BOTTOM_HEATER_INDEX].setpoint_changed = true;
+            break;
+
+        default:
+            break;
+    }
+}
+
+
+/*******************************************************************************************/
+/*                                                                                         */
+/* void lookupHeaterIndices(int slotNumber,                                                */
+/*                          int *channelIndexTopHeater,                                    */
+/*                          int *channelIndexBottomHeater)                                 */
+/*                                                                                         */
+/* Look up the heater indices for a give slot number.                                      */
+/*                                                                                         */
+/* Returns: None                                                                           */
+/*                                                                                         */
+/*******************************************************************************************/
+void lookupHeaterIndices(int slotNumber, int *channelIndexTopHeater, int *channelIndexBottomHeater)
+{
+   switch (slotNumber)
+   {
+      case SLOT1:
+         *channelIndexTopHeater = SLOT1_TOP_HEATER_INDEX;
+         *channelIndexBottomHeater = SLOT1_BOTTOM_HEATER_INDEX;
+         break;
+
+      case SLOT2:
+         *channelIndexTopHeater = SLOT2_TOP_HEATER_INDEX;
+         *channelIndexBottomHeater = SLOT2_BOTTOM_HEATER_INDEX;
+         break;
+
+      case SLOT3:
+         *channelIndexTopHeater = SLOT3_TOP_HEATER_INDEX;
+         *channelIndexBottomHeater = SLOT3_BOTTOM_HEATER_INDEX;
+         break;
+
+      case SLOT4:
+         *channelIndexTopHeater = SLOT4_TOP_HEATER_INDEX;
+         *channelIndexBottomHeater = SLOT4_BOTTOM_HEATER_INDEX;
+         break;
+
+      case SLOT5:
+         *channelIndexTopHeater = SLOT5_TOP_HEATER_INDEX;
+         *channelIndexBottomHeater = SLOT5_BOTTOM_HEATER_INDEX;
+         break;
+
+      case SLOT6:
+      default:
+         *channelIndexTopHeater = SLOT6_TOP_HEATER_INDEX;
+         *channelIndexBottomHeater = SLOT6_BOTTOM_HEATER_INDEX;
+         break;
+   }
+}
+
+
+/*******************************************************************************************/
+/*                                                                                         */
+/* void heatersAtStartup(int maxHeatersOn)                                                 */
+/*                                                                                         */
+/* This is the heater startup algorithm. Attempt the fastest possible startup by keeping   */
+/* the most heaters on that we can. This will turn on the bottom heaters of all 6 slots    */
+/* and the top heaters of slot 1 and 6, and if possible, up to 2 more upper heaters based  */
+/* on the line voltage.                                                                    */
+/*                                                                                         */
+/* Returns: None                                                                           */
+/*                                                                                         */
+/*******************************************************************************************/
+void heatersAtStartup(int maxHeatersOn)
+{
+   int i = 0;
+   int numHeatersOn = 0;
+
+   // first turn everything off so we don't blow the power budget
+   for (i = 0; i < NUM_HEATERS; i++)
+   {
+      (void)turnHeaterOnOff(i, HEATER_STATE_OFF);
+      heaterInfo[i].is_on = false;
+      heaterInfo[i].was_on = false;
+   }
+
+   // check all lower heaters first
+   if ((numHeatersOn < maxHeatersOn) && heaterInfo[SLOT1_BOTTOM_HEATER_INDEX].is_enabled && (heaterInfo[SLOT1_BOTTOM_HEATER_INDEX].current_temperature_tenths < DEGREES_TO_TEMP_TENTHS(heaterInfo[SLOT1_BOTTOM_HEATER_INDEX].temperature_setpoint)))
+   {
+      (void)turnHeaterOnOff(SLOT1_BOTTOM_HEATER_INDEX, HEATER_STATE_ON);
+      heaterInfo[SLOT1_BOTTOM_HEATER_INDEX].was_on = heaterInfo[SLOT1_BOTTOM_HEATER_INDEX].is_on;
+      heaterInfo[SLOT1_BOTTOM_HEATER_INDEX].is_on = true;
+      heaterInfo[SLOT1_BOTTOM_HEATER_INDEX].seconds_on_time++;
+      numHeatersOn++;
+   }
+
+   if ((numHeatersOn < maxHeatersOn) && heaterInfo[SLOT2_BOTTOM_HEATER_INDEX].is_enabled && (heaterInfo[SLOT2_BOTTOM_HEATER_INDEX].current_temperature_tenths < DEGREES_TO_TEMP_TENTHS(heaterInfo[SLOT2_BOTTOM_HEATER_INDEX].temperature_setpoint)))
+   {
+      (void)turnHeaterOnOff(SLOT2_BOTTOM_HEATER_INDEX, HEATER_STATE_ON);
+      heaterInfo[SLOT2_BOTTOM_HEATER_INDEX].was_on = heaterInfo[SLOT2_BOTTOM_HEATER_INDEX].is_on;
+      heaterInfo[SLOT2_BOTTOM_HEATER_INDEX].is_on = true;
+      heaterInfo[SLOT2_BOTTOM_HEATER_INDEX].seconds_on_time++;
+      numHeatersOn++;
+   }
+
+   if ((numHeatersOn < maxHeatersOn) && heaterInfo[SLOT3_BOTTOM_HEATER_INDEX].is_enabled && (heaterInfo[SLOT3_BOTTOM_HEATER_INDEX].current_temperature_tenths < DEGREES_TO_TEMP_TENTHS(heaterInfo[SLOT3_BOTTOM_HEATER_INDEX].temperature_setpoint)))
+   {
+      (void)turnHeaterOnOff(SLOT3_BOTTOM_HEATER_INDEX, HEATER_STATE_ON);
+      heaterInfo[SLOT3_BOTTOM_HEATER_INDEX].was_on = heaterInfo[SLOT3_BOTTOM_HEATER_INDEX].is_on;
+      heaterInfo[SLOT3_BOTTOM_HEATER_INDEX].is_on = true;
+      heaterInfo[SLOT3_BOTTOM_HEATER_INDEX].seconds_on_time++;
+      numHeatersOn++;
+   }
+
+   if ((numHeatersOn < maxHeatersOn) && heaterInfo[SLOT4_BOTTOM_HEATER_INDEX].is_enabled && (heaterInfo[SLOT4_BOTTOM_HEATER_INDEX].current_temperature_tenths < DEGREES_TO_TEMP_TENTHS(heaterInfo[SLOT4_BOTTOM_HEATER_INDEX].temperature_setpoint)))
+   {
+      (void)turnHeaterOnOff(SLOT4_BOTTOM_HEATER_INDEX, HEATER_STATE_ON);
+      heaterInfo[SLOT4_BOTTOM_HEATER_INDEX].was_on = heaterInfo[SLOT4_BOTTOM_HEATER_INDEX].is_on;
+      heaterInfo[SLOT4_BOTTOM_HEATER_INDEX].is_on = true;
+      heaterInfo[SLOT4_BOTTOM_HEATER_INDEX].seconds_on_time++;
+      numHeatersOn++;
+   }
+
+   if ((numHeatersOn < maxHeatersOn) && heaterInfo[SLOT5_BOTTOM_HEATER_INDEX].is_enabled && (heaterInfo[SLOT5_BOTTOM_HEATER_INDEX].current_temperature_tenths < DEGREES_TO_TEMP_TENTHS(heaterInfo[SLOT5_BOTTOM_HEATER_INDEX].temperature_setpoint)))
+   {
+      (void)turnHeaterOnOff(SLOT5_BOTTOM_HEATER_INDEX, HEATER_STATE_ON);
+      heaterInfo[SLOT5_BOTTOM_HEATER_INDEX].was_on = heaterInfo[SLOT5_BOTTOM_HEATER_INDEX].is_on;
+      heaterInfo[SLOT5_BOTTOM_HEATER_INDEX].is_on = true;
+      heaterInfo[SLOT5_BOTTOM_HEATER_INDEX].seconds_on_time++;
+      numHeatersOn++;
+   }
+
+   if ((numHeatersOn < maxHeatersOn) && heaterInfo[SLOT6_BOTTOM_HEATER_INDEX].is_enabled && (heaterInfo[SLOT6_BOTTOM_HEATER_INDEX].current_temperature_tenths < DEGREES_TO_TEMP_TENTHS(heaterInfo[SLOT6_BOTTOM_HEATER_INDEX].temperature_setpoint)))
+   {
+      (void)turnHeaterOnOff(SLOT6_BOTTOM_HEATER_INDEX, HEATER_STATE_ON);
+      heaterInfo[SLOT6_BOTTOM_HEATER_INDEX].was_on = heaterInfo[SLOT6_BOTTOM_HEATER_INDEX].is_on;
+      heaterInfo[SLOT6_BOTTOM_HEATER_INDEX].is_on = true;
+      heaterInfo[SLOT6_BOTTOM_HEATER_INDEX].seconds_on_time++;
+      numHeatersOn++;
+   }
+
+   // now, check the upper heaters; turn on as many as we can
+   if ((numHeatersOn < maxHeatersOn) && heaterInfo[SLOT6_TOP_HEATER_INDEX].is_enabled && (heaterInfo[SLOT6_TOP_HEATER_INDEX].current_temperature_tenths < DEGREES_TO_TEMP_TENTHS(heaterInfo[SLOT6_TOP_HEATER_INDEX].temperature_setpoint)))
+   {
+      (void)turnHeaterOnOff(SLOT6_TOP_HEATER_INDEX, HEATER_STATE_ON);
+      heaterInfo[SLOT6_TOP_HEATER_INDEX].was_on = heaterInfo[SLOT6_TOP_HEATER_INDEX].is_on;
+      heaterInfo[SLOT6_TOP_HEATER_INDEX].is_on = true;
+      heaterInfo[SLOT6_TOP_HEATER_INDEX].seconds_on_time++;
+      numHeatersOn++;
+   }
+
+   if ((numHeatersOn < maxHeatersOn) && heaterInfo[SLOT1_TOP_HEATER_INDEX].is_enabled && (heaterInfo[SLOT1_TOP_HEATER_INDEX].current_temperature_tenths < DEGREES_TO_TEMP_TENTHS(heaterInfo[SLOT1_TOP_HEATER_INDEX].temperature_setpoint)))
+   {
+      (void)turnHeaterOnOff(SLOT1_TOP_HEATER_INDEX, HEATER_STATE_ON);
+      heaterInfo[SLOT1_TOP_HEATER_INDEX].was_on = heaterInfo[SLOT1_TOP_HEATER_INDEX].is_on;
+      heaterInfo[SLOT1_TOP_HEATER_INDEX].is_on = true;
+      heaterInfo[SLOT1_TOP_HEATER_INDEX].seconds_on_time++;
+      numHeatersOn++;
+   }
+
+   if ((numHeatersOn < maxHeatersOn) && heaterInfo[SLOT5_TOP_HEATER_INDEX].is_enabled && (heaterInfo[SLOT5_TOP_HEATER_INDEX].current_temperature_tenths < DEGREES_TO_TEMP_TENTHS(heaterInfo[SLOT5_TOP_HEATER_INDEX].temperature_setpoint)))
+   {
+      (void)turnHeaterOnOff(SLOT5_TOP_HEATER_INDEX, HEATER_STATE_ON);
+      heaterInfo[SLOT5_TOP_HEATER_INDEX].was_on = heaterInfo[SLOT5_TOP_HEATER_INDEX].is_on;
+      heaterInfo[SLOT5_TOP_HEATER_INDEX].is_on = true;
+      heaterInfo[SLOT5_TOP_HEATER_INDEX].seconds_on_time++;
+      numHeatersOn++;
+   }
+
+   if ((numHeatersOn < maxHeatersOn) && heaterInfo[SLOT2_TOP_HEATER_INDEX].is_enabled && (heaterInfo[SLOT2_TOP_HEATER_INDEX].current_temperature_tenths < DEGREES_TO_TEMP_TENTHS(heaterInfo[SLOT2_TOP_HEATER_INDEX].temperature_setpoint)))
+   {
+      (void)turnHeaterOnOff(SLOT2_TOP_HEATER_INDEX, HEATER_STATE_ON);
+      heaterInfo[SLOT2_TOP_HEATER_INDEX].was_on = heaterInfo[SLOT2_TOP_HEATER_INDEX].is_on;
+      heaterInfo[SLOT2_TOP_HEATER_INDEX].is_on = true;
+      heaterInfo[SLOT2_TOP_HEATER_INDEX].seconds_on_time++;
+      numHeatersOn++;
+   }
+
+   if ((numHeatersOn < maxHeatersOn) && heaterInfo[SLOT3_TOP_HEATER_INDEX].is_enabled && (heaterInfo[SLOT3_TOP_HEATER_INDEX].current_temperature_tenths < DEGREES_TO_TEMP_TENTHS(heaterInfo[SLOT3_TOP_HEATER_INDEX].temperature_setpoint)))
+   {
+      (void)turnHeaterOnOff(SLOT3_TOP_HEATER_INDEX, HEATER_STATE_ON);
+      heaterInfo[SLOT3_TOP_HEATER_INDEX].was_on = heaterInfo[SLOT3_TOP_HEATER_INDEX].is_on;
+      heaterInfo[SLOT3_TOP_HEATER_INDEX].is_on = true;
+      heaterInfo[SLOT3_TOP_HEATER_INDEX].seconds_on_time++;
+      numHeatersOn++;
+   }
+
+   if ((numHeatersOn < maxHeatersOn) && heaterInfo[SLOT4_TOP_HEATER_INDEX].is_enabled && (heaterInfo[SLOT4_TOP_HEATER_INDEX].current_temperature_tenths < DEGREES_TO_TEMP_TENTHS(heaterInfo[SLOT4_TOP_HEATER_INDEX].temperature_setpoint)))
+   {
+      (void)turnHeaterOnOff(SLOT4_TOP_HEATER_INDEX, HEATER_STATE_ON);
+      heaterInfo[SLOT4_TOP_HEATER_INDEX].was_on = heaterInfo[SLOT4_TOP_HEATER_INDEX].is_on;
+      heaterInfo[SLOT4_TOP_HEATER_INDEX].is_on = true;
+      heaterInfo[SLOT4_TOP_HEATER_INDEX].seconds_on_time++;
+      numHeatersOn++;
+   }
+
+   int numberOfHeatersAtTemp = 0;
+   int numberOfHeatersEnabled = 0;
+   for (i = 0; i < NUM_HEATERS; i++)
+   {
+      if (heaterInfo[i].is_enabled)
+      {
+         numberOfHeatersEnabled++;
+      }
+      if (heaterInfo[i].is_enabled && ((HEATER_LOCATION_UPPER == heaterInfo[i].location) && (heaterInfo[i].current_temperature_tenths >= DEGREES_TO_TEMP_TENTHS(heaterInfo[i].temperature_setpoint - 10))))
+      {
+         numberOfHeatersAtTemp++;
+      }
+      if (heaterInfo[i].is_enabled && ((HEATER_LOCATION_LOWER == heaterInfo[i].location) && (heaterInfo[i].current_temperature_tenths >= DEGREES_TO_TEMP_TENTHS(heaterInfo[i].temperature_setpoint))))
+      {
+         numberOfHeatersAtTemp++;
+      }
+   }
+ printf("numberOfHeatersEnabled = %d, numberOfHeatersAtTemp = %d\n", numberOfHeatersEnabled, numberOfHeatersAtTemp);
+   if ((numberOfHeatersEnabled == numberOfHeatersAtTemp) || (startupTimeSeconds >= MAX_STARTUP_REACH_SETPOINT_TIME))
+   {
+printf("initialStartup is COMPLETE or startup time exceeded. Should resume regular heater algorithm\n");
+      initialStartup = false;
+   }
+}
+
+
+/*******************************************************************************************/
+/*                                                                                         */
+/* void heaterDataClose()                                                                  */
+/*                                                                                         */
+/* Closes the startup heater data file and renames it out of the way for the logger thread */
+/* to move into the log directory, so that the heater thread never waits on the log        */
+/* directory.                                                                              */
+/*                                                                                         */
+/* Returns: None                                                                           */
+/*                                                                                         */
+/*******************************************************************************************/
+void heaterDataClose()
+{
+   struct timespec start;
+   struct timespec end;
+   (void)clock_gettime(CLOCK_MONOTONIC, &start);
+
+   (void)fclose(csvFile);
+   csvFile = NULL;
+   if (0 == rename(HEATER_DATA_CSV_FILE, HEATER_DATA_CLOSED_FILE))
+   {
+      heaterDataLines = loggingLinesWritten;
+      heaterDataClosed = true;
+   }
+   else
+   {
+      syslog(LOG_WARNING, "Heater data %s could not be closed: %s", HEATER_DATA_CSV_FILE, strerror(errno));
+   }
+
+   (void)clock_gettime(CLOCK_MONOTONIC, &end);
+   heaterDataCloseMicroseconds = (uint32_t)timespecDiffMicroseconds(&end, &start);
+}
+
+
+/*******************************************************************************************/
+/*                                                                                         */
+/* int heaterDataCopy(const char *source, const char *destination)                         */
+/*                                                                                         */
+/* Copies a file to another file system and syncs it, for when the heater data cannot      */
+/* simply be renamed into the log directory.                                               */
+/*                                                                                         */
+/* Returns: int 0 = success, -errno = failure                                              */
+/*                                                                                         */
+/*******************************************************************************************/
+int heaterDataCopy(const char *source, const char *destination)
+{
+   static char buffer[HEATER_DATA_BUFFER_SIZE];
+   int in = open(source, O_RDONLY);
+   if (in < 0)
+   {
+      return -errno;
+   }
+
+   int status = 0;
+   int out = open(destination, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+   if (out < 0)
+   {
+      status = -errno;
+   }
+   else
+   {
+      ssize_t n = 0;
+      while ((0 == status) && ((n = read(in, buffer, sizeof(buffer))) > 0))
+      {
+         ssize_t written = write(out, buffer, n);
+         if (written != n)
+         {
+            status = (written < 0) ? -errno : -ENOSPC;
+         }
+      }
+      if ((0 == status) && (n < 0))
+      {
+         status = -errno;
+      }
+      if ((0 == status) && (0 != fdatasync(out)))
+      {
+         status = -errno;
+      }
+      if ((0 != close(out)) && (0 == status))
+      {
+         status = -errno;
+      }
+   }
+   (void)close(in);
+
+   return status;
+}
+
+
+/*******************************************************************************************/
+/*                                                                                         */
+/* void heaterDataRotate()                                                                 */
+/*                                                                                         */
+/* Called by the logger thread. Moves a closed startup heater data file into the log       */
+/* directory as the next heaterData<n>.csv, replacing the oldest once there are            */
+/* MAX_HEATER_DATA_FILES, and syncs the directory. Logs how long closing and rotating it   */
+/* took.                                                                                   */
+/*                                                                                         */
+/* Returns: None                                                                           */
+/*                                                                                         */
+/*******************************************************************************************/
+void heaterDataRotate()
+{
+   if (!heaterDataClosed.load())
+   {
+      return;
+   }
+
+   struct timespec start;
+   struct timespec end;
+   (void)clock_gettime(CLOCK_MONOTONIC, &start);
+
+   // errno of the call that failed, kept before any clean up can change it
+   int error = 0;
+   char targetFile[MAX_FILE_PATH];
+   int status = getNextFilename(targetFile, sizeof(targetFile));
+   if (0 != status)
+   {
+      error = ENAMETOOLONG;
+   }
+   else
+   {
+      // the reader never sees a partial file, the rename replaces the oldest in one step
+      status = rename(HEATER_DATA_CLOSED_FILE, targetFile);
+      error = (0 != status) ? errno : 0;
+      if (EXDEV == error)
+      {
+         status = heaterDataCopy(HEATER_DATA_CLOSED_FILE, HEATER_DATA_COPY_FILE);
+         error = -status;
+         if (0 == status)
+         {
+            status = rename(HEATER_DATA_COPY_FILE, targetFile);
+            error = (0 != status) ? errno : 0;
+         }
+         if (0 == status)
+         {
+            (void)unlink(HEATER_DATA_CLOSED_FILE);
+         }
+         else
+         {
+            (void)unlink(HEATER_DATA_COPY_FILE);
+         }
+      }
+   }
+
+   if (0 == status)
+   {
+      int dir = open(HENNYPENNY_LOG_DIRECTORY, O_RDONLY | O_DIRECTORY);
+      if (dir >= 0)
+      {
+         (void)fsync(dir);
+         (void)close(dir);
+      }
+
+      (void)clock_gettime(CLOCK_MONOTONIC, &end);
+      syslog(LOG_INFO, "Heater data %s: %u lines, close %u us, rotate %u us", targetFile, heaterDataLines,
+             heaterDataCloseMicroseconds, (uint32_t)timespecDiffMicroseconds(&end, &start));
+   }
+   else
+   {
+      syslog(LOG_WARNING, "Heater data %s could not be moved to %s: %s", HEATER_DATA_CLOSED_FILE, HENNYPENNY_LOG_DIRECTORY, strerror(error));
+   }
+
+   heaterDataClosed = false;
+}
+
+
+/*******************************************************************************************/
+/*                                                                                         */
+/* void runHeaterAlgorithm()                                                               */
+/*                                                                                         */
+/* Once per second, run the heater control algorithm. Figure out the eight heaters that    */
+/* are the farthest from their setpoints, and turn on their heaters. Ones that were on     */
+/* but won't be, turn them off before turning on any heaters. This eliminates the chance   */
+/* of having more than eight heaters on at any given time. Turn off a heater if it is      */
+/* above the setpoint.                                                                     */
+/*                                                                                         */
+/* Returns: None                                                                           */
+/*                                                                                         */
+/*******************************************************************************************/
+void runHeaterAlgorithm()
+{
+   // based on the data provided by HennyPenny, their custom Watlow
+   // heaters are rated for 400W at 240V, thus drawing a max of 1.66A
+   // With 1.2A consumed by the 12V power supply, we
+   // have 13.8A to work with to power the heaters and stay within
+   // the 15A from the wall outlet limit.
+   // At 1.66A each, we can safely run 8 heaters, since
+   // 8 * 1.66A = 13.28A
+   // 13.28A + 1.2A < 15A
+
+   // check if any heaters are at or above their setpoints
+   // by calculating their current delta_temp
+   // if the delta is <= 0, turn those heaters off
+   // if the delta is > 0 but <= 5, that heater may need to turned on.
+   // go through all of the heaters and find the top 8 deltas
+   // then turn their heaters on.
+   // but first, turn off any heaters that are transitioning to off so that
+   // we don't violate the power budget
+
+   // work from one consistent scan for this whole pass
+   SENSOR_SNAPSHOT snapshot;
+   getSensorSnapshot(&snapshot);
+   heaterScanTimeMonotonic = snapshot.scan_time_monotonic;
+   for (int i = 0; i < NUM_HEATERS; i++)
+   {
+      heaterInfo[i].current_temperature_tenths = snapshot.temperature_tenths[i];
+      heaterInfo[i].current_temperature = snapshot.temperature[i];
+   }
+
+   float volts = snapshot.voltage;
+
+   // default to 8 and 4 if we can't get the line voltage
+   int maxHeatersOn = 8;
+   int startingIndex = 4;
+
+   if (volts > 0.0)
+   {
+      if (volts <= 201.0)
+      {
+         maxHeatersOn = 10;
+         startingIndex = 2;
+      }
+      else if ((volts > 201.0) && (volts <= 221.0))
+      {
+         maxHeatersOn = 9;
+         startingIndex = 3;
+      }
+      else
+      {
+         maxHeatersOn = 8;
+         startingIndex = 4;
+      }
+   }
+
+   if (initialStartup)
+   {
+      regularHeaterAlgorithmOneShot = true;
+
+      if (!startupMessageReceived)
+      {
+         // do not start the fastest heating possible algorithm
+         // until the HMI sends the STARTUP command.
+         return;
+      }
+      // Turn on all 6 lower heaters and at least two uppers 100% duty cycle until startup is complete,
+      // then resume the normal algorithm
+      startupTimeSeconds++;
+#if (0)
+      for (int i = 0; i < NUM_HEATERS; i++)
+      {
+         if (!heaterInfo[i].is_enabled)
+         {
+            // if the user has turned off ANY heater
+            // abort the startup algorithm and let the regular algorithm take over.
+            initialStartup = false;
+            return;
+         }
+      }
+#endif
+      // run the heater startup algorithm
+      heatersAtStartup(maxHeatersOn);
+   }
+   else
+   {
+      if (regularHeaterAlgorithmOneShot)
+      {
+         printf("Resuming regular heater algorithm\n");
+         regularHeaterAlgorithmOneShot = false;
+      }
+      // normal operating mode heater algorithm
+      (void)memset(tempDeltas, 0, sizeof(tempDeltas));
+      for (int i = 0; i < NUM_HEATERS; i++)
+      {
+         if (!heaterInfo[i].is_enabled)
+         {
+            // if a heater is not enabled, make sure it's off
+            // and set the delta to MAX_NEGATIVE_DELTA_TEMP so that it's shuffled to the end of the line
+            // a negative delta temp means the temp is above the setpoint
+            heaterInfo[i].delta_temp = MAX_NEGATIVE_DELTA_TEMP * TEMP_TENTHS_PER_DEGREE;
+            tempDeltas[i] = heaterInfo[i].delta_temp;
+            heaterInfo[i].was_on = false;
+            heaterInfo[i].is_on = false;
+            (void)turnHeaterOnOff(i, HEATER_STATE_OFF);
+         }
+         else
+         {
+            // readADCThread is the single point of contact for reading the RTDs
+            // so it updates the current temperature in the heater info structure
+            // a negative delta temp means the temp is above the setpoint
+            // the delta is in tenths of a degree so heaters closer to setpoint rank below ones that are further away
+            heaterInfo[i].delta_temp = (heaterInfo[i].temperature_setpoint * TEMP_TENTHS_PER_DEGREE) - heaterInfo[i].current_temperature_tenths;
+            tempDeltas[i] = heaterInfo[i].delta_temp;
+            heaterInfo[i].was_on = heaterInfo[i].is_on;
+            heaterInfo[i].is_on = false;
+            if (startupComplete && !heaterInfo[i].setpoint_changed)
+            {
+               // only perform undertemp or overtemp limit checking once startup is complete
+               // otherwise, virtually all slots will generate an undertemp limit alarm
+               if (heaterInfo[i].current_temperature_tenths < DEGREES_TO_TEMP_TENTHS(heaterInfo[i].temperature_setpoint - UNDERTEMP_DELTA_LIMIT_DEGREES))
+               {
+                  heaterInfo[i].is_undertemp = true;
+               }
+               else
+               {
+                  heaterInfo[i].is_undertemp = false;
+               }
+
+               if (heaterInfo[i].current_temperature_tenths > DEGREES_TO_TEMP_TENTHS(heaterInfo[i].temperature_setpoint + OVERTEMP_DELTA_LIMIT_DEGREES))
+               {
+                  heaterInfo[i].is_overtemp = true;
+               }
+               else
+               {
+                  heaterInfo[i].is_overtemp = false;
+               }
+
+               int lowerHeaterThisShelf = 0;
+               int upperHeaterThisShelf = 0;
+               int shelfNumber = 0;
+
+               if (heaterInfo[i].is_undertemp && heaterInfo[i].is_enabled && !heaterInfo[i].setpoint_changed)
+               {
+                  heaterInfo[i].seconds_undertemp++;
+                  if ((heaterInfo[i].seconds_undertemp > UNDERTEMP_DELTA_LIMIT_SECONDS) && !heaterInfo[i].undertemp_oneshot)
+                  {
+                     if (debugHeatersPrintf)
+                     {
+                        (void)printf("Issue undertemp alarm for heater %d\n", i+1);
+                     }
+
+                     heaterInfo[i].undertemp_oneshot = true;
+                     heaterInfo[i].is_enabled = false;
+                     heaterInfo[i].is_undertemp_CSS = true;
+
+                     // according to FRON-246, if a heater is undertemp the SHELF is disabled, not just the single heater
+                     if (HEATER_LOCATION_LOWER == heaterInfo[i].location)
+                     {
+                        // this is a bottom/lower heater, also disable the corresponding top/upper heater
+                        upperHeaterThisShelf = i - 1;
+                        lowerHeaterThisShelf = i;
+                        heaterInfo[i-1].is_enabled = false;
+                     }
+                     else
                      {
-                        (void)printf("Issue undertemp alarm for heater %d\n", i+1);
+                        // this is an upper/top heater, also disable the corresponding bottom/lower heater
+                        lowerHeaterThisShelf = i + 1;
+                        upperHeaterThisShelf = i;
+                        heaterInfo[i+1].is_enabled = false;
+                     }
+
+                     (void)turnHeaterOnOff(lowerHeaterThisShelf, HEATER_STATE_OFF);
+                     (void)turnHeaterOnOff(upperHeaterThisShelf, HEATER_STATE_OFF);
+
+                     switch (i)
+                     {
+                        default:
+                        case SLOT1_TOP_HEATER_INDEX:     // NOSONAR
+                        case SLOT1_BOTTOM_HEATER_INDEX:  // NOSONAR
+                        // These cases are not redundant.
+                           shelfNumber = SLOT1;
+                           break;
+
+                        case SLOT2_TOP_HEATER_INDEX:
+                        case SLOT2_BOTTOM_HEATER_INDEX:
+                           shelfNumber = SLOT2;
+                           break;
+
+                        case SLOT3_TOP_HEATER_INDEX:
+                        case SLOT3_BOTTOM_HEATER_INDEX:
+                           shelfNumber = SLOT3;
+                           break;
+
+                        case SLOT4_TOP_HEATER_INDEX:
+                        case SLOT4_BOTTOM_HEATER_INDEX:
+                           shelfNumber = SLOT4;
+                           break;
+
+                        case SLOT5_TOP_HEATER_INDEX:
+                        case SLOT5_BOTTOM_HEATER_INDEX:
+                           shelfNumber = SLOT5;
+                           break;
+
+                        case SLOT6_TOP_HEATER_INDEX:
+                        case SLOT6_BOTTOM_HEATER_INDEX:
+                           shelfNumber = SLOT6;
+                           break;
+                     }
+
+                     char location_str[LOGERROR_LOCATION_SIZE];
+                     (void)snprintf(location_str, sizeof(location_str), "Shelf %d", shelfNumber);
+                     raiseAlarm(ALARM_CODE_SLOT_UNDER_TEMP, SHELF_UNDER_TEMP_ERROR_CODE, shelfNumber, location_str);
+                     syslog(LOG_ERR, "%s Undertemp alarm for shelf %d, upper heater %d and lower heater %d disabled and turned off", SHELF_UNDER_TEMP_ERROR_CODE, shelfNumber, upperHeaterThisShelf, lowerHeaterThisShelf);
+                     (void)strncpy(errorCodeString, SHELF_UNDER_TEMP_ERROR_CODE, sizeof(errorCodeString) - 1);
+                     systemStatus = SYSTEM_STATUS_ERROR;
+                     (void)logError(SHELF_UNDER_TEMP_ERROR_CODE, location_str, "Undertemp alarm");
+                  }
+               }
+               else
+               {
+                  heaterInfo[i].undertemp_oneshot = false;
+                  heaterInfo[i].seconds_undertemp = 0;
+               }
+
+               if (heaterInfo[i].is_overtemp && heaterInfo[i].is_enabled && !inCleaningMode && !heaterInfo[i].setpoint_changed)
+               {
+                  heaterInfo[i].seconds_overtemp++;
+                  if ((heaterInfo[i].seconds_overtemp > OVERTEMP_DELTA_LIMIT_SECONDS) && !heaterInfo[i].overtemp_oneshot)
+                  {
+                     if (debugHeatersPrintf)
+                     {
+                        (void)printf("Issue overtemp alarm for heater %d\n", i);
+                     }
+
+                     heaterInfo[i].overtemp_oneshot = true;
+                     heaterInfo[i].is_overtemp_CSS = true;
+                     heaterInfo[i].is_enabled = false;
+
+                     // according to FRON-246, if a heater is overtemp the SHELF is disabled, not just the single heater
+                     if (HEATER_LOCATION_LOWER == heaterInfo[i].location)
+                     {
+                        // this is a bottom/lower heater, also disable the corresponding top/upper heater
+                        upperHeaterThisShelf = i - 1;
+                        lowerHeaterThisShelf = i;
+                        heaterInfo[i-1].is_enabled = false;
+                     }
+                     else
+                     {
+                        // this is an upper/top heater, also disable the corresponding bottom/lower heater
+                        lowerHeaterThisShelf = i + 1;
+                        upperHeaterThisShelf = i;
+                        heaterInfo[i+1].is_enabled = false;
+                     }
+
+                     (void)turnHeaterOnOff(lowerHeaterThisShelf, HEATER_STATE_OFF);
+                     (void)turnHeaterOnOff(upperHeaterThisShelf, HEATER_STATE_OFF);
+
+                     int shelfNumber = 0;
+                     switch (i)
+                     {
+                        default:
+                        case SLOT1_TOP_HEATER_INDEX:     // NOSONAR
+                        case SLOT1_BOTTOM_HEATER_INDEX:  // NOSONAR
+                        // These cases are not redundant.
+                           shelfNumber = SLOT1;
+                           break;
+
+                        case SLOT2_TOP_HEATER_INDEX:
+                        case SLOT2_BOTTOM_HEATER_INDEX:
+                           shelfNumber = SLOT2;
+                           break;
+
+                        case SLOT3_TOP_HEATER_INDEX:
+                        case SLOT3_BOTTOM_HEATER_INDEX:
+                           shelfNumber = SLOT3;
+                           break;
+
+                        case SLOT4_TOP_HEATER_INDEX:
+                        case SLOT4_BOTTOM_HEATER_INDEX:
+                           shelfNumber = SLOT4;
+                           break;
+
+                        case SLOT5_TOP_HEATER_INDEX:
+                        case SLOT5_BOTTOM_HEATER_INDEX:
+                           shelfNumber = SLOT5;
+                           break;
+
+                        case SLOT6_TOP_HEATER_INDEX:
+                        case SLOT6_BOTTOM_HEATER_INDEX:
+                           shelfNumber = SLOT6;
+                           break;
                      }
 
-                     heaterInfo[i].undertemp_oneshot = true;
-                     heaterInfo[i].is_enabled = false;
-                     heaterInfo[i].is_undertemp_CSS = true;
+                     char location_str[LOGERROR_LOCATION_SIZE];
+                     (void)snprintf(location_str, sizeof(location_str), "Shelf %d", shelfNumber);
+                     raiseAlarm(ALARM_CODE_SLOT_OVER_TEMP, SHELF_OVER_TEMP_ERROR_CODE, shelfNumber, location_str);
+                     syslog(LOG_ERR, "%s Overtemp alarm for shelf %d, upper heater %d and lower heater %d disabled and turned off", SHELF_OVER_TEMP_ERROR_CODE, shelfNumber, upperHeaterThisShelf, lowerHeaterThisShelf);
+                     (void)strncpy(errorCodeString, SHELF_OVER_TEMP_ERROR_CODE, sizeof(errorCodeString) - 1);
+                     systemStatus = SYSTEM_STATUS_ERROR;
+                     (void)logError(SHELF_OVER_TEMP_ERROR_CODE, location_str, "Overtemp alarm");
+                  }
+               }
+               else
+               {
+                  heaterInfo[i].overtemp_oneshot = false;
+                  heaterInfo[i].seconds_overtemp = 0;
+               }
+            }
+         }
+      }
+
+      selectionSort(tempDeltas, NUM_HEATERS);
+      int totalHeatersOn = 0;
+      bool found = false;
+
+      // the array is assorted in ascending order, so the last maxHeatersOn are the deltas we care about
+      for (int j = startingIndex; j < NUM_HEATERS; j++)
+      {
+         // for the maxHeatersOn highest deltas, find the corresponding heater
+         found = false;
+         for (int i = 0; (i < NUM_HEATERS) && !found && (totalHeatersOn < maxHeatersOn); i++)
+         {
+            // hysteresis in tenths: a heater that was on keeps heating up to setpoint, one that
+            // was off waits until it is HEATER_HYSTERESIS_TENTHS below it, so a heater sitting
+            // at setpoint doesn't toggle its relay on every pass
+            int onThresholdTenths = heaterInfo[i].was_on ? 0 : HEATER_HYSTERESIS_TENTHS;
+            if ((tempDeltas[j] == heaterInfo[i].delta_temp) && (tempDeltas[j] > onThresholdTenths))
+            {
+               // mark the heater state on
+               heaterInfo[i].is_on = true;
+               // zero the delta to handle multiple deltas of the same value
+               heaterInfo[i].delta_temp = 0;
+               totalHeatersOn++;
+               found = true;
+            }
+         }
+      }
+
+      // first, turn off any heaters that were on but won't be this time interval
+      // so that we don't violate the power budget
+      // that way, if we turn on heaters early in the list but later ones in the list are still on
+      // we turn them off first
+      // at this point, is_on is the next state
+      for (int i = 0; i < NUM_HEATERS; i++)
+      {
+         if (heaterInfo[i].was_on && !heaterInfo[i].is_on)
+         {
+            (void)turnHeaterOnOff(i, HEATER_STATE_OFF);
+         }
+      }
+
+      // now, actually change the heater state
+      int totalHeatersCurrentlyOn = 0;
+      for (int i = 0; i < NUM_HEATERS; i++)
+      {
+         if (heaterInfo[i].is_on)
+         {
+            (void)turnHeaterOnOff(i, HEATER_STATE_ON);
+            totalHeatersCurrentlyOn++;
+            heaterInfo[i].seconds_on_time++;
+         }
+         else
+         {
+            (void)turnHeaterOnOff(i, HEATER_STATE_OFF);
+         }
+      }
+
+      if (debugHeatersPrintf)
+      {
+         (void)printf("totalHeatersCurrentlyOn = %d\n", totalHeatersCurrentlyOn);
+      }
+
+      // once all the heaters are up to temperature
+      int totalHeatersInTempRange = 0;
+      int totalHeatersEnabled = 0;
+      for (int i = 0; i < NUM_HEATERS; i++)
+      {
+         if (heaterInfo[i].is_enabled)
+         {
+            totalHeatersEnabled++;
+         }
+         if (heaterInfo[i].is_enabled && ((HEATER_LOCATION_UPPER == heaterInfo[i].location) && (heaterInfo[i].current_temperature_tenths >= DEGREES_TO_TEMP_TENTHS(heaterInfo[i].temperature_setpoint - 10))))
+         {
+            totalHeatersInTempRange++;
+         }
+         if (heaterInfo[i].is_enabled && ((HEATER_LOCATION_LOWER == heaterInfo[i].location) && (heaterInfo[i].current_temperature_tenths >= DEGREES_TO_TEMP_TENTHS(heaterInfo[i].temperature_setpoint))))
+         {
+            totalHeatersInTempRange++;
+         }
+      }
+
+      for (int i = 0; i < NUM_HEATERS; i++)
+      {
+         // if we're now within the legal +/- 5F range
+         // clear the setpoint_changed flag
+         // this was done to avoid over or under temp errors when a large change in the setpoint
+         // has occurred, since we have no way to force a slot to cool down any faster
+         // than turning the heaters off.
+         if ((heaterInfo[i].current_temperature_tenths >= DEGREES_TO_TEMP_TENTHS(heaterInfo[i].temperature_setpoint - SETPOINT_RANGE_PLUS_MINUS))
+         && (heaterInfo[i].current_temperature_tenths <= DEGREES_TO_TEMP_TENTHS(heaterInfo[i].temperature_setpoint + SETPOINT_RANGE_PLUS_MINUS)))
+         {
+            heaterInfo[i].setpoint_changed = false;
+         }
+      }
+
+      if (totalHeatersEnabled && (totalHeatersEnabled == totalHeatersInTempRange))
+      {
+         if (!startupComplete)
+         {
+            syslog(LOG_NOTICE, "Startup complete - all heaters are within range of setpoint, startup time = %d", startupTimeSeconds/60);
+            (void)logInternalEvent(STARTUP_COMPLETE_T);
+            if (debugHeatersPrintf)
+            {
+               (void)printf("Startup complete - all heaters are within range of setpoint, startup time = %d\n", startupTimeSeconds/60);
+            }
+         }
+
+         if (debugHeatersPrintf)
+         {
+            (void)printf("ALL HEATERS ARE AT TEMPERATURE!\n");
+         }
+
+         startupComplete = true;
+         initialStartup = false;
+         systemStatus = SYSTEM_STATUS_STARTUP_COMPLETE;
+      }
+
+      if (startupComplete)
+      {
+         if (startupTimeSeconds >= MAX_STARTUP_REACH_SETPOINT_TIME)
+         {
+            if (maxStartupTimeExceededOneShot)
+            {
+               // log the error
+               syslog(LOG_ERR, "%s Startup not completed in 25 minutes +/- 5 minutes = %d", STARTUP_TIME_EXCEEDED_ERROR_CODE, startupTimeSeconds/60);
+               (void)strncpy(errorCodeString, STARTUP_TIME_EXCEEDED_ERROR_CODE, sizeof(errorCodeString) - 1);
+               systemStatus = SYSTEM_STATUS_ERROR;
+               char descr_str[LOGERROR_DESCR_SIZE];
+               (void)snprintf(descr_str, sizeof(descr_str), "Startup not completed on time, currently %d minutes", startupTimeSeconds / 60);
+               (void)logError(STARTUP_TIME_EXCEEDED_ERROR_CODE, "System", descr_str);
+               maxStartupTimeExceededOneShot = false;
+            }
+         }
+         startupTimeSeconds = 0;
+      }
+      else
+      {
+         startupTimeSeconds++;
+         if (startupTimeSeconds >= MAX_STARTUP_REACH_SETPOINT_TIME)
+         {
+            if (maxStartupTimeExceededOneShot)
+            {
+               // log the error
+               syslog(LOG_ERR, "%s Startup not completed in 25 minutes +/- 5 minutes = %d", STARTUP_TIME_EXCEEDED_ERROR_CODE, startupTimeSeconds/60);
+               (void)strncpy(errorCodeString, STARTUP_TIME_EXCEEDED_ERROR_CODE, sizeof(errorCodeString) - 1);
+               systemStatus = SYSTEM_STATUS_ERROR;
+               char descr_str[LOGERROR_DESCR_SIZE];
+               (void)snprintf(descr_str, sizeof(descr_str), "Startup not completed on time, currently %d minutes", startupTimeSeconds / 60);
+               (void)logError(STARTUP_TIME_EXCEEDED_ERROR_CODE, "System", descr_str);
+               maxStartupTimeExceededOneShot = false;
+            }
+         }
+      }
+   }
+   // check if the console write to CSV file is enabled, we're in startup, and we haven't timed out
+   if ((access(HEATER_DATA_TRIGGER_FILE, F_OK) == 0) && !startupComplete && (startupTimeSeconds <= MAX_STARTUP_REACH_SETPOINT_TIME))
+   {
+      if (debugCSV)
+      {
+         (void)printf("logging trigger file exists startup NOT complete\n");
+      }
+
+      if (startupMessageReceived)
+      {
+         if (debugCSV)
+         {
+            (void)printf("logging startupMessageReceived\n");
+         }
+
+         debugHeatersWriteCSVFile = true;
+
+         if (csvFile == NULL)
+         {
+            csvFile = fopen(HEATER_DATA_CSV_FILE, "w");
+            (void)printf("csvFile = %p\n", csvFile);
+         }
+
+         if ((csvFile != NULL) && (0 == ftell(csvFile)))
+         {
+            // buffered, it's written out every minute or so rather than every second
+            (void)setvbuf(csvFile, heaterDataBuffer, _IOFBF, sizeof(heaterDataBuffer));
+            (void)fprintf(csvFile, "SECONDS, HEATER1, HEATER1ON, HEATER2, HEATER2ON, HEATER3, HEATER3ON, HEATER4, HEATER4ON, HEATER5, HEATER5ON, HEATER6, HEATER6ON, HEATER7, HEATER7ON, HEATER8, HEATER8ON, HEATER9, HEATER9ON, HEATER10, HEATER10ON, HEATER11, HEATER11ON, HEATER12, HEATER12ON, HEATSINK, AMBIENT, CURRENTDRAW, VOLTAGE\n");
+            if (debugCSV)
+            {
+               (void)printf("logging created /tmp/heaterData.csv and wrote the header\n");
+            }
+            (void)gettimeofday(&csvStartTime, NULL);
+            loggingLinesWritten = 0;
+         }
+
+         if (csvFile != NULL)
+         {
+            loggingLinesWritten++;
+            if (debugCSV)
+            {
+               (void)printf("logging writing line %u of heater data\n", loggingLinesWritten);
+            }
+
+            struct timeval now;
+            (void)gettimeofday(&now, NULL);
+            (void)fprintf(csvFile, "%d, %0.1f, %d, %0.1f, %d, %0.1f, %d, %0.1f, %d, %0.1f, %d, %0.1f, %d, %0.1f, %d, %0.1f, %d, %0.1f, %d, %0.1f, %d, %0.1f, %d, %0.1f, %d, %0.1f, %0.1f, %0.2f, %0.2f\n", loggingLinesWritten,
+                  TEMP_TENTHS_TO_DEGREES(heaterInfo[0].current_temperature_tenths),  heaterInfo[0].is_on,
+                  TEMP_TENTHS_TO_DEGREES(heaterInfo[1].current_temperature_tenths),  heaterInfo[1].is_on,
+                  TEMP_TENTHS_TO_DEGREES(heaterInfo[2].current_temperature_tenths),  heaterInfo[2].is_on,
+                  TEMP_TENTHS_TO_DEGREES(heaterInfo[3].current_temperature_tenths),  heaterInfo[3].is_on,
+                  TEMP_TENTHS_TO_DEGREES(heaterInfo[4].current_temperature_tenths),  heaterInfo[4].is_on,
+                  TEMP_TENTHS_TO_DEGREES(heaterInfo[5].current_temperature_tenths),  heaterInfo[5].is_on,
+                  TEMP_TENTHS_TO_DEGREES(heaterInfo[6].current_temperature_tenths),  heaterInfo[6].is_on,
+                  TEMP_TENTHS_TO_DEGREES(heaterInfo[7].current_temperature_tenths),  heaterInfo[7].is_on,
+                  TEMP_TENTHS_TO_DEGREES(heaterInfo[8].current_temperature_tenths),  heaterInfo[8].is_on,
+                  TEMP_TENTHS_TO_DEGREES(heaterInfo[9].current_temperature_tenths),  heaterInfo[9].is_on,
+                  TEMP_TENTHS_TO_DEGREES(heaterInfo[10].current_temperature_tenths), heaterInfo[10].is_on,
+                  TEMP_TENTHS_TO_DEGREES(heaterInfo[11].current_temperature_tenths), heaterInfo[11].is_on,
+                  TEMP_TENTHS_TO_DEGREES(snapshot.temperature_tenths[HEATSINK_RTD_INDEX]),
+                  TEMP_TENTHS_TO_DEGREES(snapshot.temperature_tenths[AMBIENT_TEMP_RTD_INDEX]),
+                  snapshot.irms, snapshot.voltage);
+         }
+      }
+   }
+   else
+   {
+      if (!startupComplete && debugCSV)
+      {
+         (void)printf("logging trigger file removed\n");
+      }
+
+      debugHeatersWriteCSVFile = false;
+      if (csvFile != NULL)
+      {
+         // the logger thread moves it into the log directory, see heaterDataRotate
+         heaterDataClose();
+         if (debugCSV)
+         {
+            (void)printf("logging closed %s in %u us\n", HEATER_DATA_CSV_FILE, heaterDataCloseMicroseconds);
+         }
+
+         startupMessageReceived = false;
+      }
+      if (startupTimeSeconds >= MAX_STARTUP_REACH_SETPOINT_TIME)
+      {
+         if (maxStartupTimeExceededOneShot)
+         {
+            // log the error
+            syslog(LOG_ERR, "%s Startup not completed in 25 minutes +/- 5 minutes = %d", STARTUP_TIME_EXCEEDED_ERROR_CODE, startupTimeSeconds/60);
+            (void)strncpy(errorCodeString, STARTUP_TIME_EXCEEDED_ERROR_CODE, sizeof(errorCodeString) - 1);
+            systemStatus = SYSTEM_STATUS_ERROR;
+            char descr_str[LOGERROR_DESCR_SIZE];
+            (void)snprintf(descr_str, sizeof(descr_str), "Startup not completed on time, currently %d minutes", startupTimeSeconds / 60);
+            (void)logError(STARTUP_TIME_EXCEEDED_ERROR_CODE, "System", descr_str);
+            maxStartupTimeExceededOneShot = false;
+         }
+      }
+   }
+}
+
+
+/*******************************************************************************************/
+/*                                                                                         */
+/* void printHeaters()                                                                     */
+/*                                                                                         */
+/* Returns: None                                                                           */
+/*                                                                                         */
+/*******************************************************************************************/
+void printHeaters()
+{
+   for (int i = 0; i < NUM_HEATERS; i++)
+   {
+      (void)printf("Heater[%d] isEnabled:%d isOn:%d short:%d open:%d over:%d under:%d sp:%d cur:%d delta:%d\n",
+            i,
+            heaterInfo[i].is_enabled,
+            heaterInfo[i].is_on,
+            rtdMappings[i].is_shorted,
+            rtdMappings[i].is_open,
+            heaterInfo[i].is_overtemp,
+            heaterInfo[i].is_undertemp,
+            heaterInfo[i].temperature_setpoint,
+            heaterInfo[i].current_temperature,
+            heaterInfo[i].delta_temp);
+   }
+
+   (void)printf("\n\n");
+}
+
+
+/*******************************************************************************************/
+/*                                                                                         */
+/* void logHourlyStats()                                                                   */
+/*                                                                                         */
+/* Once per hour, write the current statistics to the syslog file, then clear them.        */
+/*                                                                                         */
+/* Returns: None                                                                           */
+/*                                                                                         */
+/*******************************************************************************************/
+void logHourlyStats()
+{
+   syslog(LOG_INFO, "     LOCATION                VOLTAGE   ADC COUNTS  TEMPERATURE  ON TIME  ENABLED  SHORTED/OPEN");
+   syslog(LOG_INFO, "===============================================================================================");
+
+   SENSOR_SNAPSHOT snapshot;
+   getSensorSnapshot(&snapshot);
+
+   for (int i = 0; i < NUM_HEATERS; i++)
+   {
+      int current_temperature = snapshot.temperature[i];
+      char str[16];
+      (void)memset(str, 0, sizeof(str));
+
+      // if the counts are above 340 degree counts, call that open
+      if (snapshot.raw_counts[i] < 0)
+      {
+         (void)strncpy(str, "Read failed", sizeof(str));
+      }
+      else if (snapshot.raw_counts[i] > rtdMappings[i].temp_lookup_table[NUM_TEMP_LOOKUP_ENTRIES-10].adc_raw_counts)
+      {
+         (void)strncpy(str, "Open", sizeof(str));
+      }
+      else if (snapshot.raw_counts[i] < rtdMappings[i].temp_lookup_table[0].adc_raw_counts)
+      {
+         (void)strncpy(str, "Shorted", sizeof(str));
+      }
+
+      char thisLine[1024];
+      (void)memset(thisLine, 0, sizeof(thisLine));
+      (void)snprintf(thisLine, sizeof(thisLine), "%s     %0.5fV     %4d       %5d F       %4d      %1d       %s", labels[i], ((float)(snapshot.raw_counts[i]) * 1.8) / 4096.0,  snapshot.raw_counts[i], current_temperature, heaterInfo[i].seconds_on_time, heaterInfo[i].is_enabled, str);
+      syslog(LOG_INFO, thisLine);
+   }
+
+   logPeriodicTaskStats(&readADCTask);
+   logPeriodicTaskStats(&heaterControlTask);
+   logPeriodicTaskStats(&statusPublisherTask);
+   logPeriodicTaskStats(&rtdPublisherTask);
+   logPeriodicTaskStats(&mainLoopTask);
+   logThreadsAndMemory();
+   logCSSStreamStats();
+   logGUISessionStats();
+   syslog(LOG_INFO, "Alarms published %u dropped %u send failed %u, detection to send latency %u us (max %u us)",
+          alarmsPublished, alarm_queue.dropped(), alarmsSendFailed, alarmLatencyMicroseconds, alarmLatencyMaxMicroseconds);
+   syslog(LOG_INFO, "RTDStream batches published %u dropped %u, queue high water %u",
+          rtdStreamBatchesPublished, rtd_stream_queue.dropped(), rtd_stream_queue.high_water_mark());
+   syslog(LOG_INFO, "Subprocesses run %u, failed %u, timed out %u, dropped %u, longest %u ms (%s)",
+          subprocessesRun, subprocessesFailed, subprocessesTimedOut, subprocessesDropped, subprocessMaxMilliseconds, subprocessMaxName);
+#ifdef COUNT_HEAP_ALLOCATIONS
+   const char *heapAllocationsCounted = "operator new calls and arena blocks";
+#else
+   const char *heapAllocationsCounted = "arena blocks";
+#endif
+   syslog(LOG_INFO, "CurrentSystemState builds that allocated from the heap %u, last build %u protobuf/arena allocations (%s, not zmq_send), arena %u bytes",
+          cssHeapAllocatingPublishes, cssHeapAllocations, heapAllocationsCounted, (uint32_t)((NULL != cssArena) ? cssArena->SpaceAllocated() : 0));
+   syslog(LOG_INFO, "ZMQ frames over %d bytes %u, dropped over %d bytes %u",
+          DEFAULT_MESSAGE_BUFFER_SIZE, zmqLargeFrames.load(), ZMQ_MAX_MESSAGE_SIZE, zmqOversizeFrames.load());
+   syslog(LOG_INFO, "Log queue high water mark %u of %d, events dropped %u",
+          log_queue.high_water_mark(), log_queue.size(), log_queue.dropped());
+   syslog(LOG_INFO, "Log file bytes today %u, opens %u, flushes %u, flush latency %u us (max %u us)",
+          logFileBytesToday.load(), logFileOpens.load(), logFileFlushes.load(),
+          logFlushLatencyMicroseconds.load(), logFlushLatencyMaxMicroseconds.load());
+   syslog(LOG_INFO, "Recent errors log writes %u, latency %u us (max %u us)",
+          recentErrorsWrites.load(), recentErrorsLatencyMicroseconds.load(), recentErrorsLatencyMaxMicroseconds.load());
+   syslog(LOG_INFO, "Flight recorder frames %u, dumps %u (%u today), skipped %u",
+          flightRecorder.frames(), flightRecorderDumps, flightRecorderDumpsToday, flightRecorderDumpsSkipped);
+
+   // now, clear the stats
+   for (int i = 0; i < NUM_HEATERS; i++)
+   {
+      heaterInfo[i].seconds_on_time = 0;
+   }
+}
+
+
+/*******************************************************************************************/
+/*                                                                                         */
+/* int initHistory()                                                                       */
+/*                                                                                         */
+/* Empties the history store and reports its fixed size to the syslog.                     */
+/*                                                                                         */
+/* Returns: int 0                                                                          */
+/*                                                                                         */
+/*******************************************************************************************/
+int initHistory()
+{
+   (void)pthread_mutex_lock(&historyMutex);
+   (void)memset(&historySecondsRing, 0, sizeof(historySecondsRing));
+   (void)memset(&historyMinutesRing, 0, sizeof(historyMinutesRing));
+   (void)memset(&historyHoursRing, 0, sizeof(historyHoursRing));
+   (void)memset(&historyMinute, 0, sizeof(historyMinute));
+   (void)memset(&historyHour, 0, sizeof(historyHour));
+   historyLastSampleSeconds = 0;
+   (void)pthread_mutex_unlock(&historyMutex);
+
+   syslog(LOG_INFO, "History store: %u bytes, %d seconds, %d minutes, %d hours",
+          (unsigned)(sizeof(historySeconds) + sizeof(historyMinutes) + sizeof(historyHours)),
+          HISTORY_SECONDS, HISTORY_MINUTES, HISTORY_HOURS);
+
+   return 0;
+}
+
+
+/*******************************************************************************************/
+/*                                                                                         */
+/* void historyAccumulatorStart(HISTORY_ACCUMULATOR *accumulator,                          */
+/*                              const HISTORY_SAMPLE *sample, uint32_t nowSeconds)         */
+/*                                                                                         */
+/* Starts a new minute or hour with the sample as its first second.                        */
+/*                                                                                         */
+/* Returns: None                                                                           */
+/*                                                                                         */
+/*******************************************************************************************/
+void historyAccumulatorStart(HISTORY_ACCUMULATOR *accumulator, const HISTORY_SAMPLE *sample, uint32_t nowSeconds)
+{
+   (void)memset(accumulator, 0, sizeof(*accumulator));
+   accumulator->start_seconds = nowSeconds;
+   accumulator->aggregate.utc_seconds = sample->utc_seconds;
+   accumulator->aggregate.irms_min_centiamps = UINT16_MAX;
+   accumulator->aggregate.voltage_min_tenths = UINT16_MAX;
+   for (int i = 0; i < NUM_RTDs; i++)
+   {
+      accumulator->aggregate.temperature_min_tenths[i] = INT16_MAX;
+      accumulator->aggregate.temperature_max_tenths[i] = INT16_MIN;
+   }
+}
+
+
+/*******************************************************************************************/
+/*                                                                                         */
+/* void historyAccumulatorAdd(HISTORY_ACCUMULATOR *accumulator,                            */
+/*                            const HISTORY_SAMPLE *sample)                                */
+/*                                                                                         */
+/* Adds one second to the minute or hour being built. Open or shorted RTD readings are     */
+/* left out of the temperature minimum, mean and maximum.                                  */
+/*                                                                                         */
+/* Returns: None                                                                           */
+/*                                                                                         */
+/*******************************************************************************************/
+void historyAccumulatorAdd(HISTORY_ACCUMULATOR *accumulator, const HISTORY_SAMPLE *sample)
+{
+   HISTORY_AGGREGATE *aggregate = &accumulator->aggregate;
+
+   aggregate->num_samples++;
+   for (int i = 0; i < NUM_HEATERS; i++)
+   {
+      if (0 != (sample->heaters_on & (1 << i)))
+      {
+         aggregate->heater_on_seconds[i]++;
+      }
+   }
+   for (int i = 0; i < NUM_RTDs; i++)
+   {
+      int16_t tenths = sample->temperature_tenths[i];
+      if (TEMP_OUT_OF_RANGE_TENTHS != tenths)
+      {
+         aggregate->temperature_min_tenths[i] = std::min(aggregate->temperature_min_tenths[i], tenths);
+         aggregate->temperature_max_tenths[i] = std::max(aggregate->temperature_max_tenths[i], tenths);
+         accumulator->temperature_sum[i] += tenths;
+         accumulator->temperature_count[i]++;
+      }
+   }
+   aggregate->irms_min_centiamps = std::min(aggregate->irms_min_centiamps, sample->irms_centiamps);
+   aggregate->irms_max_centiamps = std::max(aggregate->irms_max_centiamps, sample->irms_centiamps);
+   aggregate->voltage_min_tenths = std::min(aggregate->voltage_min_tenths, sample->voltage_tenths);
+   aggregate->voltage_max_tenths = std::max(aggregate->voltage_max_tenths, sample->voltage_tenths);
+   accumulator->irms_sum += sample->irms_centiamps;
+   accumulator->voltage_sum += sample->voltage_tenths;
+}
+
+
+/*******************************************************************************************/
+/*                                                                                         */
+/* void historyAccumulatorFinish(const HISTORY_ACCUMULATOR *accumulator,                   */
+/*                               HISTORY_AGGREGATE *aggregate)                             */
+/*                                                                                         */
+/* Copies out the minute or hour built so far with its means filled in. The accumulator is */
+/* left as it was, so this also gives the interval still being built.                      */
+/*                                                                                         */
+/* Returns: None                                                                           */
+/*                                                                                         */
+/*******************************************************************************************/
+void historyAccumulatorFinish(const HISTORY_ACCUMULATOR *accumulator, HISTORY_AGGREGATE *aggregate)
+{
+   *aggregate = accumulator->aggregate;
+   uint16_t count = aggregate->num_samples;
+
+   for (int i = 0; i < NUM_RTDs; i++)
+   {
+      if (0 == accumulator->temperature_count[i])
+      {
+         aggregate->temperature_min_tenths[i] = TEMP_OUT_OF_RANGE_TENTHS;
+         aggregate->temperature_mean_tenths[i] = TEMP_OUT_OF_RANGE_TENTHS;
+         aggregate->temperature_max_tenths[i] = TEMP_OUT_OF_RANGE_TENTHS;
+      }
+      else
+      {
+         aggregate->temperature_mean_tenths[i] = (int16_t)(accumulator->temperature_sum[i] / accumulator->temperature_count[i]);
+      }
+   }
+
+   if (0 == count)
+   {
+      aggregate->irms_min_centiamps = 0;
+      aggregate->voltage_min_tenths = 0;
+   }
+   else
+   {
+      aggregate->irms_mean_centiamps = (uint16_t)(accumulator->irms_sum / count);
+      aggregate->voltage_mean_tenths = (uint16_t)(accumulator->voltage_sum / count);
+   }
+}
+
+
+/*******************************************************************************************/
+/*                                                                                         */
+/* uint32_t historyRingPush(HISTORY_RING *ring, uint32_t size)                             */
+/*                                                                                         */
+/* Makes room for one more entry in a ring of the given size, dropping the oldest entry    */
+/* when the ring is full.                                                                  */
+/*                                                                                         */
+/* Returns: uint32_t index of the entry to fill in                                         */
+/*                                                                                         */
+/*******************************************************************************************/
+uint32_t historyRingPush(HISTORY_RING *ring, uint32_t size)
+{
+   uint32_t index = ring->next;
+
+   ring->next = (ring->next + 1) % size;
+   if (ring->count < size)
+   {
+      ring->count++;
+   }
+
+   return index;
+}
+
+
+/*******************************************************************************************/
+/*                                                                                         */
+/* void recordHistorySample()                                                              */
+/*                                                                                         */
+/* Called on every pass of the heater algorithm. Once a second, records the latest scan,   */
+/* which heaters are on and the power monitor readings in the history store, and closes    */
+/* the minute or hour being built when it is complete. The intervals are timed on          */
+/* CLOCK_MONOTONIC so that setting the clock does not stretch or shrink them.              */
+/*                                                                                         */
+/* Returns: None                                                                           */
+/*                                                                                         */
+/*******************************************************************************************/
+void recordHistorySample()
+{
+   uint32_t nowSeconds = monotonicSeconds();
+   if (nowSeconds == historyLastSampleSeconds)
+   {
+      return;
+   }
+   historyLastSampleSeconds = nowSeconds;
+
+   SENSOR_SNAPSHOT snapshot;
+   getSensorSnapshot(&snapshot);
+
+   HISTORY_SAMPLE sample;
+   struct timeval now;
+   (void)gettimeofday(&now, NULL);
+   sample.utc_seconds = (uint32_t)now.tv_sec;
+   for (int i = 0; i < NUM_RTDs; i++)
+   {
+      sample.temperature_tenths[i] = snapshot.temperature_tenths[i];
+   }
+   sample.heaters_on = 0;
+   for (int i = 0; i < NUM_HEATERS; i++)
+   {
+      if (heaterInfo[i].is_on)
+      {
+         sample.heaters_on |= (uint16_t)(1 << i);
+      }
+   }
+   float irms = std::min(std::max(snapshot.irms, 0.0f), 600.0f);        // 600A fits in centiamps
+   float voltage = std::min(std::max(snapshot.voltage, 0.0f), 6000.0f); // 6000V fits in tenths
+   sample.irms_centiamps = (uint16_t)((irms * 100.0f) + 0.5f);
+   sample.voltage_tenths = (uint16_t)((voltage * 10.0f) + 0.5f);
+
+   (void)pthread_mutex_lock(&historyMutex);
+
+   historySeconds[historyRingPush(&historySecondsRing, HISTORY_SECONDS)] = sample;
+
+   if ((0 != historyMinute.aggregate.num_samples) && ((nowSeconds - historyMinute.start_seconds) >= ONE_MINUTE_IN_SECONDS))
+   {
+      historyAccumulatorFinish(&historyMinute, &historyMinutes[historyRingPush(&historyMinutesRing, HISTORY_MINUTES)]);
+      historyMinute.aggregate.num_samples = 0;
+   }
+   if (0 == historyMinute.aggregate.num_samples)
+   {
+      historyAccumulatorStart(&historyMinute, &sample, nowSeconds);
+   }
+   historyAccumulatorAdd(&historyMinute, &sample);
+
+   if ((0 != historyHour.aggregate.num_samples) && ((nowSeconds - historyHour.start_seconds) >= ONE_HOUR_IN_SECONDS))
+   {
+      historyAccumulatorFinish(&historyHour, &historyHours[historyRingPush(&historyHoursRing, HISTORY_HOURS)]);
+      historyHour.aggregate.num_samples = 0;
+   }
+   if (0 == historyHour.aggregate.num_samples)
+   {
+      historyAccumulatorStart(&historyHour, &sample, nowSeconds);
+   }
+   historyAccumulatorAdd(&historyHour, &sample);
+
+   (void)pthread_mutex_unlock(&historyMutex);
+}
+
+
+/*******************************************************************************************/
+/*                                                                                         */
+/* void recordFlightFrame()                                                                */
+/*                                                                                         */
+/* Called after every pass of the heater algorithm. Records the latest RTD scan, the       */
+/* heater and fan states the pass left behind and the power monitor readings in the flight */
+/* recorder. Takes no locks and makes no system calls.                                     */
+/*                                                                                         */
+/* Returns: None                                                                           */
+/*                                                                                         */
+/*******************************************************************************************/
+void recordFlightFrame()
+{
+   SENSOR_SNAPSHOT snapshot;
+   getSensorSnapshot(&snapshot);
+
+   FLIGHT_FRAME frame;
+   (void)memset(&frame, 0, sizeof(frame));
+   frame.frame_number = flightRecorder.frames();
+   frame.scan_sequence = snapshot.sequence_number;
+   frame.utc_seconds = (uint32_t)snapshot.scan_time.tv_sec;
+   frame.utc_microseconds = (uint32_t)snapshot.scan_time.tv_usec;
+   frame.heater_latency_us = heaterLatencyMicroseconds;
+   frame.irms = snapshot.irms;
+   frame.voltage = snapshot.voltage;
+   for (int i = 0; i < NUM_RTDs; i++)
+   {
+      frame.raw_counts[i] = snapshot.raw_counts[i];
+      frame.temperature_tenths[i] = snapshot.temperature_tenths[i];
+      frame.rtd_open |= snapshot.is_open[i] ? (uint16_t)(1 << i) : 0;
+      frame.rtd_shorted |= snapshot.is_shorted[i] ? (uint16_t)(1 << i) : 0;
+   }
+   for (int i = 0; i < NUM_HEATERS; i++)
+   {
+      frame.setpoint[i] = heaterInfo[i].temperature_setpoint;
+      frame.heaters_on |= heaterInfo[i].is_on ? (uint16_t)(1 << i) : 0;
+      frame.heaters_enabled |= heaterInfo[i].is_enabled ? (uint16_t)(1 << i) : 0;
+      frame.heaters_eco |= heaterInfo[i].eco_mode_on ? (uint16_t)(1 << i) : 0;
+   }
+   frame.fans_on = ((FAN_STATE_ON == fanInfo[FAN1_INDEX].fan_on) ? 0x01 : 0) | ((FAN_STATE_ON == fanInfo[FAN2_INDEX].fan_on) ? 0x02 : 0);
+   frame.system_status = (uint8_t)systemStatus;
+   frame.power_monitor_bad = snapshot.power_monitor_bad ? 1 : 0;
+
+   flightRecorder.record(frame);
+}
+
+
+/*******************************************************************************************/
+/*                                                                                         */
+/* void *heaterControlThread(void *)                                                       */
+/*                                                                                         */
+/* Run the heater control algorithm once per second. Figure out which heaters are the      */
+/* furthest away from their setpoints, and turn on up to eight heaters to keep under       */
+/* the allowed power budget of 15A from the wall outlet.                                   */
+/*                                                                                         */
+/* Returns: pthread_exit(NULL)                                                             */
+/*                                                                                         */
+/*******************************************************************************************/
+void *heaterControlThread(void *)
+{
+   uint32_t startSeconds = monotonicSeconds();
+   uint32_t hoursLogged = 0;
+   uint32_t lastScanCount = 0;
+
+   initPeriodicTask(&heaterControlTask, "heaterControlThread", ONE_SECOND_IN_MICROSECONDS);
+   numThreadsRunning++;
+   while(!sigTermReceived)
+   {
+      if (scanTriggeredHeaters)
+      {
+         // act on each RTD scan as soon as readADCThread publishes it
+         if (!waitForSensorScan(&lastScanCount))
+         {
+            heaterScanTimeouts++;
+         }
+      }
+
+      (void)pthread_mutex_lock(&heaterAlgorithmMutex);
+      runHeaterAlgorithm();
+      (void)pthread_mutex_unlock(&heaterAlgorithmMutex);
+      recordHeaterLatency();
+      recordHistorySample();
+      recordFlightFrame();
+
+      // passes come with the scans rather than once a second, so go by the clock
+      uint32_t runningHours = (monotonicSeconds() - startSeconds) / ONE_HOUR_IN_SECONDS;
+      if (runningHours != hoursLogged)
+      {
+         // once per hour, write the statistics to the syslog
+         hoursLogged = runningHours;
+         logHourlyStats();
+      }
+
+      if (debugHeatersPrintf)
+      {
+         (void)printf("Heater latency %u microseconds (max %u)  scan timeouts %u\n", heaterLatencyMicroseconds, heaterLatencyMaxMicroseconds, heaterScanTimeouts);
+         printHeaters();
+      }
+
+      if (!scanTriggeredHeaters)
+      {
+         waitPeriodicTask(&heaterControlTask);
+      }
+   }
+
+   numThreadsRunning--;
+   pthread_exit(NULL);
+}
+
+// ****************** Firmware update *******************
+/*******************************************************************************************/
+/*                                                                                         */
+/* void escapeSpaces(char *inPath, char *outPath)                                          */
+/*                                                                                         */
+/* Surround the entire file path with quotes, and escape any embedded spaces with          */
+/* "\\\" or scp will fail                                                                  */
+/*                                                                                         */
+/* Returns: None                                                                           */
+/*                                                                                         */
+/*******************************************************************************************/
+void escapeSpaces(char *inPath, char *outPath)
+{
+  int i;
+  int length = strlen(inPath);
+  char *inPtr = inPath;
+  char *outPtr = outPath;
+
+  // surround the entire file path with quotes, and escape any embedded spaces with "\\\" or scp will fail
+  (void)strcpy(outPtr, "\"");
+  outPtr++;
+  for (i = 0; i < length; i++, inPtr++, outPtr++)
+  {
+    if (*inPtr == ' ')
+    {
+      (void)strcat(outPtr, "\\");
+      outPtr += 1;
+    }
+    *outPtr = *inPtr;
+  }
+  (void)strcat(outPtr, "\"");
+}
+
+
+/*******************************************************************************************/
+/*                                                                                         */
+/* int sshKeyscan()                                                                        */
+/*                                                                                         */
+/* Issue the SSH keyscan to validate the necessary information to prepare for the SCP.     */
+/*                                                                                         */
+/* Returns: int ret - 0=success, 1 = failure                                               */
+/*                                                                                         */
+/*******************************************************************************************/
+int sshKeyscan()
+{
+   int ret = 0;
+   char commandLine[COMMAND_LINE_BUFFER_SIZE];
+
+   (void)memset(commandLine, 0, sizeof(COMMAND_LINE_BUFFER_SIZE));
+   (void)snprintf(commandLine, sizeof(commandLine), "%s", RM_KNOWN_HOSTS);
+   (void)system(commandLine);
+   (void)snprintf(commandLine, sizeof(commandLine), SSH_KEYSCAN, guiSessions[0].ip_address);
+   ret = system(commandLine);
+   return ret;
+}
+
+
+/*******************************************************************************************/
+/*                                                                                         */
+/* int getUpdateFiles(char *username, char *password, char *path)                          */
+/*                                                                                         */
+/* SCP all of the update files from the specified remote location to /tmp                  */
+/*                                                                                         */
+/* Returns: int ret - 0=success, 1 = failure                                               */
+/*                                                                                         */
+/*******************************************************************************************/
+int getUpdateFiles(char *username, char *password, char *path)
+{
+   char commandLine[COMMAND_LINE_BUFFER_SIZE];
+   char debFiles[THIS_FILE_FILENAME_LENGTH];
+   char manifestFile[THIS_FILE_FILENAME_LENGTH];
+   int pathLength = strlen(path);
+
+   (void)memset(debFiles, 0, sizeof(debFiles));
+   (void)memset(manifestFile, 0, sizeof(manifestFile));
+   (void)memset(commandLine, 0, sizeof(commandLine));
+   (void)strncpy(debFiles, path, pathLength);
+   (void)strncat(debFiles, "/*.deb", sizeof(debFiles) - strlen("/*.deb") - 1);
+   (void)strncpy(manifestFile, path, pathLength);
+   (void)strncat(manifestFile, "/controller.manifest", sizeof(manifestFile)- strlen("/controller.manifest") - 1);
+
+   (void)snprintf(commandLine, sizeof(commandLine), SCP_UPDATE_FILES, password, username, guiSessions[0].ip_address, debFiles);
+   int ret = system(commandLine);
+   (void)snprintf(commandLine, sizeof(commandLine), SCP_UPDATE_FILES, password, username, guiSessions[0].ip_address, manifestFile);
+   ret |= system(commandLine);
+
+   return ret;
+}
+
+/*******************************************************************************************/
+/*                                                                                         */
+/* int checkManifest(char *manifestFilename)                                               */
+/*                                                                                         */
+/* Check the SHA256 values for each file specified in the manifest. If ANY of them         */
+/* don't match, return failure.                                                            */
+/*                                                                                         */
+/* Returns: int ret - 0 = success, 1 = failure                                             */
+/*                                                                                         */
+/*******************************************************************************************/
+int checkManifest(char *manifestFilename)
+{
+   FILE *fp = NULL;
+   FILE *shaFP = NULL;
+   int ret = 0;
+   int itemsRead = 0;
+   char shaFile[THIS_FILE_FILENAME_LENGTH];
+   char shaString[SHA_STRING_LENGTH];
+   char computedSHAString[SHA_STRING_LENGTH];
+   char thisFilename[THIS_FILE_FILENAME_LENGTH];
+   char firmwareVersionString[FIRMWARE_VERSION_STRING_LENGTH];
+   char commandLine[COMMAND_LINE_BUFFER_SIZE];
+
+   fp = fopen(manifestFilename, "r");
+   manifestFileLineCount = 0;
+
+   if (fp != NULL)
+   {
+      while (!feof(fp))
+      {
+         (void)memset(shaString, 0, SHA_STRING_LENGTH);
+         (void)memset(thisFilename, 0, THIS_FILE_FILENAME_LENGTH);
+         (void)memset(firmwareVersionString, 0, FIRMWARE_VERSION_STRING_LENGTH);
+         (void)memset(commandLine, 0, COMMAND_LINE_BUFFER_SIZE);
+         (void)memset(shaFile, 0, THIS_FILE_FILENAME_LENGTH);
+
+         itemsRead = fscanf(fp, "%s %s %s", thisFilename, firmwareVersionString, shaString);
+         if (MANIFEST_FILE_ITEMS_PER_LINE == itemsRead)
+         {
+            manifestFileLineCount++;
+            if (!strncmp(thisFilename, FRONTIER_UHC_PACKAGE_FILENAME_ROOT, strlen(FRONTIER_UHC_PACKAGE_FILENAME_ROOT)))
+            {
+               manifestFileContainsFrontierUHC = true;
+            }
+            //(void)printf("itemsRead = %d\n", itemsRead);
+            (void)printf("Filename = %s\n", thisFilename);
+            (void)printf("firmwareVersionString = %s\n", firmwareVersionString);
+            (void)printf("shaString = %s\n", shaString);
+            (void)unlink(SHA_OUTPUT_FILE);
+            (void)snprintf(commandLine, sizeof(commandLine), SHA256_COMMAND, thisFilename, SHA_OUTPUT_FILE);
+            (void)system(commandLine);
+            //system("cat sha.out");
+            shaFP = fopen(SHA_OUTPUT_FILE, "r");
+            if (shaFP != NULL)
+            {
+               itemsRead = fscanf(shaFP, "%s %s", computedSHAString, shaFile);
+               (void)fclose(shaFP);
+               if (!strcmp(computedSHAString, shaString))
+               {
+                  (void)printf("SHA is valid for %s\n", shaFile);
+               }
+               else
+               {
+                  (void)printf("SHA FAILED for %s\n", shaFile);
+                  ret = 1;
+                  break;
+               }
+            }
+         }
+         else if (manifestFileLineCount > 0)
+         {
+            ret = 0;
+            break;
+         }
+         else
+         {
+            ret = 1;
+            break;
+         }
+      }
+      (void)fclose(fp);
+   }
+   return ret;
+}
+
 
-                     // according to FRON-246, if a heater is undertemp the SHELF is disabled, not just the single heater
-                     if (HEATER_LOCATION_LOWER == heaterInfo[i].location)
-                     {
-                        // this is a bottom/lower heater, also disable the corresponding top/upper heater
-                        upperHeaterThisShelf = i - 1;
-                        lowerHeaterThisShelf = i;
-                        heaterInfo[i-1].is_enabled = false;
-                     }
-                     else
-                     {
-                        // this is an upper/top heater, also disable the corresponding bottom/lower heater
-                        lowerHeaterThisShelf = i + 1;
-                        upperHeaterThisShelf = i;
-                        heaterInfo[i+1].is_enabled = false;
-                     }
+/*******************************************************************************************/
+/*                                                                                         */
+/* int installPackages(char *manifestFilename)                                             */
+/*                                                                                         */
+/* Install all of the packages retrieved via SCP into /tmp.                                */
+/*                                                                                         */
+/* Returns: int ret - 0 = success, 1 = failure                                             */
+/*                                                                                         */
+/*******************************************************************************************/
+int installPackages(char *manifestFilename)
+{
+   FILE *fp = NULL;
+   int ret = 0;
+   int itemsRead = 0;
+   char shaString[SHA_STRING_LENGTH];
+   char thisFilename[THIS_FILE_FILENAME_LENGTH];
+   char firmwareVersionString[FIRMWARE_VERSION_STRING_LENGTH];
+   char commandLine[COMMAND_LINE_BUFFER_SIZE];
+   char installCommand[MAX_FILE_PATH];
+   char resultString[MAX_FILE_PATH];
+   uint32_t linesRead = 0;
 
-                     (void)turnHeaterOnOff(lowerHeaterThisShelf, HEATER_STATE_OFF);
-                     (void)turnHeaterOnOff(upperHeaterThisShelf, HEATER_STATE_OFF);
+   // initialize the result buffer
+   (void)memset(firmwareUpdateResultBuffer, 0, sizeof(firmwareUpdateResultBuffer));
+   (void)memset(frontierUHCPackageFilename, 0, sizeof(frontierUHCPackageFilename));
+   processFrontierInstaller = false;
 
-                     switch (i)
-                     {
-                        default:
-                        case SLOT1_TOP_HEATER_INDEX:     // NOSONAR
-                        case SLOT1_BOTTOM_HEATER_INDEX:  // NOSONAR
-                        // These cases are not redundant.
-                           shelfNumber = SLOT1;
-                           break;
+   // attempt to read the manifest file and process all of the packages listed in it
+   fp = fopen(manifestFilename, "r");
+   if (fp != NULL)
+   {
+      // process each file in listed in the manifest file
+      while (!feof(fp))
+      {
+         (void)memset(shaString, 0, SHA_STRING_LENGTH);
+         (void)memset(thisFilename, 0, THIS_FILE_FILENAME_LENGTH);
+         (void)memset(firmwareVersionString, 0, FIRMWARE_VERSION_STRING_LENGTH);
+         (void)memset(commandLine, 0, COMMAND_LINE_BUFFER_SIZE);
 
-                        case SLOT2_TOP_HEATER_INDEX:
-                        case SLOT2_BOTTOM_HEATER_INDEX:
-                           shelfNumber = SLOT2;
-                           break;
+         itemsRead = fscanf(fp, "%s %s %s", thisFilename, firmwareVersionString, shaString);
+         if (MANIFEST_FILE_ITEMS_PER_LINE == itemsRead)
+         {
+            linesRead++;
+            if (!strncmp(thisFilename, FRONTIER_UHC_PACKAGE_FILENAME_ROOT, strlen(FRONTIER_UHC_PACKAGE_FILENAME_ROOT)))
+            {
+               // if this is the frontier-uhc package, skip it to process ALL other packages first
+               strncpy(frontierUHCPackageFilename, thisFilename, sizeof(frontierUHCPackageFilename)- 1);
+               continue;
+            }
+            (void)memset(installCommand, 0, sizeof(installCommand));
+            (void)memset(resultString, 0, sizeof(resultString));
+            (void)snprintf(installCommand, sizeof(installCommand), DPKG_INSTALL_OVERWRITE_COMMAND, TEMP_DIRECTORY, thisFilename);
 
-                        case SLOT3_TOP_HEATER_INDEX:
-                        case SLOT3_BOTTOM_HEATER_INDEX:
-                           shelfNumber = SLOT3;
-                           break;
+            if (debugPrintf)
+            {
+               (void)printf("Attempting %s\n", installCommand);
+               syslog(LOG_NOTICE, "Attempting %s", installCommand);
+            }
 
-                        case SLOT4_TOP_HEATER_INDEX:
-                        case SLOT4_BOTTOM_HEATER_INDEX:
-                           shelfNumber = SLOT4;
-                           break;
+            // attempt to install this package
+            int result = system(installCommand);
+            // build the status for this file
+            if (result == 0)
+            {
+               (void)snprintf(resultString, sizeof(resultString), "%s %s\n", thisFilename, "Success");
+               syslog(LOG_NOTICE, "%s %s", thisFilename, "Success");
+            }
+            else
+            {
+               (void)snprintf(resultString, sizeof(resultString), "%s Failed %d\n", thisFilename, result >> 8);
+               syslog(LOG_ERR, "%s Failed %d", thisFilename, result >> 8);
+               (void)logError("", "System", resultString);
+            }
 
-                        case SLOT5_TOP_HEATER_INDEX:
-                        case SLOT5_BOTTOM_HEATER_INDEX:
-                           shelfNumber = SLOT5;
-                           break;
+            // once we've processed a file, remove it from /tmp
+            char removeFilename[MAX_FILE_PATH];
+            (void)memset(removeFilename, 0, sizeof(removeFilename));
+            (void)snprintf(removeFilename, sizeof(removeFilename), "%s/%s", TEMP_DIRECTORY, thisFilename);
+            (void)unlink(removeFilename);
 
-                        case SLOT6_TOP_HEATER_INDEX:
-                        case SLOT6_BOTTOM_HEATER_INDEX:
-                           shelfNumber = SLOT6;
-                           break;
-                     }
+            // append the status for this file to previous results
+            (void)strcat(firmwareUpdateResultBuffer, resultString);
+         }
+      }
+   }
+   else
+   {
+      (void)snprintf(firmwareUpdateResultBuffer, sizeof(firmwareUpdateResultBuffer), "Could not open manifest file %s %s\n", manifestFilename, "Failed");
+      syslog(LOG_NOTICE, "Could not open manifest file %s %s\n", manifestFilename, "Failed");
+      ret = 1;
+   }
 
-                     syslog(LOG_ERR, "%s Undertemp alarm for shelf %d, upper heater %d and lower heater %d disabled and turned off", SHELF_UNDER_TEMP_ERROR_CODE, shelfNumber, upperHeaterThisShelf, lowerHeaterThisShelf);
-                     (void)strncpy(errorCodeString, SHELF_UNDER_TEMP_ERROR_CODE, sizeof(errorCodeString) - 1);
-                     systemStatus = SYSTEM_STATUS_ERROR;
-                     char location_str[LOGERROR_LOCATION_SIZE];
-                     (void)snprintf(location_str, sizeof(location_str), "Shelf %d", shelfNumber);
-                     (void)logError(SHELF_UNDER_TEMP_ERROR_CODE, location_str, "Undertemp alarm");
-                  }
-               }
-               else
-               {
-                  heaterInfo[i].undertemp_oneshot = false;
-                  heaterInfo[i].seconds_undertemp = 0;
-               }
+   return ret;
+}
 
-               if (heaterInfo[i].is_overtemp && heaterInfo[i].is_enabled && !inCleaningMode && !heaterInfo[i].setpoint_changed)
-               {
-                  heaterInfo[i].seconds_overtemp++;
-                  if ((heaterInfo[i].seconds_overtemp > OVERTEMP_DELTA_LIMIT_SECONDS) && !heaterInfo[i].overtemp_oneshot)
-                  {
-                     if (debugHeatersPrintf)
-                     {
-                        (void)printf("Issue overtemp alarm for heater %d\n", i);
-                     }
 
-                     heaterInfo[i].overtemp_oneshot = true;
-                     heaterInfo[i].is_overtemp_CSS = true;
-                     heaterInfo[i].is_enabled = false;
+/*******************************************************************************************/
+/*                                                                                         */
+/* void *firmwareUpdatePackageThread(void *)                                               */
+/*                                                                                         */
+/* Handle the frontier-uhc firmware update package. Note that invoking dpkg to install     */
+/* frontier-uhc will cause this instance of the application to be killed off so that the   */
+/* installer can overwrite the executable.                                                 */
+/*                                                                                         */
+/* Returns: pthread_exit(NULL)                                                             */
+/*                                                                                         */
+/*******************************************************************************************/
+void *firmwareUpdatePackageThread(void *)
+{
+   char installCommand[COMMAND_LINE_BUFFER_SIZE];
 
-                     // according to FRON-246, if a heater is overtemp the SHELF is disabled, not just the single heater
-                     if (HEATER_LOCATION_LOWER == heaterInfo[i].location)
-                     {
-                        // this is a bottom/lower heater, also disable the corresponding top/upper heater
-                        upperHeaterThisShelf = i - 1;
-                        lowerHeaterThisShelf = i;
-                        heaterInfo[i-1].is_enabled = false;
-                     }
-                     else
-                     {
-                        // this is an upper/top heater, also disable the corresponding bottom/lower heater
-                        lowerHeaterThisShelf = i + 1;
-                        upperHeaterThisShelf = i;
-                        heaterInfo[i+1].is_enabled = false;
-                     }
+   numThreadsRunning++;
+   while (!sigTermReceived)
+   {
+      if (processFrontierInstaller)
+      {
+         (void)memset(installCommand, 0, sizeof(installCommand));
+         (void)snprintf(installCommand, strlen(DPKG_INSTALL_OVERWRITE_COMMAND) + strlen(TEMP_DIRECTORY) + strlen(frontierUHCPackageFilename) + 1, DPKG_INSTALL_OVERWRITE_COMMAND, TEMP_DIRECTORY, frontierUHCPackageFilename);
+
+         if (debugPrintf)
+         {
+            (void)printf("Attempting %s\n", installCommand);
+            syslog(LOG_NOTICE, "Attempting %s", installCommand);
+         }
+
+         // attempt to install this package
+         (void)system(installCommand);
+         (void)printf("firmwareUpdatePackageThread return from system command %s - Rebooting device\n", installCommand);
+         processFrontierInstaller = false;
+         sleep(1);
+         (void)system(REBOOT_COMMAND);
+      }
+      sleep(1);
+   }
+   numThreadsRunning--;
+   pthread_exit(NULL);
+}
+
+
+/*******************************************************************************************/
+/*                                                                                         */
+/* void *firmwareUpdateListenerThread(void *)                                              */
+/*                                                                                         */
+/* Listen for a FirmwareUpdate message. Fetch the update files via SCP int /tmp and        */
+/* install them. Build and send the FirmwareResponse message.                              */
+/*                                                                                         */
+/* Returns: pthread_exit(NULL)                                                             */
+/*                                                                                         */
+/*******************************************************************************************/
+void *firmwareUpdateListenerThread(void *)
+{
+   zmq_msg_t message;
+   char escapedFullFilePath[MAX_FILE_PATH];
+   (void)zmq_msg_init(&message);
+   firmwareUpdateResponsePublisher = zmq_socket(context, ZMQ_PUB);
+   assert(firmwareUpdateResponsePublisher != 0);
 
-                     (void)turnHeaterOnOff(lowerHeaterThisShelf, HEATER_STATE_OFF);
-                     (void)turnHeaterOnOff(upperHeaterThisShelf, HEATER_STATE_OFF);
+   char ig1CommandRespPubPort[IP_STRING_SIZE + 14];   // Allow space for the tcp:// and :portnumber
+   char ig1CommandReqSubPort[IP_STRING_SIZE + 14];    // Allow space for the tcp:// and :portnumber
+   (void)snprintf(ig1CommandRespPubPort, sizeof(ig1CommandRespPubPort), "tcp://%s:%d", controllerIPAddress, FIRMWARE_UPDATE_RESULT_PORT_CONTROLLER);
+   (void)snprintf(ig1CommandReqSubPort, sizeof(ig1CommandReqSubPort), "tcp://%s:%d", guiSessions[0].ip_address, FIRMWARE_UPDATE_PORT_GUI1);
+   (void)printf("firmwareUpdateListenerThread ig1CommandRespPubPort = %s\n", ig1CommandRespPubPort);
+   (void)printf("firmwareUpdateListenerThread ig1CommandReqSubPort = %s\n", ig1CommandReqSubPort);
 
-                     int shelfNumber = 0;
-                     switch (i)
-                     {
-                        default:
-                        case SLOT1_TOP_HEATER_INDEX:     // NOSONAR
-                        case SLOT1_BOTTOM_HEATER_INDEX:  // NOSONAR
-                        // These cases are not redundant.
-                           shelfNumber = SLOT1;
-                           break;
+    int rs = zmq_bind(firmwareUpdateResponsePublisher, ig1CommandRespPubPort);
+    assert(rs == 0);
 
-                        case SLOT2_TOP_HEATER_INDEX:
-                        case SLOT2_BOTTOM_HEATER_INDEX:
-                           shelfNumber = SLOT2;
-                           break;
+   firmwareUpdateListener = zmq_socket(context, ZMQ_SUB);
+   assert(firmwareUpdateListener != 0);
 
-                        case SLOT3_TOP_HEATER_INDEX:
-                        case SLOT3_BOTTOM_HEATER_INDEX:
-                           shelfNumber = SLOT3;
-                           break;
+   const char messageType[] = { 10, 4, 'F', 'W', 'U', 'P' };
+   int rc = zmq_setsockopt(firmwareUpdateListener, ZMQ_SUBSCRIBE, messageType, sizeof(messageType));
+   assert(rc == 0);
 
-                        case SLOT4_TOP_HEATER_INDEX:
-                        case SLOT4_BOTTOM_HEATER_INDEX:
-                           shelfNumber = SLOT4;
-                           break;
+   int noTimeout = -1;
+   rc = zmq_setsockopt(firmwareUpdateListener, ZMQ_RCVTIMEO, &noTimeout, sizeof(noTimeout));
+   assert(rc == 0);
 
-                        case SLOT5_TOP_HEATER_INDEX:
-                        case SLOT5_BOTTOM_HEATER_INDEX:
-                           shelfNumber = SLOT5;
-                           break;
+   int64_t maxMessageSize = ZMQ_MAX_MESSAGE_SIZE;
+   rc = zmq_setsockopt(firmwareUpdateListener, ZMQ_MAXMSGSIZE, &maxMessageSize, sizeof(maxMessageSize));
+   assert(rc == 0);
 
-                        case SLOT6_TOP_HEATER_INDEX:
-                        case SLOT6_BOTTOM_HEATER_INDEX:
-                           shelfNumber = SLOT6;
-                           break;
-                     }
+   rc = zmq_connect(firmwareUpdateListener, ig1CommandReqSubPort);
+   assert(rc == 0);
 
-                     syslog(LOG_ERR, "%s Overtemp alarm for shelf %d, upper heater %d and lower heater %d disabled and turned off", SHELF_OVER_TEMP_ERROR_CODE, shelfNumber, upperHeaterThisShelf, lowerHeaterThisShelf);
-                     (void)strncpy(errorCodeString, SHELF_OVER_TEMP_ERROR_CODE, sizeof(errorCodeString) - 1);
-                     systemStatus = SYSTEM_STATUS_ERROR;
-                     char location_str[LOGERROR_LOCATION_SIZE];
-                     (void)snprintf(location_str, sizeof(location_str), "Shelf %d", shelfNumber);
-                     (void)logError(SHELF_OVER_TEMP_ERROR_CODE, location_str, "Overtemp alarm");
-                  }
-               }
-               else
-               {
-                  heaterInfo[i].overtemp_oneshot = false;
-                  heaterInfo[i].seconds_overtemp = 0;
-               }
-            }
-         }
-      }
+   (void)sleep(1);
 
-      selectionSort(tempDeltas, NUM_HEATERS);
-      int totalHeatersOn = 0;
-      bool found = false;
+   uint32_t sequenceNumber = 0U;
 
-      // the array is assorted in ascending order, so the last maxHeatersOn are the deltas we care about
-      for (int j = startingIndex; j < NUM_HEATERS; j++)
-      {
-         // for the maxHeatersOn highest deltas, find the corresponding heater
-         found = false;
-         for (int i = 0; (i < NUM_HEATERS) && !found && (totalHeatersOn < maxHeatersOn); i++)
-         {
-            if ((tempDeltas[j] == heaterInfo[i].delta_temp) && (tempDeltas[j] > 0))
-            {
-               // mark the heater state on
-               heaterInfo[i].is_on = true;
-               // zero the delta to handle multiple deltas of the same value
-               heaterInfo[i].delta_temp = 0;
-               totalHeatersOn++;
-               found = true;
-            }
-         }
-      }
+   numThreadsRunning++;
+   while(!sigTermReceived)
+   {
+      (void)memset(escapedFullFilePath, 0, sizeof(escapedFullFilePath));
 
-      // first, turn off any heaters that were on but won't be this time interval
-      // so that we don't violate the power budget
-      // that way, if we turn on heaters early in the list but later ones in the list are still on
-      // we turn them off first
-      // at this point, is_on is the next state
-      for (int i = 0; i < NUM_HEATERS; i++)
+      rc = receiveZMQMessage(firmwareUpdateListener, &message, 0, "firmwareUpdateListenerThread");
+      if (rc == -1)
       {
-         if (heaterInfo[i].was_on && !heaterInfo[i].is_on)
-         {
-            (void)turnHeaterOnOff(i, HEATER_STATE_OFF);
-         }
+         continue;
       }
 
-      // now, actually change the heater state
-      int totalHeatersCurrentlyOn = 0;
-      for (int i = 0; i < NUM_HEATERS; i++)
+      // Deserialization
+      static FirmwareUpdate deserialized;
+      if (!deserialized.ParseFromArray(zmq_msg_data(&message), rc))
       {
-         if (heaterInfo[i].is_on)
-         {
-            (void)turnHeaterOnOff(i, HEATER_STATE_ON);
-            totalHeatersCurrentlyOn++;
-            heaterInfo[i].seconds_on_time++;
-         }
-         else
+         if (debugPrintf)
          {
-            (void)turnHeaterOnOff(i, HEATER_STATE_OFF);
+            cerr << "firmwareUpdateListenerThread ERROR: Unable to deserialize!\n";
          }
+
+         syslog(LOG_ERR, "firmwareUpdateListenerThread: Unable to deserialize!");
+         (void)logError("", "firmwareUpdateListenerThread", "Unable to deserialize");
       }
 
-      if (debugHeatersPrintf)
+      if (debugPrintf)
       {
-         (void)printf("totalHeatersCurrentlyOn = %d\n", totalHeatersCurrentlyOn);
+         cout << "Deserialization:\n";
+         deserialized.PrintDebugString();
+
+         cout << "        sender IP address: " << deserialized.sender_ip_address() << "\n";
+         cout << "          sequence number: " << deserialized.sequence_number() << "\n";
+         cout << "                 username: " << deserialized.username() << "\n";
+         cout << "                 password: " << deserialized.password() << "\n";
+         cout << "                file path: " << deserialized.file_path() << "\n";
       }
 
-      // once all the heaters are up to temperature
-      int totalHeatersInTempRange = 0;
-      int totalHeatersEnabled = 0;
-      for (int i = 0; i < NUM_HEATERS; i++)
+      // init the SSH keys
+      int ret = sshKeyscan();
+
+      if (0 == ret)
       {
-         if (heaterInfo[i].is_enabled)
-         {
-            totalHeatersEnabled++;
-         }
-         if (heaterInfo[i].is_enabled && ((HEATER_LOCATION_UPPER == heaterInfo[i].location) && (heaterInfo[i].current_temperature >= (heaterInfo[i].temperature_setpoint - 10))))
+         // fetch
+         char user[deserialized.username().length()+1];
+         (void)memset(user, 0, sizeof(user));
+         (void)memcpy(user, (const void*)deserialized.username().c_str(), deserialized.username().length());
+
+         char password[deserialized.password().length()+1];
+         (void)memset(password, 0, sizeof(password));
+         (void)memcpy(password, (const void*)deserialized.password().c_str(), deserialized.password().length());
+
+         char path[deserialized.file_path().length()+1];
+         (void)memset(path, 0, sizeof(path));
+         (void)memcpy(path, (const void*)deserialized.file_path().c_str(), deserialized.file_path().length());
+
+         // handle any spaces in the provided file path and append *.deb to the end for the scp
+         escapeSpaces(path, escapedFullFilePath);
+
+         ret = getUpdateFiles(user, password, escapedFullFilePath);
+
+         if (0 == ret)
          {
-            totalHeatersInTempRange++;
+            // Clear result buffer before starting.
+            (void)memset(firmwareUpdateResultBuffer, 0, sizeof(firmwareUpdateResultBuffer));
+
+            // check the manifest file and validate packages
+            ret = checkManifest(controllerManifestFilename);
+
+            if (0 != ret)
+            {
+               (void)snprintf(firmwareUpdateResultBuffer, sizeof(firmwareUpdateResultBuffer), "%s\n", "checkManifest Failed");
+               syslog(LOG_ERR, "checkManifest Failed");
+               (void)logError("", "firmwareUpdateListenerThread", "checkManifest failed");
+            }
+            else
+            {
+               // install
+               ret = installPackages(controllerManifestFilename);
+
+               if (0 != ret)
+               {
+                  (void)snprintf(firmwareUpdateResultBuffer, sizeof(firmwareUpdateResultBuffer), "%s\n", "installPackages Failed");
+                  syslog(LOG_ERR, "installPackages Failed");
+                  (void)logError("", "firmwareUpdateListenerThread", "installPackages failed");
+               }
+            }
          }
-         if (heaterInfo[i].is_enabled && ((HEATER_LOCATION_LOWER == heaterInfo[i].location) && (heaterInfo[i].current_temperature >= heaterInfo[i].temperature_setpoint)))
+         else
          {
-            totalHeatersInTempRange++;
+            (void)snprintf(firmwareUpdateResultBuffer, sizeof(firmwareUpdateResultBuffer), "%s\n", "getUpdateFiles Failed");
+            syslog(LOG_ERR, "getUpdateFiles Failed");
+            (void)logError("", "firmwareUpdateListenerThread", "getUpdateFiles failed");
          }
       }
-
-      for (int i = 0; i < NUM_HEATERS; i++)
+      else
       {
-         // if we're now within the legal +/- 5F range
-         // clear the setpoint_changed flag
-         // this was done to avoid over or under temp errors when a large change in the setpoint
-         // has occurred, since we have no way to force a slot to cool down any faster
-         // than turning the heaters off.
-         if ((heaterInfo[i].current_temperature >= (heaterInfo[i].temperature_setpoint - SETPOINT_RANGE_PLUS_MINUS))
-         && (heaterInfo[i].current_temperature <= (heaterInfo[i].temperature_setpoint + SETPOINT_RANGE_PLUS_MINUS)))
-         {
-            heaterInfo[i].setpoint_changed = false;
-         }
+         (void)snprintf(firmwareUpdateResultBuffer, sizeof(firmwareUpdateResultBuffer), "%s\n", "sshKeyscan Failed");
+         syslog(LOG_ERR, "sshKeyscan Failed");
+         (void)logError("", "firmwareUpdateListenerThread", "sshKeyscan failed");
       }
 
-      if (totalHeatersEnabled && (totalHeatersEnabled == totalHeatersInTempRange))
+      // now that we've processed all other packages successfully, if the manifest contains the frontier-uhc package
+      // set send the FWRS message
+      // process the frontier-uhc package LAST
+      if (manifestFileContainsFrontierUHC && (0 == ret))
       {
-         if (!startupComplete)
-         {
-            syslog(LOG_NOTICE, "Startup complete - all heaters are within range of setpoint, startup time = %d", startupTimeSeconds/60);
-            (void)logInternalEvent(STARTUP_COMPLETE_T);
-            if (debugHeatersPrintf)
-            {
-               (void)printf("Startup complete - all heaters are within range of setpoint, startup time = %d\n", startupTimeSeconds/60);
-            }
-         }
-
-         if (debugHeatersPrintf)
-         {
-            (void)printf("ALL HEATERS ARE AT TEMPERATURE!\n");
-         }
+         // installed correctly. Since we get killed off by dpkg, we can't
+         // report failure anyway
+         char resultString[MAX_FILE_PATH];
+         (void)memset(resultString, 0, sizeof(resultString));
+         (void)snprintf(resultString, strlen("%s %s\n") + strlen(frontierUHCPackageFilename) + strlen("Success") + 1, "%s %s\n", frontierUHCPackageFilename, "Success");
+         // append the status for this file to previous results
+         (void)strcat(firmwareUpdateResultBuffer, resultString);
+         syslog(LOG_NOTICE, "%s %s", frontierUHCPackageFilename, "Success");
+      }
+      // Publish ZeroMQ FirmwareUpdateResult message here
+      FirmwareUpdateResult cr;
+      cr.set_topic("FWRS");
+      cr.set_controller_ip_address(controllerIPAddress);
+      cr.set_sequence_number(sequenceNumber++);
+      string resultString(firmwareUpdateResultBuffer);
 
-         startupComplete = true;
-         initialStartup = false;
-         systemStatus = SYSTEM_STATUS_STARTUP_COMPLETE;
+      if (debugPrintf)
+      {
+         (void)printf("firmwareUpdateResultBuffer = \n%s\n", firmwareUpdateResultBuffer);
       }
 
-      if (startupComplete)
+      cr.set_result_text(resultString);
+
+      string serialized;
+      if ( !cr.SerializeToString( &serialized ) )
       {
-         if (startupTimeSeconds >= MAX_STARTUP_REACH_SETPOINT_TIME)
+         if (debugPrintf)
          {
-            if (maxStartupTimeExceededOneShot)
-            {
-               // log the error
-               syslog(LOG_ERR, "%s Startup not completed in 25 minutes +/- 5 minutes = %d", STARTUP_TIME_EXCEEDED_ERROR_CODE, startupTimeSeconds/60);
-               (void)strncpy(errorCodeString, STARTUP_TIME_EXCEEDED_ERROR_CODE, sizeof(errorCodeString) - 1);
-               systemStatus = SYSTEM_STATUS_ERROR;
-               char descr_str[LOGERROR_DESCR_SIZE];
-               (void)snprintf(descr_str, sizeof(descr_str), "Startup not completed on time, currently %d minutes", startupTimeSeconds / 60);
-               (void)logError(STARTUP_TIME_EXCEEDED_ERROR_CODE, "System", descr_str);
-               maxStartupTimeExceededOneShot = false;
-            }
+            cerr << "firmwareUpdateListenerThread ERROR: Unable to serialize!\n";
          }
-         startupTimeSeconds = 0;
+         syslog(LOG_ERR, "firmwareUpdateListenerThread: Unable to serialize!");
+         (void)logError("", "firmwareUpdateListenerThread", "Unable to serialize");
       }
-      else
+
+      char bytes[serialized.length()];
+      (void)memcpy(bytes, serialized.data(), serialized.length());
+
+      rs = zmq_send(firmwareUpdateResponsePublisher, bytes, serialized.length(), 0);
+      assert(rs == (int)serialized.length());
+
+      if (debugPrintf)
       {
-         startupTimeSeconds++;
-         if (startupTimeSeconds >= MAX_STARTUP_REACH_SETPOINT_TIME)
-         {
-            if (maxStartupTimeExceededOneShot)
-            {
-               // log the error
-               syslog(LOG_ERR, "%s Startup not completed in 25 minutes +/- 5 minutes = %d", STARTUP_TIME_EXCEEDED_ERROR_CODE, startupTimeSeconds/60);
-               (void)strncpy(errorCodeString, STARTUP_TIME_EXCEEDED_ERROR_CODE, sizeof(errorCodeString) - 1);
-               systemStatus = SYSTEM_STATUS_ERROR;
-               char descr_str[LOGERROR_DESCR_SIZE];
-               (void)snprintf(descr_str, sizeof(descr_str), "Startup not completed on time, currently %d minutes", startupTimeSeconds / 60);
-               (void)logError(STARTUP_TIME_EXCEEDED_ERROR_CODE, "System", descr_str);
-               maxStartupTimeExceededOneShot = false;
-            }
-         }
+         cout << "Bytes sent: " << rs << "\n";
       }
-   }
-   // check if the console write to CSV file is enabled, we're in startup, and we haven't timed out
-   if ((access(HEATER_DATA_TRIGGER_FILE, F_OK) == 0) && !startupComplete && (startupTimeSeconds <= MAX_STARTUP_REACH_SETPOINT_TIME))
-   {
-      if (debugCSV)
+      // now that we've processed all other packages, if the manifest contains the frontier-uhc package
+      // set the flag that the firmwareUpdatePackageThread is looking for.
+      // process the frontier-uhc package LAST
+      if (manifestFileContainsFrontierUHC)
       {
-         (void)printf("logging trigger file exists startup NOT complete\n");
+         processFrontierInstaller = true;
       }
+   }
 
-      if (startupMessageReceived)
+   (void)zmq_msg_close(&message);
+   numThreadsRunning--;
+   pthread_exit(NULL);
+}
+
+
+/*******************************************************************************************/
+/*                                                                                         */
+/* int receiveZMQMessage(void *socket, zmq_msg_t *msg, int flags, const char *receiver)    */
+/*                                                                                         */
+/* Receives the next frame on the socket into msg, which the caller initializes once with  */
+/* zmq_msg_init and reuses, so the frame is parsed straight out of libzmq's buffer instead */
+/* of being copied into a fixed size buffer and again into a string. Frames longer than    */
+/* DEFAULT_MESSAGE_BUFFER_SIZE, which used to be cut short without notice, are counted in  */
+/* zmqLargeFrames. The receiving sockets set ZMQ_MAXMSGSIZE, so libzmq drops the peer that */
+/* sends a frame longer than ZMQ_MAX_MESSAGE_SIZE before allocating it; one that gets here */
+/* anyway is counted in zmqOversizeFrames and dropped, with a syslog at most every         */
+/* ZMQ_OVERSIZE_LOG_INTERVAL_SECONDS.                                                      */
+/*                                                                                         */
+/* Returns: int length of the frame, -1 if nothing was received or the frame was dropped   */
+/*                                                                                         */
+/*******************************************************************************************/
+int receiveZMQMessage(void *socket, zmq_msg_t *msg, int flags, const char *receiver)
+{
+   int length = zmq_msg_recv(msg, socket, flags);
+   if (length == -1)
+   {
+      return -1;
+   }
+
+   if (length > ZMQ_MAX_MESSAGE_SIZE)
+   {
+      // a sender flooding big frames mustn't flood the syslog too
+      uint32_t dropped = ++zmqOversizeFrames;
+      uint32_t now = monotonicSeconds();
+      uint32_t lastLogged = zmqOversizeLoggedSeconds;
+      if (((0 == lastLogged) || ((now - lastLogged) >= ZMQ_OVERSIZE_LOG_INTERVAL_SECONDS)) &&
+          zmqOversizeLoggedSeconds.compare_exchange_strong(lastLogged, now))
       {
-         if (debugCSV)
-         {
-            (void)printf("logging startupMessageReceived\n");
-         }
+         syslog(LOG_WARNING, "%s: dropped %d byte message, larger than %d (%u dropped so far)", receiver, length, ZMQ_MAX_MESSAGE_SIZE, dropped);
+      }
+      return -1;
+   }
 
-         debugHeatersWriteCSVFile = true;
+   if (length > DEFAULT_MESSAGE_BUFFER_SIZE)
+   {
+      zmqLargeFrames++;
+   }
 
-         if (csvFile == NULL)
-         {
-            csvFile = fopen(HEATER_DATA_CSV_FILE, "w");
-            (void)printf("csvFile = %p\n", csvFile);
-            (void)fprintf(csvFile, "SECONDS, HEATER1, HEATER1ON, HEATER2, HEATER2ON, HEATER3, HEATER3ON, HEATER4, HEATER4ON, HEATER5, HEATER5ON, HEATER6, HEATER6ON, HEATER7, HEATER7ON, HEATER8, HEATER8ON, HEATER9, HEATER9ON, HEATER10, HEATER10ON, HEATER11, HEATER11ON, HEATER12, HEATER12ON, HEATSINK, AMBIENT, CURRENTDRAW, VOLTAGE\n");
-            if (debugCSV)
-            {
-               (void)printf("logging created /tmp/heaterData.csv and wrote the header\n");
-            }
-            (void)gettimeofday(&csvStartTime, NULL);
-            loggingLinesWritten = 0;
-         }
+   return length;
+}
 
-         if (csvFile != NULL)
-         {
-            loggingLinesWritten++;
-            if (debugCSV)
-            {
-               (void)printf("logging writing line %u of heater data\n", loggingLinesWritten);
-            }
 
-            struct timeval now;
-            (void)gettimeofday(&now, NULL);
-            (void)fprintf(csvFile, "%d, %d, %d, %d, %d, %d, %d, %d, %d, %d, %d, %d, %d, %d, %d, %d, %d, %d, %d, %d, %d, %d, %d, %d, %d, %d, %d, %0.2f, %0.2f\n", loggingLinesWritten,
-                  heaterInfo[0].current_temperature,  heaterInfo[0].is_on,
-                  heaterInfo[1].current_temperature,  heaterInfo[1].is_on,
-                  heaterInfo[2].current_temperature,  heaterInfo[2].is_on,
-                  heaterInfo[3].current_temperature,  heaterInfo[3].is_on,
-                  heaterInfo[4].current_temperature,  heaterInfo[4].is_on,
-                  heaterInfo[5].current_temperature,  heaterInfo[5].is_on,
-                  heaterInfo[6].current_temperature,  heaterInfo[6].is_on,
-                  heaterInfo[7].current_temperature,  heaterInfo[7].is_on,
-                  heaterInfo[8].current_temperature,  heaterInfo[8].is_on,
-                  heaterInfo[9].current_temperature,  heaterInfo[9].is_on,
-                  heaterInfo[10].current_temperature, heaterInfo[10].is_on,
-                  heaterInfo[11].current_temperature, heaterInfo[11].is_on,
-                  lookupTempFromRawCounts(rtdMappings[HEATSINK_RTD_INDEX].value, HEATSINK_RTD_INDEX),
-                  lookupTempFromRawCounts(rtdMappings[AMBIENT_TEMP_RTD_INDEX].value, AMBIENT_TEMP_RTD_INDEX),
-                  irms, voltage);
-         }
-      }
+/*******************************************************************************************/
+/*                                                                                         */
+/* int addGUISession(const char *ipAddress)                                                */
+/*                                                                                         */
+/* Adds an Intelligent Glass panel to the session table. Panels are numbered in the order  */
+/* they are added and use the ports in guiSessionPorts for that number.                    */
+/*                                                                                         */
+/* Returns: int 0 = success, 1 = the table is full                                         */
+/*                                                                                         */
+/*******************************************************************************************/
+int addGUISession(const char *ipAddress)
+{
+   if (numGUISessions >= MAX_GUI_SESSIONS)
+   {
+      return 1;
    }
-   else
+
+   GUI_SESSION *session = &guiSessions[numGUISessions];
+   (void)memset(session, 0, sizeof(*session));
+   session->panel_number = numGUISessions + 1;
+   (void)strncpy(session->ip_address, ipAddress, sizeof(session->ip_address) - 1);
+   session->ports = &guiSessionPorts[numGUISessions];
+   session->missing_one_shot = true;
+   numGUISessions++;
+
+   return 0;
+}
+
+
+/*******************************************************************************************/
+/*                                                                                         */
+/* uint32_t monotonicSeconds()                                                             */
+/*                                                                                         */
+/* Seconds on CLOCK_MONOTONIC, which setting the system time doesn't move.                 */
+/*                                                                                         */
+/* Returns: uint32_t seconds                                                               */
+/*                                                                                         */
+/*******************************************************************************************/
+uint32_t monotonicSeconds()
+{
+   struct timespec now;
+   (void)clock_gettime(CLOCK_MONOTONIC, &now);
+
+   return (uint32_t)now.tv_sec;
+}
+
+
+/*******************************************************************************************/
+/*                                                                                         */
+/* void markGUISessionHeard(GUI_SESSION *session)                                          */
+/*                                                                                         */
+/* Records that a message was just received from the panel and rearms its communication    */
+/* loss one shots.                                                                         */
+/*                                                                                         */
+/* Returns: None                                                                           */
+/*                                                                                         */
+/*******************************************************************************************/
+void markGUISessionHeard(GUI_SESSION *session)
+{
+   session->last_heard_seconds = monotonicSeconds();
+   session->missing_one_shot = true;
+   bothGuisMissingOneShot = true;
+}
+
+
+/*******************************************************************************************/
+/*                                                                                         */
+/* uint32_t guiSessionSecondsSinceHeard(const GUI_SESSION *session)                        */
+/*                                                                                         */
+/* Returns: uint32_t seconds since a message was last received from the panel              */
+/*                                                                                         */
+/*******************************************************************************************/
+uint32_t guiSessionSecondsSinceHeard(const GUI_SESSION *session)
+{
+   return monotonicSeconds() - session->last_heard_seconds;
+}
+
+
+/*******************************************************************************************/
+/*                                                                                         */
+/* GUI_SESSION *findGUISession(const char *ipAddress)                                      */
+/*                                                                                         */
+/* Returns: GUI_SESSION * the panel with the IP address, NULL if there isn't one           */
+/*                                                                                         */
+/*******************************************************************************************/
+GUI_SESSION *findGUISession(const char *ipAddress)
+{
+   for (int i = 0; i < numGUISessions; i++)
    {
-      if (!startupComplete && debugCSV)
+      if (0 == strcmp(guiSessions[i].ip_address, ipAddress))
       {
-         (void)printf("logging trigger file removed\n");
+         return &guiSessions[i];
       }
+   }
 
-      debugHeatersWriteCSVFile = false;
-      if (csvFile != NULL)
+   return NULL;
+}
+
+
+/*******************************************************************************************/
+/*                                                                                         */
+/* void *openGUISubscriber(const GUI_SESSION *session, int port, const char *topic,        */
+/*                          const char *name)                                              */
+/*                                                                                         */
+/* Creates a socket that subscribes to one message type from the panel and connects it.    */
+/* The subscription matches the serialized topic, which is always the first field.         */
+/*                                                                                         */
+/* Returns: void * the socket                                                              */
+/*                                                                                         */
+/*******************************************************************************************/
+void *openGUISubscriber(const GUI_SESSION *session, int port, const char *topic, const char *name)
+{
+   void *socket = zmq_socket(context, ZMQ_SUB);
+   assert(socket != 0);
+
+   char guiIPandPort[IP_STRING_SIZE + 14];   // Allow space for the tcp:// and :portnumber
+   (void)snprintf(guiIPandPort, sizeof(guiIPandPort), "tcp://%s:%d", session->ip_address, port);
+   (void)printf("Glass %d %s guiIPandPort = %s\n", session->panel_number, name, guiIPandPort);
+
+   // field 1, length delimited, then the topic itself
+   char messageType[16];
+   size_t topicLength = strlen(topic);
+   assert(topicLength + 2 <= sizeof(messageType));
+   messageType[0] = 10;
+   messageType[1] = (char)topicLength;
+   (void)memcpy(&messageType[2], topic, topicLength);
+   int rc = zmq_setsockopt(socket, ZMQ_SUBSCRIBE, messageType, topicLength + 2);
+   assert(rc == 0);
+
+   int noTimeout = -1;
+   rc = zmq_setsockopt(socket, ZMQ_RCVTIMEO, &noTimeout, sizeof(noTimeout));
+   assert(rc == 0);
+
+   int64_t maxMessageSize = ZMQ_MAX_MESSAGE_SIZE;
+   rc = zmq_setsockopt(socket, ZMQ_MAXMSGSIZE, &maxMessageSize, sizeof(maxMessageSize));
+   assert(rc == 0);
+
+   rc = zmq_connect(socket, guiIPandPort);
+   assert(rc == 0);
+
+   return socket;
+}
+
+
+/*******************************************************************************************/
+/*                                                                                         */
+/* void openGUISession(GUI_SESSION *session)                                               */
+/*                                                                                         */
+/* Creates and connects the HeartBeat, SystemCommand and TimeSync subscribers of the       */
+/* panel, and binds the publisher its SystemCommandResponse messages go out on.            */
+/*                                                                                         */
+/* Returns: None                                                                           */
+/*                                                                                         */
+/*******************************************************************************************/
+void openGUISession(GUI_SESSION *session)
+{
+   session->heartbeat_listener = openGUISubscriber(session, session->ports->heartbeat, HEARTBEAT_TOPIC, "heartbeat");
+   session->command_listener = openGUISubscriber(session, session->ports->command, SYSTEM_COMMAND_TOPIC, "command");
+   session->time_sync_subscriber = openGUISubscriber(session, session->ports->time_sync, TIME_SYNC_TOPIC, "time sync");
+
+   session->command_response_publisher = zmq_socket(context, ZMQ_PUB);
+   assert(session->command_response_publisher != 0);
+
+   char commandRespPubPort[IP_STRING_SIZE + 14];   // Allow space for the tcp:// and :portnumber
+   (void)snprintf(commandRespPubPort, sizeof(commandRespPubPort), "tcp://%s:%d", controllerIPAddress, session->ports->command_response);
+   (void)printf("Glass %d commandRespPubPort = %s\n", session->panel_number, commandRespPubPort);
+   int rs = zmq_bind(session->command_response_publisher, commandRespPubPort);
+   assert(rs == 0);
+}
+
+
+/*******************************************************************************************/
+/*                                                                                         */
+/* void closeGUISession(GUI_SESSION *session)                                              */
+/*                                                                                         */
+/* Closes the sockets of the panel.                                                        */
+/*                                                                                         */
+/* Returns: None                                                                           */
+/*                                                                                         */
+/*******************************************************************************************/
+void closeGUISession(GUI_SESSION *session)
+{
+   if (session->heartbeat_listener != NULL)
+   {
+      (void)zmq_close (session->heartbeat_listener);
+      session->heartbeat_listener = NULL;
+   }
+   if (session->command_listener != NULL)
+   {
+      (void)zmq_close (session->command_listener);
+      session->command_listener = NULL;
+   }
+   if (session->time_sync_subscriber != NULL)
+   {
+      (void)zmq_close (session->time_sync_subscriber);
+      session->time_sync_subscriber = NULL;
+   }
+   if (session->command_response_publisher != NULL)
+   {
+      (void)zmq_close (session->command_response_publisher);
+      session->command_response_publisher = NULL;
+   }
+}
+
+
+/*******************************************************************************************/
+/*                                                                                         */
+/* int openGUISessions(zmq_pollitem_t *items, ZMQ_REACTOR_SOCKET *sockets)                 */
+/*                                                                                         */
+/* Opens the sockets of every panel and the command router they share, and fills in a      */
+/* zmq_poll item and a handler for each. items and sockets must have room for              */
+/* ZMQ_REACTOR_NUM_SOCKETS entries.                                                        */
+/*                                                                                         */
+/* Returns: int number of sockets to poll                                                  */
+/*                                                                                         */
+/*******************************************************************************************/
+int openGUISessions(zmq_pollitem_t *items, ZMQ_REACTOR_SOCKET *sockets)
+{
+   int numSockets = 0;
+
+   (void)memset(items, 0, ZMQ_REACTOR_NUM_SOCKETS * sizeof(zmq_pollitem_t));
+   for (int i = 0; i < numGUISessions; i++)
+   {
+      GUI_SESSION *session = &guiSessions[i];
+      openGUISession(session);
+
+      items[numSockets].socket = session->heartbeat_listener;
+      items[numSockets].events = ZMQ_POLLIN;
+      sockets[numSockets].session = session;
+      sockets[numSockets].handler = handleHeartBeat;
+      numSockets++;
+
+      items[numSockets].socket = session->command_listener;
+      items[numSockets].events = ZMQ_POLLIN;
+      sockets[numSockets].session = session;
+      sockets[numSockets].handler = handleSystemCommand;
+      numSockets++;
+
+      if (session->time_sync_subscriber != NULL)
       {
-         (void)fclose(csvFile);
-         sync();
-         csvFile = NULL;
+         items[numSockets].socket = session->time_sync_subscriber;
+         items[numSockets].events = ZMQ_POLLIN;
+         sockets[numSockets].session = session;
+         sockets[numSockets].handler = handleTimeSync;
+         numSockets++;
+      }
+   }
 
-         char commandLine[COMMAND_LINE_BUFFER_SIZE];
-         // Make sure targetFile appended to "mv /tmp/heaterData.csv " won't exceed COMMAND_LINE_BUFFER_SIZE.
-         char targetFile[MAX_FILE_PATH - 24];
-         (void)memset(targetFile, 0, sizeof(targetFile));
-         int fileCount = getFileCount();
-         if (0 != fileCount)
-         {
-            char oldestFileName[MAX_FILE_PATH];
-            char newestFilename[MAX_FILE_PATH];
-            (void)memset(oldestFileName, 0, sizeof(oldestFileName));
-            (void)memset(newestFilename, 0, sizeof(newestFilename));
-            (void)getNewestFile(newestFilename, sizeof(newestFilename));
-            (void)printf("newestFilename = \"%s\"\n", newestFilename);
-            (void)getOldestFile(oldestFileName, sizeof(oldestFileName));
-            (void)printf("oldestFileName = \"%s\"\n", oldestFileName);
-         }
+   openCommandRouter();
+   items[numSockets].socket = commandRouter;
+   items[numSockets].events = ZMQ_POLLIN;
+   sockets[numSockets].session = NULL;
+   sockets[numSockets].handler = NULL;
+   numSockets++;
 
-         (void)memset(commandLine, 0, sizeof(commandLine));
-         (void)getNextFilename(targetFile, sizeof(targetFile));
-         (void)printf("logging moving %s to %s\n", HEATER_DATA_CSV_FILE, targetFile);
-         (void)snprintf(commandLine, sizeof(commandLine) - 1, MOVE_HEATER_DATA_TO_LOG_DIRECTORY, HEATER_DATA_CSV_FILE, targetFile);
-         (void)system(commandLine);
+   return numSockets;
+}
 
-         (void)memset(commandLine, 0, sizeof(commandLine));
-         (void)snprintf(commandLine, sizeof(commandLine) - 1, TOUCH_FILE, targetFile);
-         (void)system(commandLine);
-         sync();
 
-         startupMessageReceived = false;
+/*******************************************************************************************/
+/*                                                                                         */
+/* void dispatchGUISessionMessages(zmq_pollitem_t *items,                                  */
+/*                                  const ZMQ_REACTOR_SOCKET *sockets, int numSockets,     */
+/*                                  zmq_msg_t *message, const char *receiver)              */
+/*                                                                                         */
+/* After a zmq_poll, receives everything queued on the sockets that are ready and passes   */
+/* each message to the socket's handler along with the panel it came from.                 */
+/*                                                                                         */
+/* Returns: None                                                                           */
+/*                                                                                         */
+/*******************************************************************************************/
+void dispatchGUISessionMessages(zmq_pollitem_t *items, const ZMQ_REACTOR_SOCKET *sockets, int numSockets, zmq_msg_t *message, const char *receiver)
+{
+   for (int i = 0; i < numSockets; i++)
+   {
+      if ((items[i].revents & ZMQ_POLLIN) && (NULL == sockets[i].session))
+      {
+         serviceCommandRouter(message);
       }
-      if (startupTimeSeconds >= MAX_STARTUP_REACH_SETPOINT_TIME)
+      else if (items[i].revents & ZMQ_POLLIN)
       {
-         if (maxStartupTimeExceededOneShot)
+         // drain everything queued on this socket
+         while (true)
          {
-            // log the error
-            syslog(LOG_ERR, "%s Startup not completed in 25 minutes +/- 5 minutes = %d", STARTUP_TIME_EXCEEDED_ERROR_CODE, startupTimeSeconds/60);
-            (void)strncpy(errorCodeString, STARTUP_TIME_EXCEEDED_ERROR_CODE, sizeof(errorCodeString) - 1);
-            systemStatus = SYSTEM_STATUS_ERROR;
-            char descr_str[LOGERROR_DESCR_SIZE];
-            (void)snprintf(descr_str, sizeof(descr_str), "Startup not completed on time, currently %d minutes", startupTimeSeconds / 60);
-            (void)logError(STARTUP_TIME_EXCEEDED_ERROR_CODE, "System", descr_str);
-            maxStartupTimeExceededOneShot = false;
+            int length = receiveZMQMessage(items[i].socket, message, ZMQ_DONTWAIT, receiver);
+            if (length == -1)
+            {
+               break;
+            }
+            sockets[i].handler(sockets[i].session, (const char *)zmq_msg_data(message), length);
          }
       }
    }
@@ -3874,445 +6613,860 @@ void runHeaterAlgorithm()
 
 /*******************************************************************************************/
 /*                                                                                         */
-/* void printHeaters()                                                                     */
+/* void logGUISessionStats()                                                               */
+/*                                                                                         */
+/* Writes the messages received from each panel in the last hour to the syslog, then       */
+/* clears the counts.                                                                      */
 /*                                                                                         */
 /* Returns: None                                                                           */
 /*                                                                                         */
 /*******************************************************************************************/
-void printHeaters()
+void logGUISessionStats()
 {
-   for (int i = 0; i < NUM_HEATERS; i++)
+   for (int i = 0; i < numGUISessions; i++)
    {
-      (void)printf("Heater[%d] isEnabled:%d isOn:%d short:%d open:%d over:%d under:%d sp:%d cur:%d delta:%d\n",
-            i,
-            heaterInfo[i].is_enabled,
-            heaterInfo[i].is_on,
-            rtdMappings[i].is_shorted,
-            rtdMappings[i].is_open,
-            heaterInfo[i].is_overtemp,
-            heaterInfo[i].is_undertemp,
-            heaterInfo[i].temperature_setpoint,
-            heaterInfo[i].current_temperature,
-            heaterInfo[i].delta_temp);
+      GUI_SESSION *session = &guiSessions[i];
+      syslog(LOG_INFO, "Glass %d %s heartbeats %u commands %u last command sequence %u last heard %u seconds ago",
+             session->panel_number, session->ip_address, session->heartbeats_received, session->commands_received,
+             session->last_command_sequence_number, guiSessionSecondsSinceHeard(session));
+      session->heartbeats_received = 0;
+      session->commands_received = 0;
    }
 
-   (void)printf("\n\n");
+   syslog(LOG_INFO, "Command router commands %u answered from the cache %u, cache keys reused by a different command %u",
+          routerCommandsReceived, routerCommandsDuplicated, routerCommandsKeyReused);
+   routerCommandsReceived = 0;
+   routerCommandsDuplicated = 0;
+   routerCommandsKeyReused = 0;
 }
 
 
 /*******************************************************************************************/
 /*                                                                                         */
-/* void logHourlyStats()                                                                   */
+/* void handleHeartBeat(GUI_SESSION *session, const char *message, int length)             */
 /*                                                                                         */
-/* Once per hour, write the current statistics to the syslog file, then clear them.        */
+/* Handles a HeartBeat message from a panel.                                               */
 /*                                                                                         */
 /* Returns: None                                                                           */
 /*                                                                                         */
 /*******************************************************************************************/
-void logHourlyStats()
+void handleHeartBeat(GUI_SESSION *session, const char *message, int length)
 {
-   syslog(LOG_INFO, "     LOCATION                VOLTAGE   ADC COUNTS  TEMPERATURE  ON TIME  ENABLED  SHORTED/OPEN");
-   syslog(LOG_INFO, "===============================================================================================");
-
-   for (int i = 0; i < NUM_HEATERS; i++)
+   // Deserialization
+   static HeartBeat deserialized;
+   if (!deserialized.ParseFromArray(message, length))
    {
-      int current_temperature = lookupTempFromRawCounts(rtdMappings[i].value, i);
-      char str[16];
-      (void)memset(str, 0, sizeof(str));
-
-      // if the counts are above 340 degree counts, call that open
-      if (rtdMappings[i].value > rtdMappings[i].temp_lookup_table[NUM_TEMP_LOOKUP_ENTRIES-10].adc_raw_counts)
-      {
-         (void)strncpy(str, "Open", sizeof(str));
-      }
-
-      if (rtdMappings[i].value < rtdMappings[i].temp_lookup_table[0].adc_raw_counts)
+      if (debugPrintf)
       {
-         (void)strncpy(str, "Shorted", sizeof(str));
+         cerr << "ERROR: Unable to deserialize!\n";
+         syslog(LOG_ERR, "handleHeartBeat Glass %d ERROR: Unable to deserialize!", session->panel_number);
+         (void)logError("", "handleHeartBeat", "Unable to deserialize");
       }
-
-      char thisLine[1024];
-      (void)memset(thisLine, 0, sizeof(thisLine));
-      (void)snprintf(thisLine, sizeof(thisLine), "%s     %0.5fV     %4d       %5d F       %4d      %1d       %s", labels[i], ((float)(rtdMappings[i].value) * 1.8) / 4096.0,  rtdMappings[i].value, current_temperature, heaterInfo[i].seconds_on_time, heaterInfo[i].is_enabled, str);
-      syslog(LOG_INFO, thisLine);
    }
 
-   // now, clear the stats
-   for (int i = 0; i < NUM_HEATERS; i++)
+   if (debugPrintf)
    {
-      heaterInfo[i].seconds_on_time = 0;
+      cout << "Deserialization:\n";
+      deserialized.PrintDebugString();
+
+      cout << "        sender IP address: " << deserialized.sender_ip_address() << "\n";
+      cout << "          sequence number: " << deserialized.sequence_number() << "\n";
    }
+
+   session->heartbeats_received++;
+   markGUISessionHeard(session);
 }
 
 
 /*******************************************************************************************/
 /*                                                                                         */
-/* void *heaterControlThread(void *)                                                       */
+/* void *cssArenaBlockAlloc(size_t size)                                                   */
 /*                                                                                         */
-/* Run the heater control algorithm once per second. Figure out which heaters are the      */
-/* furthest away from their setpoints, and turn on up to eight heaters to keep under       */
-/* the allowed power budget of 15A from the wall outlet.                                   */
+/* Gets a block for a CurrentSystemState arena once its initial block is used up, counting */
+/* it in threadHeapAllocations. The arenas only grow from the publishing thread.           */
 /*                                                                                         */
-/* Returns: pthread_exit(NULL)                                                             */
+/* Returns: void *block, NULL on failure                                                   */
 /*                                                                                         */
 /*******************************************************************************************/
-void *heaterControlThread(void *)
+void *cssArenaBlockAlloc(size_t size)
 {
-   uint32_t runningTime = 0;
-   struct timeval start;
-   struct timeval end;
-   uint32_t executionTime;
-   uint32_t balance;
+   threadHeapAllocations++;
+   return malloc(size);
+}
 
-   numThreadsRunning++;
-   while(!sigTermReceived)
-   {
-      (void)gettimeofday(&start, NULL);
 
-      runHeaterAlgorithm();
+/*******************************************************************************************/
+/*                                                                                         */
+/* void cssArenaBlockDealloc(void *block, size_t size)                                     */
+/*                                                                                         */
+/* Frees a block cssArenaBlockAlloc got for a CurrentSystemState arena.                    */
+/*                                                                                         */
+/* Returns: None                                                                           */
+/*                                                                                         */
+/*******************************************************************************************/
+void cssArenaBlockDealloc(void *block, size_t)
+{
+   free(block);
+}
 
-      runningTime++;
-      if (0 == (runningTime % ONE_HOUR_IN_SECONDS))
-      {
-         // once per hour, write the statistics to the syslog
-         logHourlyStats();
-      }
 
-      if (debugHeatersPrintf)
-      {
-         printHeaters();
-      }
+/*******************************************************************************************/
+/*                                                                                         */
+/* void openStatusPublisher()                                                              */
+/*                                                                                         */
+/* Creates and binds the CurrentSystemState publisher socket.                              */
+/*                                                                                         */
+/* Returns: None                                                                           */
+/*                                                                                         */
+/*******************************************************************************************/
+void openStatusPublisher()
+{
+   char statusPublisherPort[IP_STRING_SIZE + 14];  // Allow space for the tcp:// and :portnumber
+   (void)snprintf(statusPublisherPort, sizeof(statusPublisherPort), "tcp://%s:%d", controllerIPAddress, CURRENT_SYSTEM_STATE_PORT_CONTROLLER);
+   (void)printf("statusPublisherThread statusPublisherPort = %s\n", statusPublisherPort);
 
-      (void)gettimeofday(&end, NULL);
+   statusPublisher = zmq_socket(context, ZMQ_PUB);
+   assert(statusPublisher != 0);
 
-      executionTime = (((end.tv_sec - start.tv_sec) * ONE_SECOND_IN_MICROSECONDS) + (end.tv_usec - start.tv_usec));
-      if (executionTime < ONE_SECOND_IN_MICROSECONDS)
-      {
-         balance = ONE_SECOND_IN_MICROSECONDS - executionTime;
-//         printf("task execution took %d microseconds balance = %ld\n", executionTime, balance);
-         usleep(balance);
-      }
-      else
-      {
-         // force a minimum thread sleep time
-//         printf("Execution time took more than 1 second - %d.%d\n", (executionTime / ONE_SECOND_IN_MICROSECONDS), (executionTime % ONE_SECOND_IN_MICROSECONDS));
-         usleep(MINIMUM_THREAD_SLEEP_TIME);
-      }
-   }
+   int rc = zmq_bind(statusPublisher, statusPublisherPort);
+   assert(rc == 0);
 
-   numThreadsRunning--;
-   pthread_exit(NULL);
+   ArenaOptions options;
+   options.initial_block = cssArenaBlock;
+   options.initial_block_size = sizeof(cssArenaBlock);
+   options.block_alloc = cssArenaBlockAlloc;
+   options.block_dealloc = cssArenaBlockDealloc;
+   cssArena = new Arena(options);
+   cssMessage = Arena::CreateMessage<CurrentSystemState>(cssArena);
+
+   ArenaOptions deltaOptions;
+   deltaOptions.initial_block = cssDeltaArenaBlock;
+   deltaOptions.initial_block_size = sizeof(cssDeltaArenaBlock);
+   deltaOptions.block_alloc = cssArenaBlockAlloc;
+   deltaOptions.block_dealloc = cssArenaBlockDealloc;
+   cssDeltaArena = new Arena(deltaOptions);
+
+   (void)clock_gettime(CLOCK_MONOTONIC, &cssStreamStatsStart);
+   if (access(CSS_DELTA_ENABLE_FILE, F_OK) == 0)
+   {
+      cssDelta = true;
+      syslog(LOG_NOTICE, "CurrentSystemState deltas enabled by %s, keyframe every %d seconds", CSS_DELTA_ENABLE_FILE, CSS_KEYFRAME_INTERVAL_SECONDS);
+   }
 }
 
-// ****************** Firmware update *******************
+
 /*******************************************************************************************/
 /*                                                                                         */
-/* void escapeSpaces(char *inPath, char *outPath)                                          */
+/* bool messagePartChanged(const google::protobuf::MessageLite &part, char *last,          */
+/*                         size_t lastSize, size_t *lastLength)                            */
 /*                                                                                         */
-/* Surround the entire file path with quotes, and escape any embedded spaces with          */
-/* "\\\" or scp will fail                                                                  */
+/* Serializes part and compares the bytes with the ones it serialized to last time, then   */
+/* keeps the new bytes in last for the next comparison.                                    */
 /*                                                                                         */
-/* Returns: None                                                                           */
+/* Returns: bool true if part changed or is too big to compare                             */
 /*                                                                                         */
 /*******************************************************************************************/
-void escapeSpaces(char *inPath, char *outPath)
+bool messagePartChanged(const google::protobuf::MessageLite &part, char *last, size_t lastSize, size_t *lastLength)
 {
-  int i;
-  int length = strlen(inPath);
-  char *inPtr = inPath;
-  char *outPtr = outPath;
+   char current[DEFAULT_CSS_MESSAGE_BUFFER_SIZE];
+   size_t length = part.ByteSizeLong();
 
-  // surround the entire file path with quotes, and escape any embedded spaces with "\\\" or scp will fail
-  (void)strcpy(outPtr, "\"");
-  outPtr++;
-  for (i = 0; i < length; i++, inPtr++, outPtr++)
-  {
-    if (*inPtr == ' ')
-    {
-      (void)strcat(outPtr, "\\");
-      outPtr += 1;
-    }
-    *outPtr = *inPtr;
-  }
-  (void)strcat(outPtr, "\"");
+   if ((length > sizeof(current)) || (length > lastSize) || !part.SerializeToArray(current, (int)length))
+   {
+      *lastLength = 0;
+      return true;
+   }
+
+   bool changed = (length != *lastLength) || (memcmp(current, last, length) != 0);
+   (void)memcpy(last, current, length);
+   *lastLength = length;
+
+   return changed;
 }
 
 
 /*******************************************************************************************/
 /*                                                                                         */
-/* int sshKeyscan()                                                                        */
+/* void findSystemStateChanges(CurrentSystemState &s, bool *systemDataChanged,             */
+/*                             bool *slotChanged)                                          */
 /*                                                                                         */
-/* Issue the SSH keyscan to validate the necessary information to prepare for the SCP.     */
+/* Finds which parts of the CurrentSystemState about to be published differ from the one   */
+/* published before it. The clock fields of SystemData are left out of the comparison      */
+/* since they move every second and go in every delta anyway. Must be called for every     */
+/* publish, keyframes included, so the comparison is always against the previous message.  */
 /*                                                                                         */
-/* Returns: int ret - 0=success, 1 = failure                                               */
+/* Returns: None                                                                           */
 /*                                                                                         */
 /*******************************************************************************************/
-int sshKeyscan()
+void findSystemStateChanges(CurrentSystemState &s, bool *systemDataChanged, bool *slotChanged)
 {
-   int ret = 0;
-   char commandLine[COMMAND_LINE_BUFFER_SIZE];
+   static char lastSystemData[DEFAULT_CSS_MESSAGE_BUFFER_SIZE];
+   static size_t lastSystemDataLength = 0;
+   static char lastSlotData[TOTAL_SLOTS][CSS_SLOT_BUFFER_SIZE];
+   static size_t lastSlotDataLength[TOTAL_SLOTS];
+
+   CurrentSystemState::SystemData *systemData = s.mutable_system_data();
+   google::protobuf::Timestamp *clocks[CSS_DELTA_CLOCKS] =
+   {
+      systemData->mutable_current_time(),
+      systemData->mutable_system_up_time(),
+      systemData->mutable_last_time_intelligent_glass_1_heard(),
+      systemData->mutable_last_time_intelligent_glass_2_heard()
+   };
+   google::protobuf::Timestamp savedClocks[CSS_DELTA_CLOCKS];
 
-   (void)memset(commandLine, 0, sizeof(COMMAND_LINE_BUFFER_SIZE));
-   (void)snprintf(commandLine, sizeof(commandLine), "%s", RM_KNOWN_HOSTS);
-   (void)system(commandLine);
-   (void)snprintf(commandLine, sizeof(commandLine), SSH_KEYSCAN, guiIPAddress1);
-   ret = system(commandLine);
-   return ret;
+   // blank the clocks while comparing, then put them back
+   for (int i = 0; i < CSS_DELTA_CLOCKS; i++)
+   {
+      savedClocks[i] = *clocks[i];
+      clocks[i]->Clear();
+   }
+   *systemDataChanged = messagePartChanged(*systemData, lastSystemData, sizeof(lastSystemData), &lastSystemDataLength);
+   for (int i = 0; i < CSS_DELTA_CLOCKS; i++)
+   {
+      *clocks[i] = savedClocks[i];
+   }
+
+   for (int i = 0; i < TOTAL_SLOTS; i++)
+   {
+      slotChanged[i] = messagePartChanged(s.slot_data(i), lastSlotData[i], sizeof(lastSlotData[i]), &lastSlotDataLength[i]);
+   }
 }
 
 
 /*******************************************************************************************/
 /*                                                                                         */
-/* int getUpdateFiles(char *username, char *password, char *path)                          */
+/* bool serializeSystemStateDelta(const CurrentSystemState &s, bool systemDataChanged,     */
+/*                                const bool *slotChanged, size_t *length)                 */
 /*                                                                                         */
-/* SCP all of the update files from the specified remote location to /tmp                  */
+/* Builds the CurrentSystemStateDelta for s, relative to the message published before it,  */
+/* from the changes found by findSystemStateChanges and serializes it into                 */
+/* cssSerializeBuffer. The delta is built on cssDeltaArena, which is reset afterwards.     */
 /*                                                                                         */
-/* Returns: int ret - 0=success, 1 = failure                                               */
+/* Returns: bool true if the delta was serialized, length holds its size either way        */
 /*                                                                                         */
 /*******************************************************************************************/
-int getUpdateFiles(char *username, char *password, char *path)
+bool serializeSystemStateDelta(const CurrentSystemState &s, bool systemDataChanged, const bool *slotChanged, size_t *length)
 {
-   char commandLine[COMMAND_LINE_BUFFER_SIZE];
-   char debFiles[THIS_FILE_FILENAME_LENGTH];
-   char manifestFile[THIS_FILE_FILENAME_LENGTH];
-   int pathLength = strlen(path);
+   CurrentSystemStateDelta *delta = Arena::CreateMessage<CurrentSystemStateDelta>(cssDeltaArena);
+   const CurrentSystemState::SystemData &systemData = s.system_data();
 
-   (void)memset(debFiles, 0, sizeof(debFiles));
-   (void)memset(manifestFile, 0, sizeof(manifestFile));
-   (void)memset(commandLine, 0, sizeof(commandLine));
-   (void)strncpy(debFiles, path, pathLength);
-   (void)strncat(debFiles, "/*.deb", sizeof(debFiles) - strlen("/*.deb") - 1);
-   (void)strncpy(manifestFile, path, pathLength);
-   (void)strncat(manifestFile, "/controller.manifest", sizeof(manifestFile)- strlen("/controller.manifest") - 1);
+   delta->mutable_topic()->assign(CURRENT_SYSTEM_STATE_DELTA_TOPIC);
+   delta->set_sequence_number(s.sequence_number());
+   delta->set_base_sequence_number(s.sequence_number() - 1);
+   *delta->mutable_current_time() = systemData.current_time();
+   *delta->mutable_system_up_time() = systemData.system_up_time();
+   *delta->mutable_last_time_intelligent_glass_1_heard() = systemData.last_time_intelligent_glass_1_heard();
+   *delta->mutable_last_time_intelligent_glass_2_heard() = systemData.last_time_intelligent_glass_2_heard();
 
-   (void)snprintf(commandLine, sizeof(commandLine), SCP_UPDATE_FILES, password, username, guiIPAddress1, debFiles);
-   int ret = system(commandLine);
-   (void)snprintf(commandLine, sizeof(commandLine), SCP_UPDATE_FILES, password, username, guiIPAddress1, manifestFile);
-   ret |= system(commandLine);
+   if (systemDataChanged)
+   {
+      *delta->mutable_system_data() = systemData;
+      delta->mutable_system_data()->clear_current_time();
+      delta->mutable_system_data()->clear_system_up_time();
+      delta->mutable_system_data()->clear_last_time_intelligent_glass_1_heard();
+      delta->mutable_system_data()->clear_last_time_intelligent_glass_2_heard();
+   }
 
-   return ret;
+   for (int i = 0; i < TOTAL_SLOTS; i++)
+   {
+      if (slotChanged[i])
+      {
+         *delta->add_slot_data() = s.slot_data(i);
+      }
+   }
+
+   *length = delta->ByteSizeLong();
+   bool serialized = (*length <= sizeof(cssSerializeBuffer)) && delta->SerializeToArray(cssSerializeBuffer, (int)*length);
+
+   if (debugCSS)
+   {
+      delta->PrintDebugString();
+   }
+
+   // everything above came from the arena, give it all back for the next delta
+   cssDeltaArena->Reset();
+
+   return serialized;
 }
 
+
 /*******************************************************************************************/
 /*                                                                                         */
-/* int checkManifest(char *manifestFilename)                                               */
+/* void publishSystemState()                                                               */
 /*                                                                                         */
-/* Check the SHA256 values for each file specified in the manifest. If ANY of them         */
-/* don't match, return failure.                                                            */
+/* Builds the CurrentSystemState message from the current system data and publishes it.    */
+/* Called once per second.                                                                 */
 /*                                                                                         */
-/* Returns: int ret - 0 = success, 1 = failure                                             */
+/* Returns: None                                                                           */
 /*                                                                                         */
 /*******************************************************************************************/
-int checkManifest(char *manifestFilename)
+void publishSystemState()
 {
-   FILE *fp = NULL;
-   FILE *shaFP = NULL;
-   int ret = 0;
-   int itemsRead = 0;
-   char shaFile[THIS_FILE_FILENAME_LENGTH];
-   char shaString[SHA_STRING_LENGTH];
-   char computedSHAString[SHA_STRING_LENGTH];
-   char thisFilename[THIS_FILE_FILENAME_LENGTH];
-   char firmwareVersionString[FIRMWARE_VERSION_STRING_LENGTH];
-   char commandLine[COMMAND_LINE_BUFFER_SIZE];
+   bool fanError = false;
+   int fanTachCount = 0;
+   int rc;
+   static bool is_error = false;
+   static uint32_t sequenceNumber = 0;
+   static bool keyframeSent = false;
+   static struct timespec lastKeyframeTime;
+   uint32_t heapAllocationsBefore = threadHeapAllocations;
+
+   // every field is written on every publish, so the previous message is overwritten rather
+   // than cleared; clearing would throw away the submessages and string buffers
+   CurrentSystemState &s = *cssMessage;
+   struct timeval now;
+   (void)gettimeofday(&now, NULL);
 
-   fp = fopen(manifestFilename, "r");
-   manifestFileLineCount = 0;
+   fanError = false;
+   // log an error if the tach value is 0 and the fan is on and it's more than 3 times in a row
+   fanTachCount = getFanTach(FAN1_INDEX);
+   if ((0 == fanTachCount) && (FAN_STATE_ON == fanInfo[FAN1_INDEX].fan_on) && (fanInfo[FAN1_INDEX].consecutive_tach_failures++ >= FAN_TACH_CONSECUTIVE_FAILURES))
+   {
+      fanError = true;
+      // turn the fan off - the only way to reset it is to turn it back on
+      (void)setFanOnOff(FAN1_INDEX, FAN_STATE_OFF);
+      if (fan1FailureOneShot)
+      {
+         syslog(LOG_ERR, "%s Fan 1 tach failure", FAN_FAILURE_ERROR_CODE);
+         (void)strncpy(errorCodeString, FAN_FAILURE_ERROR_CODE, sizeof(errorCodeString) - 1);
+         systemStatus = SYSTEM_STATUS_ERROR;
+         (void)logError(FAN_FAILURE_ERROR_CODE, "Fan 1", "Fan tach failure");
+         is_error = true;
+         fan1FailureOneShot = false;
+      }
+      (void)setFanOnOff(FAN1_INDEX, FAN_STATE_ON);
+   }
+   else if (fanTachCount)
+   {
+      fanInfo[FAN1_INDEX].consecutive_tach_failures = 0;
+   }
 
-   if (fp != NULL)
+   // log an error if the tach value is 0 and the fan is on
+   fanTachCount = getFanTach(FAN2_INDEX);
+   if ((0 == fanTachCount) && (FAN_STATE_ON == fanInfo[FAN2_INDEX].fan_on) && (fanInfo[FAN2_INDEX].consecutive_tach_failures++ >= FAN_TACH_CONSECUTIVE_FAILURES))
    {
-      while (!feof(fp))
+      fanError = true;
+      // turn the fan off - the only way to reset it is to turn it back on
+      (void)setFanOnOff(FAN2_INDEX, FAN_STATE_OFF);
+      if (fan2FailureOneShot)
       {
-         (void)memset(shaString, 0, SHA_STRING_LENGTH);
-         (void)memset(thisFilename, 0, THIS_FILE_FILENAME_LENGTH);
-         (void)memset(firmwareVersionString, 0, FIRMWARE_VERSION_STRING_LENGTH);
-         (void)memset(commandLine, 0, COMMAND_LINE_BUFFER_SIZE);
-         (void)memset(shaFile, 0, THIS_FILE_FILENAME_LENGTH);
+         syslog(LOG_ERR, "%s Fan 2 tach failure", FAN_FAILURE_ERROR_CODE);
+         (void)strncpy(errorCodeString, FAN_FAILURE_ERROR_CODE, sizeof(errorCodeString) - 2);
+         systemStatus = SYSTEM_STATUS_ERROR;
+         (void)logError(FAN_FAILURE_ERROR_CODE, "Fan 2", "Fan tach failure");
+         is_error = true;
+         fan2FailureOneShot = false;
+      }
+      (void)setFanOnOff(FAN2_INDEX, FAN_STATE_ON);
+   }
+   else if (fanTachCount)
+   {
+      fanInfo[FAN2_INDEX].consecutive_tach_failures = 0;
+   }
 
-         itemsRead = fscanf(fp, "%s %s %s", thisFilename, firmwareVersionString, shaString);
-         if (MANIFEST_FILE_ITEMS_PER_LINE == itemsRead)
-         {
-            manifestFileLineCount++;
-            if (!strncmp(thisFilename, FRONTIER_UHC_PACKAGE_FILENAME_ROOT, strlen(FRONTIER_UHC_PACKAGE_FILENAME_ROOT)))
-            {
-               manifestFileContainsFrontierUHC = true;
-            }
-            //(void)printf("itemsRead = %d\n", itemsRead);
-            (void)printf("Filename = %s\n", thisFilename);
-            (void)printf("firmwareVersionString = %s\n", firmwareVersionString);
-            (void)printf("shaString = %s\n", shaString);
-            (void)unlink(SHA_OUTPUT_FILE);
-            (void)snprintf(commandLine, sizeof(commandLine), SHA256_COMMAND, thisFilename, SHA_OUTPUT_FILE);
-            (void)system(commandLine);
-            //system("cat sha.out");
-            shaFP = fopen(SHA_OUTPUT_FILE, "r");
-            if (shaFP != NULL)
+   // if hardware A02 or greater, check both fans for current limit tripped
+   if (!fanError && (controllerBoardRevision > 0))
+   {
+      bool limitTripped = getFanCurrentLimit(FAN1_INDEX);
+      if (limitTripped)
+      {
+         fanInfo[FAN1_INDEX].current_limit_delay_count++;
+         if (fanInfo[FAN1_INDEX].current_limit_delay_count >= FAN_OVERCURRENT_DELAY_COUNT)
+         {
+            if (FAN_STATE_ON == fanInfo[FAN1_INDEX].fan_on)
             {
-               itemsRead = fscanf(shaFP, "%s %s", computedSHAString, shaFile);
-               (void)fclose(shaFP);
-               if (!strcmp(computedSHAString, shaString))
+               // turn the fan off - this should reset the current limit bit
+               (void)setFanOnOff(FAN1_INDEX, FAN_STATE_OFF);
+               fanInfo[FAN1_INDEX].current_limit_auto_correct_count++;
+               if (fan1CurrentLimitOneShot && (fanInfo[FAN1_INDEX].current_limit_auto_correct_count >= FAN_OVERCURRENT_AUTO_CORRECT_LIMIT))
                {
-                  (void)printf("SHA is valid for %s\n", shaFile);
+                  syslog(LOG_ERR, "%s Fan 1 current limit", FAN_OVERCURRENT_ERROR_CODE);
+                  (void)strncpy(errorCodeString, FAN_OVERCURRENT_ERROR_CODE, sizeof(errorCodeString) - 2);
+                  systemStatus = SYSTEM_STATUS_ERROR;
+                  (void)logError(FAN_OVERCURRENT_ERROR_CODE, "Fan 1", "Fan current limit");
+                  is_error = true;
+                  fan1CurrentLimitOneShot = false;
                }
-               else
+               if (fanInfo[FAN1_INDEX].current_limit_auto_correct_count < FAN_OVERCURRENT_AUTO_CORRECT_LIMIT)
                {
-                  (void)printf("SHA FAILED for %s\n", shaFile);
-                  ret = 1;
-                  break;
+                  (void)setFanOnOff(FAN1_INDEX, FAN_STATE_ON);
                }
             }
          }
-         else if (manifestFileLineCount > 0)
-         {
-            ret = 0;
-            break;
-         }
-         else
+      }
+      else
+      {
+         fanInfo[FAN1_INDEX].current_limit_delay_count = 0;
+         fanInfo[FAN1_INDEX].current_limit_auto_correct_count = 0;
+      }
+
+      limitTripped = getFanCurrentLimit(FAN2_INDEX);
+      if (limitTripped)
+      {
+         fanInfo[FAN2_INDEX].current_limit_delay_count++;
+         if (fanInfo[FAN2_INDEX].current_limit_delay_count >= FAN_OVERCURRENT_DELAY_COUNT)
          {
-            ret = 1;
-            break;
+            if (FAN_STATE_ON == fanInfo[FAN2_INDEX].fan_on)
+            {
+               // turn the fan off - this should reset the current limit bit
+               (void)setFanOnOff(FAN2_INDEX, FAN_STATE_OFF);
+               fanInfo[FAN2_INDEX].current_limit_auto_correct_count++;
+               if (fan2CurrentLimitOneShot && (fanInfo[FAN2_INDEX].current_limit_auto_correct_count >= FAN_OVERCURRENT_AUTO_CORRECT_LIMIT))
+               {
+                  syslog(LOG_ERR, "%s Fan 2 current limit", FAN_OVERCURRENT_ERROR_CODE);
+                  (void)strncpy(errorCodeString, FAN_OVERCURRENT_ERROR_CODE, sizeof(errorCodeString) - 2);
+                  systemStatus = SYSTEM_STATUS_ERROR;
+                  (void)logError(FAN_OVERCURRENT_ERROR_CODE, "Fan 2", "Fan current limit");
+                  is_error = true;
+                  fan2CurrentLimitOneShot = false;
+               }
+               if (fanInfo[FAN2_INDEX].current_limit_auto_correct_count < FAN_OVERCURRENT_AUTO_CORRECT_LIMIT)
+               {
+                  (void)setFanOnOff(FAN2_INDEX, FAN_STATE_ON);
+               }
+            }
          }
       }
-      (void)fclose(fp);
+      else
+      {
+         fanInfo[FAN2_INDEX].current_limit_delay_count = 0;
+         fanInfo[FAN2_INDEX].current_limit_auto_correct_count = 0;
+      }
    }
-   return ret;
-}
 
+   if (!softShutdownCheckOneshot)
+   {
+      if (access(SOFT_SHUTDOWN_FILE, F_OK) == 0)
+      {
+         (void)unlink(RM_SOFT_SHUTDOWN_FILE);
+      }
 
-/*******************************************************************************************/
-/*                                                                                         */
-/* int installPackages(char *manifestFilename)                                             */
-/*                                                                                         */
-/* Install all of the packages retrieved via SCP into /tmp.                                */
-/*                                                                                         */
-/* Returns: int ret - 0 = success, 1 = failure                                             */
-/*                                                                                         */
-/*******************************************************************************************/
-int installPackages(char *manifestFilename)
-{
-   FILE *fp = NULL;
-   int ret = 0;
-   int itemsRead = 0;
-   char shaString[SHA_STRING_LENGTH];
-   char thisFilename[THIS_FILE_FILENAME_LENGTH];
-   char firmwareVersionString[FIRMWARE_VERSION_STRING_LENGTH];
-   char commandLine[COMMAND_LINE_BUFFER_SIZE];
-   char installCommand[MAX_FILE_PATH];
-   char resultString[MAX_FILE_PATH];
-   uint32_t linesRead = 0;
+      softShutdownCheckOneshot = true;
+   }
 
-   // initialize the result buffer
-   (void)memset(firmwareUpdateResultBuffer, 0, sizeof(firmwareUpdateResultBuffer));
-   (void)memset(frontierUHCPackageFilename, 0, sizeof(frontierUHCPackageFilename));
-   processFrontierInstaller = false;
+   SENSOR_SNAPSHOT snapshot;
+   getSensorSnapshot(&snapshot);
 
-   // attempt to read the manifest file and process all of the packages listed in it
-   fp = fopen(manifestFilename, "r");
-   if (fp != NULL)
+   s.mutable_topic()->assign(CURRENT_SYSTEM_STATE_TOPIC);
+   s.mutable_system_data()->set_heatsink_temp(snapshot.temperature[HEATSINK_RTD_INDEX]);
+   // Vantron asked for the ambient temp to be added to the CSS even though the sensor for it won't be available until rev A02 hardware
+   s.mutable_system_data()->set_ambient_temp(snapshotAmbientTemp(&snapshot));
+   s.mutable_system_data()->set_fan_state1((uhc::FanState)fanInfo[0].fan_on);
+   s.mutable_system_data()->set_fan_state2((uhc::FanState)fanInfo[1].fan_on);
+   s.mutable_system_data()->mutable_current_time()->set_seconds(now.tv_sec);
+   s.mutable_system_data()->mutable_current_time()->set_nanos(now.tv_usec * 1000);
+   s.mutable_system_data()->mutable_system_up_time()->set_seconds(getSytemUptime());
+   s.mutable_system_data()->set_current_power_consumption(snapshot.irms);
+   s.mutable_system_data()->set_system_status(systemStatus);
+   s.mutable_system_data()->set_configured_eco_mode_temp(heaterInfo[0].eco_mode_setpoint);
+   s.mutable_system_data()->set_configured_eco_mode_minutes(15);
+   s.mutable_system_data()->set_eco_mode_state(ECO_MODE_OFF);
+   s.mutable_system_data()->set_shutdown_requested(false);
+   s.mutable_system_data()->set_last_command_received(lastCommandReceived);
+   s.mutable_system_data()->mutable_controller_ip_address()->assign(controllerIPAddress);
+   // CurrentSystemState reports the first two panels, the unused entries are all zero
+   s.mutable_system_data()->mutable_intelligent_glass_1_ip_address()->assign(guiSessions[0].ip_address);
+   s.mutable_system_data()->mutable_intelligent_glass_2_ip_address()->assign(guiSessions[1].ip_address);
+   s.mutable_system_data()->mutable_last_time_intelligent_glass_1_heard()->set_seconds(guiSessionSecondsSinceHeard(&guiSessions[0]));
+   s.mutable_system_data()->mutable_last_time_intelligent_glass_2_heard()->set_seconds((numGUISessions > 1) ? guiSessionSecondsSinceHeard(&guiSessions[1]) : 0);
+   s.set_hardware_revision((uint32_t)controllerBoardRevision);
+   s.mutable_system_data()->set_alarm_code(ALARM_CODE_NONE);
+   s.mutable_system_data()->set_heatsink_over_temp(heatsinkOvertemp);
+   if (ambientOvertemp)
    {
-      // process each file in listed in the manifest file
-      while (!feof(fp))
+      s.mutable_system_data()->set_alarm_code(ALARM_CODE_AMBIENT_OVER_TEMP);
+      is_error = true;
+   }
+   if (heatsinkOvertemp)
+   {
+      s.mutable_system_data()->set_alarm_code(ALARM_CODE_HEATSINK_OVER_TEMP);
+      is_error = true;
+   }
+
+   s.mutable_system_data()->set_heatsink_temp(snapshot.temperature[HEATSINK_RTD_INDEX]);
+   s.mutable_system_data()->set_logging_is_event_driven(loggingIsEventDriven);
+   s.mutable_system_data()->set_logging_period_seconds(loggingPeriodSeconds);
+   s.mutable_system_data()->set_nso_mode(nsoMode);
+   s.mutable_system_data()->set_demo_mode(demoMode);
+   s.mutable_system_data()->set_last_alarm_id(lastAlarmId);
+
+   // only start logging
+   if (getSytemUptime() > TWO_MINUTES_IN_SECONDS)
+   {
+      if (powerMonitorBad)
       {
-         (void)memset(shaString, 0, SHA_STRING_LENGTH);
-         (void)memset(thisFilename, 0, THIS_FILE_FILENAME_LENGTH);
-         (void)memset(firmwareVersionString, 0, FIRMWARE_VERSION_STRING_LENGTH);
-         (void)memset(commandLine, 0, COMMAND_LINE_BUFFER_SIZE);
+         if (powerMonitorBadOneShot)
+         {
+            s.mutable_system_data()->set_alarm_code(ALARM_CODE_HARDWARE_FAILURE);
+            syslog(LOG_ERR, "Hardware failure - power monitor");
+            (void)strncpy(errorCodeString, HARDWARE_FAILURE_ERROR_CODE, sizeof(errorCodeString) - 1);
+            systemStatus = SYSTEM_STATUS_ERROR;
+            alarmCode = ALARM_CODE_HARDWARE_FAILURE;
+            char descr_str[LOGERROR_DESCR_SIZE];
+            (void)snprintf(descr_str, sizeof(descr_str), "Hardware failure - power monitor");
+            (void)logError(HARDWARE_FAILURE_ERROR_CODE, "Hardware failure - power monitor", descr_str);
+            is_error = true;
+            powerMonitorBadOneShot = false;
+         }
+      }
+      else
+      {
+         powerMonitorBadOneShot = true;
+      }
 
-         itemsRead = fscanf(fp, "%s %s %s", thisFilename, firmwareVersionString, shaString);
-         if (MANIFEST_FILE_ITEMS_PER_LINE == itemsRead)
+      int numGUIsMissing = 0;
+      for (int i = 0; i < numGUISessions; i++)
+      {
+         GUI_SESSION *session = &guiSessions[i];
+         uint32_t secondsSinceHeard = guiSessionSecondsSinceHeard(session);
+         if (secondsSinceHeard >= GUI_NO_COMMUNICATION_TIME_LIMIT)
          {
-            linesRead++;
-            if (!strncmp(thisFilename, FRONTIER_UHC_PACKAGE_FILENAME_ROOT, strlen(FRONTIER_UHC_PACKAGE_FILENAME_ROOT)))
+            numGUIsMissing++;
+            if (session->missing_one_shot)
             {
-               // if this is the frontier-uhc package, skip it to process ALL other packages first
-               strncpy(frontierUHCPackageFilename, thisFilename, sizeof(frontierUHCPackageFilename)- 1);
-               continue;
+               s.mutable_system_data()->set_alarm_code(ALARM_CODE_INTELLIGENT_GLASS_FAILURE);
+               syslog(LOG_ERR, "%s Intelligent Glass %d - not heard from in more than %u seconds", SINGLE_GUI_COMM_LOSS_ERROR, session->panel_number, secondsSinceHeard);
+               (void)strncpy(errorCodeString, SINGLE_GUI_COMM_LOSS_ERROR, sizeof(errorCodeString) - 1);
+               systemStatus = SYSTEM_STATUS_ERROR;
+               char descr_str[LOGERROR_DESCR_SIZE];
+               (void)snprintf(descr_str, sizeof(descr_str), "not heard from in more than %u seconds", secondsSinceHeard);
+               char location[16];
+               (void)snprintf(location, sizeof(location), "Glass %d", session->panel_number);
+               (void)logError(SINGLE_GUI_COMM_LOSS_ERROR, location, descr_str);
+               is_error = true;
+               session->missing_one_shot = false;
             }
-            (void)memset(installCommand, 0, sizeof(installCommand));
-            (void)memset(resultString, 0, sizeof(resultString));
-            (void)snprintf(installCommand, sizeof(installCommand), DPKG_INSTALL_OVERWRITE_COMMAND, TEMP_DIRECTORY, thisFilename);
+         }
+      }
 
-            if (debugPrintf)
-            {
-               (void)printf("Attempting %s\n", installCommand);
-               syslog(LOG_NOTICE, "Attempting %s", installCommand);
-            }
+      if (numGUIsMissing == numGUISessions)
+      {
+         // all of the GUIs are down for more than 3 minutes
+         // per Shawn Thompson, shut down the unit.
+         // turn all heaters off
+         s.mutable_system_data()->set_alarm_code(ALARM_CODE_INTELLIGENT_GLASS_FAILURE);
+         for (int j = 0; j < NUM_HEATERS; j++)
+         {
+            (void)enableDisableHeater(j, HEATER_DISABLED);
+            (void)turnHeaterOnOff(j, HEATER_STATE_OFF);
+         }
 
-            // attempt to install this package
-            int result = system(installCommand);
-            // build the status for this file
-            if (result == 0)
-            {
-               (void)snprintf(resultString, sizeof(resultString), "%s %s\n", thisFilename, "Success");
-               syslog(LOG_NOTICE, "%s %s", thisFilename, "Success");
-            }
-            else
-            {
-               (void)snprintf(resultString, sizeof(resultString), "%s Failed %d\n", thisFilename, result >> 8);
-               syslog(LOG_ERR, "%s Failed %d", thisFilename, result >> 8);
-               (void)logError("", "System", resultString);
-            }
+         if (bothGuisMissingOneShot)
+         {
+            syslog(LOG_ERR, "%s All %d Intelligent Glass devices not heard from in more than %d seconds", BOTH_GUIS_COMM_LOSS_ERROR_CODE, numGUISessions, GUI_NO_COMMUNICATION_TIME_LIMIT);
+            syslog(LOG_ERR, "Heaters turned off and disabled");
+            (void)strncpy(errorCodeString, BOTH_GUIS_COMM_LOSS_ERROR_CODE, sizeof(errorCodeString) - 1);
+            systemStatus = SYSTEM_STATUS_ERROR;
+            char descr_str[LOGERROR_DESCR_SIZE];
+            (void)snprintf(descr_str, sizeof(descr_str), "not heard from in more than %d seconds", GUI_NO_COMMUNICATION_TIME_LIMIT);
+            (void)logError(BOTH_GUIS_COMM_LOSS_ERROR_CODE, "Glass both", descr_str);
+            is_error = true;
+            bothGuisMissingOneShot= false;
+         }
+      }
+   }
+
+   if ((false == ethernetUp) && (ethernetDownTimeSeconds >= ETHERNET_NO_COMMUNICATION_TIME_LIMIT))
+   {
+      // turn all heaters off
+      for (int j = 0; j < NUM_HEATERS; j++)
+      {
+         (void)enableDisableHeater(j, HEATER_DISABLED);
+         (void)turnHeaterOnOff(j, HEATER_STATE_OFF);
+      }
+      if (ethernetErrorOneShot)
+      {
+         ethernetErrorOneShot = false;
+         syslog(LOG_ERR, "%s Ethernet down", ETHERNET_DOWN_ERROR_CODE);
+         syslog(LOG_ERR, "Heaters turned off and disabled");
+         (void)strncpy(errorCodeString, ETHERNET_DOWN_ERROR_CODE, sizeof(errorCodeString) - 1);
+         systemStatus = SYSTEM_STATUS_ERROR;
+         (void)logError(ETHERNET_DOWN_ERROR_CODE, "Ethernet down", "Ethernet down");
+         is_error = true;
+      }
+   }
+   if (ethernetUp && !previousEthernetUp)
+   {
+      //printf("====================Ethernet Re-established =================\n");
+      syslog(LOG_NOTICE, "Ethernet back up");
+      (void)logError("", "Ethernet back up", "Ethernet back up");
+   }
+
+   for (int i = 0; i < TOTAL_SLOTS; i++)
+   {
+      if (s.slot_data_size() <= i)
+      {
+         (void)s.add_slot_data();
+      }
+      SlotNumber sn = static_cast<SlotNumber>(i+1);
+      SlotData* newSlotData = s.mutable_slot_data(i);
+      newSlotData->set_slot_number(sn);
+      newSlotData->mutable_heater_location_upper()->set_state((uhc::HeaterState)heaterInfo[i*2].state);
+      newSlotData->mutable_heater_location_upper()->set_location((uhc::HeaterLocation)heaterInfo[i*2].location);
+      newSlotData->mutable_heater_location_upper()->set_thermistor_temp(snapshot.temperature[i*2]);
+      newSlotData->mutable_heater_location_upper()->set_setpoint_temp(heaterInfo[i*2].temperature_setpoint);
+
+      uhc::LEDState led_state;
+      if (HEATER_STATE_ON == heaterInfo[i*2].state)
+      {
+         led_state = LED_STATE_RED;
+      }
+      else
+      {
+         led_state = LED_STATE_OFF;
+      }
+
+      newSlotData->mutable_heater_location_upper()->set_led_state(led_state);
+
+      if (snapshot.is_open[i*2])
+      {
+         newSlotData->mutable_heater_location_upper()->set_is_open(true);
+//            (void)printf("heater[%d] (upper) is open sequenceNumber %d\n", i*2, sequenceNumber + 1);
+         is_error = true;
+      }
+      else
+      {
+         newSlotData->mutable_heater_location_upper()->set_is_open(false);
+      }
+
+      if (snapshot.is_shorted[i*2])
+      {
+         newSlotData->mutable_heater_location_upper()->set_is_shorted(true);
+//            (void)printf("heater[%d] (upper) is shorted sequenceNumber %d\n", i*2, sequenceNumber + 1);
+         is_error = true;
+      }
+      else
+      {
+         newSlotData->mutable_heater_location_upper()->set_is_shorted(false);
+      }
+
+      if (heaterInfo[i*2].is_undertemp_CSS)
+      {
+         newSlotData->mutable_heater_location_upper()->set_is_undertemp(true);
+         s.mutable_system_data()->set_alarm_code(ALARM_CODE_SLOT_UNDER_TEMP);
+//            (void)printf("heater[%d] (upper) is undertemp sequenceNumber %d\n", i*2, sequenceNumber + 1);
+         is_error = true;
+      }
+      else
+      {
+         newSlotData->mutable_heater_location_upper()->set_is_undertemp(false);
+      }
+
+      if (heaterInfo[i*2].is_overtemp_CSS)
+      {
+         newSlotData->mutable_heater_location_upper()->set_is_overtemp(true);
+         s.mutable_system_data()->set_alarm_code(ALARM_CODE_SLOT_OVER_TEMP);
+//            (void)printf("heater[%d] (upper) is overtemp sequenceNumber %d\n", i*2, sequenceNumber + 1);
+         is_error = true;
+      }
+      else
+      {
+         newSlotData->mutable_heater_location_upper()->set_is_overtemp(false);
+      }
+
+      if (heaterInfo[i*2].is_enabled)
+      {
+         newSlotData->mutable_heater_location_upper()->set_is_enabled(true);
+      }
+      else
+      {
+         newSlotData->mutable_heater_location_upper()->set_is_enabled(false);
+      }
+
+      newSlotData->mutable_heater_location_upper()->mutable_start_time()->set_seconds(heaterInfo[i*2].start_time.seconds());
+      newSlotData->mutable_heater_location_upper()->mutable_end_time()->set_seconds(heaterInfo[i*2].end_time.seconds());
+
+      newSlotData->mutable_heater_location_lower()->set_state((uhc::HeaterState)heaterInfo[(i*2)+1].state);
+      newSlotData->mutable_heater_location_lower()->set_location((uhc::HeaterLocation)heaterInfo[(i*2)+1].location);
+      newSlotData->mutable_heater_location_lower()->set_thermistor_temp(snapshot.temperature[(i*2)+1]);
+      newSlotData->mutable_heater_location_lower()->set_setpoint_temp(heaterInfo[(i*2)+1].temperature_setpoint);
+
+      if (HEATER_STATE_ON == heaterInfo[(i*2)+1].state)
+      {
+         led_state = LED_STATE_RED;
+      }
+      else
+      {
+         led_state = LED_STATE_OFF;
+      }
+
+      newSlotData->mutable_heater_location_lower()->set_led_state(led_state);
+
+      if (snapshot.is_open[(i*2)+1])
+      {
+         newSlotData->mutable_heater_location_lower()->set_is_open(true);
+//            (void)printf("heater[%d] (lower) is open sequenceNumber %d\n", (i*2)+1, sequenceNumber + 1);
+         is_error = true;
+      }
+      else
+      {
+         newSlotData->mutable_heater_location_lower()->set_is_open(false);
+      }
+
+      if (snapshot.is_shorted[(i*2)+1])
+      {
+         newSlotData->mutable_heater_location_lower()->set_is_shorted(true);
+//            (void)printf("heater[%d] (lower) is shorted sequenceNumber %d\n", (i*2)+1, sequenceNumber + 1);
+         is_error = true;
+      }
+      else
+      {
+         newSlotData->mutable_heater_location_lower()->set_is_shorted(false);
+      }
+
+      if (heaterInfo[(i*2)+1].is_undertemp_CSS)
+      {
+         newSlotData->mutable_heater_location_lower()->set_is_undertemp(true);
+         s.mutable_system_data()->set_alarm_code(ALARM_CODE_SLOT_UNDER_TEMP);
+//            (void)printf("heater[%d] (lower) is undertemp sequenceNumber %d\n", (i*2)+1, sequenceNumber + 1);
+         is_error = true;
+      }
+      else
+      {
+         newSlotData->mutable_heater_location_lower()->set_is_undertemp(false);
+      }
+
+      if (heaterInfo[(i*2)+1].is_overtemp_CSS)
+      {
+         newSlotData->mutable_heater_location_lower()->set_is_overtemp(true);
+         s.mutable_system_data()->set_alarm_code(ALARM_CODE_SLOT_OVER_TEMP);
+//            (void)printf("heater[%d] (lower) is overtemp sequenceNumber %d\n", (i*2)+1, sequenceNumber + 1);
+         is_error = true;
+      }
+      else
+      {
+         newSlotData->mutable_heater_location_lower()->set_is_overtemp(false);
+      }
+
+      if (heaterInfo[(i*2)+1].is_enabled)
+      {
+         newSlotData->mutable_heater_location_lower()->set_is_enabled(true);
+      }
+      else
+      {
+         newSlotData->mutable_heater_location_lower()->set_is_enabled(false);
+      }
+
+      newSlotData->mutable_heater_location_lower()->mutable_start_time()->set_seconds(heaterInfo[(i*2)+1].start_time.seconds());
+      newSlotData->mutable_heater_location_lower()->mutable_end_time()->set_seconds(heaterInfo[(i*2)+1].end_time.seconds());
+   }
+
+   s.mutable_serial_number()->assign(serialNumber);
+   s.mutable_model_number()->assign(modelNumber);
+   s.mutable_firmware_version()->assign(FRONTIER_UHC_FIRMWARE_VERSION);
+   s.set_sequence_number(sequenceNumber++);
+   s.mutable_system_data()->mutable_hp_error_code()->assign(errorCodeString);
+   if (strlen(errorCodeString) != 0)
+   {
+      errorReportCount++;
+      if (errorReportCount > REPORT_ERROR_COUNT)
+      {
+         (void)memset(errorCodeString, 0, sizeof(errorCodeString));
+         errorReportCount = 0;
+      }
+   }
 
-            // once we've processed a file, remove it from /tmp
-            char removeFilename[MAX_FILE_PATH];
-            (void)memset(removeFilename, 0, sizeof(removeFilename));
-            (void)snprintf(removeFilename, sizeof(removeFilename), "%s/%s", TEMP_DIRECTORY, thisFilename);
-            (void)unlink(removeFilename);
+   if (is_error && debugCSS)
+   {
+      cout << "Packet contains error state Serialization:\n\n" << s.DebugString() << "\n\n";
+      s.PrintDebugString();
+   }
 
-            // append the status for this file to previous results
-            (void)strcat(firmwareUpdateResultBuffer, resultString);
-         }
+   struct timespec cpuStart;
+   (void)clock_gettime(CLOCK_THREAD_CPUTIME_ID, &cpuStart);
+
+   size_t fullLength = s.ByteSizeLong();
+   bool keyframe = true;
+   bool systemDataChanged = false;
+   bool slotChanged[TOTAL_SLOTS];
+   if (cssDelta)
+   {
+      // look for changes on every publish so each delta is relative to the message before it
+      findSystemStateChanges(s, &systemDataChanged, slotChanged);
+      cssFullEquivalentBytes += fullLength;
+
+      struct timespec monotonicNow;
+      (void)clock_gettime(CLOCK_MONOTONIC, &monotonicNow);
+      keyframe = !keyframeSent || cssKeyframeRequested.exchange(false) ||
+                 (timespecDiffMicroseconds(&monotonicNow, &lastKeyframeTime) >= ((int64_t)CSS_KEYFRAME_INTERVAL_SECONDS * ONE_SECOND_IN_MICROSECONDS));
+      if (keyframe)
+      {
+         keyframeSent = true;
+         lastKeyframeTime = monotonicNow;
       }
    }
+
+   // serialize straight into the send buffer
+   size_t length = fullLength;
+   bool serialized;
+   CSS_STREAM_STATS *streamStats = &cssFullStats;
+   if (keyframe)
+   {
+      serialized = (length <= sizeof(cssSerializeBuffer)) && s.SerializeToArray(cssSerializeBuffer, (int)length);
+   }
    else
    {
-      (void)snprintf(firmwareUpdateResultBuffer, sizeof(firmwareUpdateResultBuffer), "Could not open manifest file %s %s\n", manifestFilename, "Failed");
-      syslog(LOG_NOTICE, "Could not open manifest file %s %s\n", manifestFilename, "Failed");
-      ret = 1;
+      serialized = serializeSystemStateDelta(s, systemDataChanged, slotChanged, &length);
+      streamStats = &cssDeltaStats;
    }
 
-   return ret;
+   struct timespec cpuEnd;
+   (void)clock_gettime(CLOCK_THREAD_CPUTIME_ID, &cpuEnd);
+
+   // only building and serializing are counted, zmq_send's copy of the frame is libzmq's
+   cssHeapAllocations = threadHeapAllocations - heapAllocationsBefore;
+   if ((cssHeapAllocations > 0) && (sequenceNumber > 1))
+   {
+      cssHeapAllocatingPublishes++;
+   }
+
+   if (!serialized)
+   {
+      if (debugPrintf)
+      {
+         cerr << "ERROR: Unable to serialize!\n";
+      }
+      syslog(LOG_ERR, "statusPublisherThread ERROR: Unable to serialize %u bytes!", (uint32_t)length);
+      (void)logError("", "statusPublisherThread", "unable to serialize");
+      return;
+   }
+
+   rc = zmq_send(statusPublisher, cssSerializeBuffer, length, 0);
+   assert(rc == (int)length);
+
+   streamStats->messages++;
+   streamStats->bytes += length;
+   streamStats->cpu_nanoseconds += (uint64_t)(((int64_t)(cpuEnd.tv_sec - cpuStart.tv_sec) * 1000000000LL) + (cpuEnd.tv_nsec - cpuStart.tv_nsec));
+
+   if (debugPrintf)
+   {
+      cout << "Bytes sent: " << rc << "  protobuf/arena allocations: " << cssHeapAllocations << "\n";
+   }
 }
 
 
 /*******************************************************************************************/
 /*                                                                                         */
-/* void *firmwareUpdatePackageThread(void *)                                               */
+/* void *statusPublisherThread(void *)                                                     */
 /*                                                                                         */
-/* Handle the frontier-uhc firmware update package. Note that invoking dpkg to install     */
-/* frontier-uhc will cause this instance of the application to be killed off so that the   */
-/* installer can overwrite the executable.                                                 */
+/* Once per second, read the system data (RTD temps, fan status, etc) and publish it.      */
 /*                                                                                         */
 /* Returns: pthread_exit(NULL)                                                             */
 /*                                                                                         */
 /*******************************************************************************************/
-void *firmwareUpdatePackageThread(void *)
+void *statusPublisherThread(void *)
 {
-   char installCommand[COMMAND_LINE_BUFFER_SIZE];
+   openStatusPublisher();
 
+   initPeriodicTask(&statusPublisherTask, "statusPublisherThread", ONE_SECOND_IN_MICROSECONDS);
    numThreadsRunning++;
-   while (!sigTermReceived)
+   while(!sigTermReceived)
    {
-      if (processFrontierInstaller)
-      {
-         (void)memset(installCommand, 0, sizeof(installCommand));
-         (void)snprintf(installCommand, strlen(DPKG_INSTALL_OVERWRITE_COMMAND) + strlen(TEMP_DIRECTORY) + strlen(frontierUHCPackageFilename) + 1, DPKG_INSTALL_OVERWRITE_COMMAND, TEMP_DIRECTORY, frontierUHCPackageFilename);
-
-         if (debugPrintf)
-         {
-            (void)printf("Attempting %s\n", installCommand);
-            syslog(LOG_NOTICE, "Attempting %s", installCommand);
-         }
-
-         // attempt to install this package
-         (void)system(installCommand);
-         (void)printf("firmwareUpdatePackageThread return from system command %s - Rebooting device\n", installCommand);
-         processFrontierInstaller = false;
-         sleep(1);
-         (void)system(REBOOT_COMMAND);
-      }
-      sleep(1);
+      publishSystemState();
+      waitPeriodicTask(&statusPublisherTask);
    }
+
    numThreadsRunning--;
    pthread_exit(NULL);
 }
@@ -4320,1038 +7474,899 @@ void *firmwareUpdatePackageThread(void *)
 
 /*******************************************************************************************/
 /*                                                                                         */
-/* void *firmwareUpdateListenerThread(void *)                                              */
+/* void openRTDPublisher()                                                                 */
 /*                                                                                         */
-/* Listen for a FirmwareUpdate message. Fetch the update files via SCP int /tmp and        */
-/* install them. Build and send the FirmwareResponse message.                              */
+/* Creates and binds the RTD data publisher socket.                                        */
 /*                                                                                         */
-/* Returns: pthread_exit(NULL)                                                             */
+/* Returns: None                                                                           */
 /*                                                                                         */
 /*******************************************************************************************/
-void *firmwareUpdateListenerThread(void *)
+void openRTDPublisher()
 {
-   char message[FIRMWARE_UPDATE_BUFFER_SIZE];
-   char escapedFullFilePath[MAX_FILE_PATH];
-   firmwareUpdateResponsePublisher = zmq_socket(context, ZMQ_PUB);
-   assert(firmwareUpdateResponsePublisher != 0);
-
-   char ig1CommandRespPubPort[IP_STRING_SIZE + 14];   // Allow space for the tcp:// and :portnumber
-   char ig1CommandReqSubPort[IP_STRING_SIZE + 14];    // Allow space for the tcp:// and :portnumber
-   (void)snprintf(ig1CommandRespPubPort, sizeof(ig1CommandRespPubPort), "tcp://%s:%d", controllerIPAddress, FIRMWARE_UPDATE_RESULT_PORT_CONTROLLER);
-   (void)snprintf(ig1CommandReqSubPort, sizeof(ig1CommandReqSubPort), "tcp://%s:%d", guiIPAddress1, FIRMWARE_UPDATE_PORT_GUI1);
-   (void)printf("firmwareUpdateListenerThread ig1CommandRespPubPort = %s\n", ig1CommandRespPubPort);
-   (void)printf("firmwareUpdateListenerThread ig1CommandReqSubPort = %s\n", ig1CommandReqSubPort);
-
-    int rs = zmq_bind(firmwareUpdateResponsePublisher, ig1CommandRespPubPort);
-    assert(rs == 0);
+   char rtdPublisherPort[IP_STRING_SIZE + 14];  // Allow space for the tcp:// and :portnumber
+   (void)snprintf(rtdPublisherPort, sizeof(rtdPublisherPort), "tcp://%s:%d", controllerIPAddress, RTD_DATA_PUBLISHER_PORT);
+   (void)printf("rtdPublisherThread rtdPublisherPort = %s\n", rtdPublisherPort);
 
-   firmwareUpdateListener = zmq_socket(context, ZMQ_SUB);
-   assert(firmwareUpdateListener != 0);
+   rtdPublisher = zmq_socket(context, ZMQ_PUB);
+   assert(rtdPublisher != 0);
 
-   const char messageType[] = { 10, 4, 'F', 'W', 'U', 'P' };
-   int rc = zmq_setsockopt(firmwareUpdateListener, ZMQ_SUBSCRIBE, messageType, sizeof(messageType));
+   int rc = zmq_bind(rtdPublisher, rtdPublisherPort);
    assert(rc == 0);
+}
 
-   int noTimeout = -1;
-   rc = zmq_setsockopt(firmwareUpdateListener, ZMQ_RCVTIMEO, &noTimeout, sizeof(noTimeout));
-   assert(rc == 0);
 
-   rc = zmq_connect(firmwareUpdateListener, ig1CommandReqSubPort);
-   assert(rc == 0);
+/*******************************************************************************************/
+/*                                                                                         */
+/* void publishRTDs()                                                                      */
+/*                                                                                         */
+/* Publishes the raw counts, temperatures and open/shorted state of every RTD. Called once */
+/* per second.                                                                             */
+/*                                                                                         */
+/* Returns: None                                                                           */
+/*                                                                                         */
+/*******************************************************************************************/
+void publishRTDs()
+{
+   char bytes[DEFAULT_RTD_MESSAGE_BUFFER_SIZE];
+   int rc;
+   static uint32_t sequenceNumber = 0;
 
-   (void)sleep(1);
+   ReadRTDs s;
+   SENSOR_SNAPSHOT snapshot;
+   getSensorSnapshot(&snapshot);
 
-   uint32_t sequenceNumber = 0U;
+   s.set_topic(RTD_DATA_PUBLISHER_TOPIC);
+   s.set_hardware_revision((uint32_t)controllerBoardRevision);
+   s.set_controller_ip_address(controllerIPAddress);
 
-   numThreadsRunning++;
-   while(!sigTermReceived)
+   for (int i = 0; i < NUM_RTDs; i++)
    {
-      (void)memset(message, 0, sizeof(message));
-      (void)memset(escapedFullFilePath, 0, sizeof(escapedFullFilePath));
-
-      rc = zmq_recv(firmwareUpdateListener, message, sizeof(message), 0);
-      if (rc == -1)
-      {
-         continue;
-      }
-
-      // Deserialization
-      string s(message, rc);
-      FirmwareUpdate deserialized;
-      if (!deserialized.ParseFromString(s))
-      {
-         if (debugPrintf)
-         {
-            cerr << "firmwareUpdateListenerThread ERROR: Unable to deserialize!\n";
-         }
-
-         syslog(LOG_ERR, "firmwareUpdateListenerThread: Unable to deserialize!");
-         (void)logError("", "firmwareUpdateListenerThread", "Unable to deserialize");
-      }
-
-      if (debugPrintf)
-      {
-         cout << "Deserialization:\n";
-         deserialized.PrintDebugString();
-
-         cout << "        sender IP address: " << deserialized.sender_ip_address() << "\n";
-         cout << "          sequence number: " << deserialized.sequence_number() << "\n";
-         cout << "                 username: " << deserialized.username() << "\n";
-         cout << "                 password: " << deserialized.password() << "\n";
-         cout << "                file path: " << deserialized.file_path() << "\n";
-      }
-
-      // init the SSH keys
-      int ret = sshKeyscan();
+      (void)s.add_rtd_data();
+      RTDData* newRTDData = s.mutable_rtd_data(i);
+      newRTDData->set_rtd_number((uint32_t)i+1);
+      newRTDData->set_location(labels[i]);
+      // a failed read has always gone out as 65535 counts, keep it that way for the GUIs
+      uint16_t rawCounts = (uint16_t)snapshot.raw_counts[i];
+      newRTDData->set_raw_counts((uint32_t)rawCounts);
+      newRTDData->set_temperature((int32_t)snapshot.temperature[i]);
+      newRTDData->set_temperature_tenths((int32_t)snapshot.temperature_tenths[i]);
+      newRTDData->set_voltage(((float)rawCounts * 1.8) / 4096.0);
+      newRTDData->set_temp_data_filename(rtdMappings[i].temp_data_filename);
 
-      if (0 == ret)
+      if (snapshot.is_open[i])
       {
-         // fetch
-         char user[deserialized.username().length()+1];
-         (void)memset(user, 0, sizeof(user));
-         (void)memcpy(user, (const void*)deserialized.username().c_str(), deserialized.username().length());
-
-         char password[deserialized.password().length()+1];
-         (void)memset(password, 0, sizeof(password));
-         (void)memcpy(password, (const void*)deserialized.password().c_str(), deserialized.password().length());
-
-         char path[deserialized.file_path().length()+1];
-         (void)memset(path, 0, sizeof(path));
-         (void)memcpy(path, (const void*)deserialized.file_path().c_str(), deserialized.file_path().length());
-
-         // handle any spaces in the provided file path and append *.deb to the end for the scp
-         escapeSpaces(path, escapedFullFilePath);
-
-         ret = getUpdateFiles(user, password, escapedFullFilePath);
-
-         if (0 == ret)
-         {
-            // Clear result buffer before starting.
-            (void)memset(firmwareUpdateResultBuffer, 0, sizeof(firmwareUpdateResultBuffer));
-
-            // check the manifest file and validate packages
-            ret = checkManifest(controllerManifestFilename);
-
-            if (0 != ret)
-            {
-               (void)snprintf(firmwareUpdateResultBuffer, sizeof(firmwareUpdateResultBuffer), "%s\n", "checkManifest Failed");
-               syslog(LOG_ERR, "checkManifest Failed");
-               (void)logError("", "firmwareUpdateListenerThread", "checkManifest failed");
-            }
-            else
-            {
-               // install
-               ret = installPackages(controllerManifestFilename);
-
-               if (0 != ret)
-               {
-                  (void)snprintf(firmwareUpdateResultBuffer, sizeof(firmwareUpdateResultBuffer), "%s\n", "installPackages Failed");
-                  syslog(LOG_ERR, "installPackages Failed");
-                  (void)logError("", "firmwareUpdateListenerThread", "installPackages failed");
-               }
-            }
-         }
-         else
-         {
-            (void)snprintf(firmwareUpdateResultBuffer, sizeof(firmwareUpdateResultBuffer), "%s\n", "getUpdateFiles Failed");
-            syslog(LOG_ERR, "getUpdateFiles Failed");
-            (void)logError("", "firmwareUpdateListenerThread", "getUpdateFiles failed");
-         }
+         newRTDData->set_is_open(true);
       }
       else
       {
-         (void)snprintf(firmwareUpdateResultBuffer, sizeof(firmwareUpdateResultBuffer), "%s\n", "sshKeyscan Failed");
-         syslog(LOG_ERR, "sshKeyscan Failed");
-         (void)logError("", "firmwareUpdateListenerThread", "sshKeyscan failed");
-      }
-
-      // now that we've processed all other packages successfully, if the manifest contains the frontier-uhc package
-      // set send the FWRS message
-      // process the frontier-uhc package LAST
-      if (manifestFileContainsFrontierUHC && (0 == ret))
-      {
-         // installed correctly. Since we get killed off by dpkg, we can't
-         // report failure anyway
-         char resultString[MAX_FILE_PATH];
-         (void)memset(resultString, 0, sizeof(resultString));
-         (void)snprintf(resultString, strlen("%s %s\n") + strlen(frontierUHCPackageFilename) + strlen("Success") + 1, "%s %s\n", frontierUHCPackageFilename, "Success");
-         // append the status for this file to previous results
-         (void)strcat(firmwareUpdateResultBuffer, resultString);
-         syslog(LOG_NOTICE, "%s %s", frontierUHCPackageFilename, "Success");
+         newRTDData->set_is_open(false);
       }
-      // Publish ZeroMQ FirmwareUpdateResult message here
-      FirmwareUpdateResult cr;
-      cr.set_topic("FWRS");
-      cr.set_controller_ip_address(controllerIPAddress);
-      cr.set_sequence_number(sequenceNumber++);
-      string resultString(firmwareUpdateResultBuffer);
-
-      if (debugPrintf)
+      if (snapshot.is_shorted[i])
       {
-         (void)printf("firmwareUpdateResultBuffer = \n%s\n", firmwareUpdateResultBuffer);
+         newRTDData->set_is_shorted(true);
       }
-
-      cr.set_result_text(resultString);
-
-      string serialized;
-      if ( !cr.SerializeToString( &serialized ) )
+      else
       {
-         if (debugPrintf)
-         {
-            cerr << "firmwareUpdateListenerThread ERROR: Unable to serialize!\n";
-         }
-         syslog(LOG_ERR, "firmwareUpdateListenerThread: Unable to serialize!");
-         (void)logError("", "firmwareUpdateListenerThread", "Unable to serialize");
+         newRTDData->set_is_shorted(false);
       }
+   }
 
-      char bytes[serialized.length()];
-      (void)memcpy(bytes, serialized.data(), serialized.length());
-
-      rs = zmq_send(firmwareUpdateResponsePublisher, bytes, serialized.length(), 0);
-      assert(rs == (int)serialized.length());
+   s.set_scan_time_us(rtdScanTimeMicroseconds);
+   s.set_max_scan_time_us(rtdScanTimeMaxMicroseconds);
+   s.set_heater_latency_us(heaterLatencyMicroseconds);
+   s.set_max_heater_latency_us(heaterLatencyMaxMicroseconds);
+   s.set_heater_scan_timeouts(heaterScanTimeouts);
+   s.set_sequence_number(sequenceNumber++);
+   if (debugCSS)
+   {
+      cout << "Packet contains error state Serialization:\n\n" << s.DebugString() << "\n\n";
+      s.PrintDebugString();
+   }
 
-      if (debugPrintf)
-      {
-         cout << "Bytes sent: " << rs << "\n";
-      }
-      // now that we've processed all other packages, if the manifest contains the frontier-uhc package
-      // set the flag that the firmwareUpdatePackageThread is looking for.
-      // process the frontier-uhc package LAST
-      if (manifestFileContainsFrontierUHC)
+   string serialized;
+   if (!s.SerializeToString(&serialized))
+   {
+      if (debugPrintf)
       {
-         processFrontierInstaller = true;
+         cerr << "ERROR: Unable to serialize!\n";
+         syslog(LOG_ERR, "rtdPublisherThread ERROR: Unable to serialize!");
+         (void)logError("", "rtdPublisherThread", "unable to serialize");
       }
    }
 
-   numThreadsRunning--;
-   pthread_exit(NULL);
+   memset(bytes, 0, DEFAULT_RTD_MESSAGE_BUFFER_SIZE);
+   (void)memcpy(bytes, serialized.data(), serialized.length());
+
+   rc = zmq_send(rtdPublisher, bytes, serialized.length(), 0);
+   assert(rc == (int)serialized.length());
+
+   if (debugPrintf)
+   {
+      cout << "Bytes sent: " << rc << "\n";
+   }
 }
 
 
 /*******************************************************************************************/
 /*                                                                                         */
-/* void *heartBeatListenerThread(void *)                                                   */
+/* uint32_t readRTDStreamRate()                                                            */
 /*                                                                                         */
-/* Listen for a HeartBeat message from the primary GUI device.                             */
+/* Reads the RTD stream rate from RTD_STREAM_RATE_FILE. Rates outside RTD_STREAM_MIN_HZ    */
+/* to RTD_STREAM_MAX_HZ are clamped to that range.                                         */
 /*                                                                                         */
-/* Returns: pthread_exit(NULL)                                                             */
+/* Returns: uint32_t scans per second, 0 if the file is missing or doesn't hold a rate     */
 /*                                                                                         */
 /*******************************************************************************************/
-void *heartBeatListenerThread(void *)
+uint32_t readRTDStreamRate()
 {
-   char message[DEFAULT_MESSAGE_BUFFER_SIZE];
-   heartBeatListener = zmq_socket(context, ZMQ_SUB);
-   assert(heartBeatListener != 0);
+   if (access(RTD_STREAM_RATE_FILE, F_OK) != 0)
+   {
+      return 0;
+   }
 
-   char heartbeatPort[IP_STRING_SIZE + 14];  // Allow space for the tcp:// and :portnumber
-   (void)snprintf(heartbeatPort, sizeof(heartbeatPort), "tcp://%s:%d", guiIPAddress1, HEARTBEAT_PORT_GUI1);
-   (void)printf("heartBeatListenerThread heartbeatPort = %s\n", heartbeatPort);
+   FILE *fp = fopen(RTD_STREAM_RATE_FILE, "r");
+   if (NULL == fp)
+   {
+      return 0;
+   }
 
-   char messageType[] = { 10, 2, 'H', 'B' };
-   int rc = zmq_setsockopt(heartBeatListener, ZMQ_SUBSCRIBE, messageType, sizeof(messageType));
-   assert(rc == 0);
+   int rate = 0;
+   if (fscanf(fp, "%d", &rate) != 1)
+   {
+      rate = 0;
+   }
+   (void)fclose(fp);
 
-   int noTimeout = -1;
-   rc = zmq_setsockopt(heartBeatListener, ZMQ_RCVTIMEO, &noTimeout, sizeof(noTimeout));
-   assert(rc == 0);
+   if (rate <= 0)
+   {
+      return 0;
+   }
+   if (rate < RTD_STREAM_MIN_HZ)
+   {
+      rate = RTD_STREAM_MIN_HZ;
+   }
+   if (rate > RTD_STREAM_MAX_HZ)
+   {
+      rate = RTD_STREAM_MAX_HZ;
+   }
 
-   rc = zmq_connect(heartBeatListener, heartbeatPort);
-   assert(rc == 0);
+   return (uint32_t)rate;
+}
 
-   (void)sleep(1);
 
-   numThreadsRunning++;
-   while(!sigTermReceived)
+/*******************************************************************************************/
+/*                                                                                         */
+/* uint32_t rtdStreamScansPerSecond(uint32_t requestedHz)                                  */
+/*                                                                                         */
+/* Works out how many RTD scans a second readADCThread can actually run for a requested    */
+/* stream rate. Streaming needs IIO buffered capture, since a scan through the sysfs text  */
+/* files takes about 85 ms. Otherwise the rate is capped so the last scan fits in          */
+/* RTD_STREAM_SCAN_PERIOD_PERCENT of the period, and streaming is refused if that is below */
+/* RTD_STREAM_MIN_HZ.                                                                      */
+/*                                                                                         */
+/* Returns: uint32_t scans per second, 1 when not streaming                                */
+/*                                                                                         */
+/*******************************************************************************************/
+uint32_t rtdStreamScansPerSecond(uint32_t requestedHz)
+{
+   if ((0 == requestedHz) || !iioBufferedCapture)
    {
-      (void)memset(message, 0, sizeof(message));
-      rc = zmq_recv(heartBeatListener, message, sizeof(message), 0);
-      if (rc == -1)
-      {
-         continue;
-      }
-
-      // Deserialization
-      string s(message, rc);
-      HeartBeat deserialized;
-      if (!deserialized.ParseFromString(s))
-      {
-         if (debugPrintf)
-         {
-            cerr << "ERROR: Unable to deserialize!\n";
-            syslog(LOG_ERR, "heartBeatListenerThread ERROR: Unable to deserialize!");
-            (void)logError("", "heartBeatListenerThread", "Unable to deserialize");
-         }
-      }
-
-      if (debugPrintf)
-      {
-         cout << "Deserialization:\n";
-         deserialized.PrintDebugString();
+      return 1;
+   }
 
-         cout << "        sender IP address: " << deserialized.sender_ip_address() << "\n";
-         cout << "          sequence number: " << deserialized.sequence_number() << "\n";
-      }
+   uint32_t periodNeeded = (rtdScanTimeMicroseconds * 100) / RTD_STREAM_SCAN_PERIOD_PERCENT;
+   if (0 == periodNeeded)
+   {
+      return requestedHz;
+   }
 
-      lastTimeGUI1Heard = 0;
-      gui1MissingOneShot = true;
-      bothGuisMissingOneShot = true;
+   uint32_t maxHz = ONE_SECOND_IN_MICROSECONDS / periodNeeded;
+   if (maxHz < RTD_STREAM_MIN_HZ)
+   {
+      return 1;
    }
 
-   numThreadsRunning--;
-   pthread_exit(NULL);
+   return (requestedHz < maxHz) ? requestedHz : maxHz;
 }
 
 
 /*******************************************************************************************/
 /*                                                                                         */
-/* void *heartBeatListenerThread2(void *)                                                  */
+/* void openRTDStreamPublisher()                                                           */
 /*                                                                                         */
-/* Listen for a HeartBeat message from the secondary GUI device.                           */
+/* Creates and binds the RTDStream publisher socket. Only rtdStreamThread uses it.         */
 /*                                                                                         */
-/* Returns: pthread_exit(NULL)                                                             */
+/* Returns: None                                                                           */
 /*                                                                                         */
 /*******************************************************************************************/
-void *heartBeatListenerThread2(void *)
+void openRTDStreamPublisher()
 {
-   char message[DEFAULT_MESSAGE_BUFFER_SIZE];
-   heartBeatListener2 = zmq_socket(context, ZMQ_SUB);
-   assert(heartBeatListener2 != 0);
+   char rtdStreamPort[IP_STRING_SIZE + 14];  // Allow space for the tcp:// and :portnumber
+   (void)snprintf(rtdStreamPort, sizeof(rtdStreamPort), "tcp://%s:%d", controllerIPAddress, RTD_STREAM_PORT);
+   (void)printf("rtdStreamThread rtdStreamPort = %s\n", rtdStreamPort);
 
-   char heartbeatPort[IP_STRING_SIZE + 14];  // Allow space for the tcp:// and :portnumber
-   (void)snprintf(heartbeatPort, sizeof(heartbeatPort), "tcp://%s:%d", guiIPAddress2, HEARTBEAT_PORT_GUI2);
-   (void)printf("heartBeatListenerThread2 heartbeatPort = %s\n", heartbeatPort);
+   rtdStreamPublisher = zmq_socket(context, ZMQ_PUB);
+   assert(rtdStreamPublisher != 0);
 
-   char messageType[] = { 10, 2, 'H', 'B' };
-   int rc = zmq_setsockopt(heartBeatListener2, ZMQ_SUBSCRIBE, messageType, sizeof(messageType));
+   int rc = zmq_bind(rtdStreamPublisher, rtdStreamPort);
    assert(rc == 0);
+}
 
-   int noTimeout = -1;
-   rc = zmq_setsockopt(heartBeatListener2, ZMQ_RCVTIMEO, &noTimeout, sizeof(noTimeout));
-   assert(rc == 0);
 
-   rc = zmq_connect(heartBeatListener2, heartbeatPort);
-   assert(rc == 0);
+/*******************************************************************************************/
+/*                                                                                         */
+/* void publishRTDStream(const RTD_STREAM_BATCH *batch)                                    */
+/*                                                                                         */
+/* Publishes a batch of RTD scans as one RTDStream message. The raw counts and             */
+/* temperatures go out as packed arrays; the location labels and calibration filenames     */
+/* only when a filename has changed or RTD_STREAM_DESCRIPTOR_SECONDS have passed.          */
+/*                                                                                         */
+/* Returns: None                                                                           */
+/*                                                                                         */
+/*******************************************************************************************/
+void publishRTDStream(const RTD_STREAM_BATCH *batch)
+{
+   char bytes[RTD_STREAM_MESSAGE_BUFFER_SIZE];
+   static RTDStream s;              // reused so the arrays keep their capacity
+   static uint32_t sequenceNumber = 0;
+   static uint32_t descriptorVersion = 0;
+   static char sentFilenames[NUM_RTDs][MAX_FILE_PATH];
+   static struct timespec lastDescriptorsTime;
 
-   (void)sleep(1);
+   if (NULL == rtdStreamPublisher)
+   {
+      openRTDStreamPublisher();
+   }
 
-   numThreadsRunning++;
-   while(!sigTermReceived)
+   bool descriptorsChanged = false;
+   for (int i = 0; i < NUM_RTDs; i++)
    {
-      (void)memset(message, 0, sizeof(message));
-      rc = zmq_recv(heartBeatListener2, message, sizeof(message), 0);
-      if (rc == -1)
+      if (strcmp(sentFilenames[i], rtdMappings[i].temp_data_filename) != 0)
       {
-         continue;
+         (void)strncpy(sentFilenames[i], rtdMappings[i].temp_data_filename, sizeof(sentFilenames[i]) - 1);
+         descriptorsChanged = true;
       }
+   }
+   if (descriptorsChanged)
+   {
+      descriptorVersion++;
+   }
 
-      // Deserialization
-      string s(message, rc);
-      HeartBeat deserialized;
-      if (!deserialized.ParseFromString(s))
+   struct timespec now;
+   (void)clock_gettime(CLOCK_MONOTONIC, &now);
+   bool sendDescriptors = descriptorsChanged ||
+                          (timespecDiffMicroseconds(&now, &lastDescriptorsTime) >= ((int64_t)RTD_STREAM_DESCRIPTOR_SECONDS * ONE_SECOND_IN_MICROSECONDS));
+
+   s.Clear();
+   s.set_topic(RTD_STREAM_TOPIC);
+   s.set_sequence_number(sequenceNumber++);
+   s.set_scan_rate_hz(batch->scan_rate_hz);
+   s.set_descriptor_version(descriptorVersion);
+   s.set_num_rtds(NUM_RTDs);
+   s.set_num_scans(batch->num_scans);
+   s.mutable_first_scan_time()->set_seconds(batch->first_scan_time.tv_sec);
+   s.mutable_first_scan_time()->set_nanos(batch->first_scan_time.tv_usec * 1000);
+
+   if (sendDescriptors)
+   {
+      for (int i = 0; i < NUM_RTDs; i++)
       {
-         if (debugPrintf)
-         {
-            cerr << "ERROR: Unable to deserialize!\n";
-            syslog(LOG_ERR, "heartBeatListenerThread2 ERROR: Unable to deserialize!");
-            (void)logError("", "heartBeatListenerThread2", "Unable to deserialize");
-         }
+         RTDDescriptor *descriptor = s.add_descriptors();
+         descriptor->set_rtd_number((uint32_t)i+1);
+         descriptor->set_location(labels[i]);
+         descriptor->set_temp_data_filename(rtdMappings[i].temp_data_filename);
       }
+      lastDescriptorsTime = now;
+   }
 
-      if (debugPrintf)
+   for (uint32_t scan = 0; scan < batch->num_scans; scan++)
+   {
+      s.add_scan_offset_us(batch->scan_offset_us[scan]);
+      for (int i = 0; i < NUM_RTDs; i++)
       {
-         cout << "Deserialization:\n";
-         deserialized.PrintDebugString();
-
-         cout << "        sender IP address: " << deserialized.sender_ip_address() << "\n";
-         cout << "          sequence number: " << deserialized.sequence_number() << "\n";
+         s.add_raw_counts((uint32_t)batch->raw_counts[scan][i]);
+         s.add_temperature_tenths(lookupTempTenthsFromRawCounts(batch->raw_counts[scan][i], i));
       }
+   }
 
-      lastTimeGUI2Heard = 0;
-      gui2MissingOneShot = true;
-      bothGuisMissingOneShot = true;
+   size_t length = s.ByteSizeLong();
+   if ((length > sizeof(bytes)) || !s.SerializeToArray(bytes, (int)length))
+   {
+      syslog(LOG_ERR, "rtdStreamThread ERROR: Unable to serialize RTDStream %u bytes!", (uint32_t)length);
+      (void)logError("", "rtdStreamThread", "unable to serialize RTDStream");
+      return;
    }
 
-   numThreadsRunning--;
-   pthread_exit(NULL);
+   int rc = zmq_send(rtdStreamPublisher, bytes, length, ZMQ_DONTWAIT);
+   if ((rc == -1) && debugPrintf)
+   {
+      (void)printf("RTDStream %u not sent, errno %d\n", s.sequence_number(), errno);
+   }
+   rtdStreamBatchesPublished++;
 }
 
 
 /*******************************************************************************************/
 /*                                                                                         */
-/* void *statusPublisherThread(void *)                                                     */
+/* void addRTDStreamScan(RTD_STREAM_BATCH *batch, const int *rawCounts, uint32_t rateHz)   */
 /*                                                                                         */
-/* Once per second, read the system data (RTD temps, fan status, etc) and publish it.      */
+/* Adds one RTD scan to the batch and queues the batch for rtdStreamThread once it holds   */
+/* a 1/RTD_STREAM_MESSAGES_PER_SECOND share of the scans for a second. The queue never     */
+/* blocks; a batch that doesn't fit is counted as dropped.                                 */
 /*                                                                                         */
-/* Returns: pthread_exit(NULL)                                                             */
+/* Returns: None                                                                           */
 /*                                                                                         */
 /*******************************************************************************************/
-void *statusPublisherThread(void *)
+void addRTDStreamScan(RTD_STREAM_BATCH *batch, const int *rawCounts, uint32_t rateHz)
 {
-   char bytes[DEFAULT_CSS_MESSAGE_BUFFER_SIZE];
-   char statusPublisherPort[IP_STRING_SIZE + 14];  // Allow space for the tcp:// and :portnumber
-   (void)snprintf(statusPublisherPort, sizeof(statusPublisherPort), "tcp://%s:%d", controllerIPAddress, CURRENT_SYSTEM_STATE_PORT_CONTROLLER);
-   (void)printf("statusPublisherThread statusPublisherPort = %s\n", statusPublisherPort);
+   uint32_t scansPerMessage = rateHz / RTD_STREAM_MESSAGES_PER_SECOND;
+   if (scansPerMessage < 1)
+   {
+      scansPerMessage = 1;
+   }
+   if (scansPerMessage > RTD_STREAM_MAX_SCANS_PER_MESSAGE)
+   {
+      scansPerMessage = RTD_STREAM_MAX_SCANS_PER_MESSAGE;
+   }
 
-   statusPublisher = zmq_socket(context, ZMQ_PUB);
-   assert(statusPublisher != 0);
+   struct timespec now;
+   (void)clock_gettime(CLOCK_MONOTONIC, &now);
+   if (0 == batch->num_scans)
+   {
+      (void)gettimeofday(&batch->first_scan_time, NULL);
+      batch->first_scan_monotonic = now;
+      batch->scan_rate_hz = rateHz;
+   }
 
-   int rc = zmq_bind(statusPublisher, statusPublisherPort);
-   assert(rc == 0);
+   batch->scan_offset_us[batch->num_scans] = (uint32_t)timespecDiffMicroseconds(&now, &batch->first_scan_monotonic);
+   (void)memcpy(batch->raw_counts[batch->num_scans], rawCounts, sizeof(batch->raw_counts[batch->num_scans]));
+   batch->num_scans++;
 
-   bool is_error = false;
-   uint32_t sequenceNumber = 0;
-   struct timeval start;
-   struct timeval end;
-   uint32_t executionTime;
-   uint32_t balance;
-   bool fanError = false;
-   int fanTachCount = 0;
+   if (batch->num_scans >= scansPerMessage)
+   {
+      (void)rtd_stream_queue.put(*batch);
+      batch->num_scans = 0;
+   }
+}
+
+
+/*******************************************************************************************/
+/*                                                                                         */
+/* void *rtdPublisherThread(void *)                                                        */
+/*                                                                                         */
+/* Once per second, read the RTD data (RTD raw counts, temp, shorted, etc) and publish it. */
+/*                                                                                         */
+/* Returns: pthread_exit(NULL)                                                             */
+/*                                                                                         */
+/*******************************************************************************************/
+void *rtdPublisherThread(void *)
+{
+   openRTDPublisher();
 
+   initPeriodicTask(&rtdPublisherTask, "rtdPublisherThread", ONE_SECOND_IN_MICROSECONDS);
    numThreadsRunning++;
    while(!sigTermReceived)
    {
-      (void)gettimeofday(&start, NULL);
-      lastTimeGUI1Heard++;
-      lastTimeGUI2Heard++;
-      CurrentSystemState s;
-      ::google::protobuf::Timestamp* timestamp = new ::google::protobuf::Timestamp();
-      struct timeval now;
-      (void)gettimeofday(&now, NULL);
-      timestamp->set_seconds(now.tv_sec);
-      timestamp->set_nanos(now.tv_usec * 1000);
-
-      fanError = false;
-      // log an error if the tach value is 0 and the fan is on and it's more than 3 times in a row
-      fanTachCount = getFanTach(FAN1_INDEX);
-      if ((0 == fanTachCount) && (FAN_STATE_ON == fanInfo[FAN1_INDEX].fan_on) && (fanInfo[FAN1_INDEX].consecutive_tach_failures++ >= FAN_TACH_CONSECUTIVE_FAILURES))
-      {
-         fanError = true;
-         // turn the fan off - the only way to reset it is to turn it back on
-         (void)setFanOnOff(FAN1_INDEX, FAN_STATE_OFF);
-         if (fan1FailureOneShot)
-         {
-            syslog(LOG_ERR, "%s Fan 1 tach failure", FAN_FAILURE_ERROR_CODE);
-            (void)strncpy(errorCodeString, FAN_FAILURE_ERROR_CODE, sizeof(errorCodeString) - 1);
-            systemStatus = SYSTEM_STATUS_ERROR;
-            (void)logError(FAN_FAILURE_ERROR_CODE, "Fan 1", "Fan tach failure");
-            is_error = true;
-            fan1FailureOneShot = false;
-         }
-         (void)setFanOnOff(FAN1_INDEX, FAN_STATE_ON);
-      }
-      else if (fanTachCount)
-      {
-         fanInfo[FAN1_INDEX].consecutive_tach_failures = 0;
-      }
+      publishRTDs();
+      waitPeriodicTask(&rtdPublisherTask);
+   }
 
-      // log an error if the tach value is 0 and the fan is on
-      fanTachCount = getFanTach(FAN2_INDEX);
-      if ((0 == fanTachCount) && (FAN_STATE_ON == fanInfo[FAN2_INDEX].fan_on) && (fanInfo[FAN2_INDEX].consecutive_tach_failures++ >= FAN_TACH_CONSECUTIVE_FAILURES))
-      {
-         fanError = true;
-         // turn the fan off - the only way to reset it is to turn it back on
-         (void)setFanOnOff(FAN2_INDEX, FAN_STATE_OFF);
-         if (fan2FailureOneShot)
-         {
-            syslog(LOG_ERR, "%s Fan 2 tach failure", FAN_FAILURE_ERROR_CODE);
-            (void)strncpy(errorCodeString, FAN_FAILURE_ERROR_CODE, sizeof(errorCodeString) - 2);
-            systemStatus = SYSTEM_STATUS_ERROR;
-            (void)logError(FAN_FAILURE_ERROR_CODE, "Fan 2", "Fan tach failure");
-            is_error = true;
-            fan2FailureOneShot = false;
-         }
-         (void)setFanOnOff(FAN2_INDEX, FAN_STATE_ON);
-      }
-      else if (fanTachCount)
-      {
-         fanInfo[FAN2_INDEX].consecutive_tach_failures = 0;
-      }
+   numThreadsRunning--;
+   pthread_exit(NULL);
+}
 
-      // if hardware A02 or greater, check both fans for current limit tripped
-      if (!fanError && (controllerBoardRevision > 0))
-      {
-         bool limitTripped = getFanCurrentLimit(FAN1_INDEX);
-         if (limitTripped)
-         {
-            fanInfo[FAN1_INDEX].current_limit_delay_count++;
-            if (fanInfo[FAN1_INDEX].current_limit_delay_count >= FAN_OVERCURRENT_DELAY_COUNT)
-            {
-               if (FAN_STATE_ON == fanInfo[FAN1_INDEX].fan_on)
-               {
-                  // turn the fan off - this should reset the current limit bit
-                  (void)setFanOnOff(FAN1_INDEX, FAN_STATE_OFF);
-                  fanInfo[FAN1_INDEX].current_limit_auto_correct_count++;
-                  if (fan1CurrentLimitOneShot && (fanInfo[FAN1_INDEX].current_limit_auto_correct_count >= FAN_OVERCURRENT_AUTO_CORRECT_LIMIT))
-                  {
-                     syslog(LOG_ERR, "%s Fan 1 current limit", FAN_OVERCURRENT_ERROR_CODE);
-                     (void)strncpy(errorCodeString, FAN_OVERCURRENT_ERROR_CODE, sizeof(errorCodeString) - 2);
-                     systemStatus = SYSTEM_STATUS_ERROR;
-                     (void)logError(FAN_OVERCURRENT_ERROR_CODE, "Fan 1", "Fan current limit");
-                     is_error = true;
-                     fan1CurrentLimitOneShot = false;
-                  }
-                  if (fanInfo[FAN1_INDEX].current_limit_auto_correct_count < FAN_OVERCURRENT_AUTO_CORRECT_LIMIT)
-                  {
-                     (void)setFanOnOff(FAN1_INDEX, FAN_STATE_ON);
-                  }
-               }
-            }
-         }
-         else
-         {
-            fanInfo[FAN1_INDEX].current_limit_delay_count = 0;
-            fanInfo[FAN1_INDEX].current_limit_auto_correct_count = 0;
-         }
 
-         limitTripped = getFanCurrentLimit(FAN2_INDEX);
-         if (limitTripped)
-         {
-            fanInfo[FAN2_INDEX].current_limit_delay_count++;
-            if (fanInfo[FAN2_INDEX].current_limit_delay_count >= FAN_OVERCURRENT_DELAY_COUNT)
-            {
-               if (FAN_STATE_ON == fanInfo[FAN2_INDEX].fan_on)
-               {
-                  // turn the fan off - this should reset the current limit bit
-                  (void)setFanOnOff(FAN2_INDEX, FAN_STATE_OFF);
-                  fanInfo[FAN2_INDEX].current_limit_auto_correct_count++;
-                  if (fan2CurrentLimitOneShot && (fanInfo[FAN2_INDEX].current_limit_auto_correct_count >= FAN_OVERCURRENT_AUTO_CORRECT_LIMIT))
-                  {
-                     syslog(LOG_ERR, "%s Fan 2 current limit", FAN_OVERCURRENT_ERROR_CODE);
-                     (void)strncpy(errorCodeString, FAN_OVERCURRENT_ERROR_CODE, sizeof(errorCodeString) - 2);
-                     systemStatus = SYSTEM_STATUS_ERROR;
-                     (void)logError(FAN_OVERCURRENT_ERROR_CODE, "Fan 2", "Fan current limit");
-                     is_error = true;
-                     fan2CurrentLimitOneShot = false;
-                  }
-                  if (fanInfo[FAN2_INDEX].current_limit_auto_correct_count < FAN_OVERCURRENT_AUTO_CORRECT_LIMIT)
-                  {
-                     (void)setFanOnOff(FAN2_INDEX, FAN_STATE_ON);
-                  }
-               }
-            }
-         }
-         else
-         {
-            fanInfo[FAN2_INDEX].current_limit_delay_count = 0;
-            fanInfo[FAN2_INDEX].current_limit_auto_correct_count = 0;
-         }
+/*******************************************************************************************/
+/*                                                                                         */
+/* void *rtdStreamThread(void *)                                                           */
+/*                                                                                         */
+/* Waits on the RTDStream queue and publishes each batch of RTD scans readADCThread queues */
+/* while streaming.                                                                        */
+/*                                                                                         */
+/* Returns: pthread_exit(NULL)                                                             */
+/*                                                                                         */
+/*******************************************************************************************/
+void *rtdStreamThread(void *)
+{
+   numThreadsRunning++;
+   while(!sigTermReceived)
+   {
+      // time out now and then to check for sigTermReceived
+      static RTD_STREAM_BATCH batch;
+      if (rtd_stream_queue.get(batch, RTD_STREAM_QUEUE_TIMEOUT_MS) == 0)
+      {
+         publishRTDStream(&batch);
       }
+   }
 
-      if (!softShutdownCheckOneshot)
-      {
-         if (access(SOFT_SHUTDOWN_FILE, F_OK) == 0)
-         {
-            (void)unlink(RM_SOFT_SHUTDOWN_FILE);
-         }
+   numThreadsRunning--;
+   pthread_exit(NULL);
+}
 
-         softShutdownCheckOneshot = true;
-      }
 
-      s.set_topic(CURRENT_SYSTEM_STATE_TOPIC);
-      s.mutable_system_data()->set_heatsink_temp(lookupTempFromRawCounts(rtdMappings[HEATSINK_RTD_INDEX].value, HEATSINK_RTD_INDEX));
-      // Vantron asked for the ambient temp to be added to the CSS even though the sensor for it won't be available until rev A02 hardware
-      if (controllerBoardRevision > 0)
-      {
-         // the controller board HW revision was bumped from 0 to 1 for A02 hardware
-         s.mutable_system_data()->set_ambient_temp(lookupTempFromRawCounts(rtdMappings[AMBIENT_TEMP_RTD_INDEX].value, AMBIENT_TEMP_RTD_INDEX));
-      }
-      else
-      {
-         // prior to HW rev A02, we report the HEATSINK temp as the AMBIENT temp
-         s.mutable_system_data()->set_ambient_temp(lookupTempFromRawCounts(rtdMappings[HEATSINK_RTD_INDEX].value, HEATSINK_RTD_INDEX));
-      }
-      s.mutable_system_data()->set_fan_state1((uhc::FanState)fanInfo[0].fan_on);
-      s.mutable_system_data()->set_fan_state2((uhc::FanState)fanInfo[1].fan_on);
-      s.mutable_system_data()->set_allocated_current_time(timestamp);
-      timestamp = new ::google::protobuf::Timestamp();
-      timestamp->set_seconds(getSytemUptime());
-      timestamp->set_nanos(0);
-      s.mutable_system_data()->set_allocated_system_up_time(timestamp);
-      s.mutable_system_data()->set_current_power_consumption(irms);
-      s.mutable_system_data()->set_system_status(systemStatus);
-      s.mutable_system_data()->set_configured_eco_mode_temp(heaterInfo[0].eco_mode_setpoint);
-      s.mutable_system_data()->set_configured_eco_mode_minutes(15);
-      s.mutable_system_data()->set_eco_mode_state(ECO_MODE_OFF);
-      s.mutable_system_data()->set_shutdown_requested(false);
-      s.mutable_system_data()->set_last_command_received(lastCommandReceived);
-      s.mutable_system_data()->set_controller_ip_address(controllerIPAddress);
-      s.mutable_system_data()->set_intelligent_glass_1_ip_address(guiIPAddress1);
-      s.mutable_system_data()->set_intelligent_glass_2_ip_address(guiIPAddress2);
-      timestamp = new ::google::protobuf::Timestamp();
-      timestamp->set_seconds(lastTimeGUI1Heard);
-      timestamp->set_nanos(0);
-      s.mutable_system_data()->set_allocated_last_time_intelligent_glass_1_heard(timestamp);
-      timestamp = new ::google::protobuf::Timestamp();
-      timestamp->set_seconds(lastTimeGUI2Heard);
-      timestamp->set_nanos(0);
-      s.mutable_system_data()->set_allocated_last_time_intelligent_glass_2_heard(timestamp);
-      s.set_hardware_revision((uint32_t)controllerBoardRevision);
-      s.mutable_system_data()->set_alarm_code(ALARM_CODE_NONE);
-      s.mutable_system_data()->set_heatsink_over_temp(heatsinkOvertemp);
-      if (heatsinkOvertemp)
-      {
-         s.mutable_system_data()->set_alarm_code(ALARM_CODE_HEATSINK_OVER_TEMP);
-         is_error = true;
-      }
+/*******************************************************************************************/
+/*                                                                                         */
+/* void raiseAlarm(uhc::AlarmCode code, const char *errorCode, int slotNumber,             */
+/*                 const char *location)                                                   */
+/*                                                                                         */
+/* Queues an alarm for alarmPublisherThread to publish on the ALARM topic right away.      */
+/* Each alarm gets the next alarm ID, which the CurrentSystemState also reports as         */
+/* last_alarm_id. The queue is a LockFreeQueue, so this never takes a lock or makes a      */
+/* system call and is safe to call from readADCThread and heaterControlThread. If the      */
+/* queue is full it counts the alarm as dropped (reported hourly), and the GUIs still see  */
+/* it in the next CurrentSystemState as before.                                            */
+/*                                                                                         */
+/* Returns: None                                                                           */
+/*                                                                                         */
+/*******************************************************************************************/
+void raiseAlarm(uhc::AlarmCode code, const char *errorCode, int slotNumber, const char *location)
+{
+   alarm_event_t ae;
+
+   (void)clock_gettime(CLOCK_MONOTONIC, &ae.detected);
+   (void)gettimeofday(&ae.timestamp, NULL);
+   ae.alarm_id = ++lastAlarmId;
+   ae.alarm_code = code;
+   ae.slot_number = slotNumber;
+   (void)memset(ae.error_code, 0, sizeof(ae.error_code));
+   (void)strncpy(ae.error_code, errorCode, sizeof(ae.error_code) - 1);
+   (void)memset(ae.location, 0, sizeof(ae.location));
+   (void)strncpy(ae.location, location, sizeof(ae.location) - 1);
+
+   (void)alarm_queue.put(ae);
+}
 
-      s.mutable_system_data()->set_heatsink_temp(heatsinkTemp);
-      s.mutable_system_data()->set_logging_is_event_driven(loggingIsEventDriven);
-      s.mutable_system_data()->set_logging_period_seconds(loggingPeriodSeconds);
-      s.mutable_system_data()->set_nso_mode(nsoMode);
-      s.mutable_system_data()->set_demo_mode(demoMode);
 
-      // only start logging
-      if (getSytemUptime() > TWO_MINUTES_IN_SECONDS)
-      {
-         if (powerMonitorBad)
-         {
-            if (powerMonitorBadOneShot)
-            {
-               s.mutable_system_data()->set_alarm_code(ALARM_CODE_HARDWARE_FAILURE);
-               syslog(LOG_ERR, "Hardware failure - power monitor");
-               (void)strncpy(errorCodeString, HARDWARE_FAILURE_ERROR_CODE, sizeof(errorCodeString) - 1);
-               systemStatus = SYSTEM_STATUS_ERROR;
-               alarmCode = ALARM_CODE_HARDWARE_FAILURE;
-               char descr_str[LOGERROR_DESCR_SIZE];
-               (void)snprintf(descr_str, sizeof(descr_str), "Hardware failure - power monitor");
-               (void)logError(HARDWARE_FAILURE_ERROR_CODE, "Hardware failure - power monitor", descr_str);
-               is_error = true;
-               powerMonitorBadOneShot = false;
-            }
-         }
-         else
-         {
-            powerMonitorBadOneShot = true;
-         }
+/*******************************************************************************************/
+/*                                                                                         */
+/* void openAlarmPublisher()                                                               */
+/*                                                                                         */
+/* Creates and binds the Alarm publisher socket.                                           */
+/*                                                                                         */
+/* Returns: None                                                                           */
+/*                                                                                         */
+/*******************************************************************************************/
+void openAlarmPublisher()
+{
+   char alarmPublisherPort[IP_STRING_SIZE + 14];  // Allow space for the tcp:// and :portnumber
+   (void)snprintf(alarmPublisherPort, sizeof(alarmPublisherPort), "tcp://%s:%d", controllerIPAddress, ALARM_PORT_CONTROLLER);
+   (void)printf("alarmPublisherThread alarmPublisherPort = %s\n", alarmPublisherPort);
 
-         if (lastTimeGUI1Heard >= GUI_NO_COMMUNICATION_TIME_LIMIT)
-         {
-            if (gui1MissingOneShot)
-            {
-               s.mutable_system_data()->set_alarm_code(ALARM_CODE_INTELLIGENT_GLASS_FAILURE);
-               syslog(LOG_ERR, "%s Intelligent Glass 1 - not heard from in more than %d seconds", SINGLE_GUI_COMM_LOSS_ERROR, lastTimeGUI1Heard);
-               (void)strncpy(errorCodeString, SINGLE_GUI_COMM_LOSS_ERROR, sizeof(errorCodeString) - 1);
-               systemStatus = SYSTEM_STATUS_ERROR;
-               char descr_str[LOGERROR_DESCR_SIZE];
-               (void)snprintf(descr_str, sizeof(descr_str), "not heard from in more than %d seconds", lastTimeGUI1Heard);
-               (void)logError(SINGLE_GUI_COMM_LOSS_ERROR, "Glass 1", descr_str);
-               is_error = true;
-               gui1MissingOneShot = false;
-            }
-         }
+   alarmPublisher = zmq_socket(context, ZMQ_PUB);
+   assert(alarmPublisher != 0);
 
-         if (lastTimeGUI2Heard >= GUI_NO_COMMUNICATION_TIME_LIMIT)
-         {
-            if (gui2MissingOneShot)
-            {
-               s.mutable_system_data()->set_alarm_code(ALARM_CODE_INTELLIGENT_GLASS_FAILURE);
-               syslog(LOG_ERR, "%s Intelligent Glass 2 - not heard from in more than %d seconds", SINGLE_GUI_COMM_LOSS_ERROR, lastTimeGUI2Heard);
-               (void)strncpy(errorCodeString, SINGLE_GUI_COMM_LOSS_ERROR, sizeof(errorCodeString) - 1);
-               systemStatus = SYSTEM_STATUS_ERROR;
-               char descr_str[LOGERROR_DESCR_SIZE];
-               (void)snprintf(descr_str, sizeof(descr_str), "not heard from in more than %d seconds", lastTimeGUI2Heard);
-               (void)logError(SINGLE_GUI_COMM_LOSS_ERROR, "Glass 2", descr_str);
-               is_error = true;
-               gui2MissingOneShot = false;
-            }
-         }
+   int rc = zmq_bind(alarmPublisher, alarmPublisherPort);
+   assert(rc == 0);
+}
 
-         if ((lastTimeGUI1Heard >= GUI_NO_COMMUNICATION_TIME_LIMIT) && (lastTimeGUI2Heard >= GUI_NO_COMMUNICATION_TIME_LIMIT))
-         {
-            // both GUIs are down for more than 3 minutes
-            // per Shawn Thompson, shut down the unit.
-            // turn all heaters off
-            s.mutable_system_data()->set_alarm_code(ALARM_CODE_INTELLIGENT_GLASS_FAILURE);
-            for (int j = 0; j < NUM_HEATERS; j++)
-            {
-               (void)enableDisableHeater(j, HEATER_DISABLED);
-               (void)turnHeaterOnOff(j, HEATER_STATE_OFF);
-            }
 
-            if (bothGuisMissingOneShot)
-            {
-               syslog(LOG_ERR, "%s Both Intelligent Glass devices not heard from in more than %d seconds", BOTH_GUIS_COMM_LOSS_ERROR_CODE, GUI_NO_COMMUNICATION_TIME_LIMIT);
-               syslog(LOG_ERR, "Heaters turned off and disabled");
-               (void)strncpy(errorCodeString, BOTH_GUIS_COMM_LOSS_ERROR_CODE, sizeof(errorCodeString) - 1);
-               systemStatus = SYSTEM_STATUS_ERROR;
-               char descr_str[LOGERROR_DESCR_SIZE];
-               (void)snprintf(descr_str, sizeof(descr_str), "not heard from in more than %d seconds", GUI_NO_COMMUNICATION_TIME_LIMIT);
-               (void)logError(BOTH_GUIS_COMM_LOSS_ERROR_CODE, "Glass both", descr_str);
-               is_error = true;
-               bothGuisMissingOneShot= false;
-            }
-         }
-      }
+/*******************************************************************************************/
+/*                                                                                         */
+/* void publishAlarm(const alarm_event_t &ae)                                              */
+/*                                                                                         */
+/* Builds the Alarm message for a queued alarm, publishes it and records the time from     */
+/* detection to zmq_send returning. The send never waits; one that fails is counted in     */
+/* alarmsSendFailed, with a syslog at most every ALARM_SEND_FAIL_LOG_INTERVAL_SECONDS.     */
+/*                                                                                         */
+/* Returns: None                                                                           */
+/*                                                                                         */
+/*******************************************************************************************/
+void publishAlarm(const alarm_event_t &ae)
+{
+   char bytes[DEFAULT_MESSAGE_BUFFER_SIZE];
+   Alarm a;
+
+   a.set_topic(ALARM_TOPIC);
+   a.set_controller_ip_address(controllerIPAddress);
+   a.set_alarm_id(ae.alarm_id);
+   a.set_alarm_code(ae.alarm_code);
+   a.set_hp_error_code(ae.error_code);
+   a.set_slot_number(static_cast<SlotNumber>(ae.slot_number));
+   a.set_location(ae.location);
+   a.mutable_detected_time()->set_seconds(ae.timestamp.tv_sec);
+   a.mutable_detected_time()->set_nanos(ae.timestamp.tv_usec * 1000);
+
+   size_t length = a.ByteSizeLong();
+   if ((length > sizeof(bytes)) || !a.SerializeToArray(bytes, (int)length))
+   {
+      syslog(LOG_ERR, "alarmPublisherThread ERROR: Unable to serialize alarm %u!", ae.alarm_id);
+      (void)logError("", "alarmPublisherThread", "unable to serialize");
+      return;
+   }
 
-      if ((false == ethernetUp) && (ethernetDownTimeSeconds >= ETHERNET_NO_COMMUNICATION_TIME_LIMIT))
+   int rc = zmq_send(alarmPublisher, bytes, length, ZMQ_DONTWAIT);
+   if (rc != (int)length)
+   {
+      int err = zmq_errno();
+      alarmsSendFailed++;
+      uint32_t now = monotonicSeconds();
+      if ((0 == alarmSendFailLoggedSeconds) || ((now - alarmSendFailLoggedSeconds) >= ALARM_SEND_FAIL_LOG_INTERVAL_SECONDS))
       {
-         // turn all heaters off
-         for (int j = 0; j < NUM_HEATERS; j++)
-         {
-            (void)enableDisableHeater(j, HEATER_DISABLED);
-            (void)turnHeaterOnOff(j, HEATER_STATE_OFF);
-         }
-         if (ethernetErrorOneShot)
-         {
-            ethernetErrorOneShot = false;
-            syslog(LOG_ERR, "%s Ethernet down", ETHERNET_DOWN_ERROR_CODE);
-            syslog(LOG_ERR, "Heaters turned off and disabled");
-            (void)strncpy(errorCodeString, ETHERNET_DOWN_ERROR_CODE, sizeof(errorCodeString) - 1);
-            systemStatus = SYSTEM_STATUS_ERROR;
-            (void)logError(ETHERNET_DOWN_ERROR_CODE, "Ethernet down", "Ethernet down");
-            is_error = true;
-         }
+         alarmSendFailLoggedSeconds = now;
+         syslog(LOG_ERR, "alarmPublisherThread ERROR: alarm %u not sent, %s (%u failed so far)", ae.alarm_id, zmq_strerror(err), alarmsSendFailed);
       }
-      if (ethernetUp && !previousEthernetUp)
+      return;
+   }
+
+   struct timespec now;
+   (void)clock_gettime(CLOCK_MONOTONIC, &now);
+   alarmLatencyMicroseconds = (uint32_t)timespecDiffMicroseconds(&now, &ae.detected);
+   if (alarmLatencyMicroseconds > alarmLatencyMaxMicroseconds)
+   {
+      alarmLatencyMaxMicroseconds = alarmLatencyMicroseconds;
+   }
+   alarmsPublished++;
+
+   if (debugPrintf)
+   {
+      (void)printf("Alarm %u %s %s published, %u us after detection\n", ae.alarm_id, ae.error_code, ae.location, alarmLatencyMicroseconds);
+   }
+}
+
+
+/*******************************************************************************************/
+/*                                                                                         */
+/* void *alarmPublisherThread(void *)                                                      */
+/*                                                                                         */
+/* Waits on the alarm queue and publishes each alarm as soon as it is raised.              */
+/*                                                                                         */
+/* Returns: pthread_exit(NULL)                                                             */
+/*                                                                                         */
+/*******************************************************************************************/
+void *alarmPublisherThread(void *)
+{
+   openAlarmPublisher();
+
+   numThreadsRunning++;
+   while(!sigTermReceived)
+   {
+      // time out now and then to check for sigTermReceived
+      alarm_event_t ae;
+      if (alarm_queue.get(ae, ALARM_QUEUE_TIMEOUT_MS) == 0)
       {
-         //printf("====================Ethernet Re-established =================\n");
-         syslog(LOG_NOTICE, "Ethernet back up");
-         (void)logError("", "Ethernet back up", "Ethernet back up");
+         publishAlarm(ae);
       }
+   }
 
-      for (int i = 0; i < TOTAL_SLOTS; i++)
-      {
-         (void)s.add_slot_data();
-         SlotNumber sn = static_cast<SlotNumber>(i+1);
-         SlotData* newSlotData = s.mutable_slot_data(i);
-         newSlotData->set_slot_number(sn);
-         newSlotData->mutable_heater_location_upper()->set_state((uhc::HeaterState)heaterInfo[i*2].state);
-         newSlotData->mutable_heater_location_upper()->set_location((uhc::HeaterLocation)heaterInfo[i*2].location);
-         newSlotData->mutable_heater_location_upper()->set_thermistor_temp(lookupTempFromRawCounts(rtdMappings[i*2].value, i*2));
-         newSlotData->mutable_heater_location_upper()->set_setpoint_temp(heaterInfo[i*2].temperature_setpoint);
+   numThreadsRunning--;
+   pthread_exit(NULL);
+}
 
-         uhc::LEDState led_state;
-         if (HEATER_STATE_ON == heaterInfo[i*2].state)
-         {
-            led_state = LED_STATE_RED;
-         }
-         else
-         {
-            led_state = LED_STATE_OFF;
-         }
 
-         newSlotData->mutable_heater_location_upper()->set_led_state(led_state);
+/*******************************************************************************************/
+/*                                                                                         */
+/* int runSubprocess(const char *name, const char *command, uint32_t timeoutSeconds,       */
+/*                   std::atomic<int> *status)                                             */
+/*                                                                                         */
+/* Queues a shell command for subprocessThread to run, so the caller doesn't wait on it.   */
+/* Commands run one at a time in the order they are queued. One still running after        */
+/* timeoutSeconds is killed, along with anything it started. The exit status goes to       */
+/* syslog and the status log, and to *status if status is not NULL.                        */
+/*                                                                                         */
+/* Returns: int 0 = queued, -ENOMEM = the queue is full                                    */
+/*                                                                                         */
+/*******************************************************************************************/
+int runSubprocess(const char *name, const char *command, uint32_t timeoutSeconds, std::atomic<int> *status)
+{
+   subprocess_request_t request;
 
-         if (rtdMappings[i*2].is_open)
-         {
-            newSlotData->mutable_heater_location_upper()->set_is_open(true);
-//            (void)printf("heater[%d] (upper) is open sequenceNumber %d\n", i*2, sequenceNumber + 1);
-            is_error = true;
-         }
-         else
-         {
-            newSlotData->mutable_heater_location_upper()->set_is_open(false);
-         }
+   (void)memset(request.name, 0, sizeof(request.name));
+   (void)strncpy(request.name, name, sizeof(request.name) - 1);
+   (void)memset(request.command, 0, sizeof(request.command));
+   (void)strncpy(request.command, command, sizeof(request.command) - 1);
+   request.timeout_seconds = timeoutSeconds;
+   request.status = status;
+   request.event = SUBPROCESS_EXITED_T;
+   (void)clock_gettime(CLOCK_MONOTONIC, &request.queued);
 
-         if (rtdMappings[i*2].is_shorted)
-         {
-            newSlotData->mutable_heater_location_upper()->set_is_shorted(true);
-//            (void)printf("heater[%d] (upper) is shorted sequenceNumber %d\n", i*2, sequenceNumber + 1);
-            is_error = true;
-         }
-         else
-         {
-            newSlotData->mutable_heater_location_upper()->set_is_shorted(false);
-         }
+   int ret = subprocess_queue.put(request);
+   if (0 != ret)
+   {
+      subprocessesDropped++;
+      syslog(LOG_ERR, "runSubprocess: subprocess queue full, %s not run", request.name);
+   }
 
-         if (heaterInfo[i*2].is_undertemp_CSS)
-         {
-            newSlotData->mutable_heater_location_upper()->set_is_undertemp(true);
-            s.mutable_system_data()->set_alarm_code(ALARM_CODE_SLOT_UNDER_TEMP);
-//            (void)printf("heater[%d] (upper) is undertemp sequenceNumber %d\n", i*2, sequenceNumber + 1);
-            is_error = true;
-         }
-         else
-         {
-            newSlotData->mutable_heater_location_upper()->set_is_undertemp(false);
-         }
+   return ret;
+}
 
-         if (heaterInfo[i*2].is_overtemp_CSS)
-         {
-            newSlotData->mutable_heater_location_upper()->set_is_overtemp(true);
-            s.mutable_system_data()->set_alarm_code(ALARM_CODE_SLOT_OVER_TEMP);
-//            (void)printf("heater[%d] (upper) is overtemp sequenceNumber %d\n", i*2, sequenceNumber + 1);
-            is_error = true;
-         }
-         else
-         {
-            newSlotData->mutable_heater_location_upper()->set_is_overtemp(false);
-         }
 
-         if (heaterInfo[i*2].is_enabled)
-         {
-            newSlotData->mutable_heater_location_upper()->set_is_enabled(true);
-         }
-         else
-         {
-            newSlotData->mutable_heater_location_upper()->set_is_enabled(false);
-         }
+/*******************************************************************************************/
+/*                                                                                         */
+/* int startSubprocess(const char *command, pid_t *pid)                                    */
+/*                                                                                         */
+/* Starts a shell command with posix_spawn in a process group of its own, with no signals  */
+/* blocked and SIGPIPE at its default whatever the calling thread has.                     */
+/*                                                                                         */
+/* Returns: int 0 = started, -errno = failure                                              */
+/*                                                                                         */
+/*******************************************************************************************/
+int startSubprocess(const char *command, pid_t *pid)
+{
+   posix_spawnattr_t attr;
+   sigset_t signals;
+
+   (void)posix_spawnattr_init(&attr);
+   (void)posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETPGROUP | POSIX_SPAWN_SETSIGMASK | POSIX_SPAWN_SETSIGDEF);
+   (void)posix_spawnattr_setpgroup(&attr, 0);
+   (void)sigemptyset(&signals);
+   (void)posix_spawnattr_setsigmask(&attr, &signals);
+   (void)sigaddset(&signals, SIGPIPE);
+   (void)posix_spawnattr_setsigdefault(&attr, &signals);
+
+   char *argv[] = { (char *)"sh", (char *)"-c", (char *)command, NULL };
+   int err = posix_spawn(pid, "/bin/sh", NULL, &attr, argv, environ);
+   (void)posix_spawnattr_destroy(&attr);
+
+   return -err;
+}
 
-         ::google::protobuf::Timestamp* ts = new ::google::protobuf::Timestamp();
-         ts->set_seconds(heaterInfo[i*2].start_time.seconds());
-         ts->set_nanos(0);
-         newSlotData->mutable_heater_location_upper()->set_allocated_start_time(ts);
-         ::google::protobuf::Timestamp* ts1 = new ::google::protobuf::Timestamp();
-         ts1->set_seconds(heaterInfo[i*2].end_time.seconds());
-         ts1->set_nanos(0);
-         newSlotData->mutable_heater_location_upper()->set_allocated_end_time(ts1);
 
-         newSlotData->mutable_heater_location_lower()->set_state((uhc::HeaterState)heaterInfo[(i*2)+1].state);
-         newSlotData->mutable_heater_location_lower()->set_location((uhc::HeaterLocation)heaterInfo[(i*2)+1].location);
-         newSlotData->mutable_heater_location_lower()->set_thermistor_temp(lookupTempFromRawCounts(rtdMappings[(i*2)+1].value, (i*2)+1));
-         newSlotData->mutable_heater_location_lower()->set_setpoint_temp(heaterInfo[(i*2)+1].temperature_setpoint);
+/*******************************************************************************************/
+/*                                                                                         */
+/* int runSubprocessNow(const char *name, const char *command, uint32_t timeoutSeconds)    */
+/*                                                                                         */
+/* Starts a shell command right away from the calling thread, rather than queueing it      */
+/* behind whatever subprocessThread is running, for the ones that can't wait: the soft     */
+/* power down that only has the hold up time, shutdown and setting the clock. It isn't     */
+/* waited for; subprocessThread reaps it, kills it after timeoutSeconds and reports it     */
+/* like the queued ones. URGENT_SUBPROCESS_SLOTS can be outstanding at a time.             */
+/*                                                                                         */
+/* Returns: int 0 = started, -EBUSY = all the slots are taken, -errno = failure            */
+/*                                                                                         */
+/*******************************************************************************************/
+int runSubprocessNow(const char *name, const char *command, uint32_t timeoutSeconds)
+{
+   return runSubprocessNow(name, command, timeoutSeconds, SUBPROCESS_EXITED_T);
+}
 
-         if (HEATER_STATE_ON == heaterInfo[(i*2)+1].state)
-         {
-            led_state = LED_STATE_RED;
-         }
-         else
-         {
-            led_state = LED_STATE_OFF;
-         }
 
-         newSlotData->mutable_heater_location_lower()->set_led_state(led_state);
+/*******************************************************************************************/
+/*                                                                                         */
+/* int runSubprocessNow(const char *name, const char *command, uint32_t timeoutSeconds,    */
+/*                      internal_event_t event)                                            */
+/*                                                                                         */
+/* As above, logging event to the status log with how it went in place of                  */
+/* SUBPROCESS_EXITED_T, for a command whose result is the event, like TIMESYNC_RECEIVED_T. */
+/*                                                                                         */
+/* Returns: int 0 = started, -EBUSY = all the slots are taken, -errno = failure            */
+/*                                                                                         */
+/*******************************************************************************************/
+int runSubprocessNow(const char *name, const char *command, uint32_t timeoutSeconds, internal_event_t event)
+{
+   // claim a free slot, fill it in, then publish the pid to subprocessThread
+   int slot;
+   for (slot = 0; slot < URGENT_SUBPROCESS_SLOTS; slot++)
+   {
+      pid_t none = 0;
+      if (urgentSubprocessPids[slot].compare_exchange_strong(none, URGENT_SUBPROCESS_CLAIMED))
+      {
+         break;
+      }
+   }
+   if (slot >= URGENT_SUBPROCESS_SLOTS)
+   {
+      syslog(LOG_ERR, "runSubprocessNow: %s not run, %d still running", name, URGENT_SUBPROCESS_SLOTS);
+      return -EBUSY;
+   }
 
-         if (rtdMappings[(i*2)+1].is_open)
-         {
-            newSlotData->mutable_heater_location_lower()->set_is_open(true);
-//            (void)printf("heater[%d] (lower) is open sequenceNumber %d\n", (i*2)+1, sequenceNumber + 1);
-            is_error = true;
-         }
-         else
-         {
-            newSlotData->mutable_heater_location_lower()->set_is_open(false);
-         }
+   subprocess_request_t *request = &urgentSubprocesses[slot];
+   (void)memset(request->name, 0, sizeof(request->name));
+   (void)strncpy(request->name, name, sizeof(request->name) - 1);
+   (void)memset(request->command, 0, sizeof(request->command));
+   (void)strncpy(request->command, command, sizeof(request->command) - 1);
+   request->timeout_seconds = timeoutSeconds;
+   request->status = NULL;
+   request->event = event;
+   (void)clock_gettime(CLOCK_MONOTONIC, &request->queued);
 
-         if (rtdMappings[(i*2)+1].is_shorted)
-         {
-            newSlotData->mutable_heater_location_lower()->set_is_shorted(true);
-//            (void)printf("heater[%d] (lower) is shorted sequenceNumber %d\n", (i*2)+1, sequenceNumber + 1);
-            is_error = true;
-         }
-         else
-         {
-            newSlotData->mutable_heater_location_lower()->set_is_shorted(false);
-         }
+   pid_t pid = 0;
+   int ret = startSubprocess(command, &pid);
+   if (0 != ret)
+   {
+      syslog(LOG_ERR, "runSubprocessNow: %s not run, error %d", name, -ret);
+      urgentSubprocessPids[slot] = 0;
+      return ret;
+   }
 
-         if (heaterInfo[(i*2)+1].is_undertemp_CSS)
-         {
-            newSlotData->mutable_heater_location_lower()->set_is_undertemp(true);
-            s.mutable_system_data()->set_alarm_code(ALARM_CODE_SLOT_UNDER_TEMP);
-//            (void)printf("heater[%d] (lower) is undertemp sequenceNumber %d\n", (i*2)+1, sequenceNumber + 1);
-            is_error = true;
-         }
-         else
-         {
-            newSlotData->mutable_heater_location_lower()->set_is_undertemp(false);
-         }
+   urgentSubprocessPids[slot] = pid;
+   return 0;
+}
 
-         if (heaterInfo[(i*2)+1].is_overtemp_CSS)
-         {
-            newSlotData->mutable_heater_location_lower()->set_is_overtemp(true);
-            s.mutable_system_data()->set_alarm_code(ALARM_CODE_SLOT_OVER_TEMP);
-//            (void)printf("heater[%d] (lower) is overtemp sequenceNumber %d\n", (i*2)+1, sequenceNumber + 1);
-            is_error = true;
-         }
-         else
-         {
-            newSlotData->mutable_heater_location_lower()->set_is_overtemp(false);
-         }
 
-         if (heaterInfo[(i*2)+1].is_enabled)
-         {
-            newSlotData->mutable_heater_location_lower()->set_is_enabled(true);
-         }
-         else
-         {
-            newSlotData->mutable_heater_location_lower()->set_is_enabled(false);
-         }
+/*******************************************************************************************/
+/*                                                                                         */
+/* bool pollSubprocess(pid_t pid, const struct timespec *start, uint32_t timeoutSeconds,   */
+/*                     int *status)                                                        */
+/*                                                                                         */
+/* Checks, without waiting, whether a subprocess started at start has exited. Kills its    */
+/* process group if it has run longer than timeoutSeconds.                                 */
+/*                                                                                         */
+/* Returns: bool true if done; *status is the exit status, 128 + signal, or -ETIMEDOUT     */
+/*                                                                                         */
+/*******************************************************************************************/
+bool pollSubprocess(pid_t pid, const struct timespec *start, uint32_t timeoutSeconds, int *status)
+{
+   int wstatus = 0;
+   pid_t ret = waitpid(pid, &wstatus, WNOHANG);
+   if (pid == ret)
+   {
+      *status = WIFEXITED(wstatus) ? WEXITSTATUS(wstatus) : (128 + WTERMSIG(wstatus));
+      return true;
+   }
+   if ((ret < 0) && (EINTR != errno))
+   {
+      *status = -errno;
+      return true;
+   }
 
-         ::google::protobuf::Timestamp* ts2 = new ::google::protobuf::Timestamp();
-         ts2->set_seconds(heaterInfo[(i*2)+1].start_time.seconds());
-         ts2->set_nanos(0);
-         newSlotData->mutable_heater_location_lower()->set_allocated_start_time(ts2);
-         ::google::protobuf::Timestamp* ts3 = new ::google::protobuf::Timestamp();
-         ts3->set_seconds(heaterInfo[(i*2)+1].end_time.seconds());
-         ts3->set_nanos(0);
-         newSlotData->mutable_heater_location_lower()->set_allocated_end_time(ts3);
-      }
+   struct timespec now;
+   (void)clock_gettime(CLOCK_MONOTONIC, &now);
+   if (timespecDiffMicroseconds(&now, start) >= ((int64_t)timeoutSeconds * ONE_SECOND_IN_MICROSECONDS))
+   {
+      (void)kill(-pid, SIGKILL);
+      (void)waitpid(pid, &wstatus, 0);
+      *status = -ETIMEDOUT;
+      return true;
+   }
 
-      s.set_serial_number(serialNumber);
-      s.set_model_number(modelNumber);
-      s.set_firmware_version(FRONTIER_UHC_FIRMWARE_VERSION);
-      s.set_sequence_number(sequenceNumber++);
-      s.mutable_system_data()->set_hp_error_code(errorCodeString);
-      if (strlen(errorCodeString) != 0)
-      {
-         errorReportCount++;
-         if (errorReportCount > REPORT_ERROR_COUNT)
-         {
-            (void)memset(errorCodeString, 0, sizeof(errorCodeString));
-            errorReportCount = 0;
-         }
-      }
+   return false;
+}
 
-      if (is_error && debugCSS)
-      {
-         cout << "Packet contains error state Serialization:\n\n" << s.DebugString() << "\n\n";
-         s.PrintDebugString();
-      }
 
-      string serialized;
-      if (!s.SerializeToString(&serialized))
+/*******************************************************************************************/
+/*                                                                                         */
+/* void reportSubprocess(const subprocess_request_t *request, int status,                  */
+/*                       const struct timespec *start)                                     */
+/*                                                                                         */
+/* Reports how a subprocess went to syslog, the status log, as request->event, and         */
+/* request->status, and keeps the statistics.                                              */
+/*                                                                                         */
+/* Returns: None                                                                           */
+/*                                                                                         */
+/*******************************************************************************************/
+void reportSubprocess(const subprocess_request_t *request, int status, const struct timespec *start)
+{
+   struct timespec end;
+   (void)clock_gettime(CLOCK_MONOTONIC, &end);
+
+   uint32_t milliseconds = (uint32_t)(timespecDiffMicroseconds(&end, start) / 1000);
+   uint32_t queuedMilliseconds = (uint32_t)(timespecDiffMicroseconds(start, &request->queued) / 1000);
+   subprocessesRun++;
+   if (milliseconds > subprocessMaxMilliseconds)
+   {
+      subprocessMaxMilliseconds = milliseconds;
+      (void)strncpy(subprocessMaxName, request->name, sizeof(subprocessMaxName) - 1);
+   }
+
+   char descr_str[LOGERROR_DESCR_SIZE];
+   if (-ETIMEDOUT == status)
+   {
+      subprocessesTimedOut++;
+      subprocessesFailed++;
+      (void)snprintf(descr_str, sizeof(descr_str), "%s killed after %u s", request->name, request->timeout_seconds);
+      syslog(LOG_ERR, "Subprocess %s, %u ms queued", descr_str, queuedMilliseconds);
+   }
+   else if (status < 0)
+   {
+      subprocessesFailed++;
+      (void)snprintf(descr_str, sizeof(descr_str), "%s not run, error %d", request->name, -status);
+      syslog(LOG_ERR, "Subprocess %s", descr_str);
+   }
+   else
+   {
+      if (0 != status)
       {
-         if (debugPrintf)
-         {
-            cerr << "ERROR: Unable to serialize!\n";
-            syslog(LOG_ERR, "statusPublisherThread ERROR: Unable to serialize!");
-            (void)logError("", "statusPublisherThread", "unable to serialize");
-         }
+         subprocessesFailed++;
       }
+      (void)snprintf(descr_str, sizeof(descr_str), "%s exit %d, %u ms", request->name, status, milliseconds);
+      syslog((0 == status) ? LOG_INFO : LOG_WARNING, "Subprocess %s, %u ms queued", descr_str, queuedMilliseconds);
+   }
+   (void)logInternalEvent(request->event, descr_str);
 
-      memset(bytes, 0, DEFAULT_CSS_MESSAGE_BUFFER_SIZE);
-      (void)memcpy(bytes, serialized.data(), serialized.length());
+   if (NULL != request->status)
+   {
+      *request->status = status;
+   }
+}
 
-      rc = zmq_send(statusPublisher, bytes, serialized.length(), 0);
-      assert(rc == (int)serialized.length());
 
-      if (debugPrintf)
+/*******************************************************************************************/
+/*                                                                                         */
+/* bool reapUrgentSubprocesses()                                                           */
+/*                                                                                         */
+/* Reaps and reports the subprocesses started with runSubprocessNow that are done.         */
+/*                                                                                         */
+/* Returns: bool true if any are still outstanding                                         */
+/*                                                                                         */
+/*******************************************************************************************/
+bool reapUrgentSubprocesses()
+{
+   bool outstanding = false;
+   for (int slot = 0; slot < URGENT_SUBPROCESS_SLOTS; slot++)
+   {
+      pid_t pid = urgentSubprocessPids[slot].load();
+      if (URGENT_SUBPROCESS_CLAIMED == pid)
+      {
+         outstanding = true;
+         continue;
+      }
+      if (pid <= 0)
       {
-         cout << "Bytes sent: " << rc << "\n";
+         continue;
       }
 
-      (void)gettimeofday(&end, NULL);
-
-      executionTime = (((end.tv_sec - start.tv_sec) * ONE_SECOND_IN_MICROSECONDS) + (end.tv_usec - start.tv_usec));
-      if (executionTime < ONE_SECOND_IN_MICROSECONDS)
+      int status;
+      subprocess_request_t *request = &urgentSubprocesses[slot];
+      if (pollSubprocess(pid, &request->queued, request->timeout_seconds, &status))
       {
-         balance = ONE_SECOND_IN_MICROSECONDS - executionTime;
-//         printf("task execution took %d microseconds balance = %ld\n", executionTime, balance);
-         usleep(balance);
+         reportSubprocess(request, status, &request->queued);
+         urgentSubprocessPids[slot] = 0;
       }
       else
       {
-         // force a minimum thread sleep time
-//         printf("Execution time took more than 1 second - %d.%d\n", (executionTime / ONE_SECOND_IN_MICROSECONDS), (executionTime % ONE_SECOND_IN_MICROSECONDS));
-         usleep(MINIMUM_THREAD_SLEEP_TIME);
+         outstanding = true;
       }
    }
 
-   numThreadsRunning--;
-   pthread_exit(NULL);
+   return outstanding;
 }
 
 
 /*******************************************************************************************/
 /*                                                                                         */
-/* void *rtdPublisherThread(void *)                                                        */
+/* void runQueuedSubprocess(const subprocess_request_t *request)                           */
 /*                                                                                         */
-/* Once per second, read the RTD data (RTD raw counts, temp, shorted, etc) and publish it. */
+/* Runs a queued shell command and waits for it, checking more slowly the longer it runs,  */
+/* then reports how it went. Those started with runSubprocessNow are reaped meanwhile.     */
 /*                                                                                         */
-/* Returns: pthread_exit(NULL)                                                             */
+/* Returns: None                                                                           */
 /*                                                                                         */
 /*******************************************************************************************/
-void *rtdPublisherThread(void *)
+void runQueuedSubprocess(const subprocess_request_t *request)
 {
-   char bytes[DEFAULT_RTD_MESSAGE_BUFFER_SIZE];
-   char rtdPublisherPort[IP_STRING_SIZE + 14];  // Allow space for the tcp:// and :portnumber
-   (void)snprintf(rtdPublisherPort, sizeof(rtdPublisherPort), "tcp://%s:%d", controllerIPAddress, RTD_DATA_PUBLISHER_PORT);
-   (void)printf("rtdPublisherThread rtdPublisherPort = %s\n", rtdPublisherPort);
-
-   rtdPublisher = zmq_socket(context, ZMQ_PUB);
-   assert(rtdPublisher != 0);
+   struct timespec start;
+   pid_t pid = 0;
+   int status;
 
-   int rc = zmq_bind(rtdPublisher, rtdPublisherPort);
-   assert(rc == 0);
-
-   uint32_t sequenceNumber = 0;
-   struct timeval start;
-   struct timeval end;
-   uint32_t executionTime;
-   uint32_t balance;
-
-   numThreadsRunning++;
-   while(!sigTermReceived)
+   (void)clock_gettime(CLOCK_MONOTONIC, &start);
+   status = startSubprocess(request->command, &pid);
+   if (0 == status)
    {
-      (void)gettimeofday(&start, NULL);
-      ReadRTDs s;
-
-      s.set_topic(RTD_DATA_PUBLISHER_TOPIC);
-      s.set_hardware_revision((uint32_t)controllerBoardRevision);
-      s.set_controller_ip_address(controllerIPAddress);
-
-      for (int i = 0; i < NUM_RTDs; i++)
-      {
-         (void)s.add_rtd_data();
-         RTDData* newRTDData = s.mutable_rtd_data(i);
-         newRTDData->set_rtd_number((uint32_t)i+1);
-         newRTDData->set_location(labels[i]);
-         newRTDData->set_raw_counts((uint32_t)rtdMappings[i].value);
-         newRTDData->set_temperature((int32_t)lookupTempFromRawCounts(rtdMappings[i].value, i));
-         newRTDData->set_voltage(((float)(rtdMappings[i].value) * 1.8) / 4096.0);
-         newRTDData->set_temp_data_filename(rtdMappings[i].temp_data_filename);
-
-         if (rtdMappings[i].is_open)
-         {
-            newRTDData->set_is_open(true);
-         }
-         else
-         {
-            newRTDData->set_is_open(false);
-         }
-         if (rtdMappings[i].is_shorted)
-         {
-            newRTDData->set_is_shorted(true);
-         }
-         else
-         {
-            newRTDData->set_is_shorted(false);
-         }
-      }
-
-      s.set_sequence_number(sequenceNumber++);
-      if (debugCSS)
-      {
-         cout << "Packet contains error state Serialization:\n\n" << s.DebugString() << "\n\n";
-         s.PrintDebugString();
-      }
-
-      string serialized;
-      if (!s.SerializeToString(&serialized))
+      uint32_t pollMilliseconds = 1;
+      while (!pollSubprocess(pid, &start, request->timeout_seconds, &status))
       {
-         if (debugPrintf)
-         {
-            cerr << "ERROR: Unable to serialize!\n";
-            syslog(LOG_ERR, "rtdPublisherThread ERROR: Unable to serialize!");
-            (void)logError("", "rtdPublisherThread", "unable to serialize");
-         }
+         (void)reapUrgentSubprocesses();
+         (void)usleep(pollMilliseconds * 1000);
+         pollMilliseconds = std::min(pollMilliseconds * 2, (uint32_t)SUBPROCESS_POLL_MAX_MS);
       }
+   }
 
-      memset(bytes, 0, DEFAULT_RTD_MESSAGE_BUFFER_SIZE);
-      (void)memcpy(bytes, serialized.data(), serialized.length());
-
-      rc = zmq_send(rtdPublisher, bytes, serialized.length(), 0);
-      assert(rc == (int)serialized.length());
-
-      if (debugPrintf)
-      {
-         cout << "Bytes sent: " << rc << "\n";
-      }
+   reportSubprocess(request, status, &start);
+}
 
-      (void)gettimeofday(&end, NULL);
 
-      executionTime = (((end.tv_sec - start.tv_sec) * ONE_SECOND_IN_MICROSECONDS) + (end.tv_usec - start.tv_usec));
-      if (executionTime < ONE_SECOND_IN_MICROSECONDS)
-      {
-         balance = ONE_SECOND_IN_MICROSECONDS - executionTime;
-//         printf("task execution took %d microseconds balance = %ld\n", executionTime, balance);
-         usleep(balance);
-      }
-      else
+/*******************************************************************************************/
+/*                                                                                         */
+/* void *subprocessThread(void *)                                                          */
+/*                                                                                         */
+/* Runs the shell commands queued with runSubprocess, one at a time, so that the threads   */
+/* that need them never stall on a fork, an fsck or a systemctl.                           */
+/*                                                                                         */
+/* Returns: pthread_exit(NULL)                                                             */
+/*                                                                                         */
+/*******************************************************************************************/
+void *subprocessThread(void *)
+{
+   numThreadsRunning++;
+   while (!sigTermReceived)
+   {
+      // time out now and then to check for sigTermReceived, and often while there's one to reap
+      bool outstanding = reapUrgentSubprocesses();
+      subprocess_request_t request;
+      int timeout = outstanding ? SUBPROCESS_POLL_MAX_MS : SUBPROCESS_QUEUE_TIMEOUT_MS;
+      if (subprocess_queue.get(request, timeout) == 0)
       {
-         // force a minimum thread sleep time
-//         printf("Execution time took more than 1 second - %d.%d\n", (executionTime / ONE_SECOND_IN_MICROSECONDS), (executionTime % ONE_SECOND_IN_MICROSECONDS));
-         usleep(MINIMUM_THREAD_SLEEP_TIME);
+         runQueuedSubprocess(&request);
       }
    }
 
@@ -5562,6 +8577,14 @@ static const char *commandStr(uhc::SystemCommands command)
          command_str = "Eco_mode_off";
          break;
 
+      case SYSTEM_COMMAND_BATCH:
+         command_str = "Batch";
+         break;
+
+      case SYSTEM_COMMAND_QUERY_HISTORY:
+         command_str = "Query_history";
+         break;
+
       default:
          command_str = "";
          break;
@@ -5585,6 +8608,10 @@ static const char *internalStr(internal_event_t event)
          internal_str = "Timesync received";
          break;
 
+      case SUBPROCESS_EXITED_T:
+         internal_str = "Subprocess";
+         break;
+
       default:
          internal_str = "";
          break;
@@ -5660,7 +8687,7 @@ static void logfileNameCreate(char *name, size_t name_len, date_t date)
    // year
    // month
    // day
-   int gen_len = snprintf(name, name_len, EESLOGFILENAMETEMPLATE,
+   int gen_len = snprintf(name, name_len, logWriter.binary ? EESBINLOGFILENAMETEMPLATE : EESLOGFILENAMETEMPLATE,
                                           SD_CARD_LOG_DIRECTORY,
                                           date.year, date.month, date.day);
    assert(gen_len < (int)name_len);
@@ -5668,83 +8695,373 @@ static void logfileNameCreate(char *name, size_t name_len, date_t date)
 
 
 /**
- * @brief Open the status/error/event log file.
- *
- * Create the log file name from the given date, and attempt to open the file. If it already exists, it is
- * opened for append. If it does not already exist, it is created and then opened for append.
+ * @brief Open the status/error/event log file.
+ *
+ * Create the log file name from the given date, and attempt to open the file. If it already exists, it is
+ * opened for append. If it does not already exist, it is created and then opened for append.
+ *
+ * This function checks the sdCardExists flag before attempting to open the file. If the SD card is not present,
+ * no attempt is made to open the file, and the function returns a NULL file pointer. This simplifies the higher
+ * level code since it doesn't have to check for the SD card.
+ *
+ * @param name The of name (full path) of the file to open.
+ *
+ * @return A file pointer if the open succeeded, or 0 if it failed.
+ */
+static FILE *logfileOpen(const char *name)
+{
+   static bool error_reported = false;
+   FILE *fp = 0;
+
+   if (sigTermReceived)
+   {
+      // if we're exiting, return
+      return fp;
+   }
+
+   if (sdCardExists)
+   {
+      // Open the file for append. Create it if it does not already exist.
+      fp = fopen(name, "a");
+
+      if (0 == fp)
+      {
+         // Error opening log file for write. Fix and remount the SD card in the background, the file is
+         // opened again with the first record after that's done.
+         if (!fsckAttempted)
+         {
+            // One request, so the card is never left unmounted by the mount not fitting in the queue.
+            char repairCommand[COMMAND_LINE_BUFFER_SIZE];
+            switch(sdCardType)
+            {
+               case FAT32:
+                  (void)snprintf(repairCommand, sizeof(repairCommand), "%s; %s; %s",
+                                 SD_CARD_FSCK_CMD, UNMOUNT_SD_CARD_COMMAND, SD_CARD_MOUNT_VFAT_COMMAND);
+                  break;
+
+               case EXFAT:
+                  (void)snprintf(repairCommand, sizeof(repairCommand), "%s; %s; %s",
+                                 SD_CARD_EXFAT_FSCK_CMD, UNMOUNT_SD_CARD_COMMAND, SD_CARD_EXFAT_MOUNT_COMMAND);
+                  break;
+
+               case UNKNOWN:
+               default:
+                  fsckAttempted = true;
+                  return NULL;
+            }
+
+            sdCardRepairStatus = SUBPROCESS_PENDING;
+            if (0 == runSubprocess("SD card repair", repairCommand, 3 * SD_CARD_REPAIR_TIMEOUT_SECONDS, &sdCardRepairStatus))
+            {
+               fsckAttempted = true;
+            }
+            else
+            {
+               // not queued, try again with the next record
+               sdCardRepairStatus = 0;
+               return NULL;
+            }
+         }
+         if (SUBPROCESS_PENDING == sdCardRepairStatus)
+         {
+            // still being repaired, not an error yet
+            return NULL;
+         }
+      }
+      else
+      {
+         fsckAttempted = false;
+      }
+
+      if (0 == fp)
+      {
+         if (!error_reported)
+         {
+            // Log this error only the first time.
+            syslog(LOG_ERR, SD_CARD_MISSING_OR_CORRUPT ": Unable to open log file %s", name);
+            error_reported = true;
+         }
+      }
+      else
+      {
+         error_reported = false;
+      }
+   }
+
+   return fp;
+}
+
+
+/**
+ * @brief Return the log writer's handle to the given log file, opening it if need be.
+ *
+ * The file stays open from one record to the next, so the card sees a directory lookup and FAT update
+ * when the file is opened rather than with every record. A different name (the next day's file), a change
+ * of SD card or an earlier write error closes the open file first.
+ *
+ * @param name The name (full path) of the log file.
+ *
+ * @return A file pointer if the file is open, or 0 if it is not.
+ */
+static FILE *logWriterOpen(const char *name)
+{
+   if (logWriterReopen.exchange(false) || !sdCardExists)
+   {
+      logWriterClose();
+      recentErrors.loaded = false;     // the next card may not have the same recent errors
+   }
+
+   if ((0 != logWriter.fp) && (0 == strcmp(name, logWriter.name)))
+   {
+      return logWriter.fp;
+   }
+
+   logWriterClose();
+   logWriter.fp = logfileOpen(name);
+   if (0 != logWriter.fp)
+   {
+      // Records collect in our buffer until logWriterRecordDone() decides to write them.
+      (void)setvbuf(logWriter.fp, logWriter.buffer, _IOFBF, sizeof(logWriter.buffer));
+      (void)fseek(logWriter.fp, 0, SEEK_END);
+      logWriter.flushed_offset = ftell(logWriter.fp);
+      logWriter.first_unflushed_seconds = 0;
+      (void)strncpy(logWriter.name, name, sizeof(logWriter.name) - 1);
+      logWriter.name[sizeof(logWriter.name) - 1] = 0;
+      logFileOpens++;
+
+      if (logWriter.binary)
+      {
+         eeslogBlockReset(&logWriter.block);
+         if (0 == logWriter.flushed_offset)
+         {
+            // a new file, it starts with the day header
+            uint8_t header[EESLOG_DAY_HEADER_SIZE];
+            date_t today = currentDateGet();
+            eeslogDayHeader(header, today.year, today.month, today.day);
+            (void)fwrite(header, 1, sizeof(header), logWriter.fp);
+         }
+      }
+   }
+
+   return logWriter.fp;
+}
+
+
+/**
+ * @brief Decide whether to write out the log writer's buffer after a record (or batch of records).
+ *
+ * The buffer is written and the file fdatasync'd once LOG_FLUSH_BYTES are buffered, once the oldest buffered
+ * record is LOG_FLUSH_INTERVAL_SEC old, or straight away if asked to.
+ *
+ * @param[in] flushNow Write the buffer out now, e.g. because an error was just logged.
+ */
+static void logWriterRecordDone(bool flushNow)
+{
+   if (0 == logWriter.fp)
+   {
+      return;
+   }
+
+   long pending = ftell(logWriter.fp) - logWriter.flushed_offset;
+   if (logWriter.binary)
+   {
+      pending += logWriter.block.length;
+   }
+   uint32_t now = monotonicSeconds();
+   if ((0 == logWriter.first_unflushed_seconds) && (pending > 0))
+   {
+      logWriter.first_unflushed_seconds = now;
+   }
+
+   if (flushNow || (pending >= LOG_FLUSH_BYTES) ||
+       ((pending > 0) && ((now - logWriter.first_unflushed_seconds) >= LOG_FLUSH_INTERVAL_SEC)))
+   {
+      logWriterFlush();
+   }
+}
+
+
+/**
+ * @brief Write out the log writer's buffer and fdatasync the log file.
+ *
+ * If the write fails (e.g. the card was pulled) the file is closed, and the next record opens it again.
+ */
+static void logWriterFlush()
+{
+   if (0 == logWriter.fp)
+   {
+      return;
+   }
+
+   if (logWriter.binary)
+   {
+      logBinaryFinishBlock();
+   }
+
+   struct timespec start;
+   struct timespec end;
+   (void)clock_gettime(CLOCK_MONOTONIC, &start);
+   int status = fflush(logWriter.fp);
+   if (0 == status)
+   {
+      status = fdatasync(fileno(logWriter.fp));
+   }
+   (void)clock_gettime(CLOCK_MONOTONIC, &end);
+
+   uint32_t latency = (uint32_t)(((end.tv_sec - start.tv_sec) * 1000000) + ((end.tv_nsec - start.tv_nsec) / 1000));
+   logFlushLatencyMicroseconds = latency;
+   if (latency > logFlushLatencyMaxMicroseconds)
+   {
+      logFlushLatencyMaxMicroseconds = latency;
+   }
+   logFileFlushes++;
+
+   long offset = ftell(logWriter.fp);
+   if (offset > logWriter.flushed_offset)
+   {
+      logFileBytesToday += (uint32_t)(offset - logWriter.flushed_offset);
+      logWriter.flushed_offset = offset;
+   }
+   logWriter.first_unflushed_seconds = 0;
+
+   if ((0 != status) || ferror(logWriter.fp))
+   {
+      syslog(LOG_ERR, "Log file %s write failed: %s", logWriter.name, strerror(errno));
+      (void)fclose(logWriter.fp);
+      logWriter.fp = 0;
+   }
+}
+
+
+/**
+ * @brief Write out anything buffered and close the log file.
+ */
+static void logWriterClose()
+{
+   if (0 != logWriter.fp)
+   {
+      logWriterFlush();
+   }
+
+   if (0 != logWriter.fp)
+   {
+      (void)fclose(logWriter.fp);
+      logWriter.fp = 0;
+   }
+}
+
+
+/**
+ * @brief Hand the binary block being built to the log file, and start a new one.
+ */
+static void logBinaryFinishBlock()
+{
+   if ((0 != logWriter.fp) && (0 != logWriter.block.num_records))
+   {
+      uint8_t header[EESLOG_BLOCK_HEADER_SIZE];
+      eeslogBlockHeader(&logWriter.block, header);
+      (void)fwrite(header, 1, sizeof(header), logWriter.fp);
+      (void)fwrite(logWriter.block.payload, 1, logWriter.block.length, logWriter.fp);
+   }
+
+   eeslogBlockReset(&logWriter.block);
+}
+
+
+/**
+ * @brief Add text, to be copied to the CSV as is, to the binary log.
+ *
+ * @param[in] text The text.
+ *
+ * @param[in] len The length of the text.
+ */
+static void logBinaryTextWrite(const char *text, size_t len)
+{
+   struct timeval now;
+   struct tm nowtm;
+   (void)gettimeofday(&now, NULL);
+   time_t nowtime = now.tv_sec;
+   (void)localtime_r(&nowtime, &nowtm);
+
+   while (len > 0)
+   {
+      uint16_t chunk = (len > EESLOG_TEXT_CHUNK_SIZE) ? EESLOG_TEXT_CHUNK_SIZE : (uint16_t)len;
+      if (!eeslogAddText(&logWriter.block, text, chunk, (uint32_t)now.tv_sec, nowtm.tm_gmtoff, (nowtm.tm_isdst > 0) ? 1 : 0))
+      {
+         logBinaryFinishBlock();
+         (void)eeslogAddText(&logWriter.block, text, chunk, (uint32_t)now.tv_sec, nowtm.tm_gmtoff, (nowtm.tm_isdst > 0) ? 1 : 0);
+      }
+      text += chunk;
+      len -= chunk;
+   }
+}
+
+
+/**
+ * @brief Add an error or event record to the binary log.
  *
- * This function checks the sdCardExists flag before attempting to open the file. If the SD card is not present,
- * no attempt is made to open the file, and the function returns a NULL file pointer. This simplifies the higher
- * level code since it doesn't have to check for the SD card.
+ * @param[in] timestamp When it happened.
  *
- * @param name The of name (full path) of the file to open.
+ * @param[in] column EESLOG_EVENT_COLUMN_EVENTS or EESLOG_EVENT_COLUMN_ERROR.
  *
- * @return A file pointer if the open succeeded, or 0 if it failed.
+ * @param[in] text The formatted error or event.
  */
-static FILE *logfileOpen(const char *name)
+static void logBinaryEventWrite(struct timeval timestamp, uint8_t column, const char *text)
 {
-   static bool error_reported = false;
-   FILE *fp = 0;
+   struct tm eventtm;
+   time_t eventtime = timestamp.tv_sec;
+   (void)localtime_r(&eventtime, &eventtm);
 
-   if (sigTermReceived)
+   if (!eeslogAddEvent(&logWriter.block, (uint32_t)timestamp.tv_sec, eventtm.tm_gmtoff, (eventtm.tm_isdst > 0) ? 1 : 0, column, text))
    {
-      // if we're exiting, return
-      return fp;
+      logBinaryFinishBlock();
+      (void)eeslogAddEvent(&logWriter.block, (uint32_t)timestamp.tv_sec, eventtm.tm_gmtoff, (eventtm.tm_isdst > 0) ? 1 : 0, column, text);
    }
+}
 
-   if (sdCardExists)
-   {
-      // Open the file for append. Create it if it does not already exist.
-      fp = fopen(name, "a");
-
-      if (0 == fp)
-      {
-         // Error opening log file for write. Fix and remount the SD card, then try again to open the file.
-         if (!fsckAttempted)
-         {
-            fsckAttempted = true;
-            switch(sdCardType)
-            {
-               case FAT32:
-                  (void)system(SD_CARD_FSCK_CMD);
-                  (void)system(UNMOUNT_SD_CARD_COMMAND);
-                  (void)system(SD_CARD_MOUNT_VFAT_COMMAND);
-                  break;
-
-               case EXFAT:
-                  (void)system(SD_CARD_EXFAT_FSCK_CMD);
-                  (void)system(UNMOUNT_SD_CARD_COMMAND);
-                  (void)system(SD_CARD_EXFAT_MOUNT_COMMAND);
-                  break;
 
-               case UNKNOWN:
-               default:
-                  return NULL;
-            }
-         }
-         fp = fopen(name, "a");
-      }
-      else
-      {
-         fsckAttempted = false;
-      }
+/**
+ * @brief Add a status record to the binary log.
+ *
+ * Collects the same values logStatusWrite() prints to the CSV, without formatting them; logConvert does that.
+ *
+ * @param[in] snapshot The sensor readings to log.
+ */
+static void logBinaryStatusWrite(const SENSOR_SNAPSHOT *snapshot)
+{
+   EESLOG_STATUS status;
+   struct timeval now;
+   struct tm nowtm;
+   (void)gettimeofday(&now, NULL);
+   time_t nowtime = now.tv_sec;
+   (void)localtime_r(&nowtime, &nowtm);
 
-      if (0 == fp)
-      {
-         if (!error_reported)
-         {
-            // Log this error only the first time.
-            syslog(LOG_ERR, SD_CARD_MISSING_OR_CORRUPT ": Unable to open log file %s", name);
-            error_reported = true;
-         }
-      }
-      else
-      {
-         error_reported = false;
-      }
+   status.utc_seconds = (uint32_t)now.tv_sec;
+   status.gmtoff_seconds = nowtm.tm_gmtoff;
+   status.is_dst = (nowtm.tm_isdst > 0) ? 1 : 0;
+   status.strings[EESLOG_STRING_SYSTEM] = systemStatusStr();
+   status.strings[EESLOG_STRING_FAN1] = 0 == fanInfo[0].fan_on ? "OFF" : "ON";
+   status.strings[EESLOG_STRING_FAN2] = 0 == fanInfo[1].fan_on ? "OFF" : "ON";
+   for (int i = 0; i < EESLOG_NUM_SLOTS; i++)
+   {
+      status.strings[EESLOG_STRING_SLOT1 + i] = slotStatusStr(i);
+   }
+   for (int i = 0; i < EESLOG_NUM_HEATERS; i++)
+   {
+      status.strings[EESLOG_STRING_HEATER1 + i] = heaterStatusStr(i);
+      status.setpoint[i] = heaterInfo[i].temperature_setpoint;
+      status.temperature_tenths[i] = snapshot->temperature_tenths[i];
    }
+   status.ambient = snapshotAmbientTemp(snapshot);
+   status.heatsink = snapshot->temperature[HEATSINK_RTD_INDEX];
+   status.voltage = snapshot->voltage;
+   status.irms = snapshot->irms;
 
-   return fp;
+   if (!eeslogAddStatus(&logWriter.block, &status))
+   {
+      logBinaryFinishBlock();
+      (void)eeslogAddStatus(&logWriter.block, &status);
+   }
 }
 
 
@@ -5755,17 +9072,21 @@ static FILE *logfileOpen(const char *name)
  */
 static void logHeaderWrite(const char *fileName)
 {
-   FILE *logfileHandle = logfileOpen(fileName);
+   static char logHeaderText[LOG_HEADER_TEXT_SIZE];
+   FILE *headerText = 0;
+
+   FILE *logfileHandle = logWriterOpen(fileName);
+   if ((0 != logfileHandle) && logWriter.binary)
+   {
+      // The header goes into the binary log as text, formatted in memory first.
+      headerText = fmemopen(logHeaderText, sizeof(logHeaderText), "w");
+      logfileHandle = headerText;
+   }
+
    if (0 != logfileHandle)
    {
-      // Read the most recent 25 errors file to get the content and the number of errors.
-      std::string recent_errors[25];
-      size_t num_recent_errors = 0;
-      std::ifstream recent_errors_file(RECENT_ERRORS_FILE);
-      while ((num_recent_errors < 25) && getline(recent_errors_file, recent_errors[num_recent_errors]))
-      {
-         ++num_recent_errors;
-      }
+      // Read the most recent 25 errors file, if it hasn't been, to get the content and the number of errors.
+      recentErrorsLoad();
 
       // The log file template is intended to produce a log file that is in CSV format, suitable for importing
       // into a spreadsheet program. The log file header records should have an empty cell in column A.
@@ -5803,19 +9124,18 @@ static void logHeaderWrite(const char *fileName)
       (void)fprintf(logfileHandle, "\n\"\",\" ===== ERROR LOG =====\"\n");
 
       // Row 15 has the total number of errors in this section, row 16 is blank.
-      (void)fprintf(logfileHandle, "\"\",\" Tot Num Errors = %u\"\n\n", num_recent_errors);
+      (void)fprintf(logfileHandle, "\"\",\" Tot Num Errors = %d\"\n\n", recentErrors.count);
 
       // Row 17 has the current date and time.
       (void)fprintf(logfileHandle, "\"\",\" A. %s *NOW*\"\n", timestr);
 
       // Rows 18 - 42 each have an error message or "---- Empty ----"
       char error_tag = 'B';
-      for (size_t i = 0; i < 25; ++i)
+      for (int i = 0; i < RECENT_ERRORS_MAX; ++i)
       {
-         // Could compare i to num_recent_errors for this, but checking for empty string is more straightforward.
-         if (!recent_errors[i].empty())
+         if ((i < recentErrors.count) && ('\0' != recentErrors.lines[i][0]))
          {
-            (void)fprintf(logfileHandle, "\"\",\" %c. %s\"\n", error_tag, recent_errors[i].c_str());
+            (void)fprintf(logfileHandle, "\"\",\" %c. %s\"\n", error_tag, recentErrors.lines[i]);
          }
          else
          {
@@ -5843,108 +9163,149 @@ static void logHeaderWrite(const char *fileName)
                "\" ... EVENTS ...\",\" ERROR\""
                "\n");
 
-      (void)fflush(logfileHandle);
-      (void)fclose(logfileHandle);
+      if (0 != headerText)
+      {
+         long len = ftell(headerText);
+         (void)fclose(headerText);
+         logBinaryTextWrite(logHeaderText, (len > 0) ? (size_t)len : 0);
+      }
+
+      logWriterRecordDone(false);
    }
 }
 
 
 /**
- * @brief Write an error or event record to the status/error/event log file.
+ * @brief Write a batch of error and event records to the status/error/event log file.
+ *
+ * The batch is formatted into the log writer's buffer in one go, and the errors in it are added to the
+ * most recent 25 errors log in one go, so a burst of events costs about as much to write as a single one.
+ * A batch with an error in it is flushed to the card straight away.
  *
- * @param[in] logfileHandle The name of the log file.
+ * @param[in] fileName The name of the log file.
+ *
+ * @param[in] ees The error or event data to write, oldest first.
  *
- * @param[in] ee The error or event data to write.
+ * @param[in] count The number of records in ees, at most LOG_DRAIN_MAX.
  */
-static void logErrorEventWrite(const char *fileName, const error_event_t &ee)
+static void logErrorEventsWrite(const char *fileName, const error_event_t *ees, int count)
 {
-   FILE *logfileHandle = logfileOpen(fileName);
+   FILE *logfileHandle = logWriterOpen(fileName);
    if (0 != logfileHandle)
    {
-      // Get the date and time string for columns A and B. Format them with "," between them to
-      // make it easy to use it in the CSV output.
-      struct tm nowtm;
-      time_t nowtime = ee.timestamp.tv_sec;
-      (void)localtime_r(&nowtime, &nowtm);
-      char timestr_colAB[TIME_STR_SIZE];    // Long enough to hold mm-dd-yyyy","hh:MM:ss AM.
-      size_t gen_len = strftime(timestr_colAB, sizeof(timestr_colAB), "%m/%d/%Y\",\"%H:%M:%S", &nowtm);
-      assert(0 != gen_len);
-
-      const char *fmt = "\"%s\","                                                         // Date and time (columns A and B)
-                        "\"\",\"\",\"\",\"\",\"\",\"\",\"\",\"\",\"\",\"\",\"\",\"\","    // Columns C - BA (51 columns) are empty.
-                        "\"\",\"\",\"\",\"\",\"\",\"\",\"\",\"\",\"\",\"\",\"\",\"\","    // 12 empty fields on this line and on the one above.
-                        "\"\",\"\",\"\",\"\",\"\",\"\",\"\",\"\",\"\",\"\",\"\",\"\","    // 12 more empty fields.
-                        "\"\",\"\",\"\",\"\",\"\",\"\",\"\",\"\",\"\",\"\",\"\",\"\","    // 12 more empty fields.
-                        "\"\",\"\",\"\","                                                 // And three more makes 51.
-                        "\"%s\",\"%s\""                                                   // Events, error.
-                        "\n";                                                             // Terminate the record with a newline.
-
-      char error_event_str[LOGERROR_LOCATION_SIZE + LOGERROR_DESCR_SIZE + 32];   // Add space for the error code
+      struct timeval recent_timestamps[LOG_DRAIN_MAX];
+      char recent_errors[LOG_DRAIN_MAX][LOG_ERROR_EVENT_STR_SIZE];
+      int num_recent = 0;
 
-      if (ERROR_T == ee.type)
+      for (int i = 0; (i < count) && (i < LOG_DRAIN_MAX); i++)
       {
-         (void)snprintf(error_event_str, sizeof(error_event_str), "%s @ %s: %s",
-                                                                  ee.data.error_data.error_code,
-                                                                  ee.data.error_data.location,
-                                                                  ee.data.error_data.description);
-         (void)fprintf(logfileHandle, fmt, timestr_colAB, "", error_event_str);
-         (void)fflush(logfileHandle);
+         const error_event_t &ee = ees[i];
+         char error_event_str[LOG_ERROR_EVENT_STR_SIZE];
+         int column = -1;
 
-         // Also record the error in the most recent 25 errors log.
-         logAppendRecentErrors(ee.timestamp, error_event_str);
-      }
-      else if (COMMAND_EVENT_T == ee.type)
-      {
-         switch (ee.data.command_event_data.command_data_len)
+         if (ERROR_T == ee.type)
          {
-            default:
-            case 0:
-               (void)snprintf(error_event_str, sizeof(error_event_str), "command %s from %s",
-                                                                        commandStr(ee.data.command_event_data.command),
-                                                                        ee.data.command_event_data.sender_ip_address);
-               break;
+            (void)snprintf(error_event_str, sizeof(error_event_str), "%s @ %s: %s",
+                                                                     ee.data.error_data.error_code,
+                                                                     ee.data.error_data.location,
+                                                                     ee.data.error_data.description);
+            column = EESLOG_EVENT_COLUMN_ERROR;
 
-            case 1:
-               (void)snprintf(error_event_str, sizeof(error_event_str), "command %s from %s: %d",
-                                                                        commandStr(ee.data.command_event_data.command),
-                                                                        ee.data.command_event_data.sender_ip_address,
-                                                                        ee.data.command_event_data.command_data[0]);
-               break;
+            // Also record the error in the most recent 25 errors log, once the batch is written.
+            recent_timestamps[num_recent] = ee.timestamp;
+            (void)memcpy(recent_errors[num_recent], error_event_str, sizeof(recent_errors[num_recent]));
+            num_recent++;
+         }
+         else if (COMMAND_EVENT_T == ee.type)
+         {
+            switch (ee.data.command_event_data.command_data_len)
+            {
+               default:
+               case 0:
+                  (void)snprintf(error_event_str, sizeof(error_event_str), "command %s from %s",
+                                                                           commandStr(ee.data.command_event_data.command),
+                                                                           ee.data.command_event_data.sender_ip_address);
+                  break;
 
-            case 2:
-               (void)snprintf(error_event_str, sizeof(error_event_str), "command %s from %s: %d, %d",
-                                                                        commandStr(ee.data.command_event_data.command),
-                                                                        ee.data.command_event_data.sender_ip_address,
-                                                                        ee.data.command_event_data.command_data[0],
-                                                                        ee.data.command_event_data.command_data[1]);
-               break;
+               case 1:
+                  (void)snprintf(error_event_str, sizeof(error_event_str), "command %s from %s: %d",
+                                                                           commandStr(ee.data.command_event_data.command),
+                                                                           ee.data.command_event_data.sender_ip_address,
+                                                                           ee.data.command_event_data.command_data[0]);
+                  break;
 
-            case 3:
-               (void)snprintf(error_event_str, sizeof(error_event_str), "command %s from %s: %d, %d, %d",
-                                                                        commandStr(ee.data.command_event_data.command),
-                                                                        ee.data.command_event_data.sender_ip_address,
-                                                                        ee.data.command_event_data.command_data[0],
-                                                                        ee.data.command_event_data.command_data[1],
-                                                                        ee.data.command_event_data.command_data[2]);
-               break;
+               case 2:
+                  (void)snprintf(error_event_str, sizeof(error_event_str), "command %s from %s: %d, %d",
+                                                                           commandStr(ee.data.command_event_data.command),
+                                                                           ee.data.command_event_data.sender_ip_address,
+                                                                           ee.data.command_event_data.command_data[0],
+                                                                           ee.data.command_event_data.command_data[1]);
+                  break;
+
+               case 3:
+                  (void)snprintf(error_event_str, sizeof(error_event_str), "command %s from %s: %d, %d, %d",
+                                                                           commandStr(ee.data.command_event_data.command),
+                                                                           ee.data.command_event_data.sender_ip_address,
+                                                                           ee.data.command_event_data.command_data[0],
+                                                                           ee.data.command_event_data.command_data[1],
+                                                                           ee.data.command_event_data.command_data[2]);
+                  break;
+            }
+
+            column = EESLOG_EVENT_COLUMN_EVENTS;
+         }
+         else if (INTERNAL_EVENT_T == ee.type)
+         {
+            if ('\0' != ee.data.internal_event_data.description[0])
+            {
+               (void)snprintf(error_event_str, sizeof(error_event_str), "internal: %s %s",
+                                                                        internalStr(ee.data.internal_event_data.event),
+                                                                        ee.data.internal_event_data.description);
+            }
+            else
+            {
+               (void)snprintf(error_event_str, sizeof(error_event_str), "internal: %s",
+                                                                        internalStr(ee.data.internal_event_data.event));
+            }
+            column = EESLOG_EVENT_COLUMN_EVENTS;
+         }
+         else
+         {
+            // Some undefined data, there's nothing to do.
          }
 
-         (void)fprintf(logfileHandle, fmt, timestr_colAB, error_event_str, "");
-         (void)fflush(logfileHandle);
-      }
-      else if (INTERNAL_EVENT_T == ee.type)
-      {
-         (void)snprintf(error_event_str, sizeof(error_event_str), "internal: %s",
-                                                                  internalStr(ee.data.internal_event_data.event));
-         (void)fprintf(logfileHandle, fmt, timestr_colAB, error_event_str, "");
-         (void)fflush(logfileHandle);
+         if (column < 0)
+         {
+            continue;
+         }
+
+         if (logWriter.binary)
+         {
+            logBinaryEventWrite(ee.timestamp, (uint8_t)column, error_event_str);
+         }
+         else
+         {
+            // Get the date and time string for columns A and B. Format them with "," between them to
+            // make it easy to use it in the CSV output.
+            struct tm nowtm;
+            time_t nowtime = ee.timestamp.tv_sec;
+            (void)localtime_r(&nowtime, &nowtm);
+            char timestr_colAB[TIME_STR_SIZE];    // Long enough to hold mm-dd-yyyy","hh:MM:ss AM.
+            size_t gen_len = strftime(timestr_colAB, sizeof(timestr_colAB), EESLOG_CSV_TIME_FORMAT, &nowtm);
+            assert(0 != gen_len);
+
+            (void)fprintf(logfileHandle, EESLOG_CSV_EVENT_FORMAT, timestr_colAB,
+                          (EESLOG_EVENT_COLUMN_EVENTS == column) ? error_event_str : "",
+                          (EESLOG_EVENT_COLUMN_ERROR == column) ? error_event_str : "");
+         }
       }
-      else
+
+      logWriterRecordDone(num_recent > 0);
+
+      if (num_recent > 0)
       {
-         // Some undefined data, there's nothing to do.
+         logAppendRecentErrors(recent_timestamps, recent_errors, num_recent);
       }
-
-      (void)fclose(logfileHandle);
    }
 }
 
@@ -5956,15 +9317,25 @@ static void logErrorEventWrite(const char *fileName, const error_event_t &ee)
  */
 static void logStatusWrite(const char *fileName)
 {
-   FILE *logfileHandle = logfileOpen(fileName);
+   FILE *logfileHandle = logWriterOpen(fileName);
    if (0 != logfileHandle)
    {
+      SENSOR_SNAPSHOT snapshot;
+      getSensorSnapshot(&snapshot);
+
+      if (logWriter.binary)
+      {
+         logBinaryStatusWrite(&snapshot);
+         logWriterRecordDone(false);
+         return;
+      }
+
       // Get the date and time string for columns A and B. Format them with "," between them to
       // make it easy to use it in the CSV output.
       struct tm nowtm;
       nowLocalGet(&nowtm);
       char timestr_colAB[TIME_STR_SIZE];     // Long enough to hold mm-dd-yyyy","hh:MM:ss AM.
-      size_t gen_len = strftime(timestr_colAB, sizeof(timestr_colAB), "%m/%d/%Y\",\"%H:%M:%S", &nowtm);
+      size_t gen_len = strftime(timestr_colAB, sizeof(timestr_colAB), EESLOG_CSV_TIME_FORMAT, &nowtm);
       assert(0 != gen_len);
 
       // Calculate the UTC offset in the proper format: +/-mm:ss.
@@ -5974,80 +9345,66 @@ static void logStatusWrite(const char *fileName)
       (void)snprintf(utc_offset_str, sizeof(utc_offset_str), "%+03d:%02d", utc_offset_hours, utc_offset_minutes);
 
       // Write the status record.
-      (void)fprintf(logfileHandle,
-               "\"%s\",\"%s\",\"%d\","                               // Date and time, UTC offset, DST enabled.
-               "\"%s\","                                             // Status (clean/normal).
-               "\"%s\",\"%s\","                                      // Fan 1 and Fan 2 status.
-               "\"%d\",\"%d\","                                      // Ambient and heat sink temperatures.
-               "\"%.0f\",\"%.1f\","                                  // Voltage and current.
-               "\"%s\",\"%s\",\"%d\",\"%d\",\"%s\",\"%d\",\"%d\","   // Shelf 1 status, upper(status, setpoint, temp), lower(status, setpoint, temp).
-               "\"%s\",\"%s\",\"%d\",\"%d\",\"%s\",\"%d\",\"%d\","   // Shelf 2 status, upper(status, setpoint, temp), lower(status, setpoint, temp).
-               "\"%s\",\"%s\",\"%d\",\"%d\",\"%s\",\"%d\",\"%d\","   // Shelf 3 status, upper(status, setpoint, temp), lower(status, setpoint, temp).
-               "\"%s\",\"%s\",\"%d\",\"%d\",\"%s\",\"%d\",\"%d\","   // Shelf 4 status, upper(status, setpoint, temp), lower(status, setpoint, temp).
-               "\"%s\",\"%s\",\"%d\",\"%d\",\"%s\",\"%d\",\"%d\","   // Shelf 5 status, upper(status, setpoint, temp), lower(status, setpoint, temp).
-               "\"%s\",\"%s\",\"%d\",\"%d\",\"%s\",\"%d\",\"%d\","   // Shelf 6 status, upper(status, setpoint, temp), lower(status, setpoint, temp).
-               "\"\",\"\""                                           // Events, error. These fields are empty in a status message.
-               "\n",                                                 // Terminate the record with a newline.
+      (void)fprintf(logfileHandle, EESLOG_CSV_STATUS_FORMAT,
                timestr_colAB,                                        // Date and time.
                utc_offset_str,                                       // UTC offset as +/-mmss.
                (nowtm.tm_isdst > 0) ? 1 : 0,                         // DST enabled.
                systemStatusStr(),                                    // System status.
                0 == fanInfo[0].fan_on ? "OFF" : "ON",                // Fan 1 status.
                0 == fanInfo[1].fan_on ? "OFF" : "ON",                // Fan 2 status.
-               0,                                                    // Ambient temperature. TODO: Fill this in once we're measuring it.
-               heatsinkTemp,                                         // Heatsink temperature.
-               voltage, irms,                                        // Voltage and current.
+               snapshotAmbientTemp(&snapshot),                       // Ambient temperature.
+               snapshot.temperature[HEATSINK_RTD_INDEX],             // Heatsink temperature.
+               snapshot.voltage, snapshot.irms,                      // Voltage and current.
                slotStatusStr(0),                                     // Shelf 1 status.
                heaterStatusStr(0),                                   // Shelf 1 upper heater status.
                heaterInfo[0].temperature_setpoint,                   // Shelf 1 upper heater setpoint.
-               heaterInfo[0].current_temperature,                    // Shelf 1 upper heater temperature.
+               TEMP_TENTHS_TO_DEGREES(snapshot.temperature_tenths[0]),// Shelf 1 upper heater temperature.
                heaterStatusStr(1),                                   // Shelf 1 lower heater status.
                heaterInfo[1].temperature_setpoint,                   // Shelf 1 lower heater setpoint.
-               heaterInfo[1].current_temperature,                    // Shelf 1 lower heater temperature.
+               TEMP_TENTHS_TO_DEGREES(snapshot.temperature_tenths[1]),// Shelf 1 lower heater temperature.
 
                slotStatusStr(1),                                     // Shelf 2 status.
                heaterStatusStr(2),                                   // Shelf 2 upper heater status.
                heaterInfo[2].temperature_setpoint,                   // Shelf 2 upper heater setpoint.
-               heaterInfo[2].current_temperature,                    // Shelf 2 upper heater temperature.
+               TEMP_TENTHS_TO_DEGREES(snapshot.temperature_tenths[2]),// Shelf 2 upper heater temperature.
                heaterStatusStr(3),                                   // Shelf 2 lower heater status.
                heaterInfo[3].temperature_setpoint,                   // Shelf 2 lower heater setpoint.
-               heaterInfo[3].current_temperature,                    // Shelf 2 lower heater temperature.
+               TEMP_TENTHS_TO_DEGREES(snapshot.temperature_tenths[3]),// Shelf 2 lower heater temperature.
 
                slotStatusStr(2),                                     // Shelf 3 status.
                heaterStatusStr(4),                                   // Shelf 3 upper heater status.
                heaterInfo[4].temperature_setpoint,                   // Shelf 3 upper heater setpoint.
-               heaterInfo[4].current_temperature,                    // Shelf 3 upper heater temperature.
+               TEMP_TENTHS_TO_DEGREES(snapshot.temperature_tenths[4]),// Shelf 3 upper heater temperature.
                heaterStatusStr(5),                                   // Shelf 3 lower heater status.
                heaterInfo[5].temperature_setpoint,                   // Shelf 3 lower heater setpoint.
-               heaterInfo[5].current_temperature,                    // Shelf 3 lower heater temperature.
+               TEMP_TENTHS_TO_DEGREES(snapshot.temperature_tenths[5]),// Shelf 3 lower heater temperature.
 
                slotStatusStr(3),                                     // Shelf 4 status.
                heaterStatusStr(6),                                   // Shelf 4 upper heater status.
                heaterInfo[6].temperature_setpoint,                   // Shelf 4 upper heater setpoint.
-               heaterInfo[6].current_temperature,                    // Shelf 4 upper heater temperature.
+               TEMP_TENTHS_TO_DEGREES(snapshot.temperature_tenths[6]),// Shelf 4 upper heater temperature.
                heaterStatusStr(7),                                   // Shelf 4 lower heater status.
                heaterInfo[7].temperature_setpoint,                   // Shelf 4 lower heater setpoint.
-               heaterInfo[7].current_temperature,                    // Shelf 4 lower heater temperature.
+               TEMP_TENTHS_TO_DEGREES(snapshot.temperature_tenths[7]),// Shelf 4 lower heater temperature.
 
                slotStatusStr(4),                                     // Shelf 5 status.
                heaterStatusStr(8),                                   // Shelf 5 upper heater status.
                heaterInfo[8].temperature_setpoint,                   // Shelf 5 upper heater setpoint.
-               heaterInfo[8].current_temperature,                    // Shelf 5 upper heater temperature.
+               TEMP_TENTHS_TO_DEGREES(snapshot.temperature_tenths[8]),// Shelf 5 upper heater temperature.
                heaterStatusStr(9),                                   // Shelf 5 lower heater status.
                heaterInfo[9].temperature_setpoint,                   // Shelf 5 lower heater setpoint.
-               heaterInfo[9].current_temperature,                    // Shelf 5 lower heater temperature.
+               TEMP_TENTHS_TO_DEGREES(snapshot.temperature_tenths[9]),// Shelf 5 lower heater temperature.
 
                slotStatusStr(5),                                     // Shelf 6 status.
                heaterStatusStr(10),                                  // Shelf 6 upper heater status.
                heaterInfo[10].temperature_setpoint,                  // Shelf 6 upper heater setpoint.
-               heaterInfo[10].current_temperature,                   // Shelf 6 upper heater temperature.
+               TEMP_TENTHS_TO_DEGREES(snapshot.temperature_tenths[10]),// Shelf 6 upper heater temperature.
                heaterStatusStr(11),                                  // Shelf 6 lower heater status.
                heaterInfo[11].temperature_setpoint,                  // Shelf 6 lower heater setpoint.
-               heaterInfo[11].current_temperature                    // Shelf 6 lower heater temperature.
+               TEMP_TENTHS_TO_DEGREES(snapshot.temperature_tenths[11])// Shelf 6 lower heater temperature.
                );
 
-      (void)fflush(logfileHandle);
-      (void)fclose(logfileHandle);
+      logWriterRecordDone(false);
    }
 }
 
@@ -6168,92 +9525,340 @@ static int logCommandEvent(uhc::SystemCommands command, const ::std::string &sen
    ee.data.command_event_data.command_data[2] = data3;
    int status = log_queue.put(ee, LOGEVENT_TIMEOUT_MS);
 
-   return status;
+   return status;
+}
+
+
+/**
+ * @brief Report an internal event to the logger.
+ *
+ * @param[in] event The internal event to log.
+ *
+ * @retval 0 No error occurred.
+ * @retval ETIMEDOUT The write to the log queue timed out.
+ */
+static int logInternalEvent(internal_event_t event)
+{
+   return logInternalEvent(event, "");
+}
+
+
+/**
+ * @brief Report an internal event with a description to the logger.
+ *
+ * @param[in] event The internal event to log.
+ *
+ * @param[in] description A pointer to the description string. Not required to persist.
+ *
+ * @retval 0 No error occurred.
+ * @retval ETIMEDOUT The write to the log queue timed out.
+ */
+static int logInternalEvent(internal_event_t event, const char *description)
+{
+   error_event_t ee;
+   ee.type = INTERNAL_EVENT_T;
+   (void)gettimeofday(&ee.timestamp, NULL);
+   ee.data.internal_event_data.event = event;
+   (void)memset(ee.data.internal_event_data.description, 0, sizeof(ee.data.internal_event_data.description));
+   (void)strncpy(ee.data.internal_event_data.description, description, sizeof(ee.data.internal_event_data.description) - 1);
+   int status = log_queue.put(ee, LOGEVENT_TIMEOUT_MS);
+
+   return status;
+}
+
+
+/**
+ * @brief Report an error to the logger.
+ *
+ * @param[in] error_code A pointer to the error code string. Must persist.
+ *
+ * @param[in] location A pointer to the location string. Not required to persist.
+ *
+ * @param[in] location A pointer to the description string. Not required to persist.
+ *
+ * @retval 0 No error occurred.
+ * @retval ETIMEDOUT The write to the log queue timed out.
+ */
+static int logError(char const *error_code, char const *location, char const *description)
+{
+   error_event_t ee;
+   ee.type = ERROR_T;
+   (void)gettimeofday(&ee.timestamp, NULL);
+   ee.data.error_data.error_code = error_code;
+   (void)strncpy(ee.data.error_data.location, location, sizeof(ee.data.error_data.location));
+   (void)strncpy(ee.data.error_data.description, description, sizeof(ee.data.error_data.description));
+   int status = log_queue.put(ee, LOGEVENT_TIMEOUT_MS);
+
+   flightRecorderTriggerDump(error_code);
+
+   return status;
+}
+
+
+/**
+ * @brief Freeze the flight recorder window around an error that has just been logged.
+ *
+ * The frames from FLIGHT_RECORDER_PRE_FRAMES before now to FLIGHT_RECORDER_POST_FRAMES after are dumped by the
+ * logger thread once the later ones have been recorded. An error logged while a dump is pending is in that dump.
+ * Safe to call from any thread; it never blocks.
+ *
+ * @param[in] error_code The error code, which goes in the dump's name. Must persist.
+ */
+static void flightRecorderTriggerDump(const char *error_code)
+{
+   // claim the trigger, fill in the details, then publish it to the logger thread
+   uint32_t none = 0;
+   if (flightRecorderTrigger.compare_exchange_strong(none, FLIGHT_RECORDER_TRIGGER_CLAIMED))
+   {
+      uint32_t triggerFrame = flightRecorder.frames();
+      (void)gettimeofday(&flightRecorderTriggerTime, NULL);
+      flightRecorderTriggerSeconds = monotonicSeconds();
+      flightRecorderTriggerCode = error_code;
+      flightRecorderTrigger = triggerFrame + 1;
+   }
+}
+
+
+/**
+ * @brief Dump the pending flight recorder window, if there is one and its last frame has been recorded.
+ *
+ * Called by the logger thread. If the heater thread has stopped recording, the window is dumped as it is after
+ * twice as many seconds as it should have taken.
+ */
+static void flightRecorderService()
+{
+   uint32_t trigger = flightRecorderTrigger.load();
+   if ((0 == trigger) || (FLIGHT_RECORDER_TRIGGER_CLAIMED == trigger))
+   {
+      return;
+   }
+
+   uint32_t triggerFrame = trigger - 1;
+   if (((flightRecorder.frames() - triggerFrame) < FLIGHT_RECORDER_POST_FRAMES) &&
+       ((monotonicSeconds() - flightRecorderTriggerSeconds.load()) < (2 * FLIGHT_RECORDER_POST_FRAMES)))
+   {
+      return;
+   }
+
+   const char *error_code = flightRecorderTriggerCode.load();
+   if (!sdCardExists || (flightRecorderDumpsToday >= FLIGHT_RECORDER_MAX_DUMPS_PER_DAY))
+   {
+      flightRecorderDumpsSkipped++;
+   }
+   else
+   {
+      flightRecorderDump(triggerFrame, (NULL != error_code) ? error_code : "");
+   }
+
+   flightRecorderTrigger = 0;
+}
+
+
+/**
+ * @brief Write the flight recorder frames around an error to a dump file in the log directory.
+ *
+ * The file is a FLIGHT_FILE_HEADER followed by the frames, oldest first; logConvert turns it into CSV. Frames the
+ * recorder has already reused are left out.
+ *
+ * @param[in] triggerFrame The first frame recorded after the error.
+ *
+ * @param[in] error_code The error code, for the file name and header.
+ */
+static void flightRecorderDump(uint32_t triggerFrame, const char *error_code)
+{
+   struct tm triggertm;
+   time_t triggertime = flightRecorderTriggerTime.tv_sec;
+   (void)localtime_r(&triggertime, &triggertm);
+
+   // keep the error code's letters, digits and dashes for the file name
+   char code[FLIGHT_FILE_ERROR_CODE_SIZE];
+   int codeLength = 0;
+   for (const char *c = error_code; (0 != *c) && (codeLength < (int)sizeof(code) - 1); c++)
+   {
+      if (isalnum((unsigned char)*c) || ('-' == *c))
+      {
+         code[codeLength++] = *c;
+      }
+   }
+   code[codeLength] = 0;
+
+   char fileName[MAX_FILE_PATH];
+   (void)snprintf(fileName, sizeof(fileName), FLIGHT_RECORDER_FILENAME_TEMPLATE, SD_CARD_LOG_DIRECTORY,
+                  triggertm.tm_year + 1900, triggertm.tm_mon + 1, triggertm.tm_mday,
+                  triggertm.tm_hour, triggertm.tm_min, triggertm.tm_sec, (0 != code[0]) ? code : "error");
+
+   FILE *fp = fopen(fileName, "wb");
+   if (0 == fp)
+   {
+      syslog(LOG_ERR, "Flight recorder: unable to create %s", fileName);
+      flightRecorderDumpsSkipped++;
+      return;
+   }
+
+   FLIGHT_FILE_HEADER header;
+   (void)memset(&header, 0, sizeof(header));
+   (void)memcpy(header.magic, FLIGHT_FILE_MAGIC, sizeof(header.magic));
+   header.version = FLIGHT_FILE_VERSION;
+   header.frame_size = sizeof(FLIGHT_FRAME);
+   header.trigger_frame = triggerFrame;
+   header.trigger_utc_seconds = (uint32_t)flightRecorderTriggerTime.tv_sec;
+   header.trigger_utc_microseconds = (uint32_t)flightRecorderTriggerTime.tv_usec;
+   (void)strncpy(header.error_code, error_code, sizeof(header.error_code) - 1);
+   (void)fwrite(&header, sizeof(header), 1, fp);
+
+   uint32_t frames = flightRecorder.frames();
+   uint32_t first = (triggerFrame > FLIGHT_RECORDER_PRE_FRAMES) ? (triggerFrame - FLIGHT_RECORDER_PRE_FRAMES) : 0;
+   uint32_t end = std::min(frames, triggerFrame + FLIGHT_RECORDER_POST_FRAMES);
+   for (uint32_t n = first; n < end; n++)
+   {
+      FLIGHT_FRAME frame;
+      if (flightRecorder.read(n, &frame))
+      {
+         (void)fwrite(&frame, sizeof(frame), 1, fp);
+         header.num_frames++;
+      }
+   }
+
+   // now that it's known, the frame count
+   (void)fseek(fp, 0, SEEK_SET);
+   (void)fwrite(&header, sizeof(header), 1, fp);
+   int status = fflush(fp);
+   if (0 == status)
+   {
+      status = fdatasync(fileno(fp));
+   }
+   (void)fclose(fp);
+
+   if (0 != status)
+   {
+      syslog(LOG_ERR, "Flight recorder: error %d writing %s", errno, fileName);
+      flightRecorderDumpsSkipped++;
+      return;
+   }
+
+   flightRecorderDumps++;
+   flightRecorderDumpsToday++;
+   syslog(LOG_NOTICE, "Flight recorder: %u frames around %s written to %s", header.num_frames, error_code, fileName);
 }
 
 
 /**
- * @brief Report an internal event to the logger.
- *
- * @param[in] event The internal event to log.
+ * @brief Read the most recent 25 errors log into memory, if it hasn't been read from the current card.
  *
- * @retval 0 No error occurred.
- * @retval ETIMEDOUT The write to the log queue timed out.
+ * A card without the log has no recent errors. If the log can't be read for some other reason, it is tried
+ * again next time.
  */
-static int logInternalEvent(internal_event_t event)
+static void recentErrorsLoad()
 {
-   error_event_t ee;
-   ee.type = INTERNAL_EVENT_T;
-   (void)gettimeofday(&ee.timestamp, NULL);
-   ee.data.internal_event_data.event = event;
-   int status = log_queue.put(ee, LOGEVENT_TIMEOUT_MS);
+   if (recentErrors.loaded)
+   {
+      return;
+   }
 
-   return status;
+   recentErrors.count = 0;
+   FILE *fp = fopen(RECENT_ERRORS_FILE, "r");
+   if (0 == fp)
+   {
+      recentErrors.loaded = (ENOENT == errno);
+      return;
+   }
+
+   while ((recentErrors.count < RECENT_ERRORS_MAX) &&
+          (0 != fgets(recentErrors.lines[recentErrors.count], RECENT_ERRORS_LINE_SIZE, fp)))
+   {
+      char *line = recentErrors.lines[recentErrors.count];
+      size_t len = strcspn(line, "\r\n");
+      if ('\0' == line[len])
+      {
+         // Longer than any line written here, keep what fits and skip the rest.
+         int c;
+         while ((EOF != (c = fgetc(fp))) && ('\n' != c))
+         {
+         }
+      }
+      line[len] = '\0';
+      recentErrors.count++;
+   }
+   (void)fclose(fp);
+
+   recentErrors.loaded = true;
 }
 
 
 /**
- * @brief Report an error to the logger.
+ * @brief Add the given errors to the most recent 25 errors log.
  *
- * @param[in] error_code A pointer to the error code string. Must persist.
+ * The log is newest first, so the errors go in reverse ahead of the older records kept in memory. The whole
+ * log is written to a temporary file next to it, synced and renamed over it, so that it is never seen
+ * part written. The time this takes is kept for the hourly statistics.
  *
- * @param[in] location A pointer to the location string. Not required to persist.
+ * @param[in] timestamps The errors' timestamps, oldest first.
  *
- * @param[in] location A pointer to the description string. Not required to persist.
+ * @param[in] errorstrs The pre-formatted error strings, oldest first.
  *
- * @retval 0 No error occurred.
- * @retval ETIMEDOUT The write to the log queue timed out.
+ * @param[in] count The number of errors, at most LOG_DRAIN_MAX.
  */
-static int logError(char const *error_code, char const *location, char const *description)
+static void logAppendRecentErrors(const struct timeval *timestamps, char (*errorstrs)[LOG_ERROR_EVENT_STR_SIZE], int count)
 {
-   error_event_t ee;
-   ee.type = ERROR_T;
-   (void)gettimeofday(&ee.timestamp, NULL);
-   ee.data.error_data.error_code = error_code;
-   (void)strncpy(ee.data.error_data.location, location, sizeof(ee.data.error_data.location));
-   (void)strncpy(ee.data.error_data.description, description, sizeof(ee.data.error_data.description));
-   int status = log_queue.put(ee, LOGEVENT_TIMEOUT_MS);
+   static char text[RECENT_ERRORS_MAX * RECENT_ERRORS_LINE_SIZE];
 
-   return status;
-}
+   struct timespec start;
+   struct timespec end;
+   (void)clock_gettime(CLOCK_MONOTONIC, &start);
 
+   recentErrorsLoad();
 
-/**
- * @brief Append the given error event to the most recent 25 errors log.
- *
- * @param[in] timestamp The error's timestamp.
- *
- * @param[in] errorstr The pre-formatted error string.
- */
-static void logAppendRecentErrors(struct timeval timestamp, const char *errorstr)
-{
-   time_t errortime = timestamp.tv_sec;
-   struct tm errortm;
-   (void)localtime_r(&errortime, &errortm);
-   char timestr[TIME_STR_SIZE];    // Long enough to hold mm-dd-yyyy hh:MM:ss AM.
-   size_t gen_len = strftime(timestr, sizeof(timestr), "%m-%d-%Y %I:%M:%S %p", &errortm);
-   assert(0 != gen_len);
-
-   // timestr + error code + location + error description + field separators and some padding.
-   char errorrec[TIME_STR_SIZE + ERROR_CODE_LENGTH + LOGERROR_LOCATION_SIZE + LOGERROR_DESCR_SIZE + 10];
-   (void)snprintf(errorrec, sizeof(errorrec), "%s %s", timestr, errorstr);
+   // Make room for the new errors at the front, dropping the oldest to keep 25 in all.
+   int keep = std::min(recentErrors.count, RECENT_ERRORS_MAX - count);
+   (void)memmove(recentErrors.lines[count], recentErrors.lines[0], keep * sizeof(recentErrors.lines[0]));
+   for (int i = 0; i < count; i++)
+   {
+      int j = count - 1 - i;
+      time_t errortime = timestamps[j].tv_sec;
+      struct tm errortm;
+      (void)localtime_r(&errortime, &errortm);
+      char timestr[TIME_STR_SIZE];    // Long enough to hold mm-dd-yyyy hh:MM:ss AM.
+      size_t gen_len = strftime(timestr, sizeof(timestr), "%m-%d-%Y %I:%M:%S %p", &errortm);
+      assert(0 != gen_len);
 
-   // Create a new recent errors file containing just this new error record.
-   string rmcmd("rm -f " RECENT_ERRORS_TEMP_FILE);
-   (void)system(rmcmd.c_str());
+      (void)snprintf(recentErrors.lines[i], sizeof(recentErrors.lines[i]), "%s %s", timestr, errorstrs[j]);
+   }
+   recentErrors.count = keep + count;
 
-   string createcmd("echo ");
-   createcmd += errorrec;
-   createcmd += " > " RECENT_ERRORS_TEMP_FILE;
-   (void)system(createcmd.c_str());
+   size_t len = 0;
+   for (int i = 0; i < recentErrors.count; i++)
+   {
+      len += snprintf(&text[len], sizeof(text) - len, "%s\n", recentErrors.lines[i]);
+   }
 
-   // Append the most recent 24 errors from the recent errors log file.
-   string appendcmd("head -n 24 " RECENT_ERRORS_FILE " >> " RECENT_ERRORS_TEMP_FILE);
-   (void)system(appendcmd.c_str());
+   int fd = open(RECENT_ERRORS_TEMP_FILE, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+   if (fd < 0)
+   {
+      return;
+   }
+   int status = (write(fd, text, len) == (ssize_t)len) ? fdatasync(fd) : -1;
+   if (0 != close(fd))
+   {
+      status = -1;
+   }
+   if (0 == status)
+   {
+      status = rename(RECENT_ERRORS_TEMP_FILE, RECENT_ERRORS_FILE);
+   }
+   if (0 != status)
+   {
+      (void)unlink(RECENT_ERRORS_TEMP_FILE);
+      return;
+   }
 
-   // Move the new recent errors log file to the log directory.
-   string mvcmd("mv -f " RECENT_ERRORS_TEMP_FILE " " RECENT_ERRORS_FILE);
-   (void)system(mvcmd.c_str());
+   (void)clock_gettime(CLOCK_MONOTONIC, &end);
+   uint32_t latency = (uint32_t)(((end.tv_sec - start.tv_sec) * 1000000) + ((end.tv_nsec - start.tv_nsec) / 1000));
+   recentErrorsLatencyMicroseconds = latency;
+   if (latency > recentErrorsLatencyMaxMicroseconds)
+   {
+      recentErrorsLatencyMaxMicroseconds = latency;
+   }
+   recentErrorsWrites++;
 }
 
 /**
@@ -6294,6 +9899,7 @@ void *loggerThread(void *)
 
    date_t currentDate = currentDateGet();
    char fileName[MAX_FILE_PATH];
+   logWriter.binary = (access(BINARY_LOG_ENABLE_FILE, F_OK) == 0);
    logfileNameCreate(fileName, sizeof(fileName), currentDate);
 
    // When starting up, write a header to the log file.
@@ -6302,251 +9908,555 @@ void *loggerThread(void *)
    using namespace std::chrono;
    steady_clock::time_point next_log_time(time_point_cast<milliseconds>(steady_clock::now()) + seconds(EESLOGINTERVAL_SEC));
 
-   numThreadsRunning++;
-   while (!sigTermReceived)
+   // static, to keep a batch of events off this thread's stack
+   static error_event_t ees[LOG_DRAIN_MAX];
+
+   numThreadsRunning++;
+   while (!sigTermReceived)
+   {
+      // Read everything in the log queue, up to a batch.
+      int queue_status = log_queue.drain(ees, LOG_DRAIN_MAX, next_log_time);
+
+      // First, check the types to see if we're supposed to stop. logStop() shoves STOP to the front,
+      // so it is the first of its batch; anything queued behind it is not written.
+      bool stop = false;
+      for (int i = 0; i < queue_status; i++)
+      {
+         if (STOP_T == ees[i].type)
+         {
+            stop = true;
+            break;
+         }
+      }
+      if (stop)
+      {
+         // Write out what is buffered and close the log file, then kill the thread.
+         logWriterClose();
+         (void)printf("loggerThread received STOP\n");
+         break;
+      }
+
+      // Before we even decide what to do, we need to see if the current log file is still valid.
+      // If we rolled over to the next day, or if the system clock got changed and it's now a different
+      // day, we need to switch to a different log file.
+      date_t today = currentDateGet();
+      if (!datesEqual(currentDate, today))
+      {
+         logWriterClose();
+         syslog(LOG_INFO, "Log file %s: %u bytes written", fileName, logFileBytesToday.load());
+         logFileBytesToday = 0;
+         flightRecorderDumpsToday = 0;
+         currentDate = today;
+
+         // We're on a new day. Get the log file name for today, in the format asked for now.
+         logWriter.binary = (access(BINARY_LOG_ENABLE_FILE, F_OK) == 0);
+         logfileNameCreate(fileName, sizeof(fileName), currentDate);
+
+         // Since we're opening a new log file, write the log file header.
+         logHeaderWrite(fileName);
+      }
+
+      if (queue_status > 0)
+      {
+         // Errors or events arrived. Log them.
+         logErrorEventsWrite(fileName, ees, queue_status);
+      }
+      else if (-ETIMEDOUT == queue_status)
+      {
+         // We hit the timeout. Write a standard log record.
+         logStatusWrite(fileName);
+
+         // Bump the next log time.
+         next_log_time += seconds(EESLOGINTERVAL_SEC);
+      }
+      else
+      {
+         // Something else terminated the get(). Ignore it.
+      }
+
+      // An error may have left a flight recorder window to write out.
+      flightRecorderService();
+
+      // A startup heater data capture may have finished.
+      heaterDataRotate();
+   }
+
+   logWriterClose();
+   (void)write(fanInfo[0].fd_on, FAN_ON_STRING, 1);
+   (void)printf("loggerThread stopped\n");
+
+   numThreadsRunning--;
+   pthread_exit(NULL);
+}
+
+
+/*******************************************************************************************/
+/*                                                                                         */
+/* void handleTimeSync(GUI_SESSION *session, const char *message, int length)              */
+/*                                                                                         */
+/* Sets the system time and time zone from a TimeSync message from a panel.                */
+/*                                                                                         */
+/* Returns: None                                                                           */
+/*                                                                                         */
+/*******************************************************************************************/
+void handleTimeSync(GUI_SESSION *session, const char *message, int length)
+{
+   // Deserialization
+   static TimeSync deserialized;
+   if (!deserialized.ParseFromArray(message, length))
+   {
+      if (debugPrintf)
+      {
+         cerr << "ERROR: Unable to deserialize!\n";
+         syslog(LOG_ERR, "handleTimeSync Glass %d ERROR: Unable to deserialize!", session->panel_number);
+         (void)logError("", "handleTimeSync", "unable to deserialize");
+      }
+   }
+
+   if (debugPrintf)
+   {
+      cout << "Deserialization:\n\n";
+      deserialized.PrintDebugString();
+
+      cout << "deserialized current time: " << TimeUtil::ToString(deserialized.current_time()) << "\n";
+   }
+
+   string dateString = TimeUtil::ToString(deserialized.current_time());
+   string cmd = "date --set ";
+   cmd += dateString;
+   timeSyncReceived = true;
+   if (debugPrintf)
+   {
+      (void)printf("TimeSync setting time to %s\n", dateString.c_str());
+   }
+
+   // TIMESYNC_RECEIVED is logged with the result once date has set the clock
+   syslog(LOG_INFO, "TimeSync setting time to %s", dateString.c_str());
+   int ret = runSubprocessNow("date", cmd.c_str(), SET_TIME_TIMEOUT_SECONDS, TIMESYNC_RECEIVED_T);
+   if (0 != ret)
+   {
+      char descr_str[LOGERROR_DESCR_SIZE];
+      (void)snprintf(descr_str, sizeof(descr_str), "date not run, error %d", -ret);
+      (void)logInternalEvent(TIMESYNC_RECEIVED_T, descr_str);
+   }
+
+   if (deserialized.time_zone().length())
+   {
+      char commandLine[COMMAND_LINE_BUFFER_SIZE];
+      (void)memset(commandLine, 0, sizeof(commandLine));
+      (void)snprintf(commandLine, sizeof(commandLine) - 1, SET_TIMEZONE_COMMAND, deserialized.time_zone().c_str());
+      (void)runSubprocess("timedatectl", commandLine, SET_TIMEZONE_TIMEOUT_SECONDS, NULL);
+      timeZoneConfigured = true;
+   }
+
+   markGUISessionHeard(session);
+}
+
+
+/*******************************************************************************************/
+/*                                                                                         */
+/* int ecoModeOnHeaters(int channelIndexTopHeater, int channelIndexBottomHeater)           */
+/*                                                                                         */
+/* Saves the setpoints of the two heaters of a slot and drops them to the ECO setpoint.    */
+/*                                                                                         */
+/* Returns: int ret - 0 = success, 1 = failure                                             */
+/*                                                                                         */
+/*******************************************************************************************/
+int ecoModeOnHeaters(int channelIndexTopHeater, int channelIndexBottomHeater)
+{
+   int funcRet = 0;
+
+   heaterInfo[channelIndexTopHeater].eco_mode_is_on = true;
+   heaterInfo[channelIndexBottomHeater].eco_mode_is_on = true;
+   heaterInfo[channelIndexTopHeater].saved_setpoint = heaterInfo[channelIndexTopHeater].temperature_setpoint;
+   heaterInfo[channelIndexBottomHeater].saved_setpoint = heaterInfo[channelIndexBottomHeater].temperature_setpoint;
+   heaterInfo[channelIndexTopHeater].eco_mode_on = true;
+   heaterInfo[channelIndexBottomHeater].eco_mode_on = true;
+   funcRet =  setSetpointHeater(channelIndexTopHeater, heaterInfo[channelIndexTopHeater].eco_mode_setpoint);
+   funcRet |= setSetpointHeater(channelIndexBottomHeater, heaterInfo[channelIndexBottomHeater].eco_mode_setpoint);
+   heaterInfo[channelIndexTopHeater].setpoint_changed = true;
+   heaterInfo[channelIndexBottomHeater].setpoint_changed = true;
+
+   return funcRet;
+}
+
+
+/*******************************************************************************************/
+/*                                                                                         */
+/* int ecoModeOffHeaters(int channelIndexTopHeater, int channelIndexBottomHeater)          */
+/*                                                                                         */
+/* Restores the setpoints the two heaters of a slot had before ECO mode.                   */
+/*                                                                                         */
+/* Returns: int ret - 0 = success, 1 = failure                                             */
+/*                                                                                         */
+/*******************************************************************************************/
+int ecoModeOffHeaters(int channelIndexTopHeater, int channelIndexBottomHeater)
+{
+   int funcRet = 0;
+
+   heaterInfo[channelIndexTopHeater].temperature_setpoint = heaterInfo[channelIndexTopHeater].saved_setpoint;
+   heaterInfo[channelIndexBottomHeater].temperature_setpoint = heaterInfo[channelIndexBottomHeater].saved_setpoint;
+   heaterInfo[channelIndexTopHeater].eco_mode_on = false;
+   heaterInfo[channelIndexBottomHeater].eco_mode_on = false;
+   heaterInfo[channelIndexTopHeater].setpoint_changed = true;
+   heaterInfo[channelIndexBottomHeater].setpoint_changed = true;
+   funcRet =  setSetpointHeater(channelIndexTopHeater, heaterInfo[channelIndexTopHeater].temperature_setpoint);
+   funcRet |= setSetpointHeater(channelIndexBottomHeater, heaterInfo[channelIndexBottomHeater].temperature_setpoint);
+
+   return funcRet;
+}
+
+
+/*******************************************************************************************/
+/*                                                                                         */
+/* uint16_t setEcoModeSetpoint(uint32_t temperature)                                       */
+/*                                                                                         */
+/* Sets the ECO mode setpoint of every heater. A temperature below the lookup table or     */
+/* above the current setpoint is replaced by DEFAULT_ECO_MODE_SETPOINT.                    */
+/*                                                                                         */
+/* Returns: uint16_t the ECO mode setpoint                                                 */
+/*                                                                                         */
+/*******************************************************************************************/
+uint16_t setEcoModeSetpoint(uint32_t temperature)
+{
+   uint16_t newTemp;
+
+   if ((temperature >= (uint32_t)tempLookupTable[0].degreesF) && (temperature <= heaterInfo[0].temperature_setpoint))
+   {
+      newTemp = (uint16_t)temperature;
+   }
+   else
+   {
+      newTemp = DEFAULT_ECO_MODE_SETPOINT;
+   }
+
+   for (int i = SLOT1_TOP_HEATER_INDEX; i < NUM_HEATERS; i++)
+   {
+      heaterInfo[i].eco_mode_setpoint = newTemp;
+   }
+
+   return newTemp;
+}
+
+
+/*******************************************************************************************/
+/*                                                                                         */
+/* uhc::SystemCommandResponses validateBatchOperation(const BatchOperation &op)            */
+/*                                                                                         */
+/* Checks one operation of a SYSTEM_COMMAND_BATCH without changing anything. The checks    */
+/* are the ones processCommand makes for the same command.                                 */
+/*                                                                                         */
+/* Returns: uhc::SystemCommandResponses SYSTEM_COMMAND_RESPONSE_OK if it can be applied    */
+/*                                                                                         */
+/*******************************************************************************************/
+uhc::SystemCommandResponses validateBatchOperation(const BatchOperation &op)
+{
+   uhc::SystemCommandResponses ret = SYSTEM_COMMAND_RESPONSE_OK;
+
+   switch (op.command())
+   {
+      case SYSTEM_COMMAND_UPDATE_SLOT_TEMP_SETPOINT:
+         if (inCleaningMode)
+         {
+            ret = SYSTEM_COMMAND_RESPONSE_FAILURE;
+         }
+         else if ((op.slot_number() < SLOT_NUMBER_ONE) || (op.slot_number() > SLOT_NUMBER_SIX) ||
+                  (op.temperature() < setpointLowLimit) || (op.temperature() > setpointHighLimit))
+         {
+            ret = SYSTEM_COMMAND_RESPONSE_BAD_PARAMETER;
+         }
+         break;
+
+      case SYSTEM_COMMAND_HEATER_ON:
+      case SYSTEM_COMMAND_HEATER_OFF:
+         if (inCleaningMode && (SYSTEM_COMMAND_HEATER_ON == op.command()))
+         {
+            ret = SYSTEM_COMMAND_RESPONSE_FAILURE;
+         }
+         else if (op.heater_index() > SLOT6_BOTTOM_HEATER_INDEX)
+         {
+            ret = SYSTEM_COMMAND_RESPONSE_BAD_PARAMETER;
+         }
+         break;
+
+      case SYSTEM_COMMAND_ECO_MODE_ON:
+      case SYSTEM_COMMAND_ECO_MODE_OFF:
+         if (inCleaningMode && (SYSTEM_COMMAND_ECO_MODE_ON == op.command()))
+         {
+            ret = SYSTEM_COMMAND_RESPONSE_FAILURE;
+         }
+         else if ((op.slot_number() < SLOT_NUMBER_ONE) || (op.slot_number() > SLOT_NUMBER_SIX))
+         {
+            ret = SYSTEM_COMMAND_RESPONSE_BAD_PARAMETER;
+         }
+         break;
+
+      case SYSTEM_COMMAND_SET_ECO_MODE_TEMP:
+         if (inCleaningMode)
+         {
+            ret = SYSTEM_COMMAND_RESPONSE_FAILURE;
+         }
+         break;
+
+      case SYSTEM_COMMAND_SET_DURATION:
+         break;
+
+      default:
+         // everything else has to be sent on its own
+         ret = SYSTEM_COMMAND_RESPONSE_BAD_PARAMETER;
+         break;
+   }
+
+   return ret;
+}
+
+
+/*******************************************************************************************/
+/*                                                                                         */
+/* int applyBatchOperation(const BatchOperation &op)                                       */
+/*                                                                                         */
+/* Applies one operation of a SYSTEM_COMMAND_BATCH that validateBatchOperation accepted.   */
+/*                                                                                         */
+/* Returns: int ret - 0 = success, 1 = failure                                             */
+/*                                                                                         */
+/*******************************************************************************************/
+int applyBatchOperation(const BatchOperation &op)
+{
+   int funcRet = 0;
+   int channelIndexTopHeater = 0;
+   int channelIndexBottomHeater = 0;
+   google::protobuf::Timestamp timestamp;
+   timestamp.set_seconds(0);
+   timestamp.set_nanos(0);
+
+   switch (op.command())
    {
-      // Read the log queue.
-      error_event_t ee;
-      int queue_status = log_queue.get(ee, next_log_time);
+      case SYSTEM_COMMAND_UPDATE_SLOT_TEMP_SETPOINT:
+         setSetpointSlot((int)op.slot_number(), op.temperature());
+         break;
 
-      // First, check the type to see if we're supposed to stop.
-      if (STOP_T == ee.type)
-      {
-         // The log file is currently closed. Just kill the thread.
-         (void)printf("loggerThread received STOP\n");
+      case SYSTEM_COMMAND_HEATER_ON:
+         funcRet = enableDisableHeater(op.heater_index(), HEATER_ENABLED);
+         funcRet |= setHeaterTimesIndex(op.heater_index(), op.start_time(), op.end_time());
          break;
-      }
 
-      // Before we even decide what to do, we need to see if the current log file is still valid.
-      // If we rolled over to the next day, or if the system clock got changed and it's now a different
-      // day, we need to switch to a different log file.
-      date_t today = currentDateGet();
-      if (!datesEqual(currentDate, today))
-      {
-         currentDate = today;
+      case SYSTEM_COMMAND_HEATER_OFF:
+         funcRet = turnHeaterOnOff(op.heater_index(), HEATER_STATE_OFF);
+         funcRet |= setHeaterTimesIndex(op.heater_index(), timestamp, timestamp);
+         funcRet |= enableDisableHeater(op.heater_index(), HEATER_DISABLED);
+         break;
 
-         // We're on a new day. Get the log file name for today.
-         logfileNameCreate(fileName, sizeof(fileName), currentDate);
+      case SYSTEM_COMMAND_ECO_MODE_ON:
+         lookupHeaterIndices(op.slot_number(), &channelIndexTopHeater, &channelIndexBottomHeater);
+         if (!heaterInfo[channelIndexTopHeater].eco_mode_is_on && !heaterInfo[channelIndexBottomHeater].eco_mode_is_on)
+         {
+            funcRet = ecoModeOnHeaters(channelIndexTopHeater, channelIndexBottomHeater);
+         }
+         break;
 
-         // Since we're opening a new log file, write the log file header.
-         logHeaderWrite(fileName);
-      }
+      case SYSTEM_COMMAND_ECO_MODE_OFF:
+         lookupHeaterIndices(op.slot_number(), &channelIndexTopHeater, &channelIndexBottomHeater);
+         if (heaterInfo[channelIndexTopHeater].eco_mode_is_on || heaterInfo[channelIndexBottomHeater].eco_mode_is_on)
+         {
+            funcRet = ecoModeOffHeaters(channelIndexTopHeater, channelIndexBottomHeater);
+         }
+         break;
 
-      if (0 == queue_status)
-      {
-         // An error or event arrived. Log it.
-         logErrorEventWrite(fileName, ee);
-      }
-      else if (-ETIMEDOUT == queue_status)
-      {
-         // We hit the timeout. Write a standard log record.
-         logStatusWrite(fileName);
+      case SYSTEM_COMMAND_SET_ECO_MODE_TEMP:
+         (void)setEcoModeSetpoint(op.temperature());
+         break;
 
-         // Bump the next log time.
-         next_log_time += seconds(EESLOGINTERVAL_SEC);
-      }
-      else
-      {
-         // Something else terminated the get(). Ignore it.
-      }
+      case SYSTEM_COMMAND_SET_DURATION:
+      default:
+         break;
    }
 
-   (void)write(fanInfo[0].fd_on, FAN_ON_STRING, 1);
-   (void)printf("loggerThread stopped\n");
-
-   numThreadsRunning--;
-   pthread_exit(NULL);
+   return funcRet;
 }
 
 
 /*******************************************************************************************/
 /*                                                                                         */
-/* void *timeSyncSubscriberThread(void *)                                                  */
+/* uhc::SystemCommandResponses processHistoryQuery(const SystemCommand &systemCommand)     */
 /*                                                                                         */
-/* Receive the TimeSync message from GUI1 and set the controller's clock from it.          */
+/* Finds the points of the history store asked for by a SYSTEM_COMMAND_QUERY_HISTORY:      */
+/* those at the requested resolution from start_time to end_time, oldest first, up to      */
+/* max_points. One second samples are returned as intervals of one second. The minute or   */
+/* hour still being built comes last, if it is in range. The points are left in            */
+/* historyQueryPoints for fillCommandResponse, which picks out the slot.                   */
 /*                                                                                         */
-/* Returns: pthread_exit(NULL)                                                             */
+/* Returns: uhc::SystemCommandResponses ret                                                */
 /*                                                                                         */
 /*******************************************************************************************/
-void *timeSyncSubscriberThread(void *)
+uhc::SystemCommandResponses processHistoryQuery(const SystemCommand &systemCommand)
 {
-   char message[DEFAULT_MESSAGE_BUFFER_SIZE];
-   char guiIPandPort[IP_STRING_SIZE + 14];   // Allow space for the tcp:// and :portnumber
-   (void)memset(guiIPandPort, 0, sizeof(guiIPandPort));
-   (void)snprintf(guiIPandPort, sizeof(guiIPandPort), "tcp://%s:%d", guiIPAddress1, TIME_SYNC_PORT_GUI1);
-   (void)printf("timeSyncSubscriberThread guiIPandPort = %s\n", guiIPandPort);
+   numHistoryQueryPoints = 0;
 
-   timeSyncSubscriber = zmq_socket(context, ZMQ_SUB);
-   assert(timeSyncSubscriber != 0);
+   if ((systemCommand.slot_number() < SLOT_NUMBER_ONE) || (systemCommand.slot_number() > SLOT_NUMBER_SIX))
+   {
+      return SYSTEM_COMMAND_RESPONSE_BAD_PARAMETER;
+   }
 
-   char messageType[] = { 10, 4, 'T', 'I', 'M', 'E' };
-   int rc = zmq_setsockopt(timeSyncSubscriber, ZMQ_SUBSCRIBE, messageType, sizeof(messageType));
-   assert(rc == 0);
+   uint32_t startSeconds = (uint32_t)systemCommand.start_time().seconds();
+   uint32_t endSeconds = (0 == systemCommand.end_time().seconds()) ? UINT32_MAX : (uint32_t)systemCommand.end_time().seconds();
+   int maxPoints = HISTORY_MAX_QUERY_POINTS;
+   if ((0 != systemCommand.max_points()) && (systemCommand.max_points() < HISTORY_MAX_QUERY_POINTS))
+   {
+      maxPoints = (int)systemCommand.max_points();
+   }
 
-   int noTimeout = -1;
-   rc = zmq_setsockopt(timeSyncSubscriber, ZMQ_RCVTIMEO, &noTimeout, sizeof(noTimeout));
-   assert(rc == 0);
+   const HISTORY_RING *ring;
+   uint32_t size;
+   const HISTORY_AGGREGATE *aggregates = NULL;
+   const HISTORY_ACCUMULATOR *building = NULL;
+   switch (systemCommand.history_resolution())
+   {
+      case HISTORY_RESOLUTION_SECOND:
+         ring = &historySecondsRing;
+         size = HISTORY_SECONDS;
+         break;
 
-   rc = zmq_connect(timeSyncSubscriber, guiIPandPort);
-   assert(rc == 0);
+      case HISTORY_RESOLUTION_MINUTE:
+         ring = &historyMinutesRing;
+         size = HISTORY_MINUTES;
+         aggregates = historyMinutes;
+         building = &historyMinute;
+         break;
 
-   (void)sleep(1);
+      case HISTORY_RESOLUTION_HOUR:
+         ring = &historyHoursRing;
+         size = HISTORY_HOURS;
+         aggregates = historyHours;
+         building = &historyHour;
+         break;
 
-   numThreadsRunning++;
-   while(!sigTermReceived)
-   {
-      (void)memset(message, 0, sizeof(message));
-      rc = zmq_recv(timeSyncSubscriber, message, sizeof(message), 0);
-      if (rc == -1)
-      {
-         continue;
-      }
+      default:
+         return SYSTEM_COMMAND_RESPONSE_BAD_PARAMETER;
+   }
 
-      // Deserialization
-      string s(message, rc);
-      TimeSync deserialized;
-      if (!deserialized.ParseFromString(s))
+   (void)pthread_mutex_lock(&historyMutex);
+
+   uint32_t oldest = (ring->next + size - ring->count) % size;
+   for (uint32_t n = 0; (n < ring->count) && (numHistoryQueryPoints < maxPoints); n++)
+   {
+      uint32_t index = (oldest + n) % size;
+      HISTORY_AGGREGATE *point = &historyQueryPoints[numHistoryQueryPoints];
+      if (NULL == aggregates)
       {
-         if (debugPrintf)
+         const HISTORY_SAMPLE *sample = &historySeconds[index];
+         if ((sample->utc_seconds < startSeconds) || (sample->utc_seconds > endSeconds))
          {
-            cerr << "ERROR: Unable to deserialize!\n";
-            syslog(LOG_ERR, "timeSyncSubscriberThread ERROR: Unable to deserialize!");
-            (void)logError("", "timeSyncSubscriberThread", "unable to deserialize");
+            continue;
          }
-      }
-
-      if (debugPrintf)
-      {
-         cout << "Deserialization:\n\n";
-         deserialized.PrintDebugString();
-
-         cout << "deserialized current time: " << TimeUtil::ToString(deserialized.current_time()) << "\n";
-      }
 
-      string dateString = TimeUtil::ToString(deserialized.current_time());
-      string cmd = "date --set ";
-      cmd += dateString;
-      timeSyncReceived = true;
-      if (debugPrintf)
-      {
-         (void)printf("TimeSync setting time to %s\n", dateString.c_str());
+         // a second is an interval of one sample
+         HISTORY_ACCUMULATOR accumulator;
+         historyAccumulatorStart(&accumulator, sample, 0);
+         historyAccumulatorAdd(&accumulator, sample);
+         historyAccumulatorFinish(&accumulator, point);
       }
-
-      syslog(LOG_INFO, "TimeSync setting time to %s", dateString.c_str());
-      (void)system(cmd.c_str());
-      (void)logInternalEvent(TIMESYNC_RECEIVED_T);
-
-      if (deserialized.time_zone().length())
+      else
       {
-         char commandLine[COMMAND_LINE_BUFFER_SIZE];
-         (void)memset(commandLine, 0, sizeof(commandLine));
-         (void)snprintf(commandLine, sizeof(commandLine) - 1, SET_TIMEZONE_COMMAND, deserialized.time_zone().c_str());
-         (void)system(commandLine);
-         timeZoneConfigured = true;
+         if ((aggregates[index].utc_seconds < startSeconds) || (aggregates[index].utc_seconds > endSeconds))
+         {
+            continue;
+         }
+         *point = aggregates[index];
       }
+      numHistoryQueryPoints++;
+   }
 
-      lastTimeGUI1Heard = 0;
-      gui1MissingOneShot = true;
-      bothGuisMissingOneShot = true;
+   if ((NULL != building) && (0 != building->aggregate.num_samples) && (numHistoryQueryPoints < maxPoints) &&
+       (building->aggregate.utc_seconds >= startSeconds) && (building->aggregate.utc_seconds <= endSeconds))
+   {
+      historyAccumulatorFinish(building, &historyQueryPoints[numHistoryQueryPoints]);
+      numHistoryQueryPoints++;
    }
 
-   numThreadsRunning--;
-   pthread_exit(NULL);
+   (void)pthread_mutex_unlock(&historyMutex);
+
+   return SYSTEM_COMMAND_RESPONSE_OK;
 }
 
 
 /*******************************************************************************************/
 /*                                                                                         */
-/* void *timeSyncSubscriberThread2(void *)                                                 */
+/* uhc::SystemCommandResponses processBatchCommand(const SystemCommand &systemCommand)     */
 /*                                                                                         */
-/* Receive the TimeSync message from GUI2 and set the controller's clock from it.          */
+/* Validates every operation of a SYSTEM_COMMAND_BATCH and, only if they are all valid,    */
+/* applies them in order between two passes of the heater algorithm, so it never sees      */
+/* part of a batch. The result of each operation is left in batchOperationResponses for    */
+/* fillCommandResponse. Logs the batch once rather than once per operation.                */
 /*                                                                                         */
-/* Returns: pthread_exit(NULL)                                                             */
+/* Returns: uhc::SystemCommandResponses OK, or the first operation's error                 */
 /*                                                                                         */
 /*******************************************************************************************/
-void *timeSyncSubscriberThread2(void *)
+uhc::SystemCommandResponses processBatchCommand(const SystemCommand &systemCommand)
 {
-   char message[DEFAULT_MESSAGE_BUFFER_SIZE];
-   char guiIPandPort[IP_STRING_SIZE + 14];   // Allow space for the tcp:// and :portnumber
-   (void)memset(guiIPandPort, 0, sizeof(guiIPandPort));
-   (void)snprintf(guiIPandPort, sizeof(guiIPandPort), "tcp://%s:%d", guiIPAddress2, TIME_SYNC_PORT_GUI2);
-   (void)printf("timeSyncSubscriberThread2 guiIPandPort = %s\n", guiIPandPort);
-
-   timeSyncSubscriber2 = zmq_socket(context, ZMQ_SUB);
-   assert(timeSyncSubscriber2 != 0);
-
-   char messageType[] = { 10, 4, 'T', 'I', 'M', 'E' };
-   int rc = zmq_setsockopt(timeSyncSubscriber2, ZMQ_SUBSCRIBE, messageType, sizeof(messageType));
-   assert(rc == 0);
-
-   int noTimeout = -1;
-   rc = zmq_setsockopt(timeSyncSubscriber2, ZMQ_RCVTIMEO, &noTimeout, sizeof(noTimeout));
-   assert(rc == 0);
-
-   rc = zmq_connect(timeSyncSubscriber2, guiIPandPort);
-   assert(rc == 0);
+   uhc::SystemCommandResponses ret = SYSTEM_COMMAND_RESPONSE_OK;
+   int numOperations = systemCommand.operations_size();
+   int funcRet = 0;
 
-   (void)sleep(1);
+   numBatchOperationResponses = 0;
+   if ((numOperations < 1) || (numOperations > MAX_BATCH_OPERATIONS))
+   {
+      syslog(LOG_ERR, "SYSTEM_COMMAND_BATCH from %s with %d operations, must be 1 to %d", systemCommand.sender_ip_address().c_str(), numOperations, MAX_BATCH_OPERATIONS);
+      return SYSTEM_COMMAND_RESPONSE_BAD_PARAMETER;
+   }
 
-   numThreadsRunning++;
-   while(!sigTermReceived)
+   for (int i = 0; i < numOperations; i++)
    {
-      (void)memset(message, 0, sizeof(message));
-      rc = zmq_recv(timeSyncSubscriber2, message, sizeof(message), 0);
-      if (rc == -1)
+      batchOperationResponses[i] = validateBatchOperation(systemCommand.operations(i));
+      if ((SYSTEM_COMMAND_RESPONSE_OK == ret) && (batchOperationResponses[i] != SYSTEM_COMMAND_RESPONSE_OK))
       {
-         continue;
+         ret = batchOperationResponses[i];
       }
+   }
+   numBatchOperationResponses = numOperations;
 
-      // Deserialization
-      string s(message, rc);
-      TimeSync deserialized;
-      if (!deserialized.ParseFromString(s))
+   if (SYSTEM_COMMAND_RESPONSE_OK == ret)
+   {
+      (void)pthread_mutex_lock(&heaterAlgorithmMutex);
+      for (int i = 0; i < numOperations; i++)
       {
-         if (debugPrintf)
+         if (applyBatchOperation(systemCommand.operations(i)) != 0)
          {
-            cerr << "ERROR: Unable to deserialize!\n";
-            syslog(LOG_ERR, "timeSyncSubscriberThread2 ERROR: Unable to deserialize!");
-            (void)logError("", "timeSyncSubscriberThread2", "unable to deserialize");
+            batchOperationResponses[i] = SYSTEM_COMMAND_RESPONSE_FAILURE;
+            funcRet = 1;
          }
       }
-
-      if (debugPrintf)
-      {
-         cout << "Deserialization:\n\n";
-         deserialized.PrintDebugString();
-
-         cout << "deserialized current time: " << TimeUtil::ToString(deserialized.current_time()) << "\n";
-      }
-
-      string dateString = TimeUtil::ToString(deserialized.current_time());
-      string cmd = "date --set ";
-      cmd += dateString;
-      timeSyncReceived = true;
-      if (debugPrintf)
+      (void)pthread_mutex_unlock(&heaterAlgorithmMutex);
+   }
+   else
+   {
+      // nothing was applied
+      for (int i = 0; i < numOperations; i++)
       {
-         (void)printf("TimeSync2 setting time to %s\n", dateString.c_str());
+         if (SYSTEM_COMMAND_RESPONSE_OK == batchOperationResponses[i])
+         {
+            batchOperationResponses[i] = SYSTEM_COMMAND_RESPONSE_UNKNOWN;
+         }
       }
+   }
 
-      syslog(LOG_INFO, "TimeSync2 setting time to %s", dateString.c_str());
-      (void)system(cmd.c_str());
-
-      if (deserialized.time_zone().length())
+   if ((SYSTEM_COMMAND_RESPONSE_OK == ret) && (0 == funcRet))
+   {
+      syslog(LOG_NOTICE, "SYSTEM_COMMAND_BATCH from %s %d operations applied", systemCommand.sender_ip_address().c_str(), numOperations);
+   }
+   else
+   {
+      if (SYSTEM_COMMAND_RESPONSE_OK == ret)
       {
-         char commandLine[COMMAND_LINE_BUFFER_SIZE];
-         (void)memset(commandLine, 0, sizeof(commandLine));
-         (void)snprintf(commandLine, sizeof(commandLine) - 1, SET_TIMEZONE_COMMAND, deserialized.time_zone().c_str());
-         (void)system(commandLine);
-         timeZoneConfigured = true;
+         ret = SYSTEM_COMMAND_RESPONSE_FAILURE;
       }
-
-      lastTimeGUI2Heard = 0;
-      gui2MissingOneShot = true;
-      bothGuisMissingOneShot = true;
+      syslog(LOG_ERR, "SYSTEM_COMMAND_BATCH from %s %d operations %s", systemCommand.sender_ip_address().c_str(), numOperations,
+             (SYSTEM_COMMAND_RESPONSE_FAILURE == ret) && (0 != funcRet) ? "applied with failures" : "rejected");
+      char descr_str[LOGERROR_DESCR_SIZE];
+      (void)snprintf(descr_str, sizeof(descr_str), "SYSTEM_COMMAND_BATCH from %s %d operations failed", systemCommand.sender_ip_address().c_str(), numOperations);
+      (void)logError("", "Batch command", descr_str);
    }
 
-   numThreadsRunning--;
-   pthread_exit(NULL);
+   return ret;
 }
 
 
@@ -6640,7 +10550,7 @@ uhc::SystemCommandResponses processCommand(SystemCommand systemCommand)
          {
             ret = SYSTEM_COMMAND_RESPONSE_SHUTDOWN_PENDING;
             shutdownRequested = true;
-            (void)system(TOUCH_SOFT_SHUTDOWN_FILE);
+            (void)runSubprocess("touch", TOUCH_SOFT_SHUTDOWN_FILE, SHUTDOWN_TIMEOUT_SECONDS, NULL);
             syslog(LOG_NOTICE, "SYSTEM_COMMAND_SHUTDOWN_REQUESTED from %s received", systemCommand.sender_ip_address().c_str());
          }
          else
@@ -6841,19 +10751,7 @@ uhc::SystemCommandResponses processCommand(SystemCommand systemCommand)
          }
          else
          {
-            if ((systemCommand.temperature() >= tempLookupTable[0].degreesF) && (systemCommand.temperature() <= heaterInfo[0].temperature_setpoint))
-            {
-               newTemp = systemCommand.temperature();
-            }
-            else
-            {
-               newTemp = DEFAULT_ECO_MODE_SETPOINT;
-            }
-
-            for (int i = SLOT1_TOP_HEATER_INDEX; i < NUM_HEATERS; i++)
-            {
-               heaterInfo[i].eco_mode_setpoint = newTemp;
-            }
+            newTemp = setEcoModeSetpoint(systemCommand.temperature());
 
             syslog(LOG_NOTICE, "SYSTEM_COMMAND_SET_ECO_MODE_TEMP from %s temp %hu", systemCommand.sender_ip_address().c_str(), newTemp);
             ret = SYSTEM_COMMAND_RESPONSE_OK;
@@ -6879,16 +10777,7 @@ uhc::SystemCommandResponses processCommand(SystemCommand systemCommand)
          }
          else
          {
-            heaterInfo[channelIndexTopHeater].eco_mode_is_on = true;
-            heaterInfo[channelIndexBottomHeater].eco_mode_is_on = true;
-            heaterInfo[channelIndexTopHeater].saved_setpoint = heaterInfo[channelIndexTopHeater].temperature_setpoint;
-            heaterInfo[channelIndexBottomHeater].saved_setpoint = heaterInfo[channelIndexBottomHeater].temperature_setpoint;
-            heaterInfo[channelIndexTopHeater].eco_mode_on = true;
-            heaterInfo[channelIndexBottomHeater].eco_mode_on = true;
-            funcRet =  setSetpointHeater(channelIndexTopHeater, heaterInfo[channelIndexTopHeater].eco_mode_setpoint);
-            funcRet |= setSetpointHeater(channelIndexBottomHeater, heaterInfo[channelIndexBottomHeater].eco_mode_setpoint);
-            heaterInfo[channelIndexTopHeater].setpoint_changed = true;
-            heaterInfo[channelIndexBottomHeater].setpoint_changed = true;
+            funcRet = ecoModeOnHeaters(channelIndexTopHeater, channelIndexBottomHeater);
             if (0 == funcRet)
             {
                ret = SYSTEM_COMMAND_RESPONSE_OK;
@@ -6916,14 +10805,7 @@ uhc::SystemCommandResponses processCommand(SystemCommand systemCommand)
          lookupHeaterIndices(systemCommand.slot_number(), &channelIndexTopHeater, &channelIndexBottomHeater);
          if (heaterInfo[channelIndexTopHeater].eco_mode_is_on || heaterInfo[channelIndexBottomHeater].eco_mode_is_on)
          {
-            heaterInfo[channelIndexTopHeater].temperature_setpoint = heaterInfo[channelIndexTopHeater].saved_setpoint;
-            heaterInfo[channelIndexBottomHeater].temperature_setpoint = heaterInfo[channelIndexBottomHeater].saved_setpoint;
-            heaterInfo[channelIndexTopHeater].eco_mode_on = false;
-            heaterInfo[channelIndexBottomHeater].eco_mode_on = false;
-            heaterInfo[channelIndexTopHeater].setpoint_changed = true;
-            heaterInfo[channelIndexBottomHeater].setpoint_changed = true;
-            funcRet =  setSetpointHeater(channelIndexTopHeater, heaterInfo[channelIndexTopHeater].temperature_setpoint);
-            funcRet |= setSetpointHeater(channelIndexBottomHeater, heaterInfo[channelIndexBottomHeater].temperature_setpoint);
+            funcRet = ecoModeOffHeaters(channelIndexTopHeater, channelIndexBottomHeater);
             if (0 == funcRet)
             {
                syslog(LOG_NOTICE, "SYSTEM_COMMAND_ECO_MODE_OFF from %s Setting Eco Mode Off Temperature setpoint heater %d temp = %u  heater %d  temp = %u",
@@ -7119,6 +11001,23 @@ uhc::SystemCommandResponses processCommand(SystemCommand systemCommand)
          ret = SYSTEM_COMMAND_RESPONSE_OK;
          break;
 
+      case SYSTEM_COMMAND_REQUEST_KEYFRAME:
+         // a GUI missed a CurrentSystemStateDelta, the next publish will be a full CurrentSystemState
+         syslog(LOG_NOTICE, "SYSTEM_COMMAND_REQUEST_KEYFRAME from %s", systemCommand.sender_ip_address().c_str());
+         cssKeyframeRequested = true;
+         ret = SYSTEM_COMMAND_RESPONSE_OK;
+         break;
+
+      case SYSTEM_COMMAND_BATCH:
+         (void)logCommandEvent(systemCommand.command(), systemCommand.sender_ip_address(), systemCommand.operations_size());
+         ret = processBatchCommand(systemCommand);
+         break;
+
+      case SYSTEM_COMMAND_QUERY_HISTORY:
+         // read only, so it is not logged
+         ret = processHistoryQuery(systemCommand);
+         break;
+
       case SystemCommands_INT_MIN_SENTINEL_DO_NOT_USE_:
       case SystemCommands_INT_MAX_SENTINEL_DO_NOT_USE_:
       default:
@@ -7133,259 +11032,379 @@ uhc::SystemCommandResponses processCommand(SystemCommand systemCommand)
 
 /*******************************************************************************************/
 /*                                                                                         */
-/* void *commandHandlerThread(void *)                                                      */
+/* void fillCommandResponse(const SystemCommand &command, uhc::SystemCommandResponses ret, */
+/*                          uint32_t sequenceNumber, SystemCommandResponse *cr)            */
 /*                                                                                         */
-/* Receive the SystemCommnnd message from GUI1, process it, and send the                   */
-/* SystemCommandResponse message.                                                          */
+/* Fills in the SystemCommandResponse to a command that has been processed.                */
 /*                                                                                         */
-/* Returns: pthread_exit(NULL)                                                             */
+/* Returns: None                                                                           */
 /*                                                                                         */
 /*******************************************************************************************/
-void *commandHandlerThread(void *)
+void fillCommandResponse(const SystemCommand &command, uhc::SystemCommandResponses ret, uint32_t sequenceNumber, SystemCommandResponse *cr)
 {
-   char message[DEFAULT_MESSAGE_BUFFER_SIZE];
-   uint32_t sequenceNumber = 0;
+   cr->set_topic(SYSTEM_COMMAND_RESPONSE_TOPIC);
+   cr->set_sequence_number(sequenceNumber);
+   cr->set_requester_ip_address(command.sender_ip_address());
+   cr->set_command(command.command());
+   cr->set_response(ret);
+   cr->set_slot_number(command.slot_number());
+   cr->set_temperature(command.temperature());
+   cr->set_correlation_id(command.correlation_id());
+
+   // processBatchCommand ran just before on this same thread
+   if (SYSTEM_COMMAND_BATCH == command.command())
+   {
+      for (int i = 0; i < numBatchOperationResponses; i++)
+      {
+         cr->add_operation_responses(batchOperationResponses[i]);
+      }
+   }
+
+   // processHistoryQuery ran just before on this same thread
+   if ((SYSTEM_COMMAND_QUERY_HISTORY == command.command()) && (SYSTEM_COMMAND_RESPONSE_OK == ret))
+   {
+      int upper;
+      int lower;
+      lookupHeaterIndices(command.slot_number(), &upper, &lower);
+      for (int i = 0; i < numHistoryQueryPoints; i++)
+      {
+         const HISTORY_AGGREGATE *point = &historyQueryPoints[i];
+         HistoryPoint *hp = cr->add_history();
+         hp->mutable_time()->set_seconds(point->utc_seconds);
+         hp->set_seconds(point->num_samples);
+         hp->set_upper_min_tenths(point->temperature_min_tenths[upper]);
+         hp->set_upper_mean_tenths(point->temperature_mean_tenths[upper]);
+         hp->set_upper_max_tenths(point->temperature_max_tenths[upper]);
+         hp->set_lower_min_tenths(point->temperature_min_tenths[lower]);
+         hp->set_lower_mean_tenths(point->temperature_mean_tenths[lower]);
+         hp->set_lower_max_tenths(point->temperature_max_tenths[lower]);
+         hp->set_upper_on_seconds(point->heater_on_seconds[upper]);
+         hp->set_lower_on_seconds(point->heater_on_seconds[lower]);
+         hp->set_irms_min((float)point->irms_min_centiamps / 100.0f);
+         hp->set_irms_mean((float)point->irms_mean_centiamps / 100.0f);
+         hp->set_irms_max((float)point->irms_max_centiamps / 100.0f);
+         hp->set_voltage_min((float)point->voltage_min_tenths / 10.0f);
+         hp->set_voltage_mean((float)point->voltage_mean_tenths / 10.0f);
+         hp->set_voltage_max((float)point->voltage_max_tenths / 10.0f);
+         hp->set_heatsink_max_tenths(point->temperature_max_tenths[HEATSINK_RTD_INDEX]);
+         hp->set_ambient_mean_tenths(point->temperature_mean_tenths[AMBIENT_TEMP_RTD_INDEX]);
+      }
+   }
+}
 
-   commandResponsePublisher = zmq_socket(context, ZMQ_PUB);
-   assert(commandResponsePublisher != 0);
-   (void)printf("commandHandlerThread commandResponsePublisher  = %p\n", commandResponsePublisher);
 
-   char commandRespPubPort[IP_STRING_SIZE+ 14];    // Allow space for the tcp:// and :portnumber
-   (void)memset(commandRespPubPort, 0, sizeof(commandRespPubPort));
-   (void)snprintf(commandRespPubPort, sizeof(commandRespPubPort), "tcp://%s:%d", controllerIPAddress, SYSTEM_COMMAND_RESPONSE_PORT_CONTROLLER);
-   (void)printf("commandHandlerThread commandRespPubPort = %s\n", commandRespPubPort);
-   int rs = zmq_bind(commandResponsePublisher, commandRespPubPort);
-   assert(rs == 0);
+/*******************************************************************************************/
+/*                                                                                         */
+/* void handleSystemCommand(GUI_SESSION *session, const char *message, int length)         */
+/*                                                                                         */
+/* Processes a SystemCommand message from a panel and publishes the response to that       */
+/* panel.                                                                                  */
+/*                                                                                         */
+/* Returns: None                                                                           */
+/*                                                                                         */
+/*******************************************************************************************/
+void handleSystemCommand(GUI_SESSION *session, const char *message, int length)
+{
+   // Deserialization
+   static SystemCommand deserialized;
+   if (!deserialized.ParseFromArray(message, length))
+   {
+      if (debugPrintf)
+      {
+         cerr << "handleSystemCommand ERROR: Unable to deserialize!\n";
+         syslog(LOG_ERR, "handleSystemCommand Glass %d ERROR: Unable to deserialize!", session->panel_number);
+         (void)logError("", "handleSystemCommand", "unable to deserialize");
+      }
+   }
 
-   char igCommandReqSubPort[IP_STRING_SIZE + 14];  // Allow space for the tcp:// and :portnumber
-   (void)snprintf(igCommandReqSubPort, sizeof(igCommandReqSubPort), "tcp://%s:%d", guiIPAddress1, SYSTEM_COMMAND_PORT_GUI1);
-   (void)printf("commandHandlerThread igCommandReqSubPort = %s\n", igCommandReqSubPort);
+   if (debugPrintf)
+   {
+      cout << "Deserialization:\n";
 
-   commandListener = zmq_socket(context, ZMQ_SUB);
-   assert(commandListener != 0);
+      cout << "        sender IP address: " << deserialized.sender_ip_address() << "\n";
+      cout << "          sequence number: " << deserialized.sequence_number() << "\n";
+      cout << "                  command: " << deserialized.command() << "\n";
+   }
 
-   char messageType[] = { 10, 3, 'C', 'M', 'D' };
-   int rc = zmq_setsockopt(commandListener, ZMQ_SUBSCRIBE, messageType, sizeof(messageType));
-   assert(rc == 0);
+   // Handle command here
+   uhc::SystemCommandResponses ret = processCommand(deserialized);
 
-   int noTimeout = -1;
-   rc = zmq_setsockopt(commandListener, ZMQ_RCVTIMEO, &noTimeout, sizeof(noTimeout));
+   // Publish ZeroMQ SystemCommandResponse message here
+   SystemCommandResponse cr;
+   fillCommandResponse(deserialized, ret, session->response_sequence_number++, &cr);
+
+   string serialized;
+   if (!cr.SerializeToString(&serialized))
+   {
+      if (debugPrintf)
+      {
+         cerr << "handleSystemCommand ERROR: Unable to serialize!\n";
+         syslog(LOG_ERR, "handleSystemCommand Glass %d ERROR: Unable to serialize!", session->panel_number);
+         (void)logError("", "handleSystemCommand", "unable to serialize");
+      }
+   }
+
+   char bytes[serialized.length()];
+   (void)memcpy(bytes, serialized.data(), serialized.length());
+
+   int rs = zmq_send(session->command_response_publisher, bytes, serialized.length(), 0);
+   assert(rs == (int)serialized.length());
+
+   if (debugPrintf)
+   {
+      cout << "Bytes sent: " << rs << "\n";
+   }
+
+   session->last_command_sequence_number = deserialized.sequence_number();
+   session->commands_received++;
+   markGUISessionHeard(session);
+
+   if (shutdownRequested)
+   {
+      (void)runSubprocessNow("shutdown", SHUTDOWN_NOW_COMMAND, SHUTDOWN_TIMEOUT_SECONDS);
+   }
+}
+
+
+/*******************************************************************************************/
+/*                                                                                         */
+/* void openCommandRouter()                                                                */
+/*                                                                                         */
+/* Creates and binds the ZMQ_ROUTER that takes SystemCommand requests from any client and  */
+/* sends each response back to the client that asked. Clients can have any number of       */
+/* commands outstanding; they are processed in the order they arrive.                      */
+/*                                                                                         */
+/* Returns: None                                                                           */
+/*                                                                                         */
+/*******************************************************************************************/
+void openCommandRouter()
+{
+   commandRouter = zmq_socket(context, ZMQ_ROUTER);
+   assert(commandRouter != 0);
+
+   int64_t maxMessageSize = ZMQ_MAX_MESSAGE_SIZE;
+   int rc = zmq_setsockopt(commandRouter, ZMQ_MAXMSGSIZE, &maxMessageSize, sizeof(maxMessageSize));
    assert(rc == 0);
 
-   rc = zmq_connect(commandListener, igCommandReqSubPort);
+   char commandRouterPort[IP_STRING_SIZE + 14];   // Allow space for the tcp:// and :portnumber
+   (void)snprintf(commandRouterPort, sizeof(commandRouterPort), "tcp://%s:%d", controllerIPAddress, SYSTEM_COMMAND_ROUTER_PORT_CONTROLLER);
+   (void)printf("commandRouterPort = %s\n", commandRouterPort);
+
+   rc = zmq_bind(commandRouter, commandRouterPort);
    assert(rc == 0);
+}
 
-   (void)sleep(1);
 
-   numThreadsRunning++;
-   while(!sigTermReceived)
+/*******************************************************************************************/
+/*                                                                                         */
+/* void handleRouterCommand(const void *identity, size_t identityLength, bool delimited,   */
+/*                          const char *message, int length)                               */
+/*                                                                                         */
+/* Processes a SystemCommand received on the command router and sends the response to the  */
+/* client it came from, with the empty delimiter frame a ZMQ_REQ client expects if the     */
+/* command had one. A command whose sender, sequence number and correlation ID match one   */
+/* of the last COMMAND_CACHE_SIZE commands was resent after a lost response or a reconnect, */
+/* so the cached response is sent again and the command isn't run twice. The cached command */
+/* must be the same command with the same parameters (the serialized bytes are compared by */
+/* CRC); otherwise the client has restarted its numbering, or shares a sender address with */
+/* another, and the command is run as a new one.                                           */
+/*                                                                                         */
+/* Returns: None                                                                           */
+/*                                                                                         */
+/*******************************************************************************************/
+void handleRouterCommand(const void *identity, size_t identityLength, bool delimited, const char *message, int length)
+{
+   static uint32_t sequenceNumber = 0;
+
+   // Deserialization
+   static SystemCommand deserialized;
+   if (!deserialized.ParseFromArray(message, length))
    {
-      (void)memset(message, 0, sizeof(message));
+      // without the command there's no correlation ID to answer with
+      syslog(LOG_ERR, "handleRouterCommand ERROR: Unable to deserialize!");
+      (void)logError("", "handleRouterCommand", "unable to deserialize");
+      return;
+   }
 
-      rc = zmq_recv(commandListener, message, sizeof(message), 0);
-      if (rc == -1)
-      {
-         continue;
-      }
+   if (debugPrintf)
+   {
+      cout << "Deserialization:\n";
 
-      // Deserialization
-      string s(message, rc);
-      SystemCommand deserialized;
-      if (!deserialized.ParseFromString(s))
-      {
-         if (debugPrintf)
-         {
-            cerr << "commandHandlerThread ERROR: Unable to deserialize!\n";
-            syslog(LOG_ERR, "commandHandlerThread ERROR: Unable to deserialize!");
-            (void)logError("", "commandHandlerThread", "unable to deserialize");
-         }
-      }
+      cout << "        sender IP address: " << deserialized.sender_ip_address() << "\n";
+      cout << "          sequence number: " << deserialized.sequence_number() << "\n";
+      cout << "           correlation ID: " << deserialized.correlation_id() << "\n";
+      cout << "                  command: " << deserialized.command() << "\n";
+   }
 
-      if (debugPrintf)
+   routerCommandsReceived++;
+   uint32_t requestCRC = eeslogCRC32((const uint8_t *)message, (size_t)length);
+   COMMAND_CACHE_ENTRY *entry = NULL;
+   for (int i = 0; i < COMMAND_CACHE_SIZE; i++)
+   {
+      if (commandCache[i].valid &&
+          (commandCache[i].sequence_number == deserialized.sequence_number()) &&
+          (commandCache[i].correlation_id == deserialized.correlation_id()) &&
+          (0 == strcmp(commandCache[i].sender, deserialized.sender_ip_address().c_str())))
       {
-         cout << "Deserialization:\n";
-
-         cout << "        sender IP address: " << deserialized.sender_ip_address() << "\n";
-         cout << "          sequence number: " << deserialized.sequence_number() << "\n";
-         cout << "                  command: " << deserialized.command() << "\n";
+         if ((commandCache[i].command != deserialized.command()) || (commandCache[i].request_crc != requestCRC))
+         {
+            // not a resend, so the cached response is stale and must never be replayed
+            commandCache[i].valid = false;
+            routerCommandsKeyReused++;
+            continue;
+         }
+         entry = &commandCache[i];
+         routerCommandsDuplicated++;
+         break;
       }
+   }
 
+   if (NULL == entry)
+   {
       // Handle command here
       uhc::SystemCommandResponses ret = processCommand(deserialized);
 
-      // Publish ZeroMQ SystemCommandResponse message here
       SystemCommandResponse cr;
-      cr.set_topic(SYSTEM_COMMAND_RESPONSE_TOPIC);
-      cr.set_sequence_number(sequenceNumber++);
-      cr.set_requester_ip_address(deserialized.sender_ip_address());
-      cr.set_command(deserialized.command());
-      cr.set_response(ret);
-      cr.set_slot_number(deserialized.slot_number());
-      cr.set_temperature(deserialized.temperature());
+      fillCommandResponse(deserialized, ret, sequenceNumber++, &cr);
 
-      string serialized;
-      if (!cr.SerializeToString(&serialized))
+      if (cr.ByteSizeLong() > COMMAND_RESPONSE_BUFFER_SIZE)
       {
-         if (debugPrintf)
+         // History query responses don't fit in the cache. A query changes nothing, so a
+         // resent one is simply answered again.
+         static string uncached;
+         if (!cr.SerializeToString(&uncached))
          {
-            cerr << "commandHandlerThread ERROR: Unable to serialize!\n";
-            syslog(LOG_ERR, "commandHandlerThread ERROR: Unable to serialize!");
-            (void)logError("", "commandHandlerThread", "unable to serialize");
+            syslog(LOG_ERR, "handleRouterCommand ERROR: Unable to serialize!");
+            (void)logError("", "handleRouterCommand", "unable to serialize");
+            return;
          }
+         sendRouterResponse(identity, identityLength, delimited, uncached.data(), uncached.length());
+         finishRouterCommand(deserialized);
+         return;
       }
 
-      char bytes[serialized.length()];
-      (void)memcpy(bytes, serialized.data(), serialized.length());
-
-      int rs = zmq_send(commandResponsePublisher, bytes, serialized.length(), 0);
-      assert(rs == (int)serialized.length());
-
-      if (debugPrintf)
-      {
-         cout << "Bytes sent: " << rs << "\n";
-      }
-
-      lastTimeGUI1Heard = 0;
-      gui1MissingOneShot = true;
-      bothGuisMissingOneShot = true;
-
-      if (shutdownRequested)
+      // the oldest response makes room for this one
+      entry = &commandCache[commandCacheNext];
+      commandCacheNext = (commandCacheNext + 1) % COMMAND_CACHE_SIZE;
+      entry->valid = false;
+      entry->length = cr.ByteSizeLong();
+      if ((entry->length > sizeof(entry->response)) || !cr.SerializeToArray(entry->response, (int)entry->length))
       {
-         (void)system(SHUTDOWN_NOW_COMMAND);
+         syslog(LOG_ERR, "handleRouterCommand ERROR: Unable to serialize!");
+         (void)logError("", "handleRouterCommand", "unable to serialize");
+         return;
       }
+      (void)memset(entry->sender, 0, sizeof(entry->sender));
+      (void)strncpy(entry->sender, deserialized.sender_ip_address().c_str(), sizeof(entry->sender) - 1);
+      entry->sequence_number = deserialized.sequence_number();
+      entry->correlation_id = deserialized.correlation_id();
+      entry->command = deserialized.command();
+      entry->request_crc = requestCRC;
+      entry->valid = true;
    }
 
-   numThreadsRunning--;
-   pthread_exit(NULL);
+   sendRouterResponse(identity, identityLength, delimited, entry->response, entry->length);
+   finishRouterCommand(deserialized);
 }
 
 
 /*******************************************************************************************/
 /*                                                                                         */
-/* void *commandHandlerThread2(void *)                                                     */
+/* void sendRouterResponse(const void *identity, size_t identityLength, bool delimited,    */
+/*                         const void *response, size_t length)                            */
 /*                                                                                         */
-/* Receive the SystemCommnnd message from GUI2, process it, and send the                   */
-/* SystemCommandResponse message.                                                          */
+/* Sends a serialized SystemCommandResponse to the command router client with the given    */
+/* routing ID, with the empty delimiter frame if the command had one.                      */
 /*                                                                                         */
-/* Returns: pthread_exit(NULL)                                                             */
+/* Returns: None                                                                           */
 /*                                                                                         */
 /*******************************************************************************************/
-void *commandHandlerThread2(void *)
+void sendRouterResponse(const void *identity, size_t identityLength, bool delimited, const void *response, size_t length)
 {
-   char message[DEFAULT_MESSAGE_BUFFER_SIZE];
-   uint32_t sequenceNumber = 0;
-
-   commandResponsePublisher2 = zmq_socket(context, ZMQ_PUB);
-   assert(commandResponsePublisher2 != 0);
-   (void)printf("commandHandlerThread2 commandResponsePublisher2  = %p\n", commandResponsePublisher2);
-
-   char commandRespPubPort[IP_STRING_SIZE + 14];   // Allow space for the tcp:// and :portnumber
-   (void)memset(commandRespPubPort, 0, sizeof(commandRespPubPort));
-   (void)snprintf(commandRespPubPort, sizeof(commandRespPubPort), "tcp://%s:%d", controllerIPAddress, SYSTEM_COMMAND_RESPONSE_PORT_CONTROLLER2);
-   (void)printf("commandHandlerThread2 commandRespPubPort = %s\n", commandRespPubPort);
-   int rs = zmq_bind(commandResponsePublisher2, commandRespPubPort);
-   assert(rs == 0);
-
-   char igCommandReqSubPort[IP_STRING_SIZE + 14];  // Allow space for the tcp:// and :portnumber
-   (void)snprintf(igCommandReqSubPort, sizeof(igCommandReqSubPort), "tcp://%s:%d", guiIPAddress2, SYSTEM_COMMAND_PORT_GUI2);
-   (void)printf("commandHandlerThread2 igCommandReqSubPort = %s\n", igCommandReqSubPort);
+   // a client that has gone away is dropped by the router rather than blocking it
+   (void)zmq_send(commandRouter, identity, identityLength, ZMQ_SNDMORE | ZMQ_DONTWAIT);
+   if (delimited)
+   {
+      (void)zmq_send(commandRouter, "", 0, ZMQ_SNDMORE | ZMQ_DONTWAIT);
+   }
+   int rs = zmq_send(commandRouter, response, length, ZMQ_DONTWAIT);
+   if (debugPrintf)
+   {
+      cout << "Bytes sent: " << rs << "\n";
+   }
+}
 
-   commandListener2 = zmq_socket(context, ZMQ_SUB);
-   assert(commandListener2 != 0);
 
-   char messageType[] = { 10, 3, 'C', 'M', 'D' };
-   int rc = zmq_setsockopt(commandListener2, ZMQ_SUBSCRIBE, messageType, sizeof(messageType));
-   assert(rc == 0);
+/*******************************************************************************************/
+/*                                                                                         */
+/* void finishRouterCommand(const SystemCommand &command)                                  */
+/*                                                                                         */
+/* Notes a command answered on the command router against the panel that sent it, if it is */
+/* one of ours, and shuts down if the command asked for it.                                */
+/*                                                                                         */
+/* Returns: None                                                                           */
+/*                                                                                         */
+/*******************************************************************************************/
+void finishRouterCommand(const SystemCommand &command)
+{
+   GUI_SESSION *session = findGUISession(command.sender_ip_address().c_str());
+   if (session != NULL)
+   {
+      session->last_command_sequence_number = command.sequence_number();
+      session->commands_received++;
+      markGUISessionHeard(session);
+   }
 
-   int noTimeout = -1;
-   rc = zmq_setsockopt(commandListener2, ZMQ_RCVTIMEO, &noTimeout, sizeof(noTimeout));
-   assert(rc == 0);
+   if (shutdownRequested)
+   {
+      (void)runSubprocessNow("shutdown", SHUTDOWN_NOW_COMMAND, SHUTDOWN_TIMEOUT_SECONDS);
+   }
+}
 
-   rc = zmq_connect(commandListener2, igCommandReqSubPort);
-   assert(rc == 0);
 
-   (void)sleep(1);
+/*******************************************************************************************/
+/*                                                                                         */
+/* void serviceCommandRouter(zmq_msg_t *message)                                           */
+/*                                                                                         */
+/* Receives every command queued on the command router. Each arrives as the client's       */
+/* routing ID, an empty delimiter if the client is a ZMQ_REQ, and the SystemCommand.       */
+/*                                                                                         */
+/* Returns: None                                                                           */
+/*                                                                                         */
+/*******************************************************************************************/
+void serviceCommandRouter(zmq_msg_t *message)
+{
+   zmq_msg_t identity;
+   (void)zmq_msg_init(&identity);
 
-   numThreadsRunning++;
-   while(!sigTermReceived)
+   while (zmq_msg_recv(&identity, commandRouter, ZMQ_DONTWAIT) != -1)
    {
-      (void)memset(message, 0, sizeof(message));
-
-      rc = zmq_recv(commandListener2, message, sizeof(message), 0);
-      if (rc == -1)
-      {
-         continue;
-      }
-
-      // Deserialization
-      string s(message, rc);
-      SystemCommand deserialized;
-      if (!deserialized.ParseFromString(s))
+      // the rest of a multipart message is always there once the first part is
+      bool delimited = false;
+      int length = -1;
+      bool more = zmq_msg_more(&identity);
+      while (more)
       {
-         if (debugPrintf)
+         if (zmq_msg_recv(message, commandRouter, 0) == -1)
          {
-            cerr << "commandHandlerThread2 ERROR: Unable to deserialize!\n";
-            syslog(LOG_ERR, "commandHandlerThread2 ERROR: Unable to deserialize!");
-            (void)logError("", "commandHandlerThread2", "unable to deserialize");
+            length = -1;
+            break;
          }
-      }
-
-      if (debugPrintf)
-      {
-         cout << "Deserialization:\n";
-
-         cout << "        sender IP address: " << deserialized.sender_ip_address() << "\n";
-         cout << "          sequence number: " << deserialized.sequence_number() << "\n";
-         cout << "                  command: " << deserialized.command() << "\n";
-      }
-
-      // Handle command here
-      uhc::SystemCommandResponses ret = processCommand(deserialized);
-
-      // Publish ZeroMQ SystemCommandResponse message here
-      SystemCommandResponse cr;
-      cr.set_topic(SYSTEM_COMMAND_RESPONSE_TOPIC);
-      cr.set_sequence_number(sequenceNumber++);
-      cr.set_requester_ip_address(deserialized.sender_ip_address());
-      cr.set_command(deserialized.command());
-      cr.set_response(ret);
-      cr.set_slot_number(deserialized.slot_number());
-      cr.set_temperature(deserialized.temperature());
-
-      string serialized;
-      if (!cr.SerializeToString(&serialized))
-      {
-         if (debugPrintf)
+         length = (int)zmq_msg_size(message);
+         more = zmq_msg_more(message);
+         if ((0 == length) && more)
          {
-            cerr << "commandHandlerThread2 ERROR: Unable to serialize!\n";
-            syslog(LOG_ERR, "commandHandlerThread2 ERROR: Unable to serialize!");
-            (void)logError("", "commandHandlerThread2", "unable to serialize");
+            delimited = true;
          }
       }
 
-      char bytes[serialized.length()];
-      (void)memcpy(bytes, serialized.data(), serialized.length());
-
-      int rs = zmq_send(commandResponsePublisher2, bytes, serialized.length(), 0);
-      assert(rs == (int)serialized.length());
-
-      if (debugPrintf)
-      {
-         cout << "Bytes sent: " << rs << "\n";
-      }
-
-      lastTimeGUI2Heard = 0;
-      gui2MissingOneShot = true;
-      bothGuisMissingOneShot = true;
-
-      if (shutdownRequested)
+      if (length > 0)
       {
-         (void)system(SHUTDOWN_NOW_COMMAND);
+         handleRouterCommand(zmq_msg_data(&identity), zmq_msg_size(&identity), delimited, (const char *)zmq_msg_data(message), length);
       }
    }
 
-   numThreadsRunning--;
-   pthread_exit(NULL);
+   (void)zmq_msg_close(&identity);
 }
 
 void *softPowerdownThread(void *)
@@ -7445,7 +11464,7 @@ void *softPowerdownThread(void *)
 
             // Stop the kernel logging service.
             closelog();
-            (void)system(STOP_KERNEL_LOG_CMD);
+            (void)runSubprocessNow("stop syslog-ng", STOP_KERNEL_LOG_CMD, STOP_KERNEL_LOG_TIMEOUT_SECONDS);
 
             // Stop our status/error/event logging thread.
             logStop();
@@ -7712,15 +11731,17 @@ int initializeDataStructures()
    ret |= readTemperatureLookupFiles();
    ret |= initPGA117SPI();
    ret |= initHeaterDataStructures();
+   initSensorSnapshot();
+   ret |= initHistory();
+   ret |= initSensorScanSignal();
    ret |= getSerialAndModel();
    ret |= getSetpointLimits();
    ret |= system(COPY_LOGROTATE_FILE);
    ret |= system(COPY_SYSLOG_NG_FILE);
-   lastTimeGUI1Heard = 0;
-   lastTimeGUI2Heard = 0;
-   gui1MissingOneShot = true;
-   gui2MissingOneShot = true;
-   bothGuisMissingOneShot = true;
+   for (int i = 0; i < numGUISessions; i++)
+   {
+      markGUISessionHeard(&guiSessions[i]);
+   }
 
    return ret;
 }
@@ -7945,6 +11966,152 @@ int checkEthernetUpDown()
 }
 
 
+/*******************************************************************************************/
+/*                                                                                         */
+/* void *guiSessionThread(void *)                                                          */
+/*                                                                                         */
+/* Services the sockets of every GUI session with zmq_poll. Used with the publisher        */
+/* threads when ZMQ_REACTOR_DISABLE_FILE exists.                                           */
+/*                                                                                         */
+/* Returns: pthread_exit(NULL)                                                             */
+/*                                                                                         */
+/*******************************************************************************************/
+void *guiSessionThread(void *)
+{
+   zmq_msg_t message;
+   ZMQ_REACTOR_SOCKET sockets[ZMQ_REACTOR_NUM_SOCKETS];
+   zmq_pollitem_t items[ZMQ_REACTOR_NUM_SOCKETS];
+   (void)zmq_msg_init(&message);
+
+   int numSockets = openGUISessions(items, sockets);
+   (void)sleep(1);
+
+   numThreadsRunning++;
+   while(!sigTermReceived)
+   {
+      int rc = zmq_poll(items, numSockets, GUI_SESSION_POLL_TIMEOUT_MS);
+      if (rc > 0)
+      {
+         dispatchGUISessionMessages(items, sockets, numSockets, &message, "guiSessionThread");
+      }
+   }
+
+   (void)zmq_msg_close(&message);
+   numThreadsRunning--;
+   pthread_exit(NULL);
+}
+
+
+/*******************************************************************************************/
+/*                                                                                         */
+/* void *zmqReactorThread(void *)                                                          */
+/*                                                                                         */
+/* Services the sockets of every GUI session from one thread with zmq_poll, and runs the   */
+/* CurrentSystemState and RTD publishers on 1 second timers between messages. Replaces     */
+/* the GUI session, status publisher and RTD publisher threads. The                        */
+/* firmware update listener keeps its own thread since an update blocks for minutes.       */
+/*                                                                                         */
+/* Returns: pthread_exit(NULL)                                                             */
+/*                                                                                         */
+/*******************************************************************************************/
+void *zmqReactorThread(void *)
+{
+   zmq_msg_t message;
+   ZMQ_REACTOR_SOCKET sockets[ZMQ_REACTOR_NUM_SOCKETS];
+   ZMQ_REACTOR_TIMER timers[ZMQ_REACTOR_NUM_TIMERS] =
+   {
+      { &statusPublisherTask, publishSystemState },
+      { &rtdPublisherTask,    publishRTDs }
+   };
+   zmq_pollitem_t items[ZMQ_REACTOR_NUM_SOCKETS];
+   (void)zmq_msg_init(&message);
+
+   int numSockets = openGUISessions(items, sockets);
+   openStatusPublisher();
+   openRTDPublisher();
+
+   (void)sleep(1);
+
+   initPeriodicTask(&statusPublisherTask, "statusPublisher", ONE_SECOND_IN_MICROSECONDS);
+   initPeriodicTask(&rtdPublisherTask, "rtdPublisher", ONE_SECOND_IN_MICROSECONDS);
+
+   numThreadsRunning++;
+   while(!sigTermReceived)
+   {
+      // sleep until a message arrives or the next timer is due, whichever is first
+      struct timespec now;
+      (void)clock_gettime(CLOCK_MONOTONIC, &now);
+      int64_t timeoutMicroseconds = ONE_SECOND_IN_MICROSECONDS;
+      for (int i = 0; i < ZMQ_REACTOR_NUM_TIMERS; i++)
+      {
+         int64_t untilDue = timespecDiffMicroseconds(&timers[i].task->next_deadline, &now);
+         if (untilDue < timeoutMicroseconds)
+         {
+            timeoutMicroseconds = untilDue;
+         }
+      }
+      if (timeoutMicroseconds < 0)
+      {
+         timeoutMicroseconds = 0;
+      }
+
+      // round up so we don't wake a fraction of a millisecond early and spin
+      int rc = zmq_poll(items, numSockets, (long)((timeoutMicroseconds + 999) / 1000));
+      if (rc > 0)
+      {
+         dispatchGUISessionMessages(items, sockets, numSockets, &message, "zmqReactorThread");
+      }
+
+      (void)clock_gettime(CLOCK_MONOTONIC, &now);
+      for (int i = 0; i < ZMQ_REACTOR_NUM_TIMERS; i++)
+      {
+         if (timespecDiffMicroseconds(&now, &timers[i].task->next_deadline) >= 0)
+         {
+            recordPeriodicTaskJitter(timers[i].task);
+            timers[i].handler();
+            advancePeriodicTask(timers[i].task);
+         }
+      }
+   }
+
+   (void)zmq_msg_close(&message);
+   numThreadsRunning--;
+   pthread_exit(NULL);
+}
+
+
+/*******************************************************************************************/
+/*                                                                                         */
+/* void createMessagingThreads()                                                           */
+/*                                                                                         */
+/* Creates a thread that services the GUI sessions and a thread for each publisher. Used   */
+/* instead of the zmqReactorThread when ZMQ_REACTOR_DISABLE_FILE exists.                   */
+/*                                                                                         */
+/* Returns: None                                                                           */
+/*                                                                                         */
+/*******************************************************************************************/
+void createMessagingThreads()
+{
+   if (pthread_create(&statusPublisherThread_ID, NULL, statusPublisherThread, NULL))
+   {
+      (void)printf("Fail...Cannot spawn the statusPublisherThread.\n");
+      exit(-1);
+   }
+
+   if (pthread_create(&guiSessionThread_ID, NULL, guiSessionThread, NULL))
+   {
+      (void)printf("Fail...Cannot spawn the guiSessionThread.\n");
+      exit(-1);
+   }
+
+   if (pthread_create(&rtdPublisherThread_ID, NULL, rtdPublisherThread, NULL))
+   {
+      (void)printf("Fail...Cannot spawn the rtdPublisherThread.\n");
+      exit(-1);
+   }
+}
+
+
 /*******************************************************************************************/
 /*                                                                                         */
 /* void createThreads()                                                                    */
@@ -7957,11 +12124,11 @@ int checkEthernetUpDown()
 /*******************************************************************************************/
 void createThreads()
 {
-    if (pthread_create( &statusPublisherThread_ID, NULL, statusPublisherThread, NULL))
-    {
-      (void)printf("Fail...Cannot spawn the statusPublisherThread.\n");
+   if (pthread_create(&subprocessThread_ID, NULL, subprocessThread, NULL))
+   {
+      (void)printf("Fail...Cannot spawn the subprocessThread.\n");
       exit(-1);
-    }
+   }
 
    if (pthread_create(&loggerThread_ID, NULL, loggerThread, NULL))
    {
@@ -7969,17 +12136,17 @@ void createThreads()
       exit(-1);
    }
 
-    if (pthread_create( &commandHandlerThread_ID, NULL, commandHandlerThread, NULL))
-    {
-      (void)printf("Fail...Cannot spawn the commandHandlerThread.\n");
+   if (pthread_create(&alarmPublisherThread_ID, NULL, alarmPublisherThread, NULL))
+   {
+      (void)printf("Fail...Cannot spawn the alarmPublisherThread.\n");
       exit(-1);
-    }
+   }
 
-    if (pthread_create( &commandHandlerThread2_ID, NULL, commandHandlerThread2, NULL))
-    {
-      (void)printf("Fail...Cannot spawn the commandHandlerThread2.\n");
+   if (pthread_create(&rtdStreamThread_ID, NULL, rtdStreamThread, NULL))
+   {
+      (void)printf("Fail...Cannot spawn the rtdStreamThread.\n");
       exit(-1);
-    }
+   }
 
     if (pthread_create( &readADCThread_ID, NULL, readADCThread, NULL))
     {
@@ -7993,30 +12160,6 @@ void createThreads()
       exit(-1);
     }
 
-    if (pthread_create( &heartBeatListenerThread_ID, NULL, heartBeatListenerThread, NULL))
-    {
-      (void)printf("Fail...Cannot spawn the heartBeatListenerThread.\n");
-      exit(-1);
-    }
-
-    if (pthread_create( &heartBeatListenerThread2_ID, NULL, heartBeatListenerThread2, NULL))
-    {
-      (void)printf("Fail...Cannot spawn the heartBeatListenerThread2.\n");
-      exit(-1);
-    }
-
-    if (pthread_create( &timeSyncSubscriberThread_ID, NULL, timeSyncSubscriberThread, NULL))
-    {
-      (void)printf("Fail...Cannot spawn the timeSyncSubscriberThread.\n");
-      exit(-1);
-    }
-#if(0)
-    if (pthread_create( &timeSyncSubscriberThread2_ID, NULL, timeSyncSubscriberThread2, NULL))
-    {
-      (void)printf("Fail...Cannot spawn the timeSyncSubscriberThread2.\n");
-      exit(-1);
-    }
-#endif
     if (pthread_create( &firmwareUpdateListenerThread_ID, NULL, firmwareUpdateListenerThread, NULL))
     {
       (void)printf("Fail...Cannot spawn the firmwareUpdateListenerThread.\n");
@@ -8035,10 +12178,20 @@ void createThreads()
       exit(-1);
    }
 
-   if (pthread_create(&rtdPublisherThread_ID, NULL, rtdPublisherThread, NULL))
+   if (access(ZMQ_REACTOR_DISABLE_FILE, F_OK) == 0)
    {
-      (void)printf("Fail...Cannot spawn the rtdPublisherThread.\n");
-      exit(-1);
+      syslog(LOG_NOTICE, "ZMQ reactor disabled by %s, using a thread per socket", ZMQ_REACTOR_DISABLE_FILE);
+      createMessagingThreads();
+   }
+   else
+   {
+      zmqReactor = true;
+      syslog(LOG_NOTICE, "ZMQ sockets serviced by zmqReactorThread");
+      if (pthread_create(&zmqReactorThread_ID, NULL, zmqReactorThread, NULL))
+      {
+         (void)printf("Fail...Cannot spawn the zmqReactorThread.\n");
+         exit(-1);
+      }
    }
 }
 
@@ -8054,10 +12207,6 @@ void createThreads()
 int main(int argc, char *argv[])
 {
    bool previousSDCardState = false;
-   struct timeval start;
-   struct timeval end;
-   uint32_t executionTime;
-   uint32_t balance;
 
    // this is really only necessary for testing in order to stop the program
    struct sigaction sig_act;
@@ -8113,45 +12262,29 @@ int main(int argc, char *argv[])
    previousSDCardState = sdCardExists;
 
    // force a logrotate since they seem to not leave the UHC
-   // powered up 24/7
-   (void)system(FORCE_LOGROTATE_COMMAND);
+   // powered up 24/7; it runs once subprocessThread is started
+   (void)runSubprocess("logrotate", FORCE_LOGROTATE_COMMAND, LOGROTATE_TIMEOUT_SECONDS, NULL);
 
    (void)memset(controllerIPAddress, 0, sizeof(controllerIPAddress));
-   (void)memset(guiIPAddress1, 0, sizeof(guiIPAddress1));
-   (void)memset(guiIPAddress2, 0, sizeof(guiIPAddress2));
    (void)memset(controllerManifestFilename, 0, sizeof(controllerManifestFilename));
    (void)strncpy(controllerManifestFilename, CONTROLLER_MANIFEST_FILENAME, sizeof(controllerManifestFilename));
 
    int i;
-   if (4 == argc)
+   if ((argc >= 3) && (argc <= (2 + MAX_GUI_SESSIONS)))
    {
-      for (i = 1; i < argc; i++)
-      {
-         switch (i)
-         {
-            case 1:
-               (void)strncpy(controllerIPAddress, argv[i], sizeof(controllerIPAddress));
-               (void)printf("controllerIPAddress = %s\n", controllerIPAddress);
-               break;
-
-            case 2:
-               (void)strncpy(guiIPAddress1, argv[i], sizeof(guiIPAddress1));
-               (void)printf("guiIPAddress1 = %s\n", guiIPAddress1);
-               break;
-
-             case 3:
-               (void)strncpy(guiIPAddress2, argv[i], sizeof(guiIPAddress2));
-               (void)printf("guiIPAddress2 = %s\n", guiIPAddress2);
-               break;
+      (void)strncpy(controllerIPAddress, argv[1], sizeof(controllerIPAddress));
+      (void)printf("controllerIPAddress = %s\n", controllerIPAddress);
 
-            default:
-               break;
-         }
+      // one session per Intelligent Glass panel or remote display
+      for (i = 2; i < argc; i++)
+      {
+         (void)addGUISession(argv[i]);
+         (void)printf("guiIPAddress%d = %s\n", i - 1, argv[i]);
       }
    }
    else
    {
-      (void)printf("Usage frontier_uhc <controllerIPAddress> <GUI1IPAddress> <GUI2IPAddress>\n");
+      (void)printf("Usage frontier_uhc <controllerIPAddress> <GUI1IPAddress> [<GUI2IPAddress> ... <GUI%dIPAddress>]\n", MAX_GUI_SESSIONS);
       exit(-1);
    }
 
@@ -8236,12 +12369,12 @@ int main(int argc, char *argv[])
    // start task threads
    createThreads();
 
+   initPeriodicTask(&mainLoopTask, "main", ONE_SECOND_IN_MICROSECONDS);
+
    // this loop just spins forever until the power is cut.
    // the task threads do all of the heavy lifting.
    while (!sigTermReceived)
    {
-      (void)gettimeofday(&start, NULL);
-
       // these file existence checks allow debug messages on the console to be turned on/off
       // while running; to start debug messages flowing, issue "touch /tmp/debug" for most messages,
       // and "touch /tmp/debugHeater" to debug the heater control
@@ -8287,11 +12420,16 @@ int main(int argc, char *argv[])
          debugCSV = false;
       }
 
+      // check for RTD streaming enabled
+      rtdStreamRateHz = readRTDStreamRate();
+
       // check if an SD card was added or removed
       // sets the sdCardExists flag
       checkSDCardExists();
       if (previousSDCardState != sdCardExists)
       {
+         // the logger's open log file is on the card that went away (or on none)
+         logWriterReopen = true;
          if (sdCardExists)
          {
             initSDCardSupport();
@@ -8329,21 +12467,13 @@ int main(int argc, char *argv[])
 	  }
 	  previousEthernetUp = ethernetUp;
 
-     (void)gettimeofday(&end, NULL);
-
-     executionTime = (((end.tv_sec - start.tv_sec) * ONE_SECOND_IN_MICROSECONDS) + (end.tv_usec - start.tv_usec));
-     if (executionTime < ONE_SECOND_IN_MICROSECONDS)
-     {
-        balance = ONE_SECOND_IN_MICROSECONDS - executionTime;
-//        printf("task execution took %d microseconds balance = %ld\n", executionTime, balance);
-        usleep(balance);
-     }
-     else
+     if (PROCESS_STATS_STARTUP_DELAY_SECONDS == mainLoopTask.runs)
      {
-        // force a minimum thread sleep time
-//        printf("Execution time took more than 1 second - %d.%d\n", (executionTime / ONE_SECOND_IN_MICROSECONDS), (executionTime % ONE_SECOND_IN_MICROSECONDS));
-        usleep(MINIMUM_THREAD_SLEEP_TIME);
+        // all of the threads have finished their setup by now
+        logThreadsAndMemory();
      }
+
+     waitPeriodicTask(&mainLoopTask);
    }
 
    // wait up to 3 seconds to terminate program once we receive SIGTERM
@@ -54,6 +54,16 @@
 
 #define FORCE_LOGROTATE_COMMAND     "/usr/sbin/logrotate /etc/logrotate.conf &"
 
+// shell commands are run by subprocessThread, see runSubprocess; these are how long each may take
+#define SET_TIME_TIMEOUT_SECONDS         10
+#define SET_TIMEZONE_TIMEOUT_SECONDS     30       // timedatectl waits on systemd-timedated
+#define SD_CARD_REPAIR_TIMEOUT_SECONDS   120      // for each of the fsck, umount and mount
+#define SHUTDOWN_TIMEOUT_SECONDS         30
+#define STOP_KERNEL_LOG_TIMEOUT_SECONDS  30
+#define LOGROTATE_TIMEOUT_SECONDS        10       // the shell leaves logrotate running in the background
+#define SUBPROCESS_PENDING               (-EINPROGRESS)
+#define SUBPROCESS_NAME_SIZE             32
+
 #define  SERIAL_NUMBER_SIZE         64
 #define MODEL_NUMBER_SIZE           64
 #define SETPOINT_LIMIT_SIZE         8
@@ -79,7 +89,32 @@
 #define COMMAND_LINE_BUFFER_SIZE    1024
 #define DEFAULT_MESSAGE_BUFFER_SIZE 1024
 #define DEFAULT_CSS_MESSAGE_BUFFER_SIZE 2048
+#define CSS_ARENA_BLOCK_SIZE            16384   // holds one complete CurrentSystemState with room to spare
 #define DEFAULT_RTD_MESSAGE_BUFFER_SIZE 2048
+
+// the status publisher sends a full CurrentSystemState keyframe every CSS_KEYFRAME_INTERVAL_SECONDS
+// and a CurrentSystemStateDelta of just the changes in between if this file exists
+#define CSS_DELTA_ENABLE_FILE           "/etc/enableCSSDelta"
+#define CSS_KEYFRAME_INTERVAL_SECONDS   10
+#define CSS_DELTA_ARENA_BLOCK_SIZE      8192    // holds one delta carrying every slot
+#define CSS_SLOT_BUFFER_SIZE            256     // one serialized SlotData
+#define CSS_DELTA_CLOCKS                4       // Timestamps in SystemData that are sent in every delta
+#define ZMQ_MAX_MESSAGE_SIZE            65536   // ZMQ_MAXMSGSIZE of the receiving sockets
+#define ZMQ_OVERSIZE_LOG_INTERVAL_SECONDS  60   // at most one syslog per interval for oversize frames
+
+// a single zmqReactorThread polls every subscriber socket and runs the 1 second publishers
+// unless this file exists, in which case each socket gets its own thread again
+#define ZMQ_REACTOR_DISABLE_FILE    "/etc/disableZMQReactor"
+#define MAX_GUI_SESSIONS            4        // Intelligent Glass panels and remote displays
+#define GUI_SESSION_NUM_SOCKETS     3        // heartbeat, command and time sync subscribers
+#define GUI_SESSION_POLL_TIMEOUT_MS 1000
+#define ZMQ_REACTOR_NUM_SOCKETS     ((MAX_GUI_SESSIONS * GUI_SESSION_NUM_SOCKETS) + 1)   // + the command router
+#define COMMAND_CACHE_SIZE          32       // responses kept for commands that are resent
+#define COMMAND_RESPONSE_BUFFER_SIZE 256
+#define MAX_BATCH_OPERATIONS        32       // in one SYSTEM_COMMAND_BATCH
+#define ZMQ_REACTOR_NUM_TIMERS      2
+#define PROCESS_STATUS_FILE         "/proc/self/status"
+#define PROCESS_STATS_STARTUP_DELAY_SECONDS  10
 #define FIRMWARE_UPDATE_BUFFER_SIZE 8192
 #define MAX_FILE_PATH               1024
 #define IP_STRING_SIZE              64
@@ -90,6 +125,7 @@
 
 #define STARTUP_TEMP_DELTA_FOR_COMPLETE      5     /* we report at temp when we reach (setpoint - STARTUP_TEMP_DELTA_FOR_COMPLETE) */
 #define SETPOINT_RANGE_PLUS_MINUS            5       /* legal temp range is +/- 5F from setpoint */
+#define HEATER_HYSTERESIS_TENTHS             5       /* an off heater waits until it is 0.5F below setpoint, an on one runs to setpoint */
 #define MAX_STARTUP_REACH_SETPOINT_TIME      3000    /* startup time 35 minutes RELAXED TO 50 MINUTES FOR ALPHA */
 #define ONE_MINUTE_IN_SECONDS                60
 #define TWO_MINUTES_IN_SECONDS               120
@@ -106,6 +142,81 @@
 #define TEN_MILLISECONDS_IN_MICROSECONDS  10000      /* Ten thousand microseconds = one millisecond */
 #define MINIMUM_THREAD_SLEEP_TIME         TEN_MILLISECONDS_IN_MICROSECONDS
 
+// periodic task scheduling statistics
+#define PERIODIC_TASK_JITTER_BUCKETS             8      // < 100us, < 200us, < 400us ... >= 6.4ms
+#define PERIODIC_TASK_JITTER_BASE_MICROSECONDS   100
+
+typedef struct
+{
+   const char *name;
+   uint32_t period_us;
+   struct timespec next_deadline;             // CLOCK_MONOTONIC
+   uint32_t runs;
+   uint32_t overruns;                         // passes that ran past their next deadline
+   uint32_t missed_deadlines;                 // periods skipped because of overruns
+   uint32_t max_jitter_us;                    // latest wakeup after a deadline
+   uint32_t jitter_histogram[PERIODIC_TASK_JITTER_BUCKETS];
+} PERIODIC_TASK;
+
+// CurrentSystemState stream statistics, kept separately for full messages and deltas
+typedef struct
+{
+   uint32_t messages;
+   uint64_t bytes;
+   uint64_t cpu_nanoseconds;                  // thread CPU time spent finding changes and serializing
+} CSS_STREAM_STATS;
+
+typedef struct
+{
+   int heartbeat;                                          // on the panel
+   int command;                                            // on the panel
+   int command_response;                                   // on the controller
+   int time_sync;                                          // on the panel
+} GUI_SESSION_PORTS;
+
+// one per Intelligent Glass panel, in the order given on the command line
+typedef struct
+{
+   int panel_number;                                       // 1 based, as used in the log messages
+   char ip_address[IP_STRING_SIZE];
+   const GUI_SESSION_PORTS *ports;
+   void *heartbeat_listener;
+   void *command_listener;
+   void *time_sync_subscriber;
+   void *command_response_publisher;
+   uint32_t last_heard_seconds;                            // CLOCK_MONOTONIC
+   bool missing_one_shot;
+   uint32_t response_sequence_number;                      // of the next SystemCommandResponse
+   uint32_t last_command_sequence_number;                  // of the last SystemCommand received
+   uint32_t heartbeats_received;
+   uint32_t commands_received;
+} GUI_SESSION;
+
+// response to a command received on the command router, kept in case the command is resent
+typedef struct
+{
+   bool valid;
+   char sender[IP_STRING_SIZE];                            // sender_ip_address of the command
+   uint32_t sequence_number;                               // of the command
+   uint64_t correlation_id;                                // of the command
+   int command;                                            // uhc::SystemCommands of the command
+   uint32_t request_crc;                                   // eeslogCRC32 of the serialized command
+   size_t length;
+   char response[COMMAND_RESPONSE_BUFFER_SIZE];            // serialized SystemCommandResponse
+} COMMAND_CACHE_ENTRY;
+
+typedef struct
+{
+   GUI_SESSION *session;                                   // panel the socket belongs to, NULL for the command router
+   void (*handler)(GUI_SESSION *session, const char *message, int length);   // called for every message received
+} ZMQ_REACTOR_SOCKET;
+
+typedef struct
+{
+   PERIODIC_TASK *task;                                    // schedule and statistics
+   void (*handler)();                                      // called once per period
+} ZMQ_REACTOR_TIMER;
+
 // defined but not used GPIOs
 #define UNUSED_GPIO_INIT_SCRIPT              "/usr/bin/setupUnusedGPIOs.sh"
 
@@ -122,6 +233,12 @@
 #define VAC220_OFF_STRING           "0"
 #define ADC_RAW_COUNTS_OPEN            0x0000
 #define ADC_RAW_COUNTS_SHORTED         0x0FFF
+#define ADC_NUM_RAW_COUNTS             4096     /* 12 bit ADC, raw counts 0 - 0x0FFF */
+#define TEMP_OUT_OF_RANGE              -1       /* temperature for raw counts outside the lookup table (RTD open or shorted) */
+#define TEMP_TENTHS_PER_DEGREE         10       /* fixed point temperatures are kept in tenths of a degree */
+#define TEMP_OUT_OF_RANGE_TENTHS       (TEMP_OUT_OF_RANGE * TEMP_TENTHS_PER_DEGREE)
+#define TEMP_TENTHS_TO_DEGREES(t)      ((float)(t) / TEMP_TENTHS_PER_DEGREE)
+#define DEGREES_TO_TEMP_TENTHS(d)      ((int)(d) * TEMP_TENTHS_PER_DEGREE)
 #define MAX_CONSECUTIVE_SECONDS_ERROR  3        /* error condition must happen this many times in a row */
 
 #define MINIMUM_SETPOINT_TEMPERATURE   100
@@ -198,24 +315,22 @@
 #define HEATER_GPIO_INIT_SCRIPT  "/usr/bin/setupHeaterGPIOs.sh"
 
 #define MAX_HEATER_DATA_FILES             5
-#define HENNYPENNY_HEATER_DATA_FILES      "/var/log/HennyPenny/heaterData*.csv"
 #define HENNYPENNY_LOG_DIRECTORY          "/var/log/HennyPenny/"
-#define HEATER_DATA_TARGET_FILE           "/var/log/HennyPenny/heaterData%d.csv"
+#define HEATER_DATA_FILE_NAME             "heaterData%d.csv"
+#define HEATER_DATA_TARGET_FILE           HENNYPENNY_LOG_DIRECTORY HEATER_DATA_FILE_NAME
+#define HEATER_DATA_COPY_FILE             HENNYPENNY_LOG_DIRECTORY "heaterData.tmp"   // when /tmp is another file system
 #define HEATER_DATA_CSV_FILE              "/tmp/heaterData.csv"
+#define HEATER_DATA_CLOSED_FILE           "/tmp/heaterDataClosed.csv"                // waiting for the logger thread
 #define HEATER_DATA_TRIGGER_FILE          "/etc/writeHeaterCSVFile"
-#define GET_NEWEST_LOG_FILE               "ls -Art /var/log/HennyPenny/heaterData* | tail -n 1 > %s"
-#define GET_OLDEST_LOG_FILE               "ls -At /var/log/HennyPenny/heaterData* | tail -n 1 > %s"
-#define GET_FILE_COUNT                    "ls -l %s | egrep -c '^-' > %s"
-#define MOVE_HEATER_DATA_TO_LOG_DIRECTORY "mv %s %s"
-#define FILE_COUNT_FILE                   "/tmp/csvFileCount.txt"
-#define OLDEST_FILENAME_FILE              "/tmp/oldestFile.txt"
-#define NEWEST_FILENAME_FILE              "/tmp/newestFile.txt"
+#define HEATER_DATA_BUFFER_SIZE           16384
 #define LOG_DIRECTORY_PERMISSIONS         0755
-#define TOUCH_FILE                        "touch %s"
 
 #define SD_CARD_LOG_TOP          SD_CARD_MOUNT_POINT  "/log"
 #define SD_CARD_LOG_DIRECTORY    SD_CARD_LOG_TOP      "/HennyPenny/"
 #define EESLOGFILENAMETEMPLATE   "%s/%4d%02d%02dControl.csv"
+#define EESBINLOGFILENAMETEMPLATE "%s/%4d%02d%02dControl.bin"
+#define BINARY_LOG_ENABLE_FILE   "/etc/enableBinaryLog"   // log in the eeslog.h binary format, from the next day's file
+#define LOG_HEADER_TEXT_SIZE     16384    // the log header, formatted in memory for the binary log
 #define EESLOGINTERVAL_SEC       3
 #define LOGEVENT_TIMEOUT_MS      100
 #define LOGERROR_LOCATION_SIZE   65
@@ -224,7 +339,11 @@
 #define UTC_OFFSET_SIZE          8
 #define RECENT_ERRORS_FILENAME   "recent_errors.log"
 #define RECENT_ERRORS_FILE       SD_CARD_LOG_DIRECTORY RECENT_ERRORS_FILENAME
-#define RECENT_ERRORS_TEMP_FILE  "/tmp/" RECENT_ERRORS_FILENAME
+#define RECENT_ERRORS_TEMP_FILE  RECENT_ERRORS_FILE ".tmp"   // same directory, so the rename replaces the file in one step
+#define RECENT_ERRORS_MAX        25
+#define LOG_WRITE_BUFFER_SIZE    8192     // the log file stays open, records are formatted into this buffer
+#define LOG_FLUSH_BYTES          4096     // write and fdatasync once this much is buffered
+#define LOG_FLUSH_INTERVAL_SEC   30       // or once the oldest buffered record is this old
 #define SD_CARD_FSCK_CMD         "fsck -t vfat " SD_CARD_MOUNT_POINT
 #define SD_CARD_REMOUNT_CMD      "mount -o remount,rw " SD_CARD_MOUNT_POINT
 
@@ -272,6 +391,7 @@ typedef struct
    uint16_t eco_mode_setpoint;      // setpoint for ECO mode
    uint16_t saved_setpoint;      // placeholder for current setpoint when they select cleaning mode
    int16_t current_temperature;  // degrees Farenheit
+   int16_t current_temperature_tenths; // tenths of a degree Farenheit, interpolated between calibration table entries
    google::protobuf::Timestamp start_time;
    google::protobuf::Timestamp end_time;
    bool is_enabled;
@@ -288,7 +408,7 @@ typedef struct
    uint32_t seconds_overtemp;
    uint32_t seconds_undertemp;
    uint32_t seconds_on_time;     // number of seconds the heater is on per hour
-   int32_t delta_temp;
+   int32_t delta_temp;           // setpoint - current temperature, in tenths of a degree
 } HEATER_GPIO_SYSFS_INFO;
 
 #define NUM_TEMP_LOOKUP_TABLE_ENTRIES
@@ -364,7 +484,7 @@ typedef struct
    uint16_t mux_number;       // either 0 or 1
    uint16_t mux_channel;         // somewhere between 1 and 9
    uint16_t gain;             // the PGA117 uses scope gain 3 bits
-   uint16_t value;                // value read from the input, raw counts
+   int16_t value;                 // value read from the input, raw counts, -1 if the read failed
    bool is_shorted;
    bool is_open;
    bool shorted_oneshot;
@@ -374,6 +494,7 @@ typedef struct
    int fd;                    // file descriptor to read the analog input value from
    char temp_data_filename[MAX_FILE_PATH];   // filename containing the filename of the temperature data file
    TEMP_LOOKUP_TABLE temp_lookup_table[TEMP_TABLE_NUM_ENTRIES];   // each RTD has its own lookup table for "calibration" purposes.
+   int16_t temp_tenths_from_raw_counts[ADC_NUM_RAW_COUNTS];      // temp_lookup_table interpolated to one entry (tenths of a degree) per raw count
 } RTD_MUX_MAPPING;
 
 
@@ -387,6 +508,35 @@ typedef struct
 #define ADC_FILE_PATH      "/sys/bus/iio/devices/iio:device0/in_voltage%d_raw"
 #define MAX_READ_RTD_RETRY_COUNT    4
 
+// IIO buffered capture of AIN0/AIN1. The am335x ADC fills its buffer in continuous mode,
+// so once the scan elements are enabled each frame read from the character device holds
+// one little-endian 16 bit sample per enabled channel, in channel order.
+// The sysfs text reads above remain as the fallback.
+#define IIO_DEVICE_PATH                   "/dev/iio:device0"
+#define IIO_SCAN_ELEMENT_ENABLE_PATH      "/sys/bus/iio/devices/iio:device0/scan_elements/in_voltage%d_en"
+#define IIO_BUFFER_LENGTH_PATH            "/sys/bus/iio/devices/iio:device0/buffer/length"
+#define IIO_BUFFER_ENABLE_PATH            "/sys/bus/iio/devices/iio:device0/buffer/enable"
+#define IIO_BUFFER_LENGTH_STRING          "16"     /* frames held by the kernel buffer */
+#define IIO_ENABLE_STRING                 "1"
+#define IIO_DISABLE_STRING                "0"
+#define IIO_SCAN_FRAME_SIZE               (NUM_ADC_CHANNELS * sizeof(uint16_t))
+#define IIO_FLUSH_BUFFER_SIZE             256      /* bytes drained per read when discarding stale frames */
+#define IIO_SAMPLE_MASK                   0x0FFF   /* 12 bit ADC */
+#define IIO_SETTLE_US                     20       /* PGA117 channel switch and settle to 0.01% is a few us per the datasheet, with margin */
+#define IIO_DISCARD_FRAMES                1        /* frames thrown away after the settle, one may straddle it */
+#define IIO_READ_TIMEOUT_MS               100
+#define IIO_BUFFERED_CAPTURE_DISABLE_FILE "/etc/disableIIOBufferedCapture"
+
+// the heater algorithm runs as soon as each RTD scan completes unless this file exists,
+// in which case heaterControlThread goes back to running on its own 1 second schedule
+#define SCAN_TRIGGERED_HEATERS_DISABLE_FILE  "/etc/disableScanTriggeredHeaters"
+#define HEATER_SCAN_TIMEOUT_MICROSECONDS     1500000    // run the heater algorithm anyway if no scan arrives within 1.5 seconds
+
+// paired RTD scan: an RTD on mux 0 (AIN0) and one on mux 1 (AIN1) are routed with a single
+// daisy chained SPI write, settle together, and are then read back to back
+#define RTD_SCAN_NO_RTD                   -1                 /* park that mux on CH0 for this step */
+#define NUM_RTD_SCAN_STEPS                NUM_RTDS_ON_AIN1   /* the longer of the two mux lists */
+
 // There are 13 RTDs.  12 for the 12 heaters, and one for the Triac heatsink
 // The first 12 values are for heaters 1 - 12, and the last one is for the heatsink
 // Starting with rev A02 hardware, there are 14 RTDs. 1 - 12 are the heaters, 13 is the heatsink,
@@ -419,6 +569,88 @@ typedef struct
 #define RTD_NUMBER_14   14   /* ambient temp starting with HW A02 rev boards */
 
 #define HEATSINK_RTD_INDEX                   12
+
+// one complete RTD scan plus the power monitor readings taken with it.
+// readADCThread is the only writer; every other thread takes a copy with getSensorSnapshot()
+typedef struct
+{
+   uint32_t sequence_number;                 // incremented once per completed scan, 0 = no scan yet
+   struct timeval scan_time;                 // when the scan completed
+   struct timespec scan_time_monotonic;      // when the scan completed, CLOCK_MONOTONIC for latency measurements
+   int16_t raw_counts[NUM_RTDs];             // raw ADC counts, -1 if the read failed
+   int16_t temperature[NUM_RTDs];            // degrees Farenheit, TEMP_OUT_OF_RANGE if open or shorted
+   int16_t temperature_tenths[NUM_RTDs];     // tenths of a degree Farenheit, TEMP_OUT_OF_RANGE_TENTHS if open or shorted
+   bool is_open[NUM_RTDs];
+   bool is_shorted[NUM_RTDs];
+   float irms;                               // heater current draw from the power monitor
+   float voltage;                            // line voltage from the power monitor
+   bool power_monitor_bad;
+} SENSOR_SNAPSHOT;
+
+// In-memory history of every RTD, the heaters and the power monitor, answered by
+// SYSTEM_COMMAND_QUERY_HISTORY. The memory is fixed:
+//    HISTORY_SECONDS 1 second samples        3600 x  40 bytes = 144000 bytes, the last hour
+//    HISTORY_MINUTES 1 minute intervals      1440 x 128 bytes = 184320 bytes, the last day
+//    HISTORY_HOURS   1 hour intervals         720 x 128 bytes =  92160 bytes, the last 30 days
+// 420480 bytes (411 KB) in all, plus the two intervals being built and one query's points.
+#define HISTORY_SECONDS                      3600
+#define HISTORY_MINUTES                      1440
+#define HISTORY_HOURS                        720
+#define HISTORY_MAX_QUERY_POINTS             360      // in one SystemCommandResponse
+
+// one second of history
+typedef struct
+{
+   uint32_t utc_seconds;
+   int16_t temperature_tenths[NUM_RTDs];     // TEMP_OUT_OF_RANGE_TENTHS if open or shorted
+   uint16_t heaters_on;                      // a bit per heater
+   uint16_t irms_centiamps;
+   uint16_t voltage_tenths;
+} HISTORY_SAMPLE;
+
+// one minute or one hour of history
+typedef struct
+{
+   uint32_t utc_seconds;                     // of the first sample
+   uint16_t num_samples;
+   uint16_t heater_on_seconds[NUM_HEATERS];
+   int16_t temperature_min_tenths[NUM_RTDs];   // TEMP_OUT_OF_RANGE_TENTHS if never in range
+   int16_t temperature_mean_tenths[NUM_RTDs];
+   int16_t temperature_max_tenths[NUM_RTDs];
+   uint16_t irms_min_centiamps;
+   uint16_t irms_mean_centiamps;
+   uint16_t irms_max_centiamps;
+   uint16_t voltage_min_tenths;
+   uint16_t voltage_mean_tenths;
+   uint16_t voltage_max_tenths;
+} HISTORY_AGGREGATE;
+
+// the minute or hour being built
+typedef struct
+{
+   HISTORY_AGGREGATE aggregate;              // the means are filled in by historyAccumulatorFinish()
+   uint32_t start_seconds;                   // monotonicSeconds() of the first sample
+   int32_t temperature_sum[NUM_RTDs];
+   uint16_t temperature_count[NUM_RTDs];     // samples in range
+   uint32_t irms_sum;
+   uint32_t voltage_sum;
+} HISTORY_ACCUMULATOR;
+
+// a ring of history entries
+typedef struct
+{
+   uint32_t next;                            // where the next entry goes
+   uint32_t count;                           // entries held, up to the size of the ring
+} HISTORY_RING;
+
+// The flight recorder keeps a FLIGHT_FRAME (flight_recorder.h) of every heater pass, and dumps the
+// frames around each logged error to the SD card: FLIGHT_RECORDER_FRAMES x 128 bytes = 128 KB.
+#define FLIGHT_RECORDER_FRAMES               1024     // a power of two, 17 minutes at a pass a second
+#define FLIGHT_RECORDER_PRE_FRAMES           600      // dumped from before the error, 10 minutes
+#define FLIGHT_RECORDER_POST_FRAMES          30       // and from after it
+#define FLIGHT_RECORDER_MAX_DUMPS_PER_DAY    24       // spares the SD card when an error keeps repeating
+#define FLIGHT_RECORDER_FILENAME_TEMPLATE    "%s%4d%02d%02d_%02d%02d%02d_%s.frec"
+#define FLIGHT_RECORDER_TRIGGER_CLAIMED      UINT32_MAX
 #define HEATSINK_MAX_TEMP                    176      // Triac maximum operational junction temp 176F
 
 #define AMBIENT_MAX_TEMP                    158    // Ambient temp sensor max temp according to Joel Marcum 10/4/2023
@@ -474,3 +706,24 @@ typedef struct
 #define DEBUG_HEATERS_PRINTF_FILE   "/tmp/debugHeaters"
 #define DEBUG_CSS_MESSAGE_FILE      "/tmp/debugCSS"
 #define DEBUG_CSV_FILE              "/tmp/debugCSV"
+
+// issue "echo 20 > /tmp/rtdStreamHz" to stream RTD scans at 20 Hz, "rm /tmp/rtdStreamHz" to stop
+#define RTD_STREAM_RATE_FILE              "/tmp/rtdStreamHz"
+#define RTD_STREAM_MIN_HZ                 10
+#define RTD_STREAM_MAX_HZ                 50
+#define RTD_STREAM_MESSAGES_PER_SECOND    5
+#define RTD_STREAM_MAX_SCANS_PER_MESSAGE  (RTD_STREAM_MAX_HZ / RTD_STREAM_MESSAGES_PER_SECOND)
+#define RTD_STREAM_DESCRIPTOR_SECONDS     10
+#define RTD_STREAM_MESSAGE_BUFFER_SIZE    4096
+#define RTD_STREAM_SCAN_PERIOD_PERCENT    80      // a scan may take at most this much of the stream period
+
+// RTD scans waiting to go out in the next RTDStream message
+typedef struct
+{
+   uint32_t num_scans;
+   uint32_t scan_rate_hz;
+   struct timeval first_scan_time;
+   struct timespec first_scan_monotonic;
+   uint32_t scan_offset_us[RTD_STREAM_MAX_SCANS_PER_MESSAGE];
+   int raw_counts[RTD_STREAM_MAX_SCANS_PER_MESSAGE][NUM_RTDs];
+} RTD_STREAM_BATCH;
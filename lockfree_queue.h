@@ -0,0 +1,529 @@
+/*
+ ***********************************************************************************************************************
+ *
+ * (c) COPYRIGHT, 2023 USA Firmware Corporation
+ *
+ * All rights reserved. This file is the intellectual property of USA Firmware Corporation and it may not be disclosed
+ * to others or used for any purposes without the written consent of USA Firmware Corporation.
+ *
+ ***********************************************************************************************************************
+ */
+
+/**
+ ***********************************************************************************************************************
+ *
+ * @brief   A template class for a bounded lock-free multiple producer, single consumer queue.
+ * @file    lockfree_queue.h
+ * @author  USA Firmware Corporation
+ *
+ * Drop-in replacement for SafeQueue (same put / get / shove_front surface) for queues that are written from the
+ * time-critical threads. A put never takes a lock: producers claim a cell with one compare-and-swap and publish it
+ * with a per-cell sequence number. A sleeping consumer is woken with a futex, and only when it is actually asleep,
+ * so a put on the fast path makes no system call.
+ *
+ * Only one thread may call get(). Any number of threads may call put() and shove_front().
+ *
+ ***********************************************************************************************************************
+ */
+
+
+/*
+ ***********************************************************************************************************************
+ *                                                      MODULE
+ ***********************************************************************************************************************
+ */
+#pragma once
+
+
+/*
+ ***********************************************************************************************************************
+ *                                                   INCLUDE FILES
+ ***********************************************************************************************************************
+ */
+/****************************************************** System ********************************************************/
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cerrno>
+#include <cstdint>
+#include <utility>
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+/*****************************************************   User   *******************************************************/
+
+
+/*
+ ***********************************************************************************************************************
+ *                                                  Class Definition
+ ***********************************************************************************************************************
+ */
+template <typename T, int N> class LockFreeQueue
+{
+   static_assert((N >= 2) && (0 == (N & (N - 1))), "LockFreeQueue capacity must be a power of two");
+
+public:
+   LockFreeQueue()
+   : capacity(N),
+     enqueue_pos(0),
+     dequeue_pos(0),
+     items_futex(0),
+     space_futex(0),
+     consumer_waiting(0),
+     producers_waiting(0),
+     front_valid(false),
+     drops(0),
+     high_water(0)
+   {
+      for (uint32_t i = 0; i < (uint32_t)N; i++)
+      {
+         cells[i].sequence.store(i, std::memory_order_relaxed);
+      }
+      front_lock.clear();
+   }
+
+   virtual ~LockFreeQueue()
+   {
+   }
+
+   /**
+    * @brief Put an element into the queue with no timeout.
+    *
+    * If the queue is full, this method returns immediately with an error indication.
+    *
+    * @param[in] elem The element to put into the queue.
+    *
+    * @retval 0 The put completed successfully.
+    * @retval -ENOMEM The queue was full, the put failed.
+    */
+   int put(const T &elem)
+   {
+      if (!try_enqueue(elem))
+      {
+         drops.fetch_add(1, std::memory_order_relaxed);
+         return -ENOMEM;
+      }
+
+      wake_consumer();
+      return 0;
+   }
+
+   /**
+    * @brief Move an element into the queue with no timeout.
+    *
+    * If the queue is full, this method returns immediately with an error indication and elem is left as it was.
+    *
+    * @param[in] elem The element to move into the queue.
+    *
+    * @retval 0 The put completed successfully.
+    * @retval -ENOMEM The queue was full, the put failed.
+    */
+   int put(T &&elem)
+   {
+      if (!try_enqueue(std::move(elem)))
+      {
+         drops.fetch_add(1, std::memory_order_relaxed);
+         return -ENOMEM;
+      }
+
+      wake_consumer();
+      return 0;
+   }
+
+   /**
+    * @brief Construct an element from the given arguments and move it into the queue, with no timeout.
+    *
+    * @param[in] args The arguments to T's constructor.
+    *
+    * @retval 0 The put completed successfully.
+    * @retval -ENOMEM The queue was full, the put failed.
+    */
+   template <typename... Args> int emplace(Args&&... args)
+   {
+      return put(T(std::forward<Args>(args)...));
+   }
+
+   /**
+    * @brief Force an element to the front of the queue.
+    *
+    * The element is returned by the next get(), ahead of everything already queued. Unlike SafeQueue, the
+    * element that was at the front is not overwritten; it is returned by the get() after. A second
+    * shove_front() before that get() replaces the first one.
+    *
+    * @param[in] elem The element to be forced into the queue.
+    *
+    * @return 0 (this method has no failure scenario).
+    */
+   int shove_front(const T &elem)
+   {
+      while (front_lock.test_and_set(std::memory_order_acquire))
+      {
+      }
+      front_elem = elem;
+      front_valid.store(true, std::memory_order_release);
+      front_lock.clear(std::memory_order_release);
+
+      wake_consumer();
+      return 0;
+   }
+
+   /**
+    * @brief Put an element into the queue, with timeout.
+    *
+    * If there is no room in the queue for the duration of the timeout, this method returns
+    * an error indication and does not modify the queue.
+    *
+    * @param[in] elem The element to put into the queue.
+    *
+    * @param[in] timeout_ms The timeout in milliseconds. Zero means time out immediately.
+    *
+    * @retval 0 The put completed successfully.
+    * @retval -ETIMEDOUT The queue was full and the timeout expired, the put failed.
+    */
+   int put(const T &elem, int timeout_ms)
+   {
+      std::chrono::steady_clock::time_point deadline(std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms));
+
+      while (!try_enqueue(elem))
+      {
+         // Full. Announce that we are about to sleep, then try once more so a get that
+         // missed the announcement is not slept through.
+         uint32_t seen = space_futex.load();
+         producers_waiting.fetch_add(1);
+         bool stored = try_enqueue(elem);
+         int status = 0;
+         if (!stored)
+         {
+            status = futex_wait(space_futex, seen, deadline);
+         }
+         producers_waiting.fetch_sub(1);
+
+         if (stored)
+         {
+            break;
+         }
+         else if (-ETIMEDOUT == status)
+         {
+            drops.fetch_add(1, std::memory_order_relaxed);
+            return -ETIMEDOUT;
+         }
+      }
+
+      wake_consumer();
+      return 0;
+   }
+
+   /**
+    * @brief Get and remove the oldest element from the queue, with deadline.
+    *
+    * If the queue is empty and remains so until the deadline, this method returns
+    * an error indication and does not modify the queue.
+    *
+    * @param[out] elem A reference to the element to return from the queue.
+    *
+    * @param[in] deadline The deadline for there to be an element in the queue.
+    *
+    * @retval 0 The get completed successfully.
+    * @retval -ETIMEDOUT The queue was empty and remained so until the deadline arrived, the get failed.
+    */
+   int get(T &elem, std::chrono::steady_clock::time_point deadline)
+   {
+      while (!try_dequeue(elem))
+      {
+         // Empty. Announce that we are about to sleep, then try once more so a put that
+         // missed the announcement is not slept through.
+         uint32_t seen = items_futex.load();
+         consumer_waiting.store(1);
+         bool fetched = try_dequeue(elem);
+         int status = 0;
+         if (!fetched)
+         {
+            status = futex_wait(items_futex, seen, deadline);
+         }
+         consumer_waiting.store(0);
+
+         if (fetched)
+         {
+            break;
+         }
+         else if (-ETIMEDOUT == status)
+         {
+            return -ETIMEDOUT;
+         }
+      }
+
+      return 0;
+   }
+
+   /**
+    * @brief Move up to max elements out of the queue, oldest first, with deadline.
+    *
+    * Waits as get() does until there is at least one element or the deadline arrives, then moves out
+    * everything that is queued (up to max) without sleeping again.
+    *
+    * @param[out] out Where the elements are moved to, e.g. a pointer into an array of at least max elements.
+    *
+    * @param[in] max The most elements to move out. Must be at least 1.
+    *
+    * @param[in] deadline The deadline for there to be an element in the queue.
+    *
+    * @return The number of elements moved out, at least 1.
+    * @retval -ETIMEDOUT The queue was empty and remained so until the deadline arrived, nothing was moved.
+    */
+   template <typename OutputIt> int drain(OutputIt out, int max, std::chrono::steady_clock::time_point deadline)
+   {
+      int retval = 0;
+      T elem;
+
+      if (0 != get(elem, deadline))
+      {
+         return -ETIMEDOUT;
+      }
+
+      do
+      {
+         *out++ = std::move(elem);
+         ++retval;
+      } while ((retval < max) && try_dequeue(elem));
+
+      return retval;
+   }
+
+   /**
+    * @brief Get and remove the oldest element from the queue, with timeout.
+    *
+    * If the queue is empty and remains so until the timeout, this method returns an error
+    * indication and does not modify the queue.
+    *
+    * @param[out] elem A reference to the element to return from the queue.
+    *
+    * @param[in] timeout_ms The timeout for there to be an element in the queue. Zero means time out immediately.
+    *
+    * @retval 0 The get completed successfully.
+    * @retval -ETIMEDOUT The queue was empty and remained so until the timeout expired, the get failed.
+    */
+   int get(T &elem, int timeout_ms)
+   {
+      std::chrono::steady_clock::time_point deadline(std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms));
+
+      return get(elem, deadline);
+   }
+
+   /**
+    * @brief Return the number of puts that failed because the queue was full.
+    */
+   uint32_t dropped() const
+   {
+      return drops.load(std::memory_order_relaxed);
+   }
+
+   /**
+    * @brief Return the most elements the queue has held at once.
+    */
+   uint32_t high_water_mark() const
+   {
+      return high_water.load(std::memory_order_relaxed);
+   }
+
+   /**
+    * @brief Return the queue's capacity.
+    */
+   int size() const
+   {
+      return capacity;
+   }
+
+protected:
+
+private:
+   /** One queue element and the sequence number that says whose turn it is to use it. */
+   struct cell_t
+   {
+      std::atomic<uint32_t> sequence;
+      T data;
+   };
+
+   /** The queue's capacity, statically set by the template argument N. */
+   int capacity;
+
+   /** The array of cells, of size N. */
+   std::array<cell_t, N> cells;
+
+   /** The position the next put writes. Kept on its own cache line, away from the consumer's. */
+   alignas(64) std::atomic<uint32_t> enqueue_pos;
+
+   /** The position the next get reads. Only the consumer writes it. */
+   alignas(64) std::atomic<uint32_t> dequeue_pos;
+
+   /** Bumped by every put; the consumer sleeps on it. */
+   std::atomic<uint32_t> items_futex;
+
+   /** Bumped by every get; producers waiting for room sleep on it. */
+   std::atomic<uint32_t> space_futex;
+
+   /** Nonzero while the consumer is, or is about to be, asleep on items_futex. */
+   std::atomic<uint32_t> consumer_waiting;
+
+   /** The number of producers asleep on space_futex. */
+   std::atomic<uint32_t> producers_waiting;
+
+   /** The element forced to the front by shove_front(), guarded by front_lock. */
+   T front_elem;
+   std::atomic<bool> front_valid;
+   std::atomic_flag front_lock;
+
+   /** The number of failed puts. */
+   std::atomic<uint32_t> drops;
+
+   /** The most elements held at once. */
+   std::atomic<uint32_t> high_water;
+
+   /**
+    * @brief Add the given element to the queue, if there is room.
+    *
+    * @param[in] elem The element to add to the queue. Moved from if it is an rvalue and the queue has room.
+    *
+    * @return true The element was added.
+    * @return false The queue was full.
+    */
+   template <typename U> bool try_enqueue(U &&elem)
+   {
+      uint32_t pos = enqueue_pos.load(std::memory_order_relaxed);
+      cell_t *cell;
+
+      for (;;)
+      {
+         cell = &cells[pos & (N - 1)];
+         int32_t diff = (int32_t)(cell->sequence.load(std::memory_order_acquire) - pos);
+         if (0 == diff)
+         {
+            // The cell is free; claim it. On failure pos is reloaded and we try the next cell.
+            if (enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+            {
+               break;
+            }
+         }
+         else if (diff < 0)
+         {
+            // The consumer has not read this cell since it was last written.
+            return false;
+         }
+         else
+         {
+            // Another producer claimed it first.
+            pos = enqueue_pos.load(std::memory_order_relaxed);
+         }
+      }
+
+      cell->data = std::forward<U>(elem);
+      cell->sequence.store(pos + 1, std::memory_order_release);
+
+      uint32_t used = pos + 1 - dequeue_pos.load(std::memory_order_relaxed);
+      uint32_t hwm = high_water.load(std::memory_order_relaxed);
+      while ((used > hwm) && !high_water.compare_exchange_weak(hwm, used, std::memory_order_relaxed))
+      {
+      }
+
+      return true;
+   }
+
+   /**
+    * @brief Remove the oldest element from the queue, if there is one.
+    *
+    * @param[out] elem The element removed from the queue.
+    *
+    * @return true An element was removed.
+    * @return false The queue was empty.
+    */
+   bool try_dequeue(T &elem)
+   {
+      if (front_valid.load(std::memory_order_acquire))
+      {
+         while (front_lock.test_and_set(std::memory_order_acquire))
+         {
+         }
+         elem = front_elem;
+         front_valid.store(false, std::memory_order_relaxed);
+         front_lock.clear(std::memory_order_release);
+         return true;
+      }
+
+      uint32_t pos = dequeue_pos.load(std::memory_order_relaxed);
+      cell_t *cell = &cells[pos & (N - 1)];
+      if ((int32_t)(cell->sequence.load(std::memory_order_acquire) - (pos + 1)) < 0)
+      {
+         // Empty, or the producer that claimed this cell has not finished writing it.
+         return false;
+      }
+
+      elem = std::move(cell->data);
+      cell->sequence.store(pos + N, std::memory_order_release);
+      dequeue_pos.store(pos + 1, std::memory_order_relaxed);
+
+      // one cell was freed, so one waiting producer is enough
+      space_futex.fetch_add(1);
+      if (0 != producers_waiting.load())
+      {
+         (void)syscall(SYS_futex, &space_futex, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
+      }
+
+      return true;
+   }
+
+   /**
+    * @brief Wake the consumer if it is asleep, after a put.
+    */
+   void wake_consumer()
+   {
+      items_futex.fetch_add(1);
+      if (0 != consumer_waiting.load())
+      {
+         (void)syscall(SYS_futex, &items_futex, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
+      }
+   }
+
+   /**
+    * @brief Sleep while the futex word still holds the value seen, until the deadline.
+    *
+    * steady_clock is CLOCK_MONOTONIC, which is the clock FUTEX_WAIT_BITSET measures an absolute timeout against.
+    *
+    * @param[in] word The futex word.
+    *
+    * @param[in] seen The value of the word when the caller decided to sleep.
+    *
+    * @param[in] deadline When to give up.
+    *
+    * @retval 0 Woken, or the word had already changed.
+    * @retval -ETIMEDOUT The deadline passed.
+    */
+   static int futex_wait(std::atomic<uint32_t> &word, uint32_t seen, std::chrono::steady_clock::time_point deadline)
+   {
+      auto since_epoch = std::chrono::duration_cast<std::chrono::nanoseconds>(deadline.time_since_epoch()).count();
+      if (since_epoch < 0)
+      {
+         since_epoch = 0;
+      }
+
+      struct timespec abstime;
+      abstime.tv_sec = (time_t)(since_epoch / 1000000000LL);
+      abstime.tv_nsec = (long)(since_epoch % 1000000000LL);
+
+      if (std::chrono::steady_clock::now() >= deadline)
+      {
+         return -ETIMEDOUT;
+      }
+
+      long status = syscall(SYS_futex, &word, FUTEX_WAIT_BITSET_PRIVATE, seen, &abstime, NULL, FUTEX_BITSET_MATCH_ANY);
+      if ((-1 == status) && (ETIMEDOUT == errno))
+      {
+         return -ETIMEDOUT;
+      }
+
+      return 0;
+   }
+};
+
+
+/*********************************************      End of file        ************************************************/
@@ -0,0 +1,551 @@
+/******************************************************************************/
+/*                                                                            */
+/* FILE:        logConvert.cpp                                                */
+/*                                                                            */
+/* DESCRIPTION: Converts a binary status/error/event log of the HennyPenny    */
+/*              Frontier UHC (YYYYMMDDControl.bin) to the CSV log the         */
+/*              controller writes when the binary log is not enabled, and a   */
+/*              flight recorder dump (.frec) to CSV                           */
+/*                                                                            */
+/* AUTHOR(S):   USA Firmware, LLC                                             */
+/*                                                                            */
+/* This is an unpublished work subject to Trade Secret and Copyright          */
+/* protection by HennyPenny and USA Firmware, LLC                             */
+/*                                                                            */
+/* USA Firmware, LLC                                                          */
+/* 10060 Brecksville Road Brecksville, OH 44141                               */
+/*                                                                            */
+/******************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <algorithm>
+#include <vector>
+#include "eeslog.h"
+#include "flight_recorder.h"
+
+using namespace std;
+
+#define TIME_STR_SIZE              32
+#define UTC_OFFSET_SIZE            16
+#define TEMP_TENTHS_TO_DEGREES(t)  ((float)(t) / 10)
+
+
+/*******************************************************************************************/
+/*                                                                                         */
+/* bool readFile(const char *name, vector<uint8_t> *data)                                  */
+/*                                                                                         */
+/* Reads the whole binary log into memory. A day's log is at most a few megabytes.         */
+/*                                                                                         */
+/* Returns: bool true if the file was read                                                 */
+/*                                                                                         */
+/*******************************************************************************************/
+bool readFile(const char *name, vector<uint8_t> *data)
+{
+   FILE *fp = fopen(name, "rb");
+   if (NULL == fp)
+   {
+      return false;
+   }
+
+   uint8_t buffer[EESLOG_BLOCK_PAYLOAD_SIZE];
+   size_t n;
+   while ((n = fread(buffer, 1, sizeof(buffer), fp)) > 0)
+   {
+      data->insert(data->end(), buffer, buffer + n);
+   }
+   (void)fclose(fp);
+
+   return true;
+}
+
+
+/*******************************************************************************************/
+/*                                                                                         */
+/* void writeStatus(FILE *out, const EESLOG_STATUS *status)                                */
+/*                                                                                         */
+/* Writes a status record exactly as logStatusWrite() in frontier_uhc does.                */
+/*                                                                                         */
+/* Returns: None                                                                           */
+/*                                                                                         */
+/*******************************************************************************************/
+void writeStatus(FILE *out, const EESLOG_STATUS *status)
+{
+   char timestr_colAB[TIME_STR_SIZE];
+   eeslogFormatTime(timestr_colAB, sizeof(timestr_colAB), status->utc_seconds, status->gmtoff_seconds);
+
+   // the same UTC offset calculation as logStatusWrite()
+   int utc_offset_minutes = abs(status->gmtoff_seconds) % 60;
+   int utc_offset_hours = status->gmtoff_seconds / 60;
+   char utc_offset_str[UTC_OFFSET_SIZE];
+   (void)snprintf(utc_offset_str, sizeof(utc_offset_str), "%+03d:%02d", utc_offset_hours, utc_offset_minutes);
+
+   const char *const *s = status->strings;
+   const uint16_t *sp = status->setpoint;
+   const int16_t *t = status->temperature_tenths;
+   const int h = EESLOG_STRING_HEATER1;
+   const int sl = EESLOG_STRING_SLOT1;
+
+   (void)fprintf(out, EESLOG_CSV_STATUS_FORMAT,
+                 timestr_colAB, utc_offset_str, status->is_dst,
+                 s[EESLOG_STRING_SYSTEM],
+                 s[EESLOG_STRING_FAN1], s[EESLOG_STRING_FAN2],
+                 status->ambient, status->heatsink,
+                 status->voltage, status->irms,
+                 s[sl + 0], s[h + 0], sp[0], TEMP_TENTHS_TO_DEGREES(t[0]), s[h + 1], sp[1], TEMP_TENTHS_TO_DEGREES(t[1]),
+                 s[sl + 1], s[h + 2], sp[2], TEMP_TENTHS_TO_DEGREES(t[2]), s[h + 3], sp[3], TEMP_TENTHS_TO_DEGREES(t[3]),
+                 s[sl + 2], s[h + 4], sp[4], TEMP_TENTHS_TO_DEGREES(t[4]), s[h + 5], sp[5], TEMP_TENTHS_TO_DEGREES(t[5]),
+                 s[sl + 3], s[h + 6], sp[6], TEMP_TENTHS_TO_DEGREES(t[6]), s[h + 7], sp[7], TEMP_TENTHS_TO_DEGREES(t[7]),
+                 s[sl + 4], s[h + 8], sp[8], TEMP_TENTHS_TO_DEGREES(t[8]), s[h + 9], sp[9], TEMP_TENTHS_TO_DEGREES(t[9]),
+                 s[sl + 5], s[h + 10], sp[10], TEMP_TENTHS_TO_DEGREES(t[10]), s[h + 11], sp[11], TEMP_TENTHS_TO_DEGREES(t[11]));
+}
+
+
+/*******************************************************************************************/
+/*                                                                                         */
+/* bool decodeStatus(EESLOG_BLOCK *block, const uint8_t *p, const uint8_t *end,            */
+/*                   EESLOG_STATUS *status, const uint8_t **next)                          */
+/*                                                                                         */
+/* Decodes a status record, filling in whatever it leaves out from the block's previous    */
+/* status record. p points just past the record type.                                      */
+/*                                                                                         */
+/* Returns: bool true if the record is complete and consistent                             */
+/*                                                                                         */
+/*******************************************************************************************/
+bool decodeStatus(EESLOG_BLOCK *block, const uint8_t *p, const uint8_t *end,
+                  EESLOG_STATUS *status, const uint8_t **next)
+{
+   bool all = !block->have_previous;
+   if (all)
+   {
+      (void)memset(status, 0, sizeof(*status));
+   }
+   else
+   {
+      *status = block->previous;
+   }
+   status->gmtoff_seconds = block->gmtoff_seconds;
+   status->is_dst = block->is_dst;
+
+   if ((end - p) < 6)
+   {
+      return false;
+   }
+   status->utc_seconds = block->base_seconds + eeslogGet16(p);
+   uint32_t stringMask = eeslogGet32(&p[2]);
+   p += 6;
+   if (all && (stringMask != ((1UL << EESLOG_STATUS_NUM_STRINGS) - 1)))
+   {
+      return false;
+   }
+   for (int i = 0; i < EESLOG_STATUS_NUM_STRINGS; i++)
+   {
+      if (0 != (stringMask & (1UL << i)))
+      {
+         if ((p >= end) || (*p >= block->num_strings))
+         {
+            return false;
+         }
+         status->strings[i] = block->string_text[*p++];
+      }
+   }
+
+   if (p >= end)
+   {
+      return false;
+   }
+   uint8_t flags = *p++;
+   const uint8_t allFlags = EESLOG_STATUS_AMBIENT | EESLOG_STATUS_HEATSINK | EESLOG_STATUS_VOLTAGE |
+                            EESLOG_STATUS_CURRENT | EESLOG_STATUS_SETPOINTS | EESLOG_STATUS_TEMPS;
+   if (all && (flags != allFlags))
+   {
+      return false;
+   }
+   if (0 != (flags & EESLOG_STATUS_AMBIENT))
+   {
+      if ((end - p) < 2)
+      {
+         return false;
+      }
+      status->ambient = (int16_t)eeslogGet16(p);
+      p += 2;
+   }
+   if (0 != (flags & EESLOG_STATUS_HEATSINK))
+   {
+      if ((end - p) < 2)
+      {
+         return false;
+      }
+      status->heatsink = (int16_t)eeslogGet16(p);
+      p += 2;
+   }
+   if (0 != (flags & EESLOG_STATUS_VOLTAGE))
+   {
+      if ((end - p) < 4)
+      {
+         return false;
+      }
+      uint32_t bits = eeslogGet32(p);
+      (void)memcpy(&status->voltage, &bits, sizeof(bits));
+      p += 4;
+   }
+   if (0 != (flags & EESLOG_STATUS_CURRENT))
+   {
+      if ((end - p) < 4)
+      {
+         return false;
+      }
+      uint32_t bits = eeslogGet32(p);
+      (void)memcpy(&status->irms, &bits, sizeof(bits));
+      p += 4;
+   }
+   if (0 != (flags & EESLOG_STATUS_SETPOINTS))
+   {
+      if ((end - p) < 2)
+      {
+         return false;
+      }
+      uint16_t setpointMask = eeslogGet16(p);
+      p += 2;
+      for (int i = 0; i < EESLOG_NUM_HEATERS; i++)
+      {
+         if (0 != (setpointMask & (1 << i)))
+         {
+            if ((end - p) < 2)
+            {
+               return false;
+            }
+            status->setpoint[i] = eeslogGet16(p);
+            p += 2;
+         }
+      }
+   }
+   if (0 != (flags & EESLOG_STATUS_TEMPS))
+   {
+      for (int i = 0; i < EESLOG_NUM_HEATERS; i++)
+      {
+         if (p >= end)
+         {
+            return false;
+         }
+         int8_t delta = (int8_t)*p++;
+         if (EESLOG_TEMP_ESCAPE == delta)
+         {
+            if ((end - p) < 2)
+            {
+               return false;
+            }
+            status->temperature_tenths[i] = (int16_t)eeslogGet16(p);
+            p += 2;
+         }
+         else
+         {
+            status->temperature_tenths[i] = (int16_t)(status->temperature_tenths[i] + delta);
+         }
+      }
+   }
+
+   block->previous = *status;
+   block->have_previous = true;
+   *next = p;
+
+   return true;
+}
+
+
+/*******************************************************************************************/
+/*                                                                                         */
+/* bool decodeBlock(EESLOG_BLOCK *block, FILE *out)                                        */
+/*                                                                                         */
+/* Writes the records of a block, whose header has been checked, as CSV.                   */
+/*                                                                                         */
+/* Returns: bool true if every record decoded                                              */
+/*                                                                                         */
+/*******************************************************************************************/
+bool decodeBlock(EESLOG_BLOCK *block, FILE *out)
+{
+   const uint8_t *p = block->payload;
+   const uint8_t *end = block->payload + block->length;
+
+   for (int record = 0; record < block->num_records; record++)
+   {
+      if (p >= end)
+      {
+         return false;
+      }
+
+      uint8_t type = *p++;
+      if (EESLOG_RECORD_TEXT == type)
+      {
+         if ((end - p) < 2)
+         {
+            return false;
+         }
+         uint16_t len = eeslogGet16(p);
+         p += 2;
+         if ((end - p) < len)
+         {
+            return false;
+         }
+         (void)fwrite(p, 1, len, out);
+         p += len;
+      }
+      else if (EESLOG_RECORD_STRING == type)
+      {
+         if ((end - p) < 2)
+         {
+            return false;
+         }
+         uint8_t index = p[0];
+         uint8_t len = p[1];
+         p += 2;
+         if ((index != block->num_strings) || (index >= EESLOG_MAX_STRINGS) ||
+             (len > EESLOG_MAX_STRING_LENGTH) || ((end - p) < len))
+         {
+            return false;
+         }
+         (void)memcpy(block->string_text[index], p, len);
+         block->string_text[index][len] = 0;
+         block->strings[index] = block->string_text[index];
+         block->num_strings++;
+         p += len;
+      }
+      else if (EESLOG_RECORD_EVENT == type)
+      {
+         if ((end - p) < 7)
+         {
+            return false;
+         }
+         uint32_t utc_seconds = block->base_seconds + eeslogGet32(p);
+         uint8_t column = p[4];
+         uint16_t len = eeslogGet16(&p[5]);
+         p += 7;
+         if (((end - p) < len) || (len > EESLOG_TEXT_CHUNK_SIZE))
+         {
+            return false;
+         }
+         char text[EESLOG_TEXT_CHUNK_SIZE + 1];
+         (void)memcpy(text, p, len);
+         text[len] = 0;
+         p += len;
+
+         char timestr_colAB[TIME_STR_SIZE];
+         eeslogFormatTime(timestr_colAB, sizeof(timestr_colAB), utc_seconds, block->gmtoff_seconds);
+         (void)fprintf(out, EESLOG_CSV_EVENT_FORMAT, timestr_colAB,
+                       (EESLOG_EVENT_COLUMN_EVENTS == column) ? text : "",
+                       (EESLOG_EVENT_COLUMN_ERROR == column) ? text : "");
+      }
+      else if (EESLOG_RECORD_STATUS == type)
+      {
+         EESLOG_STATUS status;
+         if (!decodeStatus(block, p, end, &status, &p))
+         {
+            return false;
+         }
+         writeStatus(out, &status);
+      }
+      else
+      {
+         return false;
+      }
+   }
+
+   return p == end;
+}
+
+
+/*******************************************************************************************/
+/*                                                                                         */
+/* int convertFlightDump(const vector<uint8_t> &data, FILE *out)                           */
+/*                                                                                         */
+/* Writes the frames of a flight recorder dump as CSV, one line per frame, with a * in the */
+/* first column of the first frame recorded after the error.                               */
+/*                                                                                         */
+/* Returns: int 0 if the dump is whole, 2 if it is damaged                                 */
+/*                                                                                         */
+/*******************************************************************************************/
+int convertFlightDump(const vector<uint8_t> &data, FILE *out)
+{
+   FLIGHT_FILE_HEADER header;
+   (void)memcpy(&header, &data[0], sizeof(header));
+   if ((FLIGHT_FILE_VERSION != header.version) || (sizeof(FLIGHT_FRAME) != header.frame_size))
+   {
+      fprintf(stderr, "Flight recorder dump version %u frame size %u, this logConvert reads version %d size %u\n",
+              header.version, header.frame_size, FLIGHT_FILE_VERSION, (unsigned)sizeof(FLIGHT_FRAME));
+      return 2;
+   }
+   header.error_code[sizeof(header.error_code) - 1] = 0;
+
+   char timestr[TIME_STR_SIZE];
+   time_t triggertime = header.trigger_utc_seconds;
+   struct tm triggertm;
+   (void)localtime_r(&triggertime, &triggertm);
+   (void)strftime(timestr, sizeof(timestr), "%m/%d/%Y %H:%M:%S", &triggertm);
+   (void)fprintf(out, "\"Error %s at %s.%06u, frame %u\"\n", header.error_code, timestr,
+                 header.trigger_utc_microseconds, header.trigger_frame);
+
+   (void)fprintf(out, "\"Trigger\",\"Frame\",\"Scan\",\"Date\",\"Time\",\"Microseconds\",\"Latency us\","
+                      "\"Status\",\"Fans\",\"Voltage\",\"Current\",\"Power monitor bad\"");
+   for (int i = 0; i < FLIGHT_FRAME_NUM_RTDS; i++)
+   {
+      (void)fprintf(out, ",\"RTD%d counts\",\"RTD%d temp\",\"RTD%d open\",\"RTD%d shorted\"", i + 1, i + 1, i + 1, i + 1);
+   }
+   for (int i = 0; i < FLIGHT_FRAME_NUM_HEATERS; i++)
+   {
+      (void)fprintf(out, ",\"Heater%d setpoint\",\"Heater%d on\",\"Heater%d enabled\",\"Heater%d ECO\"", i + 1, i + 1, i + 1, i + 1);
+   }
+   (void)fprintf(out, "\n");
+
+   size_t available = (data.size() - sizeof(header)) / sizeof(FLIGHT_FRAME);
+   size_t count = std::min((size_t)header.num_frames, available);
+   for (size_t n = 0; n < count; n++)
+   {
+      FLIGHT_FRAME frame;
+      (void)memcpy(&frame, &data[sizeof(header) + (n * sizeof(FLIGHT_FRAME))], sizeof(frame));
+
+      time_t frametime = frame.utc_seconds;
+      struct tm frametm;
+      (void)localtime_r(&frametime, &frametm);
+      (void)strftime(timestr, sizeof(timestr), EESLOG_CSV_TIME_FORMAT, &frametm);
+      (void)fprintf(out, "\"%s\",\"%u\",\"%u\",\"%s\",\"%u\",\"%u\",\"%u\",\"%u\",\"%.1f\",\"%.2f\",\"%u\"",
+                    (frame.frame_number == header.trigger_frame) ? "*" : "",
+                    frame.frame_number, frame.scan_sequence, timestr, frame.utc_microseconds, frame.heater_latency_us,
+                    frame.system_status, frame.fans_on, frame.voltage, frame.irms, frame.power_monitor_bad);
+      for (int i = 0; i < FLIGHT_FRAME_NUM_RTDS; i++)
+      {
+         (void)fprintf(out, ",\"%d\",\"%.1f\",\"%d\",\"%d\"", frame.raw_counts[i], TEMP_TENTHS_TO_DEGREES(frame.temperature_tenths[i]),
+                       (frame.rtd_open >> i) & 1, (frame.rtd_shorted >> i) & 1);
+      }
+      for (int i = 0; i < FLIGHT_FRAME_NUM_HEATERS; i++)
+      {
+         (void)fprintf(out, ",\"%u\",\"%d\",\"%d\",\"%d\"", frame.setpoint[i], (frame.heaters_on >> i) & 1,
+                       (frame.heaters_enabled >> i) & 1, (frame.heaters_eco >> i) & 1);
+      }
+      (void)fprintf(out, "\n");
+   }
+
+   fprintf(stderr, "%zu frames converted\n", count);
+   if (count < header.num_frames)
+   {
+      fprintf(stderr, "The dump is cut short, %u frames were expected\n", header.num_frames);
+      return 2;
+   }
+
+   return 0;
+}
+
+
+int main(int argc, char *argv[])
+{
+   vector<uint8_t> data;
+   FILE *out = stdout;
+
+   if ((argc < 2) || (argc > 3))
+   {
+      printf("Usage logConvert <binaryLog> [<csvLog>]\n");
+      printf("      e.g. logConvert /mnt/SD/20260101Control.bin 20260101Control.csv\n");
+      printf("      or   logConvert /mnt/SD/log/HennyPenny/20260101_101500_E-5.frec E-5.csv\n");
+      exit(1);
+   }
+   if (!readFile(argv[1], &data))
+   {
+      fprintf(stderr, "Cannot read %s\n", argv[1]);
+      exit(1);
+   }
+   if ((data.size() >= sizeof(FLIGHT_FILE_HEADER)) && (0 == memcmp(&data[0], FLIGHT_FILE_MAGIC, 4)))
+   {
+      if (argc > 2)
+      {
+         out = fopen(argv[2], "w");
+         if (NULL == out)
+         {
+            fprintf(stderr, "Cannot create %s\n", argv[2]);
+            exit(1);
+         }
+      }
+      int status = convertFlightDump(data, out);
+      if (stdout != out)
+      {
+         (void)fclose(out);
+      }
+      return status;
+   }
+   if ((data.size() < EESLOG_DAY_HEADER_SIZE) || (0 != memcmp(&data[0], EESLOG_MAGIC, 4)))
+   {
+      fprintf(stderr, "%s is not a binary log\n", argv[1]);
+      exit(1);
+   }
+   if (EESLOG_SCHEMA_VERSION != eeslogGet16(&data[4]))
+   {
+      fprintf(stderr, "%s is version %u, this logConvert reads version %d\n", argv[1],
+              eeslogGet16(&data[4]), EESLOG_SCHEMA_VERSION);
+      exit(1);
+   }
+   if (argc > 2)
+   {
+      out = fopen(argv[2], "w");
+      if (NULL == out)
+      {
+         fprintf(stderr, "Cannot create %s\n", argv[2]);
+         exit(1);
+      }
+   }
+
+   // static, it is too big for the stack
+   static EESLOG_BLOCK block;
+   size_t pos = eeslogGet16(&data[6]);
+   int blocks = 0;
+   int badBlocks = 0;
+   bool resyncing = false;
+   while ((pos + EESLOG_BLOCK_HEADER_SIZE) <= data.size())
+   {
+      const uint8_t *header = &data[pos];
+      uint16_t length = eeslogGet16(&header[2]);
+      bool good = (EESLOG_BLOCK_MAGIC == eeslogGet16(header)) &&
+                  (length <= EESLOG_BLOCK_PAYLOAD_SIZE) &&
+                  ((pos + EESLOG_BLOCK_HEADER_SIZE + length) <= data.size()) &&
+                  (eeslogGet32(&header[16]) == eeslogCRC32(&header[EESLOG_BLOCK_HEADER_SIZE], length));
+      if (!good)
+      {
+         // A block cut short by a power loss, or a damaged one. Look for the next block.
+         if (!resyncing)
+         {
+            fprintf(stderr, "Bad block at offset %zu, skipping to the next one\n", pos);
+            badBlocks++;
+            resyncing = true;
+         }
+         pos++;
+         continue;
+      }
+      resyncing = false;
+
+      eeslogBlockReset(&block);
+      (void)memcpy(block.payload, &header[EESLOG_BLOCK_HEADER_SIZE], length);
+      block.length = length;
+      block.num_records = eeslogGet16(&header[4]);
+      block.is_dst = header[6];
+      block.base_seconds = eeslogGet32(&header[8]);
+      block.gmtoff_seconds = (int32_t)eeslogGet32(&header[12]);
+      if (!decodeBlock(&block, out))
+      {
+         fprintf(stderr, "Block at offset %zu does not decode, written up to the bad record\n", pos);
+         badBlocks++;
+      }
+      blocks++;
+      pos += EESLOG_BLOCK_HEADER_SIZE + length;
+   }
+   if (pos < data.size())
+   {
+      fprintf(stderr, "%zu bytes at the end of the file are not a whole block\n", data.size() - pos);
+   }
+
+   if (stdout != out)
+   {
+      (void)fclose(out);
+   }
+   fprintf(stderr, "%d blocks converted, %d bad\n", blocks, badBlocks);
+
+   return (0 == badBlocks) ? 0 : 2;
+}
@@ -0,0 +1,270 @@
+/******************************************************************************/
+/*                                                                            */
+/* FILE:        logWriteBench.cpp                                             */
+/*                                                                            */
+/* DESCRIPTION: Compares writing the HennyPenny Frontier UHC status log to    */
+/*              the SD card one open/append/close per record with keeping     */
+/*              the file open and flushing on a size/time policy              */
+/*                                                                            */
+/* AUTHOR(S):   USA Firmware, LLC                                             */
+/*                                                                            */
+/* This is an unpublished work subject to Trade Secret and Copyright          */
+/* protection by HennyPenny and USA Firmware, LLC                             */
+/*                                                                            */
+/* USA Firmware, LLC                                                          */
+/* 10060 Brecksville Road Brecksville, OH 44141                               */
+/*                                                                            */
+/******************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <algorithm>
+#include <vector>
+
+using namespace std;
+
+#define DEFAULT_RECORD_COUNT       1200     // an hour of status records, one every 3 seconds
+#define STATUS_RECORD_SIZE         480      // about the length of a status record
+#define WRITE_BUFFER_SIZE          8192     // LOG_WRITE_BUFFER_SIZE
+#define FLUSH_BYTES                4096     // LOG_FLUSH_BYTES
+#define PATH_SIZE                  1024
+
+enum write_mode_t
+{
+   OPEN_PER_RECORD,                    // what frontier_uhc used to do: fopen, fprintf, fflush, fclose
+   OPEN_PER_RECORD_SYNC,               // the same with an fdatasync, so every record is on the card
+   KEEP_OPEN                           // one fopen, records buffered and fdatasync'd every FLUSH_BYTES
+};
+
+struct BENCH_RESULT
+{
+   vector<double> recordMicroseconds;
+   uint32_t opens;
+   uint32_t flushes;
+   uint64_t sectorsWritten;            // from /sys/block/<device>/stat, 0 if no device given
+};
+
+
+/*******************************************************************************************/
+/*                                                                                         */
+/* double nowMicroseconds()                                                                */
+/*                                                                                         */
+/* Returns: double CLOCK_MONOTONIC in microseconds                                         */
+/*                                                                                         */
+/*******************************************************************************************/
+double nowMicroseconds()
+{
+   struct timespec ts;
+   (void)clock_gettime(CLOCK_MONOTONIC, &ts);
+   return ((double)ts.tv_sec * 1000000.0) + ((double)ts.tv_nsec / 1000.0);
+}
+
+
+/*******************************************************************************************/
+/*                                                                                         */
+/* uint64_t readSectorsWritten(const char *device)                                         */
+/*                                                                                         */
+/* Reads the count of sectors written to the block device (e.g. mmcblk0) since boot,       */
+/* after a sync so that anything still in the page cache is counted.                       */
+/*                                                                                         */
+/* Returns: uint64_t sectors written, 0 if there is no such device                         */
+/*                                                                                         */
+/*******************************************************************************************/
+uint64_t readSectorsWritten(const char *device)
+{
+   char path[PATH_SIZE];
+   unsigned long long fields[7];
+
+   if (NULL == device)
+   {
+      return 0;
+   }
+
+   sync();
+   (void)snprintf(path, sizeof(path), "/sys/block/%s/stat", device);
+   FILE *fp = fopen(path, "r");
+   if (NULL == fp)
+   {
+      return 0;
+   }
+
+   // reads completed, reads merged, sectors read, ms reading, writes completed, writes merged, sectors written
+   int n = fscanf(fp, "%llu %llu %llu %llu %llu %llu %llu", &fields[0], &fields[1], &fields[2], &fields[3],
+                  &fields[4], &fields[5], &fields[6]);
+   (void)fclose(fp);
+
+   return (7 == n) ? (uint64_t)fields[6] : 0;
+}
+
+
+/*******************************************************************************************/
+/*                                                                                         */
+/* void runBench(write_mode_t mode, const char *fileName, int count, const char *device,   */
+/*               BENCH_RESULT *result)                                                     */
+/*                                                                                         */
+/* Appends count status sized records to the file the given way, timing each record.       */
+/*                                                                                         */
+/* Returns: None                                                                           */
+/*                                                                                         */
+/*******************************************************************************************/
+void runBench(write_mode_t mode, const char *fileName, int count, const char *device, BENCH_RESULT *result)
+{
+   static char buffer[WRITE_BUFFER_SIZE];
+   char record[STATUS_RECORD_SIZE];
+   FILE *fp = NULL;
+   long flushedOffset = 0;
+
+   (void)memset(record, 'x', sizeof(record));
+   record[0] = '"';
+   record[sizeof(record) - 2] = '"';
+   record[sizeof(record) - 1] = 0;
+
+   (void)unlink(fileName);
+   result->recordMicroseconds.clear();
+   result->opens = 0;
+   result->flushes = 0;
+   uint64_t sectorsBefore = readSectorsWritten(device);
+
+   for (int i = 0; i < count; i++)
+   {
+      double start = nowMicroseconds();
+
+      if (KEEP_OPEN == mode)
+      {
+         if (NULL == fp)
+         {
+            fp = fopen(fileName, "a");
+            if (NULL == fp)
+            {
+               perror(fileName);
+               exit(1);
+            }
+            (void)setvbuf(fp, buffer, _IOFBF, sizeof(buffer));
+            result->opens++;
+         }
+
+         (void)fprintf(fp, "%s\n", record);
+         if ((ftell(fp) - flushedOffset) >= FLUSH_BYTES)
+         {
+            (void)fflush(fp);
+            (void)fdatasync(fileno(fp));
+            flushedOffset = ftell(fp);
+            result->flushes++;
+         }
+      }
+      else
+      {
+         fp = fopen(fileName, "a");
+         if (NULL == fp)
+         {
+            perror(fileName);
+            exit(1);
+         }
+         result->opens++;
+
+         (void)fprintf(fp, "%s\n", record);
+         (void)fflush(fp);
+         if (OPEN_PER_RECORD_SYNC == mode)
+         {
+            (void)fdatasync(fileno(fp));
+         }
+         result->flushes++;
+         (void)fclose(fp);
+         fp = NULL;
+      }
+
+      result->recordMicroseconds.push_back(nowMicroseconds() - start);
+   }
+
+   if (NULL != fp)
+   {
+      (void)fflush(fp);
+      (void)fdatasync(fileno(fp));
+      result->flushes++;
+      (void)fclose(fp);
+   }
+
+   uint64_t sectorsAfter = readSectorsWritten(device);
+   result->sectorsWritten = (sectorsAfter > sectorsBefore) ? (sectorsAfter - sectorsBefore) : 0;
+   (void)unlink(fileName);
+}
+
+
+/*******************************************************************************************/
+/*                                                                                         */
+/* void printResult(const char *name, BENCH_RESULT *result, int count, const char *device) */
+/*                                                                                         */
+/* Prints the per record latency percentiles, the opens and flushes, and the data the      */
+/* card was asked to write.                                                                */
+/*                                                                                         */
+/* Returns: None                                                                           */
+/*                                                                                         */
+/*******************************************************************************************/
+void printResult(const char *name, BENCH_RESULT *result, int count, const char *device)
+{
+   vector<double> &samples = result->recordMicroseconds;
+   sort(samples.begin(), samples.end());
+   size_t n = samples.size();
+   double total = 0.0;
+   for (size_t i = 0; i < n; i++)
+   {
+      total += samples[i];
+   }
+
+   printf("%-26s p50 %7.0f us  p99 %7.0f us  max %8.0f us  total %8.1f ms  opens %5u  flushes %5u",
+          name, samples[(n - 1) * 50 / 100], samples[(n - 1) * 99 / 100], samples[n - 1], total / 1000.0,
+          result->opens, result->flushes);
+   if (NULL != device)
+   {
+      printf("  card writes %7.1f KB (%5.2f KB/record)", (double)result->sectorsWritten / 2.0,
+             (double)result->sectorsWritten / 2.0 / (double)count);
+   }
+   printf("\n");
+}
+
+
+int main(int argc, char *argv[])
+{
+   char fileName[PATH_SIZE];
+   int count = DEFAULT_RECORD_COUNT;
+   const char *device = NULL;
+   BENCH_RESULT result;
+
+   if ((argc < 2) || (argc > 4))
+   {
+      printf("Usage logWriteBench <directory> [<records> [<blockDevice>]]\n");
+      printf("      e.g. logWriteBench /mnt/SD 1200 mmcblk0\n");
+      exit(1);
+   }
+   if (argc > 2)
+   {
+      count = atoi(argv[2]);
+   }
+   if (argc > 3)
+   {
+      device = argv[3];
+   }
+   if (count < 1)
+   {
+      printf("records must be at least 1\n");
+      exit(1);
+   }
+
+   (void)snprintf(fileName, sizeof(fileName), "%s/logWriteBench.csv", argv[1]);
+   printf("%d records of %d bytes to %s\n", count, STATUS_RECORD_SIZE, fileName);
+
+   runBench(OPEN_PER_RECORD, fileName, count, device, &result);
+   printResult("open per record", &result, count, device);
+
+   runBench(OPEN_PER_RECORD_SYNC, fileName, count, device, &result);
+   printResult("open per record + sync", &result, count, device);
+
+   runBench(KEEP_OPEN, fileName, count, device, &result);
+   printResult("keep open, flush 4 KB", &result, count, device);
+
+   return 0;
+}
@@ -0,0 +1,296 @@
+/******************************************************************************/
+/*                                                                            */
+/* FILE:        queueBench.cpp                                                */
+/*                                                                            */
+/* DESCRIPTION: Compares the SafeQueue and LockFreeQueue used by the          */
+/*              HennyPenny Frontier UHC logger under contention: put          */
+/*              latency, throughput, dropped events and high water mark       */
+/*                                                                            */
+/* AUTHOR(S):   USA Firmware, LLC                                             */
+/*                                                                            */
+/* This is an unpublished work subject to Trade Secret and Copyright          */
+/* protection by HennyPenny and USA Firmware, LLC                             */
+/*                                                                            */
+/* USA Firmware, LLC                                                          */
+/* 10060 Brecksville Road Brecksville, OH 44141                               */
+/*                                                                            */
+/******************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <vector>
+
+#include "safe_queue.h"
+#include "lockfree_queue.h"
+
+using namespace std;
+
+#define DEFAULT_NUM_PRODUCERS      3
+#define DEFAULT_EVENTS_PER_PRODUCER 20000
+#define MAX_PRODUCERS              16
+#define QUEUE_ELEMENTS             16
+#define PUT_TIMEOUT_MS             100
+#define GET_TIMEOUT_MS             1000
+#define SLOW_CONSUMER_US           200      // about what a log file write costs on the target
+#define PACED_PUT_US               20       // between the puts of a paced producer
+
+// the size of the logger's error_event_t
+struct bench_event_t
+{
+   int producer;
+   uint32_t sequence;
+   char payload[296];
+};
+
+template <typename Q> struct BENCH_RUN
+{
+   Q *queue;
+   int numProducers;
+   int eventsPerProducer;
+   bool timedPut;                      // put(elem, PUT_TIMEOUT_MS) like the logger, else put(elem)
+   bool paced;                         // sleep PACED_PUT_US between puts, so the queue rarely fills
+   bool slowConsumer;
+   atomic<int> producersRunning;
+   vector<double> putNanoseconds[MAX_PRODUCERS];
+   uint32_t failedPuts[MAX_PRODUCERS];
+   uint32_t received;
+   uint32_t outOfOrder;
+};
+
+
+/*******************************************************************************************/
+/*                                                                                         */
+/* uint64_t nowNanoseconds()                                                               */
+/*                                                                                         */
+/* Returns: uint64_t CLOCK_MONOTONIC in nanoseconds                                        */
+/*                                                                                         */
+/*******************************************************************************************/
+uint64_t nowNanoseconds()
+{
+   struct timespec ts;
+   (void)clock_gettime(CLOCK_MONOTONIC, &ts);
+   return ((uint64_t)ts.tv_sec * 1000000000ULL) + (uint64_t)ts.tv_nsec;
+}
+
+
+/*******************************************************************************************/
+/*                                                                                         */
+/* template <typename Q> void *producerThread(void *arg)                                   */
+/*                                                                                         */
+/* Puts eventsPerProducer events into the queue as fast as it can, timing each put.        */
+/*                                                                                         */
+/* Returns: NULL                                                                           */
+/*                                                                                         */
+/*******************************************************************************************/
+template <typename Q> struct PRODUCER_ARG
+{
+   BENCH_RUN<Q> *run;
+   int producer;
+};
+
+template <typename Q> void *producerThread(void *arg)
+{
+   PRODUCER_ARG<Q> *pa = (PRODUCER_ARG<Q> *)arg;
+   BENCH_RUN<Q> *run = pa->run;
+   bench_event_t ev;
+
+   (void)memset(&ev, 0, sizeof(ev));
+   ev.producer = pa->producer;
+   run->putNanoseconds[pa->producer].reserve(run->eventsPerProducer);
+
+   for (int i = 0; i < run->eventsPerProducer; i++)
+   {
+      ev.sequence = (uint32_t)i;
+      uint64_t start = nowNanoseconds();
+      int status = run->timedPut ? run->queue->put(ev, PUT_TIMEOUT_MS) : run->queue->put(ev);
+      run->putNanoseconds[pa->producer].push_back((double)(nowNanoseconds() - start));
+      if (status != 0)
+      {
+         run->failedPuts[pa->producer]++;
+      }
+      if (run->paced)
+      {
+         (void)usleep(PACED_PUT_US);
+      }
+   }
+
+   run->producersRunning--;
+   return NULL;
+}
+
+
+/*******************************************************************************************/
+/*                                                                                         */
+/* template <typename Q> void consume(BENCH_RUN<Q> *run)                                   */
+/*                                                                                         */
+/* Takes events off the queue until every producer has finished and the queue is empty,    */
+/* checking that each producer's events arrive in order.                                   */
+/*                                                                                         */
+/* Returns: None                                                                           */
+/*                                                                                         */
+/*******************************************************************************************/
+template <typename Q> void consume(BENCH_RUN<Q> *run)
+{
+   uint32_t nextSequence[MAX_PRODUCERS];
+   bench_event_t ev;
+
+   (void)memset(nextSequence, 0, sizeof(nextSequence));
+   for (;;)
+   {
+      int status = run->queue->get(ev, run->producersRunning.load() > 0 ? GET_TIMEOUT_MS : 0);
+      if (status != 0)
+      {
+         if (0 == run->producersRunning.load())
+         {
+            break;
+         }
+         continue;
+      }
+
+      run->received++;
+      if (ev.sequence < nextSequence[ev.producer])
+      {
+         run->outOfOrder++;
+      }
+      nextSequence[ev.producer] = ev.sequence + 1;
+
+      if (run->slowConsumer)
+      {
+         (void)usleep(SLOW_CONSUMER_US);
+      }
+   }
+}
+
+
+/*******************************************************************************************/
+/*                                                                                         */
+/* template <typename Q> void runBench(const char *name, Q *queue, int numProducers,       */
+/*                   int eventsPerProducer, bool timedPut, bool paced, bool slowConsumer)  */
+/*                                                                                         */
+/* Runs one producer/consumer test and prints the put latency percentiles, the events      */
+/* received and lost, and the elapsed time.                                                */
+/*                                                                                         */
+/* Returns: None                                                                           */
+/*                                                                                         */
+/*******************************************************************************************/
+template <typename Q> void runBench(const char *name, Q *queue, int numProducers, int eventsPerProducer, bool timedPut, bool paced, bool slowConsumer)
+{
+   BENCH_RUN<Q> *run = new BENCH_RUN<Q>();
+   PRODUCER_ARG<Q> args[MAX_PRODUCERS];
+   pthread_t threads[MAX_PRODUCERS];
+
+   run->queue = queue;
+   run->numProducers = numProducers;
+   run->eventsPerProducer = eventsPerProducer;
+   run->timedPut = timedPut;
+   run->paced = paced;
+   run->slowConsumer = slowConsumer;
+   run->producersRunning = numProducers;
+   (void)memset(run->failedPuts, 0, sizeof(run->failedPuts));
+   run->received = 0;
+   run->outOfOrder = 0;
+
+   uint64_t start = nowNanoseconds();
+   for (int i = 0; i < numProducers; i++)
+   {
+      args[i].run = run;
+      args[i].producer = i;
+      (void)pthread_create(&threads[i], NULL, producerThread<Q>, &args[i]);
+   }
+
+   consume(run);
+
+   for (int i = 0; i < numProducers; i++)
+   {
+      (void)pthread_join(threads[i], NULL);
+   }
+   double elapsedMs = (double)(nowNanoseconds() - start) / 1000000.0;
+
+   vector<double> samples;
+   uint32_t failed = 0;
+   for (int i = 0; i < numProducers; i++)
+   {
+      samples.insert(samples.end(), run->putNanoseconds[i].begin(), run->putNanoseconds[i].end());
+      failed += run->failedPuts[i];
+   }
+   sort(samples.begin(), samples.end());
+   size_t n = samples.size();
+
+   printf("%-36s put p50 %7.0f ns  p99 %8.0f ns  max %9.0f ns  received %6u lost %6u%s  %7.1f ms\n",
+          name, samples[(n - 1) * 50 / 100], samples[(n - 1) * 99 / 100], samples[n - 1],
+          run->received, failed, (run->outOfOrder != 0) ? " OUT OF ORDER" : "", elapsedMs);
+
+   delete run;
+}
+
+
+int main(int argc, char *argv[])
+{
+   int numProducers = DEFAULT_NUM_PRODUCERS;
+   int eventsPerProducer = DEFAULT_EVENTS_PER_PRODUCER;
+
+   if ((argc > 3) || ((argc > 1) && (0 == strcmp(argv[1], "-h"))))
+   {
+      printf("Usage queueBench [<producers> [<eventsPerProducer>]]\n");
+      exit(1);
+   }
+   if (argc > 1)
+   {
+      numProducers = atoi(argv[1]);
+   }
+   if (argc > 2)
+   {
+      eventsPerProducer = atoi(argv[2]);
+   }
+   if ((numProducers < 1) || (numProducers > MAX_PRODUCERS) || (eventsPerProducer < 1))
+   {
+      printf("producers must be 1 to %d and eventsPerProducer at least 1\n", MAX_PRODUCERS);
+      exit(1);
+   }
+
+   printf("%d producers, %d events each, %d element queues\n", numProducers, eventsPerProducer, QUEUE_ELEMENTS);
+
+   // the logger's normal case: the queue has room, so this is the cost of the put itself
+   int paced = min(eventsPerProducer, 5000);
+   {
+      SafeQueue<bench_event_t, QUEUE_ELEMENTS> sq;
+      runBench("SafeQueue      timed put, paced", &sq, numProducers, paced, true, true, false);
+   }
+   {
+      LockFreeQueue<bench_event_t, QUEUE_ELEMENTS> lq;
+      runBench("LockFreeQueue  timed put, paced", &lq, numProducers, paced, true, true, false);
+      printf("%-36s high water mark %u of %d\n", "", lq.high_water_mark(), lq.size());
+   }
+
+   // the queue is kept full, so most puts wait for the consumer
+   {
+      SafeQueue<bench_event_t, QUEUE_ELEMENTS> sq;
+      runBench("SafeQueue      timed put, flat out", &sq, numProducers, eventsPerProducer, true, false, false);
+   }
+   {
+      LockFreeQueue<bench_event_t, QUEUE_ELEMENTS> lq;
+      runBench("LockFreeQueue  timed put, flat out", &lq, numProducers, eventsPerProducer, true, false, false);
+   }
+
+   // a burst into a slow consumer, as when the logger is writing to the SD card
+   int burst = min(eventsPerProducer, 200);
+   {
+      SafeQueue<bench_event_t, QUEUE_ELEMENTS> sq;
+      runBench("SafeQueue      put, slow consumer", &sq, numProducers, burst, false, false, true);
+   }
+   {
+      LockFreeQueue<bench_event_t, QUEUE_ELEMENTS> lq;
+      runBench("LockFreeQueue  put, slow consumer", &lq, numProducers, burst, false, false, true);
+      printf("%-36s high water mark %u of %d, dropped %u\n", "", lq.high_water_mark(), lq.size(), lq.dropped());
+   }
+
+   return 0;
+}
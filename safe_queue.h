@@ -39,6 +39,7 @@
 #include <chrono>
 #include <mutex>
 #include <condition_variable>
+#include <utility>
 
 /*****************************************************   User   *******************************************************/
 
@@ -92,6 +93,66 @@ public:
       return retval;
    }
 
+   /**
+    * @brief Move an element into the queue with no timeout.
+    *
+    * If the queue is full, this method returns immediately with an error indication and elem is left as it was.
+    *
+    * @param[in] elem The element to move into the queue.
+    *
+    * @retval 0 The put completed successfully.
+    * @retval -ENOMEM The queue was full, the put failed.
+    */
+   int put(T &&elem)
+   {
+      int retval = 0;
+
+      {
+         std::lock_guard<std::mutex> lg(queue_mutex);
+         if (is_full())
+         {
+            retval = -ENOMEM;
+         }
+         else
+         {
+            enqueue(std::move(elem));
+            queue_cv.notify_all();
+         }
+      }
+
+      return retval;
+   }
+
+   /**
+    * @brief Construct an element in the queue from the given arguments, with no timeout.
+    *
+    * If the queue is full, this method returns immediately with an error indication.
+    *
+    * @param[in] args The arguments to T's constructor.
+    *
+    * @retval 0 The put completed successfully.
+    * @retval -ENOMEM The queue was full, the put failed.
+    */
+   template <typename... Args> int emplace(Args&&... args)
+   {
+      int retval = 0;
+
+      {
+         std::lock_guard<std::mutex> lg(queue_mutex);
+         if (is_full())
+         {
+            retval = -ENOMEM;
+         }
+         else
+         {
+            enqueue(T(std::forward<Args>(args)...));
+            queue_cv.notify_all();
+         }
+      }
+
+      return retval;
+   }
+
    /**
     * @brief Force an element to the front of the queue.
     *
@@ -196,6 +257,46 @@ public:
       return retval;
    }
 
+   /**
+    * @brief Move up to max elements out of the queue, oldest first, with deadline.
+    *
+    * Waits until there is at least one element or the deadline arrives, then moves out everything
+    * that is queued (up to max) under a single acquisition of the lock.
+    *
+    * @param[out] out Where the elements are moved to, e.g. a pointer into an array of at least max elements.
+    *
+    * @param[in] max The most elements to move out. Must be at least 1.
+    *
+    * @param[in] deadline The deadline for there to be an element in the queue.
+    *
+    * @return The number of elements moved out, at least 1.
+    * @retval -ETIMEDOUT The queue was empty and remained so until the deadline arrived, nothing was moved.
+    */
+   template <typename OutputIt> int drain(OutputIt out, int max, std::chrono::steady_clock::time_point deadline)
+   {
+      int retval = 0;
+
+      {
+         std::unique_lock<std::mutex> ul(queue_mutex);
+         bool has_elem = queue_cv.wait_until(ul, deadline, [&]{ return !is_empty(); });
+         if (!has_elem)
+         {
+            retval = -ETIMEDOUT;
+         }
+         else
+         {
+            while ((retval < max) && !is_empty())
+            {
+               *out++ = std::move(dequeue());
+               ++retval;
+            }
+            queue_cv.notify_all();
+         }
+      }
+
+      return retval;
+   }
+
    /**
     * @brief Get and remove the oldest element from the queue, with timeout.
     *
@@ -286,6 +387,32 @@ private:
       the_array[rear] = elem;
    }
 
+   /**
+    * @brief Move the given element into the queue.
+    *
+    * @param[in] elem The element to move into the queue.
+    *
+    * @note This method assumes the queue is not full. Invoking it when the queue is full will corrupt the queue.
+    */
+   void enqueue(T &&elem)
+   {
+      if (-1 == front)
+      {
+         front = 0;
+         rear = 0;
+      }
+      else if ((rear == (capacity - 1) && (0 != front)))
+      {
+         rear = 0;
+      }
+      else
+      {
+         ++rear;
+      }
+
+      the_array[rear] = std::move(elem);
+   }
+
    /**
     * @brief Remove and return the oldest element from the queue.
     *
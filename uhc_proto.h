@@ -41,15 +41,27 @@
 /*  commands from GUI2. ZeroMQ doesn't seem to support multiple transmitters using     */
 /*  the same port.                                                                     */
 /*                                                                                     */
+/*  Additional remote displays (GUI3, GUI4) publish on ports ending in their number    */
+/*  and the controller responds to their system commands on 5025 and 5026. GUI3 sends  */
+/*  its system commands on 5027, since 5023 is the GUI2 response port.                 */
+/*                                                                                     */
+/*  Any client can also send system commands to the controller's ZMQ_ROUTER on port    */
+/*  5029 from a ZMQ_DEALER (or ZMQ_REQ) and receive each response on the same socket.  */
+/*  A command resent with the same sender_ip_address and sequence_number gets the      */
+/*  original response back rather than being run a second time.                       */
+/*                                                                                     */
 /***************************************************************************************/
 
 
 #define CURRENT_SYSTEM_STATE_TOPIC					"CSS"
+#define CURRENT_SYSTEM_STATE_DELTA_TOPIC			"CSSD"
 #define CURRENT_SYSTEM_STATE_PORT_CONTROLLER		5000
 
 #define HEARTBEAT_TOPIC								"HB"
 #define HEARTBEAT_PORT_GUI1							5011
 #define HEARTBEAT_PORT_GUI2							5012
+#define HEARTBEAT_PORT_GUI3							5013
+#define HEARTBEAT_PORT_GUI4							5014
 
 #define SYSTEM_COMMAND_TOPIC						"CMD"
 #define SYSTEM_COMMAND_RESPONSE_TOPIC				"RSP"
@@ -57,10 +69,17 @@
 #define SYSTEM_COMMAND_PORT_GUI1					5021
 #define SYSTEM_COMMAND_PORT_GUI2					5022
 #define SYSTEM_COMMAND_RESPONSE_PORT_CONTROLLER2	5023
+#define SYSTEM_COMMAND_PORT_GUI3					5027
+#define SYSTEM_COMMAND_PORT_GUI4					5024
+#define SYSTEM_COMMAND_RESPONSE_PORT_CONTROLLER3	5025
+#define SYSTEM_COMMAND_RESPONSE_PORT_CONTROLLER4	5026
+#define SYSTEM_COMMAND_ROUTER_PORT_CONTROLLER		5029
 
 #define TIME_SYNC_TOPIC								"TIME"
 #define TIME_SYNC_PORT_GUI1							5031
 #define TIME_SYNC_PORT_GUI2							5032
+#define TIME_SYNC_PORT_GUI3							5033
+#define TIME_SYNC_PORT_GUI4							5034
 
 #define FIRMWARE_UPDATE_TOPIC						"FWUP"
 #define FIRMWARE_UPDATE_RESPONSE_TOPIC				"FWRS"
@@ -69,6 +88,11 @@
 
 #define RTD_DATA_PUBLISHER_TOPIC                "RTD"
 #define RTD_DATA_PUBLISHER_PORT                 5050
+#define RTD_STREAM_TOPIC                        "RTDS"
+#define RTD_STREAM_PORT                         5051
+
+#define ALARM_TOPIC                             "ALARM"
+#define ALARM_PORT_CONTROLLER                   5060
 
 #define SYNC_BACKEND_SUB_PORT                   5111
 #define SYNC_BACKEND_PUB_PORT                   5211